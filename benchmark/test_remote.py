@@ -0,0 +1,118 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""EnvPool remote benchmark script.
+
+Compare the async throughput of an in-process pool with the same pool behind
+``envpool.make_remote``. Without ``--address``, a server is started on the
+loopback in a subprocess, e.g.
+::
+
+  python3 test_remote.py --env atari --compress
+  python3 test_remote.py --env atari --address 10.0.0.2:5555
+"""
+
+import argparse
+import socket
+import subprocess
+import sys
+import time
+
+import numpy as np
+import tqdm
+
+import envpool
+
+
+def run(env, total_step: int, batch_size: int, seed: int) -> float:
+  env.async_reset()
+  env.action_space.seed(seed)
+  action = np.array([env.action_space.sample() for _ in range(batch_size)])
+  t = time.time()
+  for _ in tqdm.trange(total_step):
+    info = env.recv()[-1]
+    env.send(action, info["env_id"])
+  duration = time.time() - t
+  frame_skip = getattr(env.spec.config, "frame_skip", 1)
+  return total_step * batch_size / duration * frame_skip
+
+
+def free_port() -> int:
+  with socket.socket() as s:
+    s.bind(("127.0.0.1", 0))
+    return s.getsockname()[1]
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser()
+  parser.add_argument(
+    "--env",
+    type=str,
+    default="atari",
+    choices=["atari", "mujoco", "vizdoom", "box2d"],
+  )
+  parser.add_argument("--num-envs", type=int, default=64)
+  parser.add_argument("--batch-size", type=int, default=16)
+  # num_threads == 0 means to let envpool itself determine
+  parser.add_argument("--num-threads", type=int, default=0)
+  parser.add_argument("--total-step", type=int, default=5000)
+  parser.add_argument("--seed", type=int, default=0)
+  parser.add_argument("--address", type=str, default="")
+  parser.add_argument("--compress", action="store_true")
+  parser.add_argument("--pipeline", type=int, default=2)
+  args = parser.parse_args()
+  print(args)
+  task_id = {
+    "atari": "Pong-v5",
+    "mujoco": "Ant-v3",
+    "vizdoom": "HealthGathering-v1",
+    "box2d": "LunarLander-v2",
+  }[args.env]
+  kwargs = dict(
+    num_envs=args.num_envs,
+    batch_size=args.batch_size,
+    num_threads=args.num_threads,
+    seed=args.seed,
+  )
+  server = None
+  address = args.address
+  if not address:
+    port = free_port()
+    address = f"127.0.0.1:{port}"
+    server = subprocess.Popen(
+      [
+        sys.executable, "-m", "envpool.python.remote", "--host", "127.0.0.1",
+        "--port",
+        str(port)
+      ]
+    )
+    time.sleep(3)
+  try:
+    local_fps = run(
+      envpool.make_gym(task_id, **kwargs), args.total_step, args.batch_size,
+      args.seed
+    )
+    remote = envpool.make_remote(
+      task_id,
+      address,
+      compress=args.compress,
+      pipeline=args.pipeline,
+      **kwargs,
+    )
+    remote_fps = run(remote, args.total_step, args.batch_size, args.seed)
+    remote.close()
+  finally:
+    if server is not None:
+      server.terminate()
+  print(f"Local FPS = {local_fps:.2f}")
+  print(f"Remote FPS = {remote_fps:.2f} ({remote_fps / local_fps:.1%})")
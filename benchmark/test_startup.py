@@ -0,0 +1,63 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""EnvPool startup benchmark script.
+
+Measure the time of ``envpool.make`` (constructing all envs) and of the first
+reset, for one env family with a given number of envs, e.g.
+::
+
+  python3 test_startup.py --env mujoco --num-envs 1000
+"""
+
+import argparse
+import time
+
+import envpool
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser()
+  parser.add_argument(
+    "--env",
+    type=str,
+    default="atari",
+    choices=["atari", "mujoco", "dmc", "vizdoom", "box2d", "procgen"],
+  )
+  parser.add_argument("--num-envs", type=int, default=1000)
+  # num_threads == 0 means to let envpool itself determine
+  parser.add_argument("--num-threads", type=int, default=0)
+  parser.add_argument("--seed", type=int, default=0)
+  args = parser.parse_args()
+  print(args)
+  task_id = {
+    "atari": "Pong-v5",
+    "mujoco": "Ant-v3",
+    "dmc": "CheetahRun-v1",
+    "vizdoom": "HealthGathering-v1",
+    "box2d": "LunarLander-v2",
+    "procgen": "BigfishEasy-v0",
+  }[args.env]
+  t = time.time()
+  env = envpool.make_gym(
+    task_id,
+    num_envs=args.num_envs,
+    num_threads=args.num_threads,
+    seed=args.seed,
+  )
+  make_duration = time.time() - t
+  t = time.time()
+  env.reset()
+  reset_duration = time.time() - t
+  print(f"Make duration = {make_duration:.2f}s")
+  print(f"Reset duration = {reset_duration:.2f}s")
+  print(f"Per-env make = {make_duration / args.num_envs * 1000:.3f}ms")
@@ -15,11 +15,13 @@
 
 import envpool.entry  # noqa: F401
 from envpool.registration import (
+  connect_shm,
   list_all_envs,
   make,
   make_dm,
   make_gym,
   make_gymnasium,
+  make_remote,
   make_spec,
   register,
 )
@@ -32,5 +34,7 @@ __all__ = [
   "make_gym",
   "make_gymnasium",
   "make_spec",
+  "connect_shm",
+  "make_remote",
   "list_all_envs",
 ]
@@ -14,17 +14,38 @@
 # limitations under the License.
 """Atari env in EnvPool."""
 
+import numpy as np
+
 from envpool.python.api import py_env
+from envpool.python.protocol import EnvSpec
 
-from .atari_envpool import _AtariEnvPool, _AtariEnvSpec
+from .atari_envpool import _AtariEnvPool, _AtariEnvSpec, _palette
 
 AtariEnvSpec, AtariDMEnvPool, AtariGymEnvPool, AtariGymnasiumEnvPool = py_env(
   _AtariEnvSpec, _AtariEnvPool
 )
 
+
+def palette(spec: EnvSpec) -> np.ndarray:
+  """Colors of the palette indices returned with ``obs_type="screen"``.
+
+  :param spec: the spec of an Atari env, e.g. ``env.spec``.
+
+  :return: a uint8 lookup table, ``(256,)`` gray levels with ``gray_scale``,
+    ``(256, 3)`` RGB otherwise, so that ``palette(spec)[obs]`` is the colored
+    screen.
+  """
+  config = spec.config
+  table = np.asarray(
+    _palette(config.base_path, config.task, config.gray_scale), np.uint8
+  )
+  return table if config.gray_scale else table.reshape(256, 3)
+
+
 __all__ = [
   "AtariEnvSpec",
   "AtariDMEnvPool",
   "AtariGymEnvPool",
   "AtariGymnasiumEnvPool",
+  "palette",
 ]
@@ -18,16 +18,25 @@
 #define ENVPOOL_ATARI_ATARI_ENV_H_
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 #include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <random>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "ale_interface.hpp"
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/core/env_variant.h"
+#include "envpool/utils/area_resize.h"
+#include "envpool/utils/image_kernels.h"
 #include "envpool/utils/image_process.h"
 
 namespace atari {
@@ -39,6 +48,9 @@ auto TurnOffVerbosity() {
 
 static bool verbosity_off = TurnOffVerbosity();
 
+// bytes of the console RAM
+constexpr int kRamSize = 128;
+
 auto GetRomPath(const std::string& base_path, const std::string& task) {
   std::stringstream ss;
   // hardcode path here :(
@@ -46,6 +58,54 @@ auto GetRomPath(const std::string& base_path, const std::string& task) {
   return ss.str();
 }
 
+/**
+ * Number of actions of a rom. Spinning up an ALE only to count them is slow,
+ * so it is done once per rom per process.
+ */
+int GetActionSize(const std::string& rom_path, bool full_action_space) {
+  static std::mutex mutex;
+  static std::map<std::pair<std::string, bool>, int> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto key = std::make_pair(rom_path, full_action_space);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    ale::ALEInterface env;
+    env.loadROM(rom_path);
+    int action_size = full_action_space ? env.getLegalActionSet().size()
+                                        : env.getMinimalActionSet().size();
+    it = cache.emplace(key, action_size).first;
+  }
+  return it->second;
+}
+
+/**
+ * Colors of the ALE palette indices of a rom, as 256 gray levels or 256 RGB
+ * triplets, computed once per process like the action size.
+ */
+std::vector<uint8_t> GetPalette(const std::string& rom_path, bool gray_scale) {
+  static std::mutex mutex;
+  static std::map<std::pair<std::string, bool>, std::vector<uint8_t>> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto key = std::make_pair(rom_path, gray_scale);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    ale::ALEInterface env;
+    env.loadROM(rom_path);
+    std::vector<uint8_t> index(256);
+    std::iota(index.begin(), index.end(), 0);
+    std::vector<uint8_t> palette(index.size() * (gray_scale ? 1 : 3));
+    if (gray_scale) {
+      env.theOSystem->colourPalette().applyPaletteGrayscale(
+          palette.data(), index.data(), index.size());
+    } else {
+      env.theOSystem->colourPalette().applyPaletteRGB(
+          palette.data(), index.data(), index.size());
+    }
+    it = cache.emplace(key, std::move(palette)).first;
+  }
+  return it->second;
+}
+
 class AtariEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
@@ -56,25 +116,30 @@ class AtariEnvFns {
         "img_height"_.Bind(84), "img_width"_.Bind(84),
         "task"_.Bind(std::string("pong")), "full_action_space"_.Bind(false),
         "repeat_action_probability"_.Bind(0.0f),
-        "use_inter_area_resize"_.Bind(true), "gray_scale"_.Bind(true));
+        "use_inter_area_resize"_.Bind(true), "gray_scale"_.Bind(true),
+        "frame_dedup"_.Bind(false), "obs_type"_.Bind(std::string("pixel")));
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs"_.Bind(Spec<uint8_t>(
-                        {conf["stack_num"_] * (conf["gray_scale"_] ? 1 : 3),
-                         conf["img_height"_], conf["img_width"_]},
-                        {0, 255})),
+    int num_frames = conf["frame_dedup"_] ? 1 : conf["stack_num"_];
+    std::vector<int> obs_shape{num_frames * (conf["gray_scale"_] ? 1 : 3),
+                               conf["img_height"_], conf["img_width"_]};
+    if (conf["obs_type"_] == "ram") {
+      obs_shape = {num_frames, kRamSize};
+    } else if (conf["obs_type"_] == "screen") {
+      obs_shape = {2, 210, 160};
+    }
+    return MakeDict("obs"_.Bind(Spec<uint8_t>(obs_shape, {0, 255})),
+                    "info:frame_index"_.Bind(Spec<int>({-1})),
                     "info:lives"_.Bind(Spec<int>({-1})),
                     "info:reward"_.Bind(Spec<float>({-1})),
                     "info:terminated"_.Bind(Spec<int>({-1}, {0, 1})));
   }
   template <typename Config>
   static decltype(auto) ActionSpec(const Config& conf) {
-    ale::ALEInterface env;
-    env.loadROM(GetRomPath(conf["base_path"_], conf["task"_]));
-    int action_size = conf["full_action_space"_]
-                          ? env.getLegalActionSet().size()
-                          : env.getMinimalActionSet().size();
+    int action_size =
+        GetActionSize(GetRomPath(conf["base_path"_], conf["task"_]),
+                      conf["full_action_space"_]);
     return MakeDict("action"_.Bind(Spec<int>({-1}, {0, action_size - 1})));
   }
 };
@@ -91,11 +156,24 @@ class AtariEnv : public Env<AtariEnvSpec> {
   ale::ActionVect action_set_;
   int max_episode_steps_, elapsed_step_, stack_num_, frame_skip_;
   bool fire_reset_{false}, reward_clip_, zero_discount_on_life_loss_;
-  bool gray_scale_, episodic_life_, use_inter_area_resize_;
+  bool gray_scale_, episodic_life_, use_inter_area_resize_, frame_dedup_;
+  // obs_type="ram": the frames are the console RAM, the screen is never read
+  bool ram_;
+  // obs_type="screen": the last two ALE screens as they are, no stack
+  bool screen_;
   bool done_{true};
+  // frames pushed to stack_buf_ since it was last filled by a reset
+  int frame_index_{0};
   int lives_;
   FrameSpec raw_spec_, resize_spec_, transpose_spec_;
   std::deque<Array> stack_buf_;
+  // ALE screens (palette indices) of the last two frames of a step
+  std::vector<Array> screen_buf_;
+  // gray or RGB color of each palette index
+  std::vector<uint8_t> palette_;
+  // fused palette, max-pool and resize, nullptr when cv::resize would not
+  // take its general INTER_AREA path
+  std::unique_ptr<AreaResizer> resizer_;
   std::vector<Array> maxpool_buf_;
   Array resize_img_;
   std::uniform_int_distribution<> dist_noop_;
@@ -114,6 +192,9 @@ class AtariEnv : public Env<AtariEnvSpec> {
         gray_scale_(spec.config["gray_scale"_]),
         episodic_life_(spec.config["episodic_life"_]),
         use_inter_area_resize_(spec.config["use_inter_area_resize"_]),
+        frame_dedup_(spec.config["frame_dedup"_]),
+        ram_(spec.config["obs_type"_] == "ram"),
+        screen_(spec.config["obs_type"_] == "screen"),
         raw_spec_({kRawHeight, kRawWidth, gray_scale_ ? 1 : 3}),
         resize_spec_({spec.config["img_height"_], spec.config["img_width"_],
                       gray_scale_ ? 1 : 3}),
@@ -139,10 +220,36 @@ class AtariEnv : public Env<AtariEnvSpec> {
         }
       }
     }
+    if (ram_) {
+      for (int i = 0; i < stack_num_; ++i) {
+        stack_buf_.emplace_back(Array(FrameSpec({1, kRamSize})));
+      }
+      return;
+    }
+    if (spec.config["obs_type"_] != "pixel" && !screen_) {
+      throw std::invalid_argument(
+          "Atari: unknown obs_type " + spec.config["obs_type"_] +
+          ", should be \"pixel\", \"ram\" or \"screen\"");
+    }
     // init buf
+    for (int i = 0; i < 2; ++i) {
+      screen_buf_.emplace_back(Array(FrameSpec({kRawHeight, kRawWidth, 1})));
+    }
+    if (screen_) {
+      return;
+    }
     for (int i = 0; i < 2; ++i) {
       maxpool_buf_.emplace_back(Array(raw_spec_));
     }
+    palette_ = GetPalette(rom_path_, gray_scale_);
+    if (use_inter_area_resize_ &&
+        AreaResizer::Supports(kRawHeight, kRawWidth,
+                              spec.config["img_height"_],
+                              spec.config["img_width"_])) {
+      resizer_ = std::make_unique<AreaResizer>(kRawHeight, kRawWidth,
+                                               spec.config["img_height"_],
+                                               spec.config["img_width"_]);
+    }
     for (int i = 0; i < stack_num_; ++i) {
       stack_buf_.emplace_back(Array(transpose_spec_));
     }
@@ -167,19 +274,19 @@ class AtariEnv : public Env<AtariEnvSpec> {
     if (fire_reset_) {
       env_->act(static_cast<ale::Action>(1));
     }
-    uint8_t* ale_screen_data = env_->getScreen().getArray();
-    auto* ptr = static_cast<uint8_t*>(maxpool_buf_[0].Data());
-    if (gray_scale_) {
-      env_->theOSystem->colourPalette().applyPaletteGrayscale(
-          ptr, ale_screen_data, kRawSize);
-    } else {
-      env_->theOSystem->colourPalette().applyPaletteRGB(ptr, ale_screen_data,
-                                                        kRawSize);
-    }
-    PushStack(push_all, false);
     done_ = false;
     lives_ = env_->lives();
-    WriteState(0.0, 1.0, 0.0);
+    State state = WriteState(0.0, 1.0, 0.0);
+    if (ram_ || screen_) {
+      PushFrame(push_all, false);
+      EmitObs(&state);
+      return;
+    }
+    std::memcpy(screen_buf_[0].Data(), env_->getScreen().getArray(), kRawSize);
+    Defer([this, state, push_all]() mutable {
+      PushFrame(push_all, false);
+      EmitObs(&state);
+    });
   }
 
   void Step(const Action& action) override {
@@ -190,20 +297,13 @@ class AtariEnv : public Env<AtariEnvSpec> {
     for (; skip_id > 0 && !done_; --skip_id) {
       reward += env_->act(action_set_[act]);
       done_ = env_->game_over();
-      if (skip_id <= 2) {  // put final two frames in to maxpool buffer
-        uint8_t* ale_screen_data = env_->getScreen().getArray();
-        auto* ptr = static_cast<uint8_t*>(maxpool_buf_[2 - skip_id].Data());
-        if (gray_scale_) {
-          env_->theOSystem->colourPalette().applyPaletteGrayscale(
-              ptr, ale_screen_data, kRawSize);
-        } else {
-          env_->theOSystem->colourPalette().applyPaletteRGB(
-              ptr, ale_screen_data, kRawSize);
-        }
+      // put final two frames in to maxpool buffer
+      if (skip_id <= 2 && !ram_) {
+        std::memcpy(screen_buf_[2 - skip_id].Data(),
+                    env_->getScreen().getArray(), kRawSize);
       }
     }
-    // push the maxpool outcome to the stack_buf
-    PushStack(false, skip_id == 0);
+    bool maxpool = skip_id == 0;
     ++elapsed_step_;
     done_ |= (elapsed_step_ >= max_episode_steps_);
     if (episodic_life_ && 0 < env_->lives() && env_->lives() < lives_) {
@@ -224,13 +324,64 @@ class AtariEnv : public Env<AtariEnvSpec> {
       }
     }
     lives_ = env_->lives();
-    WriteState(reward, discount, info_reward);
+    State state = WriteState(reward, discount, info_reward);
+    if (ram_ || screen_) {
+      PushFrame(false, maxpool);
+      EmitObs(&state);
+      return;
+    }
+    // push the maxpool outcome to the stack_buf
+    Defer([this, state, maxpool]() mutable {
+      PushFrame(false, maxpool);
+      EmitObs(&state);
+    });
   }
 
   bool IsDone() override { return done_; }
 
- private:
-  void WriteState(float reward, float discount, float info_reward) {
+  /**
+   * Construct a config-specialized `AtariEnvVariant` when the config is in
+   * the dispatch table, or a generic `AtariEnv` otherwise.
+   */
+  static std::unique_ptr<AtariEnv> Create(const Spec& spec, int env_id);
+
+  void SaveState(StateWriter* writer) override {
+    // system state includes the emulator rng used by sticky actions
+    writer->WriteString(env_->cloneSystemState().serialize());
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(lives_);
+    writer->Write(frame_index_);
+    for (const auto& buf : screen_buf_) {
+      writer->WriteArray(buf);
+    }
+    for (const auto& buf : stack_buf_) {
+      writer->WriteArray(buf);
+    }
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    State state = WriteState(0.0, 1.0, 0.0);
+    EmitObs(&state);
+  }
+
+  void Restore(StateReader* reader) override {
+    env_->restoreSystemState(ale::ALEState(reader->ReadString()));
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&lives_);
+    reader->Read(&frame_index_);
+    for (auto& buf : screen_buf_) {
+      reader->ReadArray(buf);
+    }
+    for (auto& buf : stack_buf_) {
+      reader->ReadArray(buf);
+    }
+  }
+
+ protected:
+  State WriteState(float reward, float discount, float info_reward) {
     State state = Allocate();
     state["discount"_] = discount;
     state["trunc"_] = done_ && (elapsed_step_ >= max_episode_steps_);
@@ -242,17 +393,98 @@ class AtariEnv : public Env<AtariEnvSpec> {
     // episodic_life == True behaves correctly
     // see Issue #179
     state["elapsed_step"_] = elapsed_step_;
+    return state;
+  }
+
+  void PushFrame(bool push_all, bool maxpool) {
+    PushStack(push_all, maxpool);
+    frame_index_ = push_all ? 0 : frame_index_ + 1;
+  }
+
+  /**
+   * With frame_dedup, obs is only the newest frame, and info:frame_index
+   * tells where it goes in the stack, see `envpool.python.frame_stack`. The
+   * index is part of the saved state, so it carries on from the restored
+   * one; the older frames of the stack are only on the Python side.
+   */
+  void EmitObs(State* state) {
+    (*state)["info:frame_index"_] = frame_index_;
+    if (frame_dedup_ && !screen_) {
+      (*state)["obs"_].Assign(stack_buf_.back());
+    } else {
+      WriteObs(state);
+    }
+  }
+
+  virtual void WriteObs(State* state) {
+    if (screen_) {
+      auto* obs = static_cast<uint8_t*>((*state)["obs"_].Data());
+      std::memcpy(obs, screen_buf_[0].Data(), kRawSize);
+      std::memcpy(obs + kRawSize, screen_buf_[1].Data(), kRawSize);
+      return;
+    }
+    int channel = gray_scale_ || ram_ ? 1 : 3;
     for (int i = 0; i < stack_num_; ++i) {
-      state["obs"_]
-          .Slice(gray_scale_ ? i : i * 3, gray_scale_ ? i + 1 : (i + 1) * 3)
+      (*state)["obs"_]
+          .Slice(i * channel, (i + 1) * channel)
           .Assign(stack_buf_[i]);
     }
   }
 
+  /**
+   * Color screen i into maxpool_buf_[i] with palette_. This runs on the
+   * preprocess threads too, which must not touch env_ while it steps.
+   */
+  void ApplyPalette(int i) {
+    const auto* src = static_cast<const uint8_t*>(screen_buf_[i].Data());
+    auto* dst = static_cast<uint8_t*>(maxpool_buf_[i].Data());
+    const uint8_t* palette = palette_.data();
+    if (gray_scale_) {
+      for (int p = 0; p < kRawSize; ++p) {
+        dst[p] = palette[src[p]];
+      }
+    } else {
+      for (int p = 0; p < kRawSize; ++p) {
+        std::memcpy(dst + p * 3, palette + src[p] * 3, 3);
+      }
+    }
+  }
+
+  /**
+   * Palette, max-pool, INTER_AREA resize and transpose to (C, H, W) in one
+   * pass over the screens, bit-exact with doing them one by one.
+   */
+  void FusedFrame(bool maxpool, uint8_t* dst) {
+    const auto* screen0 = static_cast<const uint8_t*>(screen_buf_[0].Data());
+    const auto* screen1 = static_cast<const uint8_t*>(screen_buf_[1].Data());
+    const uint8_t* palette = palette_.data();
+    int channel = gray_scale_ ? 1 : 3;
+    resizer_->Resize(
+        channel,
+        [&](int y, float* row) {
+          const uint8_t* s0 = screen0 + y * kRawWidth;
+          const uint8_t* s1 = screen1 + y * kRawWidth;
+          for (int c = 0; c < channel; ++c) {
+            float* out = row + c * kRawWidth;
+            if (maxpool) {
+              for (int x = 0; x < kRawWidth; ++x) {
+                out[x] = std::max(palette[s0[x] * channel + c],
+                                  palette[s1[x] * channel + c]);
+              }
+            } else {
+              for (int x = 0; x < kRawWidth; ++x) {
+                out[x] = palette[s0[x] * channel + c];
+              }
+            }
+          }
+        },
+        dst);
+  }
+
   /**
    * FrameStack env wrapper implementation.
    *
-   * The original gray scale image are saved inside maxpool_buf_.
+   * The ALE screens of the last two frames are saved inside screen_buf_.
    * The stacked result is in stack_buf_ where len(stack_buf_) == stack_num_.
    *
    * At reset time, we need to clear all data in stack_buf_ with push_all =
@@ -266,33 +498,26 @@ class AtariEnv : public Env<AtariEnvSpec> {
    * @param maxpool whether to perform maxpool operation on the last two
    *   observation. Maybe there is only one?
    */
-  void PushStack(bool push_all, bool maxpool) {
-    auto* ptr = static_cast<uint8_t*>(maxpool_buf_[0].Data());
-    if (maxpool) {
-      auto* ptr1 = static_cast<uint8_t*>(maxpool_buf_[1].Data());
-      for (std::size_t i = 0; i < maxpool_buf_[0].size; ++i) {
-        ptr[i] = std::max(ptr[i], ptr1[i]);
+  virtual void PushStack(bool push_all, bool maxpool) {
+    if (screen_) {
+      // the last screen is in screen_buf_[1] only after a full frame skip,
+      // otherwise take the current one, which is also its max-pool partner
+      if (!maxpool) {
+        std::memcpy(screen_buf_[1].Data(), env_->getScreen().getArray(),
+                    kRawSize);
+        std::memcpy(screen_buf_[0].Data(), screen_buf_[1].Data(), kRawSize);
       }
+      return;
     }
-    Resize(maxpool_buf_[0], &resize_img_, use_inter_area_resize_);
     Array tgt = std::move(*stack_buf_.begin());
-    ptr = static_cast<uint8_t*>(tgt.Data());
+    auto* ptr = static_cast<uint8_t*>(tgt.Data());
     stack_buf_.pop_front();
-    if (gray_scale_) {
-      tgt.Assign(resize_img_);
+    if (ram_) {
+      std::memcpy(ptr, env_->getRAM().array(), kRamSize);
+    } else if (resizer_ != nullptr) {
+      FusedFrame(maxpool, ptr);
     } else {
-      auto* ptr1 = static_cast<uint8_t*>(resize_img_.Data());
-      // tgt = resize_img_.transpose(1, 2, 0)
-      // tgt[i, j, k] = resize_img_[j, k, i]
-      std::size_t h = resize_img_.Shape(0);
-      std::size_t w = resize_img_.Shape(1);
-      for (std::size_t j = 0; j < h; ++j) {
-        for (std::size_t k = 0; k < w; ++k) {
-          for (std::size_t i = 0; i < 3; ++i) {
-            ptr[i * h * w + j * w + k] = ptr1[j * w * 3 + k * 3 + i];
-          }
-        }
-      }
+      PoolAndResize(maxpool, ptr);
     }
     std::size_t size = tgt.size;
     stack_buf_.push_back(std::move(tgt));
@@ -305,8 +530,113 @@ class AtariEnv : public Env<AtariEnvSpec> {
       }
     }
   }
+
+  /**
+   * Unfused fallback of FusedFrame, for any size and resize method.
+   */
+  virtual void PoolAndResize(bool maxpool, uint8_t* dst) {
+    ApplyPalette(0);
+    auto* ptr = static_cast<uint8_t*>(maxpool_buf_[0].Data());
+    if (maxpool) {
+      ApplyPalette(1);
+      image_kernels::MaxPool(
+          ptr, static_cast<const uint8_t*>(maxpool_buf_[1].Data()),
+          maxpool_buf_[0].size);
+    }
+    Resize(maxpool_buf_[0], &resize_img_, use_inter_area_resize_);
+    if (gray_scale_) {
+      std::memcpy(dst, resize_img_.Data(), resize_img_.size);
+    } else {
+      // tgt = resize_img_.transpose(2, 0, 1)
+      image_kernels::HwcToChw(static_cast<const uint8_t*>(resize_img_.Data()),
+                              resize_img_.Shape(0) * resize_img_.Shape(1), 3,
+                              dst);
+    }
+  }
+};
+
+/**
+ * AtariEnv with gray_scale, stack_num and the output size fixed at compile
+ * time, so that the frame copies and stacking loops have constant trip
+ * counts. The gray scale variant also
+ * resizes straight into the frame stack instead of going through
+ * resize_img_. The result is bit-identical to the generic path.
+ */
+template <bool kGrayScale, int kStackNum, int kHeight, int kWidth>
+class AtariEnvVariant : public AtariEnv {
+ protected:
+  static constexpr std::size_t kChannel = kGrayScale ? 1 : 3;
+  static constexpr std::size_t kRawFrameSize = 210 * 160 * kChannel;
+  static constexpr std::size_t kFrameSize = kHeight * kWidth * kChannel;
+
+ public:
+  AtariEnvVariant(const Spec& spec, int env_id) : AtariEnv(spec, env_id) {}
+
+ protected:
+  void WriteObs(State* state) override {
+    auto* obs = static_cast<uint8_t*>((*state)["obs"_].Data());
+    for (int i = 0; i < kStackNum; ++i) {
+      std::memcpy(obs + i * kFrameSize, stack_buf_[i].Data(), kFrameSize);
+    }
+  }
+
+  void PushStack(bool push_all, bool maxpool) override {
+    Array tgt = std::move(stack_buf_.front());
+    stack_buf_.pop_front();
+    auto* dst = static_cast<uint8_t*>(tgt.Data());
+    if (resizer_ != nullptr) {
+      FusedFrame(maxpool, dst);
+    } else {
+      PoolAndResize(maxpool, dst);
+    }
+    stack_buf_.push_back(std::move(tgt));
+    if (push_all) {
+      for (int i = 0; i < kStackNum - 1; ++i) {
+        std::memcpy(stack_buf_[i].Data(), dst, kFrameSize);
+      }
+    }
+  }
+
+  void PoolAndResize(bool maxpool, uint8_t* dst) override {
+    ApplyPalette(0);
+    auto* ptr = static_cast<uint8_t*>(maxpool_buf_[0].Data());
+    if (maxpool) {
+      ApplyPalette(1);
+      image_kernels::MaxPool(
+          ptr, static_cast<const uint8_t*>(maxpool_buf_[1].Data()),
+          kRawFrameSize);
+    }
+    if constexpr (kGrayScale) {
+      // (1, h, w) and (h, w, 1) share the same memory layout
+      Array view(resize_spec_, reinterpret_cast<char*>(dst));
+      Resize(maxpool_buf_[0], &view, use_inter_area_resize_);
+    } else {
+      Resize(maxpool_buf_[0], &resize_img_, use_inter_area_resize_);
+      image_kernels::HwcToChw(static_cast<const uint8_t*>(resize_img_.Data()),
+                              kHeight * kWidth, 3, dst);
+    }
+  }
 };
 
+inline std::unique_ptr<AtariEnv> AtariEnv::Create(const Spec& spec,
+                                                  int env_id) {
+  using Key = std::tuple<bool, int, int, int>;
+  static const std::array<EnvVariant<AtariEnv, Key>, 4> kVariants{{
+      {{true, 4, 84, 84}, CreateEnvVariant<AtariEnvVariant<true, 4, 84, 84>>},
+      {{true, 1, 84, 84}, CreateEnvVariant<AtariEnvVariant<true, 1, 84, 84>>},
+      {{false, 4, 84, 84},
+       CreateEnvVariant<AtariEnvVariant<false, 4, 84, 84>>},
+      {{false, 1, 84, 84},
+       CreateEnvVariant<AtariEnvVariant<false, 1, 84, 84>>},
+  }};
+  if (spec.config["obs_type"_] != "pixel") {
+    return std::make_unique<AtariEnv>(spec, env_id);
+  }
+  Key key{spec.config["gray_scale"_], spec.config["stack_num"_],
+          spec.config["img_height"_], spec.config["img_width"_]};
+  return DispatchEnvVariant(kVariants, key, spec, env_id);
+}
+
 using AtariEnvPool = AsyncEnvPool<AtariEnv>;
 
 }  // namespace atari
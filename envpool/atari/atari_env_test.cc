@@ -17,7 +17,12 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include <random>
+#include <string>
+#include <vector>
 
 using AtariState = atari::AtariEnv::State;
 using AtariAction = atari::AtariEnv::Action;
@@ -135,6 +140,80 @@ TEST(AtariEnvTest, Seed) {
   }
 }
 
+TEST(AtariEnvTest, Pipeline) {
+  auto config = atari::AtariEnvSpec::kDefaultConfig;
+  int num_envs = 8;
+  int batch = 4;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 3;
+  atari::AtariEnvPool envpool0((atari::AtariEnvSpec(config)));
+  config["num_preprocess_threads"_] = 2;
+  atari::AtariEnvPool envpool1((atari::AtariEnvSpec(config)));
+  config["batch_size"_] = batch;
+  atari::AtariEnvPool envpool2((atari::AtariEnvSpec(config)));
+  TArray all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool0.Reset(all_env_ids);
+  envpool1.Reset(all_env_ids);
+  envpool2.Reset(all_env_ids);
+  std::size_t obs_size = 4 * 84 * 84;
+  // async results are gathered per env and compared with the sync ones
+  std::vector<std::vector<uint8_t>> async_obs(num_envs);
+  std::vector<std::size_t> async_pos(num_envs);
+  AtariAction action;
+  for (int i = 0; i < 500; ++i) {
+    AtariState state0(envpool0.Recv());
+    AtariState state1(envpool1.Recv());
+    auto* data0 = static_cast<uint8_t*>(state0["obs"_].Data());
+    auto* data1 = static_cast<uint8_t*>(state1["obs"_].Data());
+    for (int j = 0; j < num_envs; ++j) {
+      EXPECT_EQ(static_cast<int>(state1["info:env_id"_][j]), j);
+      EXPECT_EQ(static_cast<float>(state0["reward"_][j]),
+                static_cast<float>(state1["reward"_][j]));
+    }
+    EXPECT_EQ(std::memcmp(data0, data1, num_envs * obs_size), 0) << i;
+    for (int j = 0; j < num_envs; ++j) {
+      async_obs[j].insert(async_obs[j].end(), data0 + j * obs_size,
+                          data0 + (j + 1) * obs_size);
+    }
+    action["env_id"_] = all_env_ids;
+    action["players.env_id"_] = all_env_ids;
+    action["action"_] = TArray(Spec<int>({num_envs}));
+    for (int j = 0; j < num_envs; ++j) {
+      action["action"_][j] = (i + j) % 6;
+    }
+    envpool0.Send(action);
+    envpool1.Send(action);
+  }
+  // same action sequence in async mode, action (t + env_id) % 6 at step t
+  for (int i = 0; i < 500 * num_envs / batch; ++i) {
+    AtariState state(envpool2.Recv());
+    auto* data = static_cast<uint8_t*>(state["obs"_].Data());
+    TArray env_ids(Spec<int>({batch}));
+    TArray actions(Spec<int>({batch}));
+    for (int j = 0; j < batch; ++j) {
+      int env_id = state["info:env_id"_][j];
+      std::size_t t = async_pos[env_id]++;
+      if ((t + 1) * obs_size <= async_obs[env_id].size()) {
+        EXPECT_EQ(std::memcmp(data + j * obs_size,
+                              async_obs[env_id].data() + t * obs_size,
+                              obs_size),
+                  0);
+      }
+      env_ids[j] = env_id;
+      actions[j] = static_cast<int>((t + env_id) % 6);
+    }
+    action["env_id"_] = env_ids;
+    action["players.env_id"_] = env_ids;
+    action["action"_] = actions;
+    envpool2.Send(action);
+  }
+}
+
 TEST(AtariEnvTest, MaxEpisodeSteps) {
   auto config = atari::AtariEnvSpec::kDefaultConfig;
   int batch = 4;
@@ -324,7 +403,108 @@ TEST(AtariEnvTest, ZeroDiscountOnLifeLoss) {
   }
 }
 
-TEST(AtariEnvSpeedTest, Benchmark) {
+/**
+ * Step a generic AtariEnv and the variant picked by AtariEnv::Create side by
+ * side with the same actions, check that the observations are identical and
+ * report the time spent in each.
+ */
+void CompareVariant(bool gray_scale, int stack_num, int total_iter) {
+  auto config = atari::AtariEnvSpec::kDefaultConfig;
+  config["num_envs"_] = 1;
+  config["batch_size"_] = 1;
+  config["gray_scale"_] = gray_scale;
+  config["stack_num"_] = stack_num;
+  atari::AtariEnvSpec spec(config);
+  auto specs = spec.state_spec.AllValues<ShapeSpec>();
+  std::vector<std::unique_ptr<atari::AtariEnv>> envs;
+  envs.emplace_back(new atari::AtariEnv(spec, 0));
+  envs.emplace_back(atari::AtariEnv::Create(spec, 0));
+  using PongVariant = atari::AtariEnvVariant<true, 4, 84, 84>;
+  EXPECT_EQ(dynamic_cast<PongVariant*>(envs[1].get()) != nullptr,
+            gray_scale && stack_num == 4);
+  std::vector<std::unique_ptr<StateBufferQueue>> sbqs;
+  std::vector<std::chrono::duration<double>> durs(2);
+  for (int k = 0; k < 2; ++k) {
+    sbqs.emplace_back(new StateBufferQueue(1, 1, 1, specs));
+  }
+  AtariAction action;
+  action["env_id"_] = TArray(Spec<int>({1}));
+  action["players.env_id"_] = TArray(Spec<int>({1}));
+  action["action"_] = TArray(Spec<int>({1}));
+  action["env_id"_][0] = 0;
+  action["players.env_id"_][0] = 0;
+  std::size_t obs_size = stack_num * (gray_scale ? 1 : 3) * 84 * 84;
+  for (int i = 0; i < total_iter; ++i) {
+    action["action"_][0] = i % 6;
+    auto batch = std::make_shared<std::vector<Array>>(
+        action.template AllValues<Array>());
+    std::vector<AtariState> states;
+    for (int k = 0; k < 2; ++k) {
+      auto start = std::chrono::system_clock::now();
+      envs[k]->SetAction(batch, 0);
+      envs[k]->EnvStep(sbqs[k].get(), 0, i == 0 || envs[k]->IsDone());
+      states.emplace_back(sbqs[k]->Wait());
+      durs[k] += std::chrono::system_clock::now() - start;
+    }
+    ASSERT_EQ(std::memcmp(states[0]["obs"_].Data(), states[1]["obs"_].Data(),
+                          obs_size),
+              0)
+        << i;
+  }
+  LOG(INFO) << "gray_scale=" << gray_scale << " stack_num=" << stack_num
+            << " generic(s): " << durs[0].count()
+            << ", variant(s): " << durs[1].count();
+}
+
+TEST(AtariEnvTest, Variant) {
+  // Pong 84x84 gray scale stack 4 is served by AtariEnvVariant
+  CompareVariant(true, 4, 20000);
+  CompareVariant(false, 4, 5000);
+  // not in the dispatch table, falls back to the generic path
+  CompareVariant(true, 3, 1000);
+}
+
+TEST(AtariEnvTest, Ram) {
+  auto config = atari::AtariEnvSpec::kDefaultConfig;
+  config["num_envs"_] = 1;
+  config["batch_size"_] = 1;
+  config["obs_type"_] = std::string("ram");
+  config["max_episode_steps"_] = 50;
+  atari::AtariEnvSpec spec(config);
+  atari::AtariEnvPool envpool(spec);
+  TArray env_ids(Spec<int>({1}));
+  env_ids[0] = 0;
+  envpool.Reset(env_ids);
+  AtariAction action;
+  action["env_id"_] = env_ids;
+  action["players.env_id"_] = env_ids;
+  action["action"_] = TArray(Spec<int>({1}));
+  std::vector<uint8_t> last;
+  for (int i = 0; i < 200; ++i) {
+    AtariState state(envpool.Recv());
+    ASSERT_EQ(state["obs"_].Shape(), std::vector<std::size_t>({1, 4, 128}));
+    const auto* obs = static_cast<const uint8_t*>(state["obs"_].Data());
+    int frame_index =
+        *static_cast<const int*>(state["info:frame_index"_].Data());
+    if (frame_index == 0) {
+      // a reset fills the stack with the first frame
+      for (int j = 1; j < 4; ++j) {
+        EXPECT_EQ(std::memcmp(obs, obs + j * 128, 128), 0);
+      }
+    } else {
+      // the stack shifts by one frame per step
+      EXPECT_EQ(std::memcmp(obs, last.data() + 128, 3 * 128), 0);
+    }
+    last.assign(obs, obs + 4 * 128);
+    action["action"_][0] = i % 6;
+    envpool.Send(action);
+  }
+  config["obs_type"_] = std::string("rgb");
+  EXPECT_THROW(atari::AtariEnv(atari::AtariEnvSpec(config), 0),
+               std::invalid_argument);
+}
+
+void Benchmark(const std::string& obs_type) {
   int num_envs = 8;
   int batch = 3;
   int num_threads = 3;
@@ -338,6 +518,7 @@ TEST(AtariEnvSpeedTest, Benchmark) {
   config["batch_size"_] = batch;
   config["num_threads"_] = num_threads;
   config["thread_affinity_offset"_] = 0;
+  config["obs_type"_] = obs_type;
   atari::AtariEnvSpec spec(config);
   atari::AtariEnvPool envpool(spec);
   TArray all_env_ids(Spec<int>({num_envs}));
@@ -365,5 +546,12 @@ TEST(AtariEnvSpeedTest, Benchmark) {
   std::chrono::duration<double> dur = std::chrono::system_clock::now() - start;
   double t = dur.count();
   double fps = (total_iter * batch) / t * 4;
-  LOG(INFO) << "time(s): " << t << ", FPS: " << fps;
+  LOG(INFO) << "obs_type=" << obs_type << " time(s): " << t
+            << ", FPS: " << fps;
+}
+
+TEST(AtariEnvSpeedTest, Benchmark) {
+  Benchmark("pixel");
+  // bounded by emulation alone
+  Benchmark("ram");
 }
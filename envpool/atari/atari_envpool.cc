@@ -12,10 +12,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+
 #include "envpool/atari/atari_env.h"
 #include "envpool/core/py_envpool.h"
 
 using AtariEnvSpec = PyEnvSpec<atari::AtariEnvSpec>;
 using AtariEnvPool = PyEnvPool<atari::AtariEnvPool>;
 
-PYBIND11_MODULE(atari_envpool, m) { REGISTER(m, AtariEnvSpec, AtariEnvPool) }
+PYBIND11_MODULE(atari_envpool, m) {
+  REGISTER(m, AtariEnvSpec, AtariEnvPool)
+  m.def("_palette", [](const std::string& base_path, const std::string& task,
+                       bool gray_scale) {
+    return atari::GetPalette(atari::GetRomPath(base_path, task), gray_scale);
+  });
+}
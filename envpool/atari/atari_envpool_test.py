@@ -14,6 +14,7 @@
 """Unit test for atari envpool and speed benchmark."""
 
 import os
+import tempfile
 import time
 
 import cv2
@@ -24,7 +25,9 @@ from absl.testing import absltest
 from jax import jit, lax
 
 import envpool.atari.registration  # noqa: F401
+from envpool.atari import palette
 from envpool.atari.atari_envpool import _AtariEnvPool, _AtariEnvSpec
+from envpool.python.frame_stack import FrameStacker, stack_frames
 from envpool.registration import make_dm, make_gym, make_gymnasium
 
 
@@ -238,6 +241,145 @@ class _AtariEnvPoolTest(absltest.TestCase):
       )
       np.testing.assert_allclose(obs_, obs[0, i:i + 3].transpose(1, 2, 0))
 
+  def test_frame_dedup(self) -> None:
+    num_envs = 3
+    kwargs = dict(num_envs=num_envs, episodic_life=True, max_episode_steps=300)
+    env0 = make_gym("Breakout-v5", **kwargs)
+    env1 = make_gym("Breakout-v5", frame_dedup=True, **kwargs)
+    self.assertEqual(env1.observation_space.shape, (1, 84, 84))
+    stacker = FrameStacker(num_envs, 4, (1, 84, 84))
+    obs0, _ = env0.reset()
+    obs1, info = env1.reset()
+    frames, index = [obs1], [info["frame_index"]]
+    np.testing.assert_array_equal(
+      obs0, stacker(obs1, info["env_id"], info["frame_index"])
+    )
+    stacks = [obs0]
+    for _ in range(1000):
+      action = np.random.randint(4, size=num_envs)
+      obs0 = env0.step(action)[0]
+      obs1, _, _, _, info = env1.step(action)
+      np.testing.assert_array_equal(
+        obs0, stacker(obs1, info["env_id"], info["frame_index"])
+      )
+      frames.append(obs1)
+      index.append(info["frame_index"])
+      stacks.append(obs0)
+    frames, index, stacks = map(np.stack, (frames, index, stacks))
+    for i in range(num_envs):
+      np.testing.assert_array_equal(
+        stacks[:, i], stack_frames(frames[:, i], index[:, i], 4)
+      )
+
+  def test_frame_dedup_restore(self) -> None:
+    num_envs = 3
+    all_ids = np.arange(num_envs)
+    kwargs = dict(num_envs=num_envs, max_episode_steps=300)
+    env0 = make_gym("Breakout-v5", **kwargs)
+    env1 = make_gym("Breakout-v5", frame_dedup=True, **kwargs)
+    stacker = FrameStacker(num_envs, 4, (1, 84, 84))
+    actions = np.random.randint(4, size=(40, num_envs))
+
+    def check(obs0: np.ndarray, obs1: np.ndarray, info: dict) -> None:
+      np.testing.assert_array_equal(
+        obs0, stacker(obs1, info["env_id"], info["frame_index"])
+      )
+
+    def run(begin: int, end: int) -> None:
+      for action in actions[begin:end]:
+        obs0 = env0.step(action)[0]
+        obs1, _, _, _, info = env1.step(action)
+        check(obs0, obs1, info)
+
+    obs0, _ = env0.reset()
+    obs1, info = env1.reset()
+    check(obs0, obs1, info)
+    run(0, 20)
+    # restore and branch mid-episode, mirrored on the stacker
+    handles0, handles1 = env0.snapshot(), env1.snapshot()
+    frames = stacker.snapshot(all_ids)
+    run(20, 40)
+    env0.restore(handles0)
+    env1.restore(handles1)
+    stacker.restore(frames, all_ids)
+    env0.branch(0, np.array([1]))
+    env1.branch(0, np.array([1]))
+    stacker.branch(0, np.array([1]))
+    run(20, 40)
+    env0.release_snapshot(handles0)
+    env1.release_snapshot(handles1)
+    # the frame index is saved, the older frames of the stack are not
+    with tempfile.TemporaryDirectory() as tmp:
+      path0 = os.path.join(tmp, "env0")
+      path1 = os.path.join(tmp, "env1")
+      env0.save_state(path0)
+      env1.save_state(path1)
+      frames = stacker.snapshot(all_ids)
+      run(0, 20)
+      obs0, _ = env0.load_state(path0)
+      obs1, info = env1.load_state(path1)
+    self.assertTrue(np.all(info["frame_index"] > 0))
+    stacker.restore(frames, all_ids)
+    check(obs0, obs1, info)
+    run(0, 20)
+
+  def test_ram(self) -> None:
+    num_envs = 3
+    kwargs = dict(num_envs=num_envs, episodic_life=True, max_episode_steps=300)
+    env0 = make_gym("Breakout-v5", **kwargs)
+    env1 = make_gym("Breakout-v5", obs_type="ram", **kwargs)
+    self.assertEqual(env1.observation_space.shape, (4, 128))
+    env0.reset()
+    obs, _ = env1.reset()
+    self.assertEqual(obs.shape, (num_envs, 4, 128))
+    for _ in range(1000):
+      action = np.random.randint(4, size=num_envs)
+      _, rew0, term0, trunc0, info0 = env0.step(action)
+      last = obs
+      obs, rew1, term1, trunc1, info1 = env1.step(action)
+      # the emulation does not depend on the obs type
+      np.testing.assert_array_equal(rew0, rew1)
+      np.testing.assert_array_equal(term0, term1)
+      np.testing.assert_array_equal(trunc0, trunc1)
+      np.testing.assert_array_equal(info0["lives"], info1["lives"])
+      np.testing.assert_array_equal(info0["frame_index"], info1["frame_index"])
+      shift = info1["frame_index"] > 0
+      np.testing.assert_array_equal(obs[shift, :3], last[shift, 1:])
+
+  def test_screen(self) -> None:
+    num_envs = 3
+    kwargs = dict(num_envs=num_envs, episodic_life=True, max_episode_steps=300)
+    for gray_scale in [True, False]:
+      env0 = make_gym(
+        "Breakout-v5",
+        gray_scale=gray_scale,
+        stack_num=1,
+        img_height=210,
+        img_width=160,
+        **kwargs,
+      )
+      env1 = make_gym("Breakout-v5", obs_type="screen", **kwargs)
+      self.assertEqual(env1.observation_space.shape, (2, 210, 160))
+      table = palette(env0.spec)
+      self.assertEqual(table.shape, (256,) if gray_scale else (256, 3))
+      env0.reset()
+      env1.reset()
+      for _ in range(300):
+        action = np.random.randint(4, size=num_envs)
+        obs0, _, term, trunc, _ = env0.step(action)
+        obs1 = env1.step(action)[0]
+        # max-pool of the colored screens, at the original size; a game over
+        # cuts the frame skip short, where the pixel obs may pool a stale
+        # frame
+        full = ~(term | trunc)
+        pooled = np.maximum(table[obs1[:, 0]], table[obs1[:, 1]])[full]
+        if gray_scale:
+          np.testing.assert_array_equal(obs0[full, 0], pooled)
+        else:
+          np.testing.assert_array_equal(
+            obs0[full], pooled.transpose(0, 3, 1, 2)
+          )
+
   def test_benchmark(self) -> None:
     if os.cpu_count() == 256:
       num_envs = 645
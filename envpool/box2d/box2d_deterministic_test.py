@@ -13,7 +13,9 @@
 # limitations under the License.
 """Unit tests for box2d environments deterministic check."""
 
-from typing import Any
+import os
+import tempfile
+from typing import Any, List
 
 import numpy as np
 from absl.testing import absltest
@@ -54,6 +56,43 @@ class _Box2dEnvPoolDeterministicTest(absltest.TestCase):
     self.run_deterministic_check("LunarLanderContinuous-v2")
     self.run_deterministic_check("LunarLander-v2")
 
+  def test_lunar_lander_restore(self) -> None:
+    num_envs, total = 2, 100
+    for task_id in ["LunarLander-v2", "LunarLanderContinuous-v2"]:
+      env = make_gym(task_id, num_envs=num_envs, seed=0)
+      env.action_space.seed(0)
+      actions = [env.action_space.sample() for _ in range(2 * total)]
+
+      def run(begin: int, end: int) -> List[List[Any]]:
+        # every env takes the same actions, the result is indexed by env_id
+        traj: List[List[Any]] = [[] for _ in range(num_envs)]
+        for action in actions[begin:end]:
+          obs, rew, term, trunc, info = env.step(
+            np.array([action] * num_envs)
+          )
+          for i, env_id in enumerate(info["env_id"]):
+            traj[env_id].append([obs[i].tolist(), rew[i], term[i], trunc[i]])
+        return traj
+
+      obs, _ = env.reset()
+      # the bodies are recreated with their state, but not the contact and
+      # joint impulses box2d warm starts from, so a restored env only steps
+      # like the other copies restored from the same state
+      with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "state")
+        env.save_state(path)
+        handles = env.snapshot(np.array([0]))
+        run(0, total)
+        loaded, _ = env.load_state(path)
+        np.testing.assert_array_equal(loaded, obs)
+        ref = run(total, 2 * total)
+      env.restore(handles, np.array([0]))
+      env.branch(0, np.array([1]))
+      traj = run(total, 2 * total)
+      env.release_snapshot(handles)
+      self.assertEqual(traj[0], ref[0])
+      self.assertEqual(traj[1], ref[0])
+
 
 if __name__ == "__main__":
   absltest.main()
@@ -18,9 +18,12 @@
 #ifndef ENVPOOL_BOX2D_CAR_RACING_H_
 #define ENVPOOL_BOX2D_CAR_RACING_H_
 
+#include <cstdint>
+
 #include "car_racing_env.h"
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/image_kernels.h"
 
 namespace box2d {
 
@@ -76,7 +79,9 @@ class CarRacingEnv : public Env<CarRacingEnvSpec>, public CarRacingBox2dEnv {
     State state = Allocate();
     state["reward"_] = step_reward_;
     CreateImageArray();
-    state["obs"_].Assign(img_array_.data, 96 * 96 * 3);
+    // BGR to RGB, straight into the state
+    image_kernels::SwapRedBlue(img_array_.data, 96 * 96,
+                               static_cast<uint8_t*>(state["obs"_].Data()));
 #ifdef ENVPOOL_TEST
     state["info:tile_visited_count"_] = tile_visited_count_;
     state["info:car_fuel_spent"_] = car_->GetFuelSpent();
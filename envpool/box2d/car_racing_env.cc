@@ -416,7 +416,6 @@ void CarRacingBox2dEnv::CreateImageArray() {
   // cv::resize(surf_, img_array_, cv::Size(kStateW, kStateH), 0, 0,
   // cv::INTER_AREA);
   cv::resize(surf_, img_array_, cv::Size(kStateW, kStateH));
-  cv::cvtColor(img_array_, img_array_, cv::COLOR_BGR2RGB);
 }
 
 void CarRacingBox2dEnv::DrawColoredPolygon(
@@ -49,6 +49,17 @@ class LunarLanderDiscreteEnv : public Env<LunarLanderDiscreteEnvSpec>,
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    LunarLanderSaveState(writer);
+  }
+
+  void LoadState(StateReader* reader) override {
+    LunarLanderLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { LunarLanderLoadState(reader); }
+
   void Reset() override {
     LunarLanderReset(&gen_);
     WriteState();
@@ -59,6 +59,30 @@ LunarLanderBox2dEnv::LunarLanderBox2dEnv(bool continuous, int max_episode_steps)
 }
 
 void LunarLanderBox2dEnv::ResetBox2d(std::mt19937* gen) {
+  double h = kViewportH / kScale;
+
+  // moon
+  std::array<double, kChunks + 1> height;
+  double helipad_y = h / 4;
+  for (int i = 0; i <= kChunks; ++i) {
+    if (kChunks / 2 - 2 <= i && i <= kChunks / 2 + 2) {
+      height[i] = helipad_y;
+    } else {
+      height[i] = RandUniform(0, h / 2)(*gen);
+    }
+  }
+  for (int i = 0; i < kChunks; ++i) {
+    smooth_y_[i] =
+        (height[i == 0 ? kChunks : i - 1] + height[i] + height[i + 1]) / 3;
+  }
+  CreateBodies();
+
+  b2Vec2 force = Vec2(RandUniform(-kInitialRandom, kInitialRandom)(*gen),
+                      RandUniform(-kInitialRandom, kInitialRandom)(*gen));
+  lander_->ApplyForceToCenter(force, true);
+}
+
+void LunarLanderBox2dEnv::CreateBodies() {
   // clean all body in world
   if (moon_ != nullptr) {
     world_->SetContactListener(nullptr);
@@ -77,21 +101,9 @@ void LunarLanderBox2dEnv::ResetBox2d(std::mt19937* gen) {
   double h = kViewportH / kScale;
 
   // moon
-  std::array<double, kChunks + 1> height;
   std::array<double, kChunks> chunk_x;
-  std::array<double, kChunks> smooth_y;
-  double helipad_y = h / 4;
-  for (int i = 0; i <= kChunks; ++i) {
-    if (kChunks / 2 - 2 <= i && i <= kChunks / 2 + 2) {
-      height[i] = helipad_y;
-    } else {
-      height[i] = RandUniform(0, h / 2)(*gen);
-    }
-  }
   for (int i = 0; i < kChunks; ++i) {
     chunk_x[i] = w / (kChunks - 1) * i;
-    smooth_y[i] =
-        (height[i == 0 ? kChunks : i - 1] + height[i] + height[i + 1]) / 3;
   }
   {
     b2BodyDef bd;
@@ -108,8 +120,8 @@ void LunarLanderBox2dEnv::ResetBox2d(std::mt19937* gen) {
   }
   for (int i = 0; i < kChunks - 1; ++i) {
     b2EdgeShape shape;
-    shape.SetTwoSided(b2Vec2(chunk_x[i], smooth_y[i]),
-                      b2Vec2(chunk_x[i + 1], smooth_y[i + 1]));
+    shape.SetTwoSided(b2Vec2(chunk_x[i], smooth_y_[i]),
+                      b2Vec2(chunk_x[i + 1], smooth_y_[i + 1]));
 
     b2FixtureDef fd;
     fd.shape = &shape;
@@ -141,9 +153,6 @@ void LunarLanderBox2dEnv::ResetBox2d(std::mt19937* gen) {
 
     lander_ = world_->CreateBody(&bd);
     lander_->CreateFixture(&fd);
-    b2Vec2 force = Vec2(RandUniform(-kInitialRandom, kInitialRandom)(*gen),
-                        RandUniform(-kInitialRandom, kInitialRandom)(*gen));
-    lander_->ApplyForceToCenter(force, true);
   }
 
   // legs
@@ -320,4 +329,60 @@ void LunarLanderBox2dEnv::LunarLanderStep(std::mt19937* gen, int action,
   StepBox2d(gen, action, action0, action1);
 }
 
+static void SaveBody(StateWriter* writer, const b2Body* body) {
+  writer->Write(body->GetPosition());
+  writer->Write(body->GetAngle());
+  writer->Write(body->GetLinearVelocity());
+  writer->Write(body->GetAngularVelocity());
+  writer->Write(body->IsAwake());
+}
+
+static void LoadBody(StateReader* reader, b2Body* body) {
+  auto pos = reader->Read<b2Vec2>();
+  auto angle = reader->Read<float>();
+  body->SetTransform(pos, angle);
+  body->SetLinearVelocity(reader->Read<b2Vec2>());
+  body->SetAngularVelocity(reader->Read<float>());
+  body->SetAwake(reader->Read<bool>());
+}
+
+void LunarLanderBox2dEnv::LunarLanderSaveState(StateWriter* writer) {
+  writer->Write(elapsed_step_);
+  writer->Write(reward_);
+  writer->Write(prev_shaping_);
+  writer->Write(done_);
+  writer->Write(obs_);
+  writer->Write(ground_contact_);
+  writer->Write(smooth_y_);
+  SaveBody(writer, lander_);
+  SaveBody(writer, legs_[0]);
+  SaveBody(writer, legs_[1]);
+  writer->Write<uint64_t>(particles_.size());
+  for (const auto* p : particles_) {
+    writer->Write(p->GetFixtureList()->GetDensity());
+    SaveBody(writer, p);
+  }
+}
+
+void LunarLanderBox2dEnv::LunarLanderLoadState(StateReader* reader) {
+  reader->Read(&elapsed_step_);
+  reader->Read(&reward_);
+  reader->Read(&prev_shaping_);
+  reader->Read(&done_);
+  reader->Read(&obs_);
+  auto ground_contact = reader->Read<std::array<float, 2>>();
+  reader->Read(&smooth_y_);
+  CreateBodies();
+  LoadBody(reader, lander_);
+  LoadBody(reader, legs_[0]);
+  LoadBody(reader, legs_[1]);
+  auto num_particles = reader->Read<uint64_t>();
+  for (uint64_t i = 0; i < num_particles; ++i) {
+    auto density = reader->Read<float>();
+    LoadBody(reader, CreateParticle(density, b2Vec2(0, 0)));
+  }
+  // CreateBodies clears the contact flags, box2d re-detects them on next step
+  ground_contact_ = ground_contact;
+}
+
 }  // namespace box2d
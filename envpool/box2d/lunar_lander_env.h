@@ -25,6 +25,8 @@
 #include <random>
 #include <vector>
 
+#include "envpool/core/serialization.h"
+
 namespace box2d {
 
 class LunarLanderContactDetector;
@@ -63,6 +65,7 @@ class LunarLanderBox2dEnv {
   std::vector<b2Vec2> lander_poly_;
   std::array<b2Body*, 2> legs_;
   std::array<float, 2> ground_contact_;
+  std::array<double, kChunks> smooth_y_;
   std::unique_ptr<LunarLanderContactDetector> listener_;
 
  public:
@@ -72,9 +75,13 @@ class LunarLanderBox2dEnv {
   // continuous action space: action0 and action1
   void LunarLanderStep(std::mt19937* gen, int action, float action0,
                        float action1);
+  // the terrain and all body states, contact impulses are not preserved
+  void LunarLanderSaveState(StateWriter* writer);
+  void LunarLanderLoadState(StateReader* reader);
 
  private:
   void ResetBox2d(std::mt19937* gen);
+  void CreateBodies();
   void StepBox2d(std::mt19937* gen, int action, float action0, float action1);
   b2Body* CreateParticle(float mass, b2Vec2 pos);
 };
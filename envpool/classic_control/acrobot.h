@@ -85,6 +85,23 @@ class AcrobotEnv : public Env<AcrobotEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(s_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&s_);
+  }
+
   void Reset() override {
     s_.s0 = dist_(gen_);
     s_.s1 = dist_(gen_);
@@ -74,6 +74,29 @@ class CartPoleEnv : public Env<CartPoleEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(x_);
+    writer->Write(x_dot_);
+    writer->Write(theta_);
+    writer->Write(theta_dot_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&x_);
+    reader->Read(&x_dot_);
+    reader->Read(&theta_);
+    reader->Read(&theta_dot_);
+  }
+
   void Reset() override {
     x_ = dist_(gen_);
     x_dot_ = dist_(gen_);
@@ -67,6 +67,25 @@ class MountainCarContinuousEnv : public Env<MountainCarContinuousEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(pos_);
+    writer->Write(vel_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&pos_);
+    reader->Read(&vel_);
+  }
+
   void Reset() override {
     pos_ = dist_(gen_);
     vel_ = 0.0;
@@ -66,6 +66,25 @@ class PendulumEnv : public Env<PendulumEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(theta_);
+    writer->Write(theta_dot_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&theta_);
+    reader->Read(&theta_dot_);
+  }
+
   void Reset() override {
     theta_ = dist_(gen_);
     theta_dot_ = dist_dot_(gen_);
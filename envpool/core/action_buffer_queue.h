@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <functional>
 #include <utility>
 #include <vector>
 
@@ -38,6 +39,8 @@ class ActionBufferQueue {
     int env_id;
     int order;
     bool force_reset;
+    // if set, the worker runs task(env_id, order) instead of stepping the env
+    std::function<void(int, int)>* task{nullptr};
   };
 
  protected:
@@ -19,7 +19,13 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -27,14 +33,32 @@
 #include "ThreadPool.h"
 #include "envpool/core/action_buffer_queue.h"
 #include "envpool/core/array.h"
+#include "envpool/core/checkpoint.h"
+#include "envpool/core/env_variant.h"
 #include "envpool/core/envpool.h"
+#include "envpool/core/preprocess_queue.h"
+#include "envpool/core/process_pool.h"
+#include "envpool/core/recorder.h"
+#include "envpool/core/shm_envpool.h"
+#include "envpool/core/snapshot_arena.h"
 #include "envpool/core/spec.h"
 #include "envpool/core/state_buffer_queue.h"
+#include "envpool/core/video_recorder.h"
 /**
  * Async EnvPool
  *
  * batch-action -> action buffer queue -> threadpool -> state buffer queue
  *
+ * With num_preprocess_threads > 0, the observation processing an env defers
+ * with `Env::Defer` runs in a second stage:
+ *
+ * threadpool -> preprocess queue -> preprocess threads -> state buffer queue
+ *
+ * With isolation="process", the envs live in worker processes instead, see
+ * `ProcessPool`:
+ *
+ * batch-action -> request rings -> worker processes -> state buffer queue
+ *
  * ThreadPool is tailored with EnvPool, so here we don't use the existing
  * third_party ThreadPool (which is really slow).
  */
@@ -45,14 +69,34 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
   std::size_t batch_;
   std::size_t max_num_players_;
   std::size_t num_threads_;
+  std::size_t num_preprocess_threads_;
   bool is_sync_;
   std::atomic<int> stop_;
   std::atomic<std::size_t> stepping_env_num_;
   std::vector<std::thread> workers_;
+  std::vector<std::thread> preprocess_workers_;
   std::unique_ptr<ActionBufferQueue> action_buffer_queue_;
+  // only with isolation="process", envs_ is empty then
+  std::unique_ptr<ProcessPool> process_pool_;
+  std::unique_ptr<PreprocessQueue> preprocess_queue_;
   std::unique_ptr<StateBufferQueue> state_buffer_queue_;
   std::vector<std::unique_ptr<Env>> envs_;
   std::vector<std::atomic<int>> stepping_env_;
+  std::unique_ptr<SnapshotArena> snapshot_arena_;
+  // episode collection, see CollectBegin; collect_quota_ is empty otherwise
+  int collect_num_episodes_{0};
+  std::size_t collect_active_{0};
+  std::vector<int> collect_quota_;
+  std::vector<float> collect_running_return_;
+  std::vector<float> collect_returns_;
+  std::vector<int> collect_lengths_;
+  // serving clients in other processes, see ServeShm
+  std::unique_ptr<ShmServer> shm_server_;
+  std::thread shm_thread_;
+  // trajectory recording, see RecordBegin
+  std::unique_ptr<TrajectoryRecorder> recorder_;
+  // episode videos, see the video_* configs
+  std::unique_ptr<VideoRecorder> video_recorder_;
   std::chrono::duration<double> dur_send_, dur_recv_, dur_send_all_;
 
   template <typename V>
@@ -62,24 +106,261 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
     std::vector<ActionSlice> actions;
     std::shared_ptr<std::vector<Array>> action_batch =
         std::make_shared<std::vector<Array>>(std::forward<V>(action));
+    if (recorder_ != nullptr) {
+      recorder_->RecordAction(*action_batch);
+    }
     for (int i = 0; i < shared_offset; ++i) {
       int eid = env_id[i];
-      envs_[eid]->SetAction(action_batch, i);
+      if (IsCollected(eid)) {
+        continue;
+      }
+      if (process_pool_ != nullptr) {
+        process_pool_->SetAction(eid, *action_batch, i);
+      } else {
+        envs_[eid]->SetAction(action_batch, i);
+      }
       actions.emplace_back(ActionSlice{
           .env_id = eid,
-          .order = is_sync_ ? i : -1,
+          .order = is_sync_ ? static_cast<int>(actions.size()) : -1,
           .force_reset = false,
       });
     }
-    if (is_sync_) {
-      stepping_env_num_ += shared_offset;
+    if (IsCounting()) {
+      stepping_env_num_ += actions.size();
     }
     // add to abq
     auto start = std::chrono::system_clock::now();
-    action_buffer_queue_->EnqueueBulk(actions);
+    Enqueue(actions);
     dur_send_ += std::chrono::system_clock::now() - start;
   }
 
+  void Enqueue(
+      const std::vector<ActionBufferQueue::ActionSlice>& actions) {
+    if (process_pool_ != nullptr) {
+      process_pool_->EnqueueBulk(actions);
+    } else {
+      action_buffer_queue_->EnqueueBulk(actions);
+    }
+  }
+
+  /**
+   * The per-env operations below run on the worker threads, they are not
+   * available when the envs live in other processes.
+   */
+  void CheckThreadIsolation(const std::string& name) const {
+    if (process_pool_ != nullptr) {
+      throw std::runtime_error(name +
+                               " is not available with isolation=\"process\"");
+    }
+  }
+
+  /**
+   * With isolation="process", build the fork server before the pool starts
+   * any thread. There is one worker process per simulation thread.
+   */
+  static std::unique_ptr<ProcessPool> MakeProcessPool(
+      const typename Env::Spec& spec) {
+    const std::string& isolation = spec.config["isolation"_];
+    if (isolation == "thread") {
+      return nullptr;
+    }
+    if (isolation != "process") {
+      throw std::invalid_argument(
+          "isolation should be \"thread\" or \"process\", got " + isolation);
+    }
+    if (spec.config["max_num_players"_] != 1) {
+      throw std::runtime_error(
+          "isolation=\"process\" is not available for multiplayer "
+          "environment.");
+    }
+    if (HasContainerType(spec.state_spec)) {
+      throw std::runtime_error(
+          "isolation=\"process\": states with container type are not "
+          "supported");
+    }
+    if (!spec.config["video_path"_].empty()) {
+      throw std::invalid_argument(
+          "isolation=\"process\": video recording is not supported");
+    }
+    std::size_t num_envs = spec.config["num_envs"_];
+    std::size_t num_processes = spec.config["num_threads"_];
+    if (num_processes == 0) {
+      std::size_t batch = spec.config["batch_size"_] <= 0
+                              ? num_envs
+                              : spec.config["batch_size"_];
+      num_processes = std::min<std::size_t>(
+          batch, std::thread::hardware_concurrency());
+    }
+    num_processes = std::min(num_processes, num_envs);
+    return std::make_unique<ProcessPool>(
+        num_envs, num_processes,
+        spec.action_spec.template AllValues<ShapeSpec>(),
+        spec.state_spec.template AllValues<ShapeSpec>(),
+        spec.config["thread_affinity_offset"_],
+        [spec](ProcessPool* pool, int index) {
+          RunWorkerProcess(spec, pool, index);
+        });
+  }
+
+  /**
+   * Body of worker process `index`: build the envs it owns, then step them
+   * as the parent asks. A rebuilt env is reset before its first step.
+   */
+  static void RunWorkerProcess(const typename Env::Spec& spec,
+                               ProcessPool* pool, int index) {
+    std::size_t num_envs = spec.config["num_envs"_];
+    std::vector<std::unique_ptr<Env>> envs(num_envs);
+    std::vector<bool> fresh(num_envs, true);
+    for (int env_id : pool->EnvIds(index)) {
+      envs[env_id] = EnvCreator<Env>::Create(spec, env_id);
+      envs[env_id]->SetAction(
+          std::make_shared<std::vector<Array>>(pool->ActionRow(env_id)), 0);
+    }
+    pool->Serve(index, [&](const ProcessPool::Task& task) {
+      auto& env = envs[task.env_id];
+      bool reset = task.force_reset || fresh[task.env_id] || env->IsDone();
+      fresh[task.env_id] = false;
+      env->EnvStepInto(pool->StateRow(task.env_id), reset);
+    });
+  }
+
+  /**
+   * Run fn(env_id, index) for every env_ids[index] on the worker threads and
+   * block until all of them finish. The first exception thrown by fn is
+   * rethrown here. It must not race with a step of the same env, i.e. the
+   * caller needs to make sure no step is in flight.
+   */
+  void ForEachEnv(const std::vector<int>& env_ids,
+                  const std::function<void(int, int)>& fn) {
+    CheckThreadIsolation("per-env state access");
+    if (env_ids.empty()) {
+      return;
+    }
+    std::atomic<std::size_t> remaining(env_ids.size());
+    moodycamel::LightweightSemaphore finish(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::function<void(int, int)> task = [&](int env_id, int index) {
+      try {
+        fn(env_id, index);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      if (--remaining == 0) {
+        finish.signal();
+      }
+    };
+    std::vector<ActionSlice> actions;
+    for (std::size_t i = 0; i < env_ids.size(); ++i) {
+      actions.emplace_back(ActionSlice{
+          .env_id = env_ids[i],
+          .order = static_cast<int>(i),
+          .force_reset = false,
+          .task = &task,
+      });
+    }
+    action_buffer_queue_->EnqueueBulk(actions);
+    while (!finish.wait()) {
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  /**
+   * Serialize env_id with `EnvSnapshot` into a per-thread scratch buffer,
+   * the returned reference is valid until the next call on the same thread.
+   */
+  const std::vector<char>& SnapshotToBuffer(int env_id) {
+    thread_local std::vector<char> buf;
+    buf.clear();
+    StateWriter writer(&buf);
+    envs_[env_id]->EnvSnapshot(&writer);
+    return buf;
+  }
+
+  /**
+   * The number of stepping envs is tracked in sync mode, and in async mode
+   * too while collecting episodes or serving, so that `Recv` can return a
+   * partial batch once fewer than batch_size envs are left.
+   */
+  [[nodiscard]] bool IsCounting() const {
+    return is_sync_ || !collect_quota_.empty() || shm_server_ != nullptr;
+  }
+
+  /**
+   * Serving loop: forward the clients' requests to the pool, and the
+   * received states back to their rings. Requests and receives are handled
+   * on this thread only, so stepping_env_num_ is exact and `Recv` never
+   * waits for envs that no client has sent.
+   */
+  void ShmServeLoop() {
+    auto send = [this](std::vector<Array>&& action) {
+      SendImpl(std::move(action));
+    };
+    auto reset = [this](const Array& env_ids) { Reset(env_ids); };
+    while (!shm_server_->Stopped()) {
+      if (stepping_env_num_ == 0) {
+        shm_server_->WaitRequest();
+      }
+      shm_server_->Poll(send, reset);
+      if (stepping_env_num_ > 0) {
+        shm_server_->Scatter(Recv());
+      }
+    }
+  }
+
+  /**
+   * Whether env_id has finished its quota of episodes in collection mode.
+   */
+  [[nodiscard]] bool IsCollected(int env_id) const {
+    return !collect_quota_.empty() && collect_quota_[env_id] == 0;
+  }
+
+  /**
+   * Accumulate per-episode return and length from a received batch. The
+   * state order is the one hardcoded in common_state_spec.
+   */
+  void CollectStats(const std::vector<Array>& state) {
+    const int* env_id = static_cast<const int*>(state[0].Data());
+    const int* elapsed_step = static_cast<const int*>(state[2].Data());
+    const bool* done = static_cast<const bool*>(state[3].Data());
+    const float* reward = static_cast<const float*>(state[4].Data());
+    const int* step_type = static_cast<const int*>(state[6].Data());
+    for (std::size_t i = 0; i < state[0].Shape(0); ++i) {
+      int eid = env_id[i];
+      if (collect_quota_[eid] == 0) {
+        continue;
+      }
+      if (step_type[i] == 0) {
+        collect_running_return_[eid] = 0.0f;
+      } else {
+        collect_running_return_[eid] += reward[i];
+      }
+      if (done[i]) {
+        std::size_t index = static_cast<std::size_t>(eid) *
+                                collect_num_episodes_ +
+                            collect_num_episodes_ - collect_quota_[eid];
+        collect_returns_[index] = collect_running_return_[eid];
+        collect_lengths_[index] = elapsed_step[i];
+        if (--collect_quota_[eid] == 0) {
+          --collect_active_;
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] std::vector<int> AllEnvIds() const {
+    std::vector<int> env_ids(num_envs_);
+    for (std::size_t i = 0; i < num_envs_; ++i) {
+      env_ids[i] = static_cast<int>(i);
+    }
+    return env_ids;
+  }
+
  public:
   using Spec = typename Env::Spec;
   using Action = typename Env::Action;
@@ -93,24 +374,55 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
                                                : spec.config["batch_size"_]),
         max_num_players_(spec.config["max_num_players"_]),
         num_threads_(spec.config["num_threads"_]),
+        num_preprocess_threads_(spec.config["num_preprocess_threads"_]),
         is_sync_(batch_ == num_envs_ && max_num_players_ == 1),
         stop_(0),
         stepping_env_num_(0),
         action_buffer_queue_(new ActionBufferQueue(num_envs_)),
+        process_pool_(MakeProcessPool(spec)),
         state_buffer_queue_(new StateBufferQueue(
             batch_, num_envs_, max_num_players_,
             spec.state_spec.template AllValues<ShapeSpec>())),
         envs_(num_envs_) {
     std::size_t processor_count = std::thread::hardware_concurrency();
+    if (process_pool_ != nullptr) {
+      envs_.clear();
+      num_threads_ = process_pool_->NumProcesses();
+      process_pool_->Start(
+          [this](int env_id, int order, const std::vector<Array>& state_row) {
+            auto slice = state_buffer_queue_->Allocate(1, order);
+            for (std::size_t i = 0; i < state_row.size(); ++i) {
+              slice.arr[i].Assign(state_row[i]);
+            }
+            slice.done_write();
+          });
+      return;
+    }
+    // env 0 is the prototype: it is built alone first, so that whatever an
+    // env family shares between its instances (compiled models, parsed
+    // configs, ...) is loaded once, and the others copy it in parallel
+    // instead of all loading it at the same time
+    envs_[0] = EnvCreator<Env>::Create(spec, 0);
     ThreadPool init_pool(std::min(processor_count, num_envs_));
     std::vector<std::future<void>> result;
-    for (std::size_t i = 0; i < num_envs_; ++i) {
-      result.emplace_back(init_pool.enqueue(
-          [i, spec, this] { envs_[i].reset(new Env(spec, i)); }));
+    for (std::size_t i = 1; i < num_envs_; ++i) {
+      result.emplace_back(init_pool.enqueue([i, spec, this] {
+        envs_[i] = EnvCreator<Env>::Create(spec, static_cast<int>(i));
+      }));
     }
     for (auto& f : result) {
       f.get();
     }
+    if (!spec.config["video_path"_].empty()) {
+      video_recorder_ = std::make_unique<VideoRecorder>(
+          spec.config["video_path"_], spec.config["video_format"_],
+          spec.config["video_num_envs"_], spec.config["video_every"_],
+          Spec::StateSpec::AllKeys(),
+          spec.state_spec.template AllValues<ShapeSpec>());
+      for (auto& env : envs_) {
+        env->SetVideoRecorder(video_recorder_.get());
+      }
+    }
     if (num_threads_ == 0) {
       num_threads_ = std::min(batch_, processor_count);
     }
@@ -123,26 +435,61 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
           }
           int env_id = raw_action.env_id;
           int order = raw_action.order;
+          if (raw_action.task != nullptr) {
+            (*raw_action.task)(env_id, order);
+            continue;
+          }
           bool reset = raw_action.force_reset || envs_[env_id]->IsDone();
           envs_[env_id]->EnvStep(state_buffer_queue_.get(), order, reset);
         }
       });
     }
+    if (num_preprocess_threads_ > 0) {
+      preprocess_queue_ = std::make_unique<PreprocessQueue>(num_envs_);
+      for (auto& env : envs_) {
+        env->SetPreprocessQueue(preprocess_queue_.get());
+      }
+      for (std::size_t i = 0; i < num_preprocess_threads_; ++i) {
+        preprocess_workers_.emplace_back([this] {
+          for (;;) {
+            auto task = preprocess_queue_->Dequeue();
+            if (stop_ == 1) {
+              break;
+            }
+            task.fn();
+            task.done();
+          }
+        });
+      }
+    }
     if (spec.config["thread_affinity_offset"_] >= 0) {
       std::size_t thread_affinity_offset =
           spec.config["thread_affinity_offset"_];
-      for (std::size_t tid = 0; tid < num_threads_; ++tid) {
+      // preprocess threads are pinned right after the simulation threads
+      std::vector<std::thread*> threads;
+      for (auto& t : workers_) {
+        threads.push_back(&t);
+      }
+      for (auto& t : preprocess_workers_) {
+        threads.push_back(&t);
+      }
+      for (std::size_t tid = 0; tid < threads.size(); ++tid) {
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
         std::size_t cid = (thread_affinity_offset + tid) % processor_count;
         CPU_SET(cid, &cpuset);
-        pthread_setaffinity_np(workers_[tid].native_handle(), sizeof(cpu_set_t),
-                               &cpuset);
+        pthread_setaffinity_np(threads[tid]->native_handle(),
+                               sizeof(cpu_set_t), &cpuset);
       }
     }
   }
 
   ~AsyncEnvPool() override {
+    if (shm_server_ != nullptr) {
+      StopShm();
+    }
+    // joins the supervisor threads, which write to state_buffer_queue_
+    process_pool_.reset();
     stop_ = 1;
     // LOG(INFO) << "envpool send: " << dur_send_.count();
     // LOG(INFO) << "envpool recv: " << dur_recv_.count();
@@ -152,6 +499,12 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
     for (auto& worker : workers_) {
       worker.join();
     }
+    for (std::size_t i = 0; i < preprocess_workers_.size(); ++i) {
+      preprocess_queue_->Enqueue(PreprocessQueue::Task{});
+    }
+    for (auto& worker : preprocess_workers_) {
+      worker.join();
+    }
   }
 
   void Send(const Action& action) {
@@ -162,31 +515,340 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
 
   std::vector<Array> Recv() override {
     int additional_wait = 0;
-    if (is_sync_ && stepping_env_num_ < batch_) {
+    if (IsCounting() && stepping_env_num_ < batch_) {
       additional_wait = batch_ - stepping_env_num_;
     }
     auto start = std::chrono::system_clock::now();
     auto ret = state_buffer_queue_->Wait(additional_wait);
     dur_recv_ += std::chrono::system_clock::now() - start;
-    if (is_sync_) {
+    if (IsCounting()) {
       stepping_env_num_ -= ret[0].Shape(0);
     }
+    if (!collect_quota_.empty()) {
+      CollectStats(ret);
+    }
+    if (recorder_ != nullptr) {
+      recorder_->RecordState(ret);
+    }
     return ret;
   }
 
   void Reset(const Array& env_ids) override {
     TArray<int> tenv_ids(env_ids);
     int shared_offset = tenv_ids.Shape(0);
-    std::vector<ActionSlice> actions(shared_offset);
+    std::vector<ActionSlice> actions;
+    actions.reserve(shared_offset);
     for (int i = 0; i < shared_offset; ++i) {
-      actions[i].force_reset = true;
-      actions[i].env_id = tenv_ids[i];
-      actions[i].order = is_sync_ ? i : -1;
+      int eid = tenv_ids[i];
+      if (IsCollected(eid)) {
+        continue;
+      }
+      actions.emplace_back(ActionSlice{
+          .env_id = eid,
+          .order = is_sync_ ? static_cast<int>(actions.size()) : -1,
+          .force_reset = true,
+      });
+    }
+    if (IsCounting()) {
+      stepping_env_num_ += actions.size();
+    }
+    Enqueue(actions);
+  }
+
+  /**
+   * Enter episode collection mode: every env is reset and has to finish
+   * num_episodes episodes. Afterwards it is no longer scheduled, i.e. its
+   * actions in `Send` are dropped and it is not auto-reset, so `Recv` may
+   * return fewer than batch_size states towards the end. Must be called when
+   * no env is stepping.
+   */
+  void CollectBegin(int num_episodes) override {
+    if (max_num_players_ != 1) {
+      throw std::runtime_error(
+          "collect_episodes is not available for multiplayer environment.");
+    }
+    if (num_episodes <= 0) {
+      throw std::invalid_argument("collect_episodes: num_episodes must be > 0");
+    }
+    if (!is_sync_) {
+      // not tracked in async mode so far
+      stepping_env_num_ = 0;
+    }
+    collect_num_episodes_ = num_episodes;
+    collect_active_ = num_envs_;
+    collect_quota_.assign(num_envs_, num_episodes);
+    collect_running_return_.assign(num_envs_, 0.0f);
+    collect_returns_.assign(num_envs_ * num_episodes, 0.0f);
+    collect_lengths_.assign(num_envs_ * num_episodes, 0);
+    std::vector<int> env_ids = AllEnvIds();
+    Reset(Array(ShapeSpec(sizeof(int), {static_cast<int>(num_envs_)}),
+                reinterpret_cast<char*>(env_ids.data())));
+  }
+
+  /**
+   * Number of envs that have not finished their episodes yet.
+   */
+  std::size_t CollectActive() override { return collect_active_; }
+
+  /**
+   * Leave collection mode and return the per-episode returns and lengths,
+   * both flattened as [num_envs, num_episodes]. Episodes that were not
+   * finished are reported as zero.
+   */
+  std::pair<std::vector<float>, std::vector<int>> CollectEnd() override {
+    collect_quota_.clear();
+    collect_active_ = 0;
+    return {std::move(collect_returns_), std::move(collect_lengths_)};
+  }
+
+  /**
+   * Host this pool for EnvPool clients in other local processes through the
+   * POSIX shared memory segment `name`. Client c owns the next
+   * client_num_envs[c] env ids and receives batches of client_batch_size[c]
+   * states. The pool must be in async mode, and must not be used directly
+   * until `StopShm`.
+   */
+  void ServeShm(const std::string& name,
+                const std::vector<int>& client_num_envs,
+                const std::vector<int>& client_batch_size) override {
+    if (shm_server_ != nullptr) {
+      throw std::runtime_error("serve_shm: already serving");
+    }
+    if (max_num_players_ != 1) {
+      throw std::runtime_error(
+          "serve_shm is not available for multiplayer environment.");
     }
     if (is_sync_) {
-      stepping_env_num_ += shared_offset;
+      throw std::runtime_error(
+          "serve_shm needs an async pool, i.e. batch_size < num_envs");
     }
-    action_buffer_queue_->EnqueueBulk(actions);
+    if (HasContainerType(this->spec.state_spec)) {
+      throw std::runtime_error(
+          "serve_shm: states with container type are not supported");
+    }
+    if (client_num_envs.size() != client_batch_size.size()) {
+      throw std::invalid_argument(
+          "serve_shm: client_num_envs and client_batch_size differ in size");
+    }
+    std::size_t total = 0;
+    for (int n : client_num_envs) {
+      total += n;
+    }
+    if (total != num_envs_) {
+      throw std::invalid_argument("serve_shm: clients own " +
+                                  std::to_string(total) +
+                                  " envs, but num_envs is " +
+                                  std::to_string(num_envs_));
+    }
+    ShmLayout layout(this->spec.action_spec.template AllValues<ShapeSpec>(),
+                     this->spec.state_spec.template AllValues<ShapeSpec>(),
+                     client_num_envs, client_batch_size);
+    shm_server_ = std::make_unique<ShmServer>(name, std::move(layout));
+    // not tracked in async mode so far
+    stepping_env_num_ = 0;
+    shm_thread_ = std::thread([this] { ShmServeLoop(); });
+  }
+
+  /**
+   * Stop serving and remove the segment. Blocked clients are woken up and
+   * get an error. Envs still stepping are received and dropped.
+   */
+  void StopShm() override {
+    if (shm_server_ == nullptr) {
+      return;
+    }
+    shm_server_->Stop();
+    shm_thread_.join();
+    shm_server_->WakeClients();
+    while (stepping_env_num_ > 0) {
+      Recv();
+    }
+    shm_server_.reset();
+  }
+
+  /**
+   * Record every received state and every sent action into the directory
+   * `path` until `RecordEnd`, see `TrajectoryRecorder` for the layout.
+   * With compress, uint8 columns are zlib-compressed. The files are written
+   * by num_threads background threads, recv and send only block when more
+   * than max_backlog bytes are waiting. The received states are recorded
+   * without a copy and must not be modified in place. Must be called before
+   * `ServeShm` when serving.
+   */
+  void RecordBegin(const std::string& path, bool compress, int num_threads,
+                   std::size_t max_backlog) override {
+    if (recorder_ != nullptr) {
+      throw std::runtime_error("record: already recording");
+    }
+    if (shm_server_ != nullptr) {
+      throw std::runtime_error("record: the pool is served, stop_shm first");
+    }
+    if (max_num_players_ != 1) {
+      throw std::runtime_error(
+          "record is not available for multiplayer environment.");
+    }
+    if (HasContainerType(this->spec.state_spec)) {
+      throw std::runtime_error(
+          "record: states with container type are not supported");
+    }
+    recorder_ = std::make_unique<TrajectoryRecorder>(
+        path, num_envs_, Spec::StateSpec::AllKeys(),
+        this->spec.state_spec.template AllValues<ShapeSpec>(),
+        DtypeNames(this->spec.state_spec.AllValues()),
+        Spec::ActionSpec::AllKeys(),
+        this->spec.action_spec.template AllValues<ShapeSpec>(),
+        DtypeNames(this->spec.action_spec.AllValues()), compress, num_threads,
+        max_backlog);
+  }
+
+  /**
+   * Stop recording, wait for the pending writes and write the episode index
+   * and meta.json.
+   */
+  void RecordEnd() override {
+    if (recorder_ == nullptr) {
+      return;
+    }
+    if (shm_server_ != nullptr) {
+      throw std::runtime_error("record: the pool is served, stop_shm first");
+    }
+    auto recorder = std::move(recorder_);
+    recorder->Close();
+  }
+
+  /**
+   * Dump all envs to a single checkpoint file. Each env is serialized by the
+   * worker threads and copied into an mmap-ed file in parallel. Must be
+   * called between recv and the next send, when no env is stepping.
+   */
+  void SaveState(const std::string& path) override {
+    std::vector<std::vector<char>> bufs(num_envs_);
+    ForEachEnv(AllEnvIds(), [&](int env_id, int index) {
+      StateWriter writer(&bufs[env_id]);
+      envs_[env_id]->EnvSaveState(&writer);
+    });
+    std::vector<std::size_t> sizes(num_envs_);
+    for (std::size_t i = 0; i < num_envs_; ++i) {
+      sizes[i] = bufs[i].size();
+    }
+    CheckpointWriter checkpoint(path, sizes);
+    ForEachEnv(AllEnvIds(), [&](int env_id, int index) {
+      std::memcpy(checkpoint.Data(env_id), bufs[env_id].data(),
+                  bufs[env_id].size());
+      std::vector<char>().swap(bufs[env_id]);
+    });
+    checkpoint.Commit();
+  }
+
+  /**
+   * Restore all envs from a file written by `SaveState`. Like `Reset` on all
+   * env ids, the restored observations are then available through `Recv`.
+   */
+  void LoadState(const std::string& path) override {
+    CheckThreadIsolation("load_state");
+    CheckpointReader checkpoint(path);
+    if (checkpoint.NumEntries() != num_envs_) {
+      throw std::runtime_error(
+          "Checkpoint " + path + " has " +
+          std::to_string(checkpoint.NumEntries()) + " envs, but num_envs is " +
+          std::to_string(num_envs_));
+    }
+    if (is_sync_) {
+      stepping_env_num_ += num_envs_;
+    }
+    ForEachEnv(AllEnvIds(), [&](int env_id, int index) {
+      StateReader reader = checkpoint.Reader(env_id);
+      int order = is_sync_ ? index : -1;
+      try {
+        envs_[env_id]->EnvLoadState(state_buffer_queue_.get(), order, &reader);
+      } catch (...) {
+        // keep the state buffer consistent so that the next recv won't hang
+        envs_[env_id]->EnvStep(state_buffer_queue_.get(), order, true);
+        throw;
+      }
+    });
+  }
+
+  /**
+   * Take in-memory snapshots of env_ids in parallel and return one handle
+   * per env. Handles stay valid until `ReleaseSnapshot`. The arena slot size
+   * is sized from the first snapshot ever taken, with 2x headroom.
+   */
+  std::vector<int> Snapshot(const std::vector<int>& env_ids) override {
+    if (env_ids.empty()) {
+      return {};
+    }
+    if (snapshot_arena_ == nullptr) {
+      std::size_t size = 0;
+      ForEachEnv({env_ids[0]}, [&](int env_id, int index) {
+        size = SnapshotToBuffer(env_id).size();
+      });
+      snapshot_arena_ = std::make_unique<SnapshotArena>(
+          Checkpoint::AlignUp(size * 2), num_envs_);
+    }
+    std::vector<int> handles(env_ids.size());
+    for (auto& handle : handles) {
+      handle = snapshot_arena_->Acquire();
+    }
+    try {
+      ForEachEnv(env_ids, [&](int env_id, int index) {
+        snapshot_arena_->Store(handles[index], SnapshotToBuffer(env_id));
+      });
+    } catch (...) {
+      ReleaseSnapshot(handles);
+      throw;
+    }
+    return handles;
+  }
+
+  /**
+   * Restore env_ids[i] from handles[i] in parallel. Nothing is written to the
+   * state buffer; the restored envs continue from the snapshot on the next
+   * send. Must be called when these envs are not stepping.
+   */
+  void Restore(const std::vector<int>& env_ids,
+               const std::vector<int>& handles) override {
+    if (env_ids.size() != handles.size()) {
+      throw std::invalid_argument("Restore: got " +
+                                  std::to_string(env_ids.size()) +
+                                  " env ids but " +
+                                  std::to_string(handles.size()) + " handles");
+    }
+    if (snapshot_arena_ == nullptr) {
+      throw std::out_of_range("Restore: no snapshot has been taken");
+    }
+    ForEachEnv(env_ids, [&](int env_id, int index) {
+      StateReader reader = snapshot_arena_->Reader(handles[index]);
+      envs_[env_id]->EnvRestore(&reader);
+    });
+  }
+
+  void ReleaseSnapshot(const std::vector<int>& handles) override {
+    if (snapshot_arena_ == nullptr) {
+      return;
+    }
+    for (int handle : handles) {
+      snapshot_arena_->Release(handle);
+    }
+  }
+
+  /**
+   * Copy the current state of src_env_id into all dst_env_ids: one snapshot
+   * followed by a parallel restore on the worker threads, without touching
+   * the arena. Like `Restore`, nothing is emitted.
+   */
+  void Branch(int src_env_id, const std::vector<int>& dst_env_ids) override {
+    std::vector<char> buf;
+    ForEachEnv({src_env_id}, [&](int env_id, int index) {
+      buf = SnapshotToBuffer(env_id);
+    });
+    ForEachEnv(dst_env_ids, [&](int env_id, int index) {
+      if (env_id == src_env_id) {
+        return;
+      }
+      StateReader reader(buf.data(), buf.size());
+      envs_[env_id]->EnvRestore(&reader);
+    });
   }
 };
 
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_CHECKPOINT_H_
+#define ENVPOOL_CORE_CHECKPOINT_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envpool/core/serialization.h"
+
+/**
+ * On-disk layout of a whole-pool checkpoint:
+ *
+ *   header  | magic, version, number of entries (one per env)
+ *   table   | num_entries x (offset, size), both uint64_t
+ *   payload | the serialized envs, each starting at a kAlign boundary
+ *
+ * Every entry is aligned so that the file can be mmap-ed and the envs can be
+ * restored in place, in parallel, without an intermediate copy.
+ */
+class Checkpoint {
+ public:
+  static constexpr uint64_t kMagic = 0x31504b4350564e45ULL;  // "ENVPCKP1"
+  static constexpr uint64_t kVersion = 1;
+  static constexpr std::size_t kAlign = 64;
+
+  struct Header {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t num_entries;
+  };
+
+  struct Entry {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  static std::size_t AlignUp(std::size_t x) {
+    return (x + kAlign - 1) / kAlign * kAlign;
+  }
+
+  static std::runtime_error Error(const std::string& what,
+                                  const std::string& path) {
+    return std::runtime_error("Checkpoint: " + what + " " + path + ": " +
+                              std::strerror(errno));
+  }
+};
+
+/**
+ * Creates a checkpoint file with the given entry sizes and maps it for
+ * writing. Entries can be filled concurrently from different threads.
+ * The file is written to `path + ".tmp"` and only renamed to `path` in
+ * `Commit`, so a crash in the middle never leaves a truncated checkpoint.
+ */
+class CheckpointWriter {
+ protected:
+  std::string path_, tmp_path_;
+  int fd_{-1};
+  char* data_{nullptr};
+  std::size_t size_{0};
+  std::vector<Checkpoint::Entry> entries_;
+
+ public:
+  CheckpointWriter(std::string path, const std::vector<std::size_t>& sizes)
+      : path_(std::move(path)), tmp_path_(path_ + ".tmp") {
+    std::size_t offset = Checkpoint::AlignUp(
+        sizeof(Checkpoint::Header) + sizes.size() * sizeof(Checkpoint::Entry));
+    for (auto size : sizes) {
+      entries_.push_back(Checkpoint::Entry{offset, size});
+      offset = Checkpoint::AlignUp(offset + size);
+    }
+    size_ = offset;
+    fd_ = open(tmp_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw Checkpoint::Error("cannot create", tmp_path_);
+    }
+    if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+      Close();
+      throw Checkpoint::Error("cannot resize", tmp_path_);
+    }
+    void* ptr =
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (ptr == MAP_FAILED) {
+      Close();
+      throw Checkpoint::Error("cannot mmap", tmp_path_);
+    }
+    data_ = static_cast<char*>(ptr);
+    Checkpoint::Header header{Checkpoint::kMagic, Checkpoint::kVersion,
+                              sizes.size()};
+    std::memcpy(data_, &header, sizeof(header));
+    std::memcpy(data_ + sizeof(header), entries_.data(),
+                entries_.size() * sizeof(Checkpoint::Entry));
+  }
+
+  ~CheckpointWriter() {
+    if (fd_ >= 0) {
+      Close();
+      unlink(tmp_path_.c_str());
+    }
+  }
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  /**
+   * Pointer to the memory reserved for entry `i`, of the size given at
+   * construction time.
+   */
+  char* Data(std::size_t i) { return data_ + entries_[i].offset; }
+
+  /**
+   * Flush the mapping to disk and atomically move the file into place.
+   */
+  void Commit() {
+    if (msync(data_, size_, MS_SYNC) != 0) {
+      throw Checkpoint::Error("cannot sync", tmp_path_);
+    }
+    Close();
+    if (std::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+      throw Checkpoint::Error("cannot rename to", path_);
+    }
+  }
+
+ protected:
+  void Close() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+      data_ = nullptr;
+    }
+    close(fd_);
+    fd_ = -1;
+  }
+};
+
+/**
+ * Read-only mmap view of a checkpoint file written by `CheckpointWriter`.
+ */
+class CheckpointReader {
+ protected:
+  const char* data_{nullptr};
+  std::size_t size_{0};
+  std::vector<Checkpoint::Entry> entries_;
+
+ public:
+  explicit CheckpointReader(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw Checkpoint::Error("cannot open", path);
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw Checkpoint::Error("cannot stat", path);
+    }
+    size_ = st.st_size;
+    if (size_ < sizeof(Checkpoint::Header)) {
+      close(fd);
+      throw std::runtime_error("Checkpoint: " + path + " is truncated");
+    }
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw Checkpoint::Error("cannot mmap", path);
+    }
+    data_ = static_cast<const char*>(ptr);
+    Checkpoint::Header header{};
+    std::memcpy(&header, data_, sizeof(header));
+    if (header.magic != Checkpoint::kMagic ||
+        header.version != Checkpoint::kVersion) {
+      Unmap();
+      throw std::runtime_error("Checkpoint: " + path +
+                               " is not an envpool checkpoint");
+    }
+    std::size_t table_end = sizeof(header) +
+                            header.num_entries * sizeof(Checkpoint::Entry);
+    if (table_end > size_) {
+      Unmap();
+      throw std::runtime_error("Checkpoint: " + path + " is truncated");
+    }
+    entries_.resize(header.num_entries);
+    std::memcpy(entries_.data(), data_ + sizeof(header),
+                header.num_entries * sizeof(Checkpoint::Entry));
+    for (const auto& e : entries_) {
+      if (e.offset + e.size > size_) {
+        Unmap();
+        throw std::runtime_error("Checkpoint: " + path + " is truncated");
+      }
+    }
+  }
+
+  ~CheckpointReader() { Unmap(); }
+
+  CheckpointReader(const CheckpointReader&) = delete;
+  CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+  [[nodiscard]] std::size_t NumEntries() const { return entries_.size(); }
+
+  [[nodiscard]] StateReader Reader(std::size_t i) const {
+    return {data_ + entries_[i].offset, entries_[i].size};
+  }
+
+ protected:
+  void Unmap() {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+      data_ = nullptr;
+    }
+  }
+};
+
+#endif  // ENVPOOL_CORE_CHECKPOINT_H_
@@ -0,0 +1,101 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/checkpoint.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST(CheckpointTest, SerializationRoundTrip) {
+  std::vector<char> buf;
+  StateWriter writer(&buf);
+  std::mt19937 gen(42);
+  gen();
+  writer.Write(gen);
+  writer.Write(3.5);
+  std::vector<int> ints({1, 2, 3});
+  writer.Write(ints.data(), ints.size());
+  writer.WriteString("envpool");
+  TArray<uint8_t> arr(Spec<uint8_t>({2, 3}));
+  for (int i = 0; i < 6; ++i) {
+    arr(i / 3, i % 3) = static_cast<uint8_t>(i * 7);
+  }
+  writer.WriteArray(arr);
+  EXPECT_EQ(writer.Size(), buf.size());
+
+  StateReader reader(buf.data(), buf.size());
+  std::mt19937 gen2;
+  reader.Read(&gen2);
+  EXPECT_EQ(gen(), gen2());
+  EXPECT_EQ(reader.Read<double>(), 3.5);
+  std::vector<int> ints2(3);
+  reader.Read(ints2.data(), ints2.size());
+  EXPECT_EQ(ints, ints2);
+  EXPECT_EQ(reader.ReadString(), "envpool");
+  TArray<uint8_t> arr2(Spec<uint8_t>({2, 3}));
+  reader.ReadArray(arr2);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(static_cast<int>(arr2(i / 3, i % 3)), i * 7);
+  }
+  EXPECT_EQ(reader.Offset(), buf.size());
+  EXPECT_THROW(reader.Read<int>(), std::out_of_range);
+}
+
+TEST(CheckpointTest, WriteRead) {
+  std::string path = testing::TempDir() + "/checkpoint_test.bin";
+  std::vector<std::size_t> sizes({5, 0, 130});
+  {
+    CheckpointWriter writer(path, sizes);
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(writer.Data(i)) %
+                    Checkpoint::kAlign,
+                0);
+      for (std::size_t j = 0; j < sizes[i]; ++j) {
+        writer.Data(i)[j] = static_cast<char>(i + j);
+      }
+    }
+    writer.Commit();
+  }
+  CheckpointReader reader(path);
+  ASSERT_EQ(reader.NumEntries(), sizes.size());
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    StateReader r = reader.Reader(i);
+    EXPECT_EQ(r.Size(), sizes[i]);
+    for (std::size_t j = 0; j < sizes[i]; ++j) {
+      EXPECT_EQ(r.Read<char>(), static_cast<char>(i + j));
+    }
+  }
+  std::remove(path.c_str());
+}
+
+TEST(CheckpointTest, Invalid) {
+  std::string path = testing::TempDir() + "/checkpoint_invalid.bin";
+  EXPECT_THROW(CheckpointReader reader(path), std::runtime_error);
+  {
+    std::ofstream f(path);
+    f << "definitely not a checkpoint";
+  }
+  EXPECT_THROW(CheckpointReader reader(path), std::runtime_error);
+  {
+    // an uncommitted writer leaves nothing behind
+    CheckpointWriter writer(path + ".new", {16});
+  }
+  EXPECT_THROW(CheckpointReader reader(path + ".new"), std::runtime_error);
+  std::remove(path.c_str());
+}
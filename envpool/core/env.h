@@ -17,6 +17,7 @@
 #ifndef ENVPOOL_CORE_ENV_H_
 #define ENVPOOL_CORE_ENV_H_
 
+#include <functional>
 #include <memory>
 #include <random>
 #include <tuple>
@@ -25,7 +26,10 @@
 #include <vector>
 
 #include "envpool/core/env_spec.h"
+#include "envpool/core/preprocess_queue.h"
+#include "envpool/core/serialization.h"
 #include "envpool/core/state_buffer_queue.h"
+#include "envpool/core/video_recorder.h"
 
 template <typename Dtype>
 struct InitializeHelper {
@@ -71,6 +75,14 @@ class Env {
   int order_, current_step_{-1};
   bool is_single_player_;
   StateBuffer::WritableSlice slice_;
+  // where `Allocate` writes when there is no state buffer queue
+  const std::vector<Array>* state_row_{nullptr};
+  // observation processing deferred by `Defer`, and where to run it
+  std::function<void()> deferred_;
+  PreprocessQueue* preprocess_queue_{nullptr};
+  // episode video recording, video_episode_ is -1 if this one isn't recorded
+  VideoRecorder* video_{nullptr};
+  int num_episodes_{0}, video_episode_{-1};
   // for parsing single env action from input action batch
   std::vector<ShapeSpec> action_specs_;
   std::vector<bool> is_player_action_;
@@ -103,6 +115,20 @@ class Env {
 
   virtual ~Env() = default;
 
+  /**
+   * Run the work passed to `Defer` on the preprocessing workers that drain
+   * this queue instead of inline; nullptr turns the pipeline off.
+   */
+  void SetPreprocessQueue(PreprocessQueue* queue) {
+    preprocess_queue_ = queue;
+  }
+
+  /**
+   * Push the frames of the sampled episodes to this recorder; nullptr turns
+   * the recording off.
+   */
+  void SetVideoRecorder(VideoRecorder* video) { video_ = video; }
+
   void SetAction(std::shared_ptr<std::vector<Array>> action_batch,
                  int env_index) {
     action_batch_ = std::move(action_batch);
@@ -171,30 +197,160 @@ class Env {
     PostProcess();
   }
 
+  /**
+   * Like `EnvStep`, but the state is written into state_row, a slice shaped
+   * like the ones of `StateBuffer::Allocate`, instead of a state buffer
+   * queue. Used in worker processes, see `ProcessPool`.
+   */
+  void EnvStepInto(const std::vector<Array>& state_row, bool reset) {
+    state_row_ = &state_row;
+    EnvStep(nullptr, -1, reset);
+  }
+
+  /**
+   * Serialize this env, including the rng and step counter owned by the base
+   * class, see `SaveState`.
+   */
+  void EnvSaveState(StateWriter* writer) {
+    writer->Write(gen_);
+    writer->Write(current_step_);
+    SaveState(writer);
+  }
+
+  /**
+   * Restore a state written by `EnvSaveState`. Like a reset, it writes the
+   * restored observation to the state buffer queue.
+   */
+  void EnvLoadState(StateBufferQueue* sbq, int order, StateReader* reader) {
+    sbq_ = sbq;
+    order_ = order;
+    reader->Read(&gen_);
+    reader->Read(&current_step_);
+    LoadState(reader);
+    PostProcess();
+  }
+
+  /**
+   * In-memory counterpart of `EnvSaveState`, see `Snapshot`.
+   */
+  void EnvSnapshot(StateWriter* writer) {
+    writer->Write(gen_);
+    writer->Write(current_step_);
+    Snapshot(writer);
+  }
+
+  /**
+   * Restore a state written by `EnvSnapshot` without emitting anything, the
+   * next send continues from there.
+   */
+  void EnvRestore(StateReader* reader) {
+    reader->Read(&gen_);
+    reader->Read(&current_step_);
+    Restore(reader);
+  }
+
   virtual void Reset() { throw std::runtime_error("reset not implemented"); }
   virtual void Step(const Action& action) {
     throw std::runtime_error("step not implemented");
   }
   virtual bool IsDone() { throw std::runtime_error("is_done not implemented"); }
 
+  /**
+   * Write everything needed to resume the current episode: simulator state,
+   * counters and frame stacks. The rng `gen_` is handled by the caller.
+   */
+  virtual void SaveState(StateWriter* writer) {
+    throw std::runtime_error("save_state not implemented");
+  }
+
+  /**
+   * Read back what `SaveState` wrote, then `Allocate` and write the current
+   * observation, the same way as `Reset` does. Usually it is `Restore`
+   * followed by the env's own state writing.
+   */
+  virtual void LoadState(StateReader* reader) {
+    throw std::runtime_error("load_state not implemented");
+  }
+
+  /**
+   * Snapshot for in-process branching. By default it is the same as
+   * `SaveState`; override it if something can be skipped in memory.
+   */
+  virtual void Snapshot(StateWriter* writer) { SaveState(writer); }
+
+  /**
+   * Restore what `Snapshot` wrote. Unlike `LoadState`, it must not call
+   * `Allocate`.
+   */
+  virtual void Restore(StateReader* reader) {
+    throw std::runtime_error("restore not implemented");
+  }
+
  protected:
   void PreProcess(StateBufferQueue* sbq, int order, bool reset) {
     sbq_ = sbq;
     order_ = order;
     if (reset) {
       current_step_ = 0;
+      if (video_ != nullptr) {
+        video_episode_ =
+            video_->Sample(env_id_, num_episodes_) ? num_episodes_ : -1;
+        ++num_episodes_;
+      }
     } else {
       ++current_step_;
     }
   }
 
   void PostProcess() {
+    if (video_ != nullptr && video_episode_ >= 0) {
+      CaptureFrame();
+    }
+    if (deferred_) {
+      if (preprocess_queue_ != nullptr) {
+        preprocess_queue_->Enqueue(PreprocessQueue::Task{
+            .fn = std::move(deferred_), .done = slice_.done_write});
+        deferred_ = nullptr;
+        return;
+      }
+      deferred_();
+      deferred_ = nullptr;
+    }
     slice_.done_write();
     // action_batch_.reset();
   }
 
+  // runs once the state row is complete, i.e. after the deferred work
+  void CaptureFrame() {
+    auto push = [video = video_, env_id = env_id_, episode = video_episode_,
+                 arr = slice_.arr] { video->Push(env_id, episode, arr); };
+    if (!deferred_) {
+      push();
+      return;
+    }
+    deferred_ = [fn = std::move(deferred_), push = std::move(push)] {
+      fn();
+      push();
+    };
+  }
+
+  /**
+   * Finish the allocated state later with fn, e.g. image post-processing and
+   * writing obs. With num_preprocess_threads > 0, fn runs on a preprocessing
+   * worker after Reset/Step returns, so the simulation worker can move on to
+   * the next env; otherwise it runs inline. The state is handed out only
+   * after fn is done, and the env isn't stepped again before that, so fn may
+   * use the env's own buffers, but must not touch the simulator.
+   */
+  void Defer(std::function<void()> fn) { deferred_ = std::move(fn); }
+
   State Allocate(int player_num = 1) {
-    slice_ = sbq_->Allocate(player_num, order_);
+    if (sbq_ != nullptr) {
+      slice_ = sbq_->Allocate(player_num, order_);
+    } else {
+      slice_ = StateBuffer::WritableSlice{.arr = *state_row_,
+                                          .done_write = [] {}};
+    }
     State state(slice_.arr);
     bool done = IsDone();
     int max_episode_steps = spec_.config["max_episode_steps"_];
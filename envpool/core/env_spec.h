@@ -26,6 +26,10 @@
 auto common_config =
     MakeDict("num_envs"_.Bind(1), "batch_size"_.Bind(0), "num_threads"_.Bind(0),
              "max_num_players"_.Bind(1), "thread_affinity_offset"_.Bind(-1),
+             "num_preprocess_threads"_.Bind(0),
+             "isolation"_.Bind(std::string("thread")),
+             "video_path"_.Bind(std::string("")), "video_num_envs"_.Bind(1),
+             "video_every"_.Bind(1), "video_format"_.Bind(std::string("mjpeg")),
              "base_path"_.Bind(std::string("envpool")), "seed"_.Bind(42),
              "gym_reset_return_info"_.Bind(false),
              "max_episode_steps"_.Bind(std::numeric_limits<int>::max()));
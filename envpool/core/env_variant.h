@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_ENV_VARIANT_H_
+#define ENVPOOL_CORE_ENV_VARIANT_H_
+
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Config-specialized env variants.
+ *
+ * When the hot loops of an env depend on a few config values, the env can
+ * derive a templated subclass taking these values as template parameters and
+ * list the most common combinations in a dispatch table. If the env defines
+ *
+ *   static std::unique_ptr<Env> Create(const Spec& spec, int env_id);
+ *
+ * `AsyncEnvPool` constructs it through `Create`, which usually forwards to
+ * `DispatchEnvVariant`. Configs missing from the table fall back to the
+ * generic env with runtime checks.
+ */
+template <typename Base, typename Key>
+struct EnvVariant {
+  Key key;
+  std::unique_ptr<Base> (*create)(const typename Base::Spec& spec, int env_id);
+};
+
+template <typename Derived, typename Base>
+std::unique_ptr<Base> CreateEnvVariant(const typename Base::Spec& spec,
+                                       int env_id) {
+  return std::make_unique<Derived>(spec, env_id);
+}
+
+template <typename Base, typename Key, std::size_t N>
+std::unique_ptr<Base> DispatchEnvVariant(
+    const std::array<EnvVariant<Base, Key>, N>& table, const Key& key,
+    const typename Base::Spec& spec, int env_id) {
+  for (const auto& variant : table) {
+    if (variant.key == key) {
+      return variant.create(spec, env_id);
+    }
+  }
+  return std::make_unique<Base>(spec, env_id);
+}
+
+/**
+ * Construct an env through `Env::Create` if there is one, or its
+ * constructor otherwise.
+ */
+template <typename Env, typename = void>
+struct EnvCreator {
+  static std::unique_ptr<Env> Create(const typename Env::Spec& spec,
+                                     int env_id) {
+    return std::make_unique<Env>(spec, env_id);
+  }
+};
+
+template <typename Env>
+struct EnvCreator<Env, std::void_t<decltype(Env::Create(
+                           std::declval<const typename Env::Spec&>(), 0))>> {
+  static std::unique_ptr<Env> Create(const typename Env::Spec& spec,
+                                     int env_id) {
+    return Env::Create(spec, env_id);
+  }
+};
+
+#endif  // ENVPOOL_CORE_ENV_VARIANT_H_
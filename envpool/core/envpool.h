@@ -17,6 +17,7 @@
 #ifndef ENVPOOL_CORE_ENVPOOL_H_
 #define ENVPOOL_CORE_ENVPOOL_H_
 
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -48,6 +49,52 @@ class EnvPool {
   virtual void Reset(const Array& env_ids) {
     throw std::runtime_error("reset not implemented");
   }
+  virtual void SaveState(const std::string& path) {
+    throw std::runtime_error("save_state not implemented");
+  }
+  virtual void LoadState(const std::string& path) {
+    throw std::runtime_error("load_state not implemented");
+  }
+  virtual std::vector<int> Snapshot(const std::vector<int>& env_ids) {
+    throw std::runtime_error("snapshot not implemented");
+  }
+  virtual void Restore(const std::vector<int>& env_ids,
+                       const std::vector<int>& handles) {
+    throw std::runtime_error("restore not implemented");
+  }
+  virtual void ReleaseSnapshot(const std::vector<int>& handles) {
+    throw std::runtime_error("release_snapshot not implemented");
+  }
+  virtual void Branch(int src_env_id, const std::vector<int>& dst_env_ids) {
+    throw std::runtime_error("branch not implemented");
+  }
+  virtual void CollectBegin(int num_episodes) {
+    throw std::runtime_error("collect_episodes not implemented");
+  }
+  virtual std::size_t CollectActive() {
+    throw std::runtime_error("collect_episodes not implemented");
+  }
+  virtual std::pair<std::vector<float>, std::vector<int>> CollectEnd() {
+    throw std::runtime_error("collect_episodes not implemented");
+  }
+  virtual void ServeShm(const std::string& name,
+                        const std::vector<int>& client_num_envs,
+                        const std::vector<int>& client_batch_size) {
+    throw std::runtime_error("serve_shm not implemented");
+  }
+  virtual void StopShm() {
+    throw std::runtime_error("stop_shm not implemented");
+  }
+  virtual void ConnectShm(const std::string& name, int client_id) {
+    throw std::runtime_error("connect_shm not implemented");
+  }
+  virtual void RecordBegin(const std::string& path, bool compress,
+                           int num_threads, std::size_t max_backlog) {
+    throw std::runtime_error("record not implemented");
+  }
+  virtual void RecordEnd() {
+    throw std::runtime_error("record not implemented");
+  }
 };
 
 #endif  // ENVPOOL_CORE_ENVPOOL_H_
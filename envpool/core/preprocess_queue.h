@@ -0,0 +1,93 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_PREPROCESS_QUEUE_H_
+#define ENVPOOL_CORE_PREPROCESS_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "lightweightsemaphore.h"
+
+/**
+ * Ring buffer between the simulation workers and the preprocessing workers
+ * of a pipelined EnvPool. Enqueues and dequeues are each serialized by a
+ * binary semaphore, and a counting semaphore makes Dequeue block until a
+ * task is available, the same scheme as ActionBufferQueue.
+ *
+ * Each task is the deferred observation processing of one env step, plus the
+ * `done_write` callback of its state buffer slice. Since an env can't be
+ * stepped again before its state is received, there are at most num_envs
+ * pending tasks, and a ring of 2 * num_envs never overflows.
+ */
+class PreprocessQueue {
+ public:
+  struct Task {
+    std::function<void()> fn;
+    std::function<void()> done;
+  };
+
+ protected:
+  std::atomic<uint64_t> alloc_ptr_, done_ptr_;
+  std::size_t queue_size_;
+  std::vector<Task> queue_;
+  moodycamel::LightweightSemaphore sem_, sem_enqueue_, sem_dequeue_;
+
+ public:
+  explicit PreprocessQueue(std::size_t num_envs)
+      : alloc_ptr_(0),
+        done_ptr_(0),
+        queue_size_(num_envs * 2),
+        queue_(queue_size_),
+        sem_(0),
+        sem_enqueue_(1),
+        sem_dequeue_(1) {}
+
+  /**
+   * Called by the simulation workers, possibly from many threads at once.
+   */
+  void Enqueue(Task task) {
+    while (!sem_enqueue_.wait()) {
+    }
+    uint64_t pos = alloc_ptr_.fetch_add(1);
+    queue_[pos % queue_size_] = std::move(task);
+    sem_.signal(1);
+    sem_enqueue_.signal(1);
+  }
+
+  /**
+   * Called by the preprocessing workers, blocks until a task is available.
+   */
+  Task Dequeue() {
+    while (!sem_.wait()) {
+    }
+    while (!sem_dequeue_.wait()) {
+    }
+    auto ptr = done_ptr_.fetch_add(1);
+    Task ret = std::move(queue_[ptr % queue_size_]);
+    sem_dequeue_.signal(1);
+    return ret;
+  }
+
+  std::size_t SizeApprox() {
+    return static_cast<std::size_t>(alloc_ptr_ - done_ptr_);
+  }
+};
+
+#endif  // ENVPOOL_CORE_PREPROCESS_QUEUE_H_
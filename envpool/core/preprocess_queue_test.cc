@@ -0,0 +1,83 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/preprocess_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(PreprocessQueueTest, ManyProducersManyConsumers) {
+  std::size_t num_envs = 64;
+  std::size_t num_producers = 4;
+  std::size_t num_consumers = 3;
+  std::size_t num_rounds = 2000;
+  PreprocessQueue queue(num_envs);
+  std::vector<std::atomic<int>> processed(num_envs);
+  std::vector<std::atomic<int>> finished(num_envs);
+  std::atomic<std::size_t> total(0);
+  std::vector<std::thread> consumers;
+  for (std::size_t i = 0; i < num_consumers; ++i) {
+    consumers.emplace_back([&] {
+      for (;;) {
+        auto task = queue.Dequeue();
+        if (!task.fn) {
+          break;
+        }
+        task.fn();
+        task.done();
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (std::size_t p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&, p] {
+      // every producer owns a disjoint set of envs, and an env is only
+      // enqueued again once its previous task is done
+      for (std::size_t r = 0; r < num_rounds; ++r) {
+        for (std::size_t e = p; e < num_envs; e += num_producers) {
+          while (finished[e] != static_cast<int>(r)) {
+          }
+          queue.Enqueue(PreprocessQueue::Task{
+              .fn = [&, e] { ++processed[e]; },
+              .done =
+                  [&, e] {
+                    EXPECT_EQ(processed[e], finished[e] + 1);
+                    ++finished[e];
+                    ++total;
+                  },
+          });
+        }
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  while (total != num_envs * num_rounds) {
+  }
+  EXPECT_EQ(queue.SizeApprox(), 0);
+  for (std::size_t i = 0; i < num_consumers; ++i) {
+    queue.Enqueue(PreprocessQueue::Task{});
+  }
+  for (auto& t : consumers) {
+    t.join();
+  }
+  for (std::size_t e = 0; e < num_envs; ++e) {
+    EXPECT_EQ(processed[e], static_cast<int>(num_rounds));
+    EXPECT_EQ(finished[e], static_cast<int>(num_rounds));
+  }
+}
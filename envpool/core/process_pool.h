@@ -0,0 +1,510 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_PROCESS_POOL_H_
+#define ENVPOOL_CORE_PROCESS_POOL_H_
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <poll.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "envpool/core/action_buffer_queue.h"
+#include "envpool/core/array.h"
+#include "envpool/core/shm_envpool.h"
+#include "envpool/core/spec.h"
+
+/**
+ * Worker processes of an `AsyncEnvPool` with isolation="process".
+ *
+ * Env i lives in worker process i % num_processes. Every env has one action
+ * row and one state row in an anonymous shared mapping: the parent copies
+ * the env's action into its row and queues a task on the process' request
+ * ring, the process steps the env, writes the state row and puts the env id
+ * on its done ring. One supervisor thread per process hands finished rows
+ * back to the pool, and restarts the process if it died: its envs are built
+ * again, and those in flight come back as resets.
+ *
+ * Processes are forked by a fork server, which is itself forked in the
+ * constructor, before the pool starts any thread, so that no worker inherits
+ * a lock held by a thread that does not exist in it.
+ */
+class ProcessPool {
+ public:
+  using Task = ActionBufferQueue::ActionSlice;
+  // runs in a new worker process, builds its envs and calls `Serve`
+  using WorkerMain = std::function<void(ProcessPool* pool, int index)>;
+  // runs on a supervisor thread when the state row of env_id is written
+  using DoneFn = std::function<void(int env_id, int order,
+                                    const std::vector<Array>& state_row)>;
+
+ protected:
+  struct Header {
+    std::atomic<int32_t> stop;
+  };
+
+  struct Channel {
+    std::atomic<uint64_t> request_head;
+    std::atomic<uint64_t> done_head;
+    sem_t request_sem;
+    sem_t done_sem;
+  };
+
+  struct Entry {
+    int32_t env_id;
+    int32_t order;
+    int32_t force_reset;
+  };
+
+  static constexpr int kIdle = -2;
+  static constexpr int kStopServer = -1;
+  // how long a supervisor waits before checking that its process is alive
+  static constexpr long kCheckIntervalNs = 100000000;  // NOLINT
+
+  std::size_t num_envs_, num_processes_, ring_size_;
+  int affinity_offset_;
+  WorkerMain main_;
+  DoneFn done_;
+  char* base_{nullptr};
+  std::size_t size_{0};
+  Header* header_;
+  std::vector<Channel*> channels_;
+  std::vector<Entry*> request_rings_;
+  std::vector<int32_t*> done_rings_;
+  std::vector<std::vector<Array>> action_rows_, state_rows_;
+  pid_t server_pid_{-1};
+  int request_fd_{-1}, reply_fd_{-1};
+  std::mutex server_mutex_;
+  std::vector<pid_t> pids_;
+  std::vector<std::unique_ptr<std::mutex>> mutexes_;
+  // order of the task in flight of each env, kIdle if none
+  std::vector<int> inflight_;
+  std::vector<std::thread> supervisors_;
+  std::atomic<int> num_restarts_{0};
+
+  static bool ReadAll(int fd, void* data, std::size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+      ssize_t n = read(fd, p, size);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  static bool WriteAll(int fd, const void* data, std::size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+      ssize_t n = write(fd, p, size);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  static void SemWait(sem_t* sem) {
+    while (sem_wait(sem) != 0 && errno == EINTR) {
+    }
+  }
+
+  /**
+   * Fork server loop: fork a worker for every process index read from the
+   * request pipe and reply its pid. Exits with the parent, killing the
+   * workers, which also die with it.
+   */
+  [[noreturn]] void RunServer(pid_t parent, int request_fd, int reply_fd) {
+    signal(SIGCHLD, SIG_IGN);  // reap workers automatically
+    std::vector<pid_t> workers(num_processes_, 0);
+    for (;;) {
+      pollfd pfd{.fd = request_fd, .events = POLLIN, .revents = 0};
+      if (poll(&pfd, 1, 1000) == 0) {
+        if (getppid() != parent) {
+          break;
+        }
+        continue;
+      }
+      int index = kStopServer;
+      if (!ReadAll(request_fd, &index, sizeof(index)) || index < 0) {
+        break;
+      }
+      pid_t pid = fork();
+      if (pid == 0) {
+        close(request_fd);
+        close(reply_fd);
+        RunWorker(index);
+      }
+      workers[index] = pid;
+      if (!WriteAll(reply_fd, &pid, sizeof(pid))) {
+        break;
+      }
+    }
+    for (pid_t pid : workers) {
+      if (pid > 0) {
+        kill(pid, SIGKILL);
+      }
+    }
+    _exit(0);
+  }
+
+  [[noreturn]] void RunWorker(int index) {
+    pid_t server = getppid();
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != server) {
+      _exit(1);
+    }
+    signal(SIGCHLD, SIG_DFL);
+    if (affinity_offset_ >= 0) {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      std::size_t processor_count = std::thread::hardware_concurrency();
+      CPU_SET((affinity_offset_ + index) % processor_count, &cpuset);
+      sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
+    }
+    try {
+      main_(this, index);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "envpool worker process " << index << ": " << e.what();
+      _exit(1);
+    }
+    _exit(0);
+  }
+
+  pid_t Spawn(int index) {
+    std::lock_guard<std::mutex> lock(server_mutex_);
+    pid_t pid = -1;
+    if (!WriteAll(request_fd_, &index, sizeof(index)) ||
+        !ReadAll(reply_fd_, &pid, sizeof(pid)) || pid < 0) {
+      throw std::runtime_error("envpool: failed to fork a worker process");
+    }
+    return pid;
+  }
+
+  [[nodiscard]] bool Alive(int index) const {
+    return kill(pids_[index], 0) == 0 || errno != ESRCH;
+  }
+
+  /**
+   * Start a new process in place of a dead one. Its rings are cleared, and
+   * the envs it had in flight are queued again as resets, so that every task
+   * still gets its state.
+   */
+  void Restart(int index) {
+    std::lock_guard<std::mutex> lock(*mutexes_[index]);
+    Channel* channel = channels_[index];
+    uint64_t head = 0;
+    for (std::size_t env_id = index; env_id < num_envs_;
+         env_id += num_processes_) {
+      if (inflight_[env_id] != kIdle) {
+        request_rings_[index][head++ % ring_size_] =
+            Entry{static_cast<int32_t>(env_id), inflight_[env_id], 1};
+      }
+    }
+    sem_destroy(&channel->request_sem);
+    sem_destroy(&channel->done_sem);
+    sem_init(&channel->request_sem, 1, head);
+    sem_init(&channel->done_sem, 1, 0);
+    channel->request_head = head;
+    channel->done_head = 0;
+    pids_[index] = Spawn(index);
+    ++num_restarts_;
+    LOG(WARNING) << "envpool worker process " << index
+                 << " died, restarted with " << head << " envs reset";
+  }
+
+  void Supervise(int index) {
+    Channel* channel = channels_[index];
+    uint64_t tail = 0;
+    while (header_->stop == 0) {
+      timespec deadline{};
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += kCheckIntervalNs;
+      if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_nsec -= 1000000000;
+        ++deadline.tv_sec;
+      }
+      bool timeout = sem_timedwait(&channel->done_sem, &deadline) != 0 &&
+                     errno == ETIMEDOUT;
+      uint64_t head = channel->done_head.load(std::memory_order_acquire);
+      for (; tail < head; ++tail) {
+        int env_id = done_rings_[index][tail % ring_size_];
+        int order;
+        {
+          std::lock_guard<std::mutex> lock(*mutexes_[index]);
+          order = inflight_[env_id];
+          inflight_[env_id] = kIdle;
+        }
+        done_(env_id, order, state_rows_[env_id]);
+      }
+      if (timeout && header_->stop == 0 && !Alive(index)) {
+        Restart(index);
+        tail = 0;
+      }
+    }
+  }
+
+ public:
+  ProcessPool(std::size_t num_envs, std::size_t num_processes,
+              const std::vector<ShapeSpec>& action_specs,
+              const std::vector<ShapeSpec>& state_specs, int affinity_offset,
+              WorkerMain main)
+      : num_envs_(num_envs),
+        num_processes_(num_processes),
+        ring_size_(num_envs * 2),
+        affinity_offset_(affinity_offset),
+        main_(std::move(main)),
+        pids_(num_processes, -1),
+        inflight_(num_envs, kIdle) {
+    for (const auto& spec : state_specs) {
+      if (spec.shape.size() > 1 &&
+          std::find(spec.shape.begin() + 1, spec.shape.end(), -1) !=
+              spec.shape.end()) {
+        throw std::invalid_argument(
+            "isolation=\"process\": states with dynamic (-1) shape are not "
+            "supported");
+      }
+    }
+    // header | channels | request rings | done rings | env rows
+    std::size_t offset = ShmLayout::AlignUp(sizeof(Header));
+    std::vector<std::size_t> channel_offset, request_offset, done_offset;
+    for (std::size_t i = 0; i < num_processes_; ++i) {
+      channel_offset.push_back(offset);
+      offset = ShmLayout::AlignUp(offset + sizeof(Channel));
+    }
+    for (std::size_t i = 0; i < num_processes_; ++i) {
+      request_offset.push_back(offset);
+      offset = ShmLayout::AlignUp(offset + sizeof(Entry) * ring_size_);
+      done_offset.push_back(offset);
+      offset = ShmLayout::AlignUp(offset + sizeof(int32_t) * ring_size_);
+    }
+    std::size_t rows_offset = offset;
+    for (std::size_t i = 0; i < num_envs_; ++i) {
+      for (const auto* specs : {&action_specs, &state_specs}) {
+        for (const auto& spec : *specs) {
+          offset = ShmLayout::AlignUp(offset + ShmLayout::RowSize(spec));
+        }
+      }
+    }
+    size_ = offset;
+    void* ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      throw std::runtime_error(std::string("envpool: mmap failed: ") +
+                               std::strerror(errno));
+    }
+    base_ = static_cast<char*>(ptr);
+    header_ = new (base_) Header;
+    header_->stop = 0;
+    for (std::size_t i = 0; i < num_processes_; ++i) {
+      auto* channel = new (base_ + channel_offset[i]) Channel;
+      channel->request_head = 0;
+      channel->done_head = 0;
+      sem_init(&channel->request_sem, 1, 0);
+      sem_init(&channel->done_sem, 1, 0);
+      channels_.push_back(channel);
+      request_rings_.push_back(
+          reinterpret_cast<Entry*>(base_ + request_offset[i]));
+      done_rings_.push_back(
+          reinterpret_cast<int32_t*>(base_ + done_offset[i]));
+      mutexes_.emplace_back(std::make_unique<std::mutex>());
+    }
+    // rows are views of one env, shaped like the slices that
+    // `StateBuffer::Allocate` hands out
+    offset = rows_offset;
+    for (std::size_t i = 0; i < num_envs_; ++i) {
+      std::vector<Array> actions, states;
+      for (const auto& spec : action_specs) {
+        actions.emplace_back(ShmLayout::RowsSpec(spec, 1), base_ + offset);
+        offset = ShmLayout::AlignUp(offset + ShmLayout::RowSize(spec));
+      }
+      for (const auto& spec : state_specs) {
+        Array row(ShmLayout::RowsSpec(spec, 1), base_ + offset);
+        bool is_player = !spec.shape.empty() && spec.shape[0] == -1;
+        states.emplace_back(is_player ? row : row[0]);
+        offset = ShmLayout::AlignUp(offset + ShmLayout::RowSize(spec));
+      }
+      action_rows_.emplace_back(std::move(actions));
+      state_rows_.emplace_back(std::move(states));
+    }
+    int request_pipe[2];
+    int reply_pipe[2];
+    if (pipe2(request_pipe, O_CLOEXEC) != 0 ||
+        pipe2(reply_pipe, O_CLOEXEC) != 0) {
+      munmap(base_, size_);
+      throw std::runtime_error("envpool: failed to create the fork server");
+    }
+    pid_t parent = getpid();
+    server_pid_ = fork();
+    if (server_pid_ == 0) {
+      close(request_pipe[1]);
+      close(reply_pipe[0]);
+      RunServer(parent, request_pipe[0], reply_pipe[1]);
+    }
+    close(request_pipe[0]);
+    close(reply_pipe[1]);
+    request_fd_ = request_pipe[1];
+    reply_fd_ = reply_pipe[0];
+    if (server_pid_ < 0) {
+      close(request_fd_);
+      close(reply_fd_);
+      munmap(base_, size_);
+      throw std::runtime_error("envpool: failed to create the fork server");
+    }
+  }
+
+  ~ProcessPool() {
+    header_->stop = 1;
+    for (auto* channel : channels_) {
+      sem_post(&channel->request_sem);
+      sem_post(&channel->done_sem);
+    }
+    for (auto& t : supervisors_) {
+      t.join();
+    }
+    int stop = kStopServer;
+    WriteAll(request_fd_, &stop, sizeof(stop));
+    close(request_fd_);
+    close(reply_fd_);
+    waitpid(server_pid_, nullptr, 0);
+    for (auto* channel : channels_) {
+      sem_destroy(&channel->request_sem);
+      sem_destroy(&channel->done_sem);
+    }
+    munmap(base_, size_);
+  }
+
+  /**
+   * Fork all worker processes and start supervising them. done is called
+   * for every finished task, from the supervisor threads.
+   */
+  void Start(DoneFn done) {
+    done_ = std::move(done);
+    for (std::size_t i = 0; i < num_processes_; ++i) {
+      pids_[i] = Spawn(static_cast<int>(i));
+    }
+    for (std::size_t i = 0; i < num_processes_; ++i) {
+      supervisors_.emplace_back([this, i] { Supervise(static_cast<int>(i)); });
+    }
+  }
+
+  [[nodiscard]] std::size_t NumProcesses() const { return num_processes_; }
+  [[nodiscard]] int NumRestarts() const { return num_restarts_; }
+
+  [[nodiscard]] std::vector<int> EnvIds(int index) const {
+    std::vector<int> env_ids;
+    for (std::size_t i = index; i < num_envs_; i += num_processes_) {
+      env_ids.push_back(static_cast<int>(i));
+    }
+    return env_ids;
+  }
+
+  /**
+   * Action of env_id as a batch of one, to pass to `Env::SetAction`.
+   */
+  [[nodiscard]] const std::vector<Array>& ActionRow(int env_id) const {
+    return action_rows_[env_id];
+  }
+
+  /**
+   * State of env_id, to pass to `Env::EnvStepInto`.
+   */
+  [[nodiscard]] const std::vector<Array>& StateRow(int env_id) const {
+    return state_rows_[env_id];
+  }
+
+  /**
+   * Copy entry `index` of every action array into the action row of env_id.
+   * The env must not be in flight.
+   */
+  void SetAction(int env_id, const std::vector<Array>& action, int index) {
+    for (std::size_t i = 0; i < action.size(); ++i) {
+      action_rows_[env_id][i][0].Assign(action[i][index]);
+    }
+  }
+
+  void EnqueueBulk(const std::vector<Task>& tasks) {
+    for (const auto& task : tasks) {
+      int index = task.env_id % static_cast<int>(num_processes_);
+      Channel* channel = channels_[index];
+      std::lock_guard<std::mutex> lock(*mutexes_[index]);
+      inflight_[task.env_id] = task.order;
+      uint64_t head = channel->request_head.load(std::memory_order_relaxed);
+      request_rings_[index][head % ring_size_] =
+          Entry{task.env_id, task.order, task.force_reset ? 1 : 0};
+      channel->request_head.store(head + 1, std::memory_order_release);
+      sem_post(&channel->request_sem);
+    }
+  }
+
+  /**
+   * Worker side: run step on every task of process `index` until the pool
+   * is destroyed.
+   */
+  void Serve(int index, const std::function<void(const Task&)>& step) {
+    Channel* channel = channels_[index];
+    uint64_t tail = 0;
+    for (;;) {
+      SemWait(&channel->request_sem);
+      if (header_->stop != 0) {
+        return;
+      }
+      Entry entry = request_rings_[index][tail++ % ring_size_];
+      step(Task{
+          .env_id = entry.env_id,
+          .order = entry.order,
+          .force_reset = entry.force_reset != 0,
+      });
+      uint64_t head = channel->done_head.load(std::memory_order_relaxed);
+      done_rings_[index][head % ring_size_] = entry.env_id;
+      channel->done_head.store(head + 1, std::memory_order_release);
+      sem_post(&channel->done_sem);
+    }
+  }
+};
+
+#endif  // ENVPOOL_CORE_PROCESS_POOL_H_
@@ -0,0 +1,211 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/process_pool.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "envpool/core/async_envpool.h"
+#include "envpool/core/env.h"
+
+namespace {
+
+class CrashEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs"_.Bind(Spec<int>({3})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1})));
+  }
+};
+
+using CrashEnvSpec = EnvSpec<CrashEnvFns>;
+
+// obs is (env_id, sum of the actions since the last reset, pid); action -1
+// kills the process, -2 throws
+class CrashEnv : public Env<CrashEnvSpec> {
+ protected:
+  int counter_{0};
+
+ public:
+  CrashEnv(const Spec& spec, int env_id) : Env<CrashEnvSpec>(spec, env_id) {}
+
+  void Reset() override {
+    counter_ = 0;
+    WriteState();
+  }
+
+  void Step(const Action& action) override {
+    int value = action["action"_][0];
+    if (value == -1) {
+      raise(SIGKILL);
+    }
+    if (value == -2) {
+      throw std::runtime_error("CrashEnv");
+    }
+    counter_ += value;
+    WriteState();
+  }
+
+  bool IsDone() override { return false; }
+
+ protected:
+  void WriteState() {
+    auto state = Allocate();
+    state["obs"_](0) = env_id_;
+    state["obs"_](1) = counter_;
+    state["obs"_](2) = static_cast<int>(getpid());
+  }
+};
+
+using CrashEnvPool = AsyncEnvPool<CrashEnv>;
+
+CrashEnvSpec MakeSpec(int num_envs, int batch_size,
+                      const std::string& isolation = "process") {
+  auto config = CrashEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = batch_size;
+  config["num_threads"_] = 2;
+  config["isolation"_] = isolation;
+  return CrashEnvSpec(config);
+}
+
+std::vector<Array> MakeAction(const std::vector<int>& env_ids,
+                              const std::vector<int>& values) {
+  int n = static_cast<int>(env_ids.size());
+  std::vector<Array> action{Array(Spec<int>({n})), Array(Spec<int>({n})),
+                            Array(Spec<int>({n}))};
+  for (int i = 0; i < n; ++i) {
+    action[0][i] = env_ids[i];
+    action[1][i] = env_ids[i];
+    action[2][i] = values[i];
+  }
+  return action;
+}
+
+Array MakeEnvIds(int n) {
+  Array arr(Spec<int>({n}));
+  for (int i = 0; i < n; ++i) {
+    arr[i] = i;
+  }
+  return arr;
+}
+
+// (env_id, counter, pid) of every env in a received batch, by env id
+std::vector<std::vector<int>> ByEnvId(const std::vector<Array>& state,
+                                      int num_envs) {
+  std::vector<std::vector<int>> result(num_envs);
+  const int* obs = static_cast<const int*>(state.back().Data());
+  for (std::size_t i = 0; i < state[0].Shape(0); ++i) {
+    result[obs[i * 3]] = {obs[i * 3], obs[i * 3 + 1], obs[i * 3 + 2]};
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(ProcessPoolTest, SameAsThreads) {
+  CrashEnvPool threads(MakeSpec(4, 4, "thread"));
+  CrashEnvPool processes(MakeSpec(4, 4));
+  threads.Reset(MakeEnvIds(4));
+  processes.Reset(MakeEnvIds(4));
+  for (int s = 0; s < 100; ++s) {
+    auto state0 = threads.Recv();
+    auto state1 = processes.Recv();
+    const int* obs0 = static_cast<const int*>(state0.back().Data());
+    const int* obs1 = static_cast<const int*>(state1.back().Data());
+    std::set<int> pids;
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(obs0[i * 3], obs1[i * 3]);
+      EXPECT_EQ(obs0[i * 3 + 1], obs1[i * 3 + 1]);
+      EXPECT_EQ(obs0[i * 3 + 2], getpid());
+      EXPECT_NE(obs1[i * 3 + 2], getpid());
+      pids.insert(obs1[i * 3 + 2]);
+    }
+    // env i lives in process i % 2
+    EXPECT_EQ(pids.size(), 2);
+    EXPECT_EQ(obs1[2], obs1[8]);
+    threads.Send(MakeAction({0, 1, 2, 3}, {1, 2, 3, s}));
+    processes.Send(MakeAction({0, 1, 2, 3}, {1, 2, 3, s}));
+  }
+}
+
+TEST(ProcessPoolTest, Async) {
+  int num_envs = 8;
+  CrashEnvPool pool(MakeSpec(num_envs, 3));
+  pool.Reset(MakeEnvIds(num_envs));
+  std::vector<int> expected(num_envs, 0);
+  for (int s = 0; s < 500; ++s) {
+    auto state = pool.Recv();
+    ASSERT_EQ(state[0].Shape(0), 3);
+    auto obs = ByEnvId(state, num_envs);
+    std::vector<int> env_ids;
+    for (int i = 0; i < num_envs; ++i) {
+      if (!obs[i].empty()) {
+        EXPECT_EQ(obs[i][1], expected[i]);
+        ++expected[i];
+        env_ids.push_back(i);
+      }
+    }
+    pool.Send(MakeAction(env_ids, std::vector<int>(env_ids.size(), 1)));
+  }
+}
+
+TEST(ProcessPoolTest, RestartCrashedWorker) {
+  CrashEnvPool pool(MakeSpec(4, 4));
+  pool.Reset(MakeEnvIds(4));
+  auto obs = ByEnvId(pool.Recv(), 4);
+  for (int crash : {-1, -2}) {
+    pool.Send(MakeAction({0, 1, 2, 3}, {1, 1, 1, 1}));
+    obs = ByEnvId(pool.Recv(), 4);
+    EXPECT_EQ(obs[0][1], 1);
+    EXPECT_EQ(obs[1][1], 1);
+    int old_pid = obs[1][2];
+    // env 1 takes down process 1 and env 3 with it, env 1 comes back as a
+    // reset, env 3 too unless it was done before the crash
+    pool.Send(MakeAction({0, 1, 2, 3}, {1, crash, 1, 1}));
+    obs = ByEnvId(pool.Recv(), 4);
+    EXPECT_EQ(obs[0][1], 2);
+    EXPECT_EQ(obs[2][1], 2);
+    EXPECT_EQ(obs[1][1], 0);
+    EXPECT_TRUE(obs[3][1] == 0 || obs[3][1] == 2);
+    EXPECT_NE(obs[1][2], old_pid);
+    EXPECT_EQ(obs[0][2], obs[2][2]);
+    // every env of the new process is reset before its first step
+    pool.Send(MakeAction({0, 1, 2, 3}, {1, 1, 1, 1}));
+    obs = ByEnvId(pool.Recv(), 4);
+    EXPECT_EQ(obs[0][1], 3);
+    EXPECT_EQ(obs[1][1], 1);
+    pool.Reset(MakeEnvIds(4));
+    obs = ByEnvId(pool.Recv(), 4);
+  }
+}
+
+TEST(ProcessPoolTest, Unsupported) {
+  EXPECT_THROW(CrashEnvPool(MakeSpec(4, 4, "fiber")), std::invalid_argument);
+  CrashEnvPool pool(MakeSpec(4, 4));
+  EXPECT_THROW(pool.SaveState("/tmp/unused"), std::runtime_error);
+  EXPECT_THROW(pool.LoadState("/tmp/unused"), std::runtime_error);
+  EXPECT_THROW(pool.Snapshot({0}), std::runtime_error);
+}
@@ -30,6 +30,7 @@
 #include <vector>
 
 #include "envpool/core/envpool.h"
+#include "envpool/core/shm_envpool.h"
 #include "envpool/core/xla.h"
 
 namespace py = pybind11;
@@ -273,6 +274,119 @@ class PyEnvPool : public EnvPool {
     py::gil_scoped_release release;
     EnvPool::Reset(arr);
   }
+
+  /**
+   * py api
+   */
+  void PySaveState(const std::string& path) {
+    py::gil_scoped_release release;
+    EnvPool::SaveState(path);
+  }
+
+  /**
+   * py api
+   */
+  void PyLoadState(const std::string& path) {
+    py::gil_scoped_release release;
+    EnvPool::LoadState(path);
+  }
+
+  /**
+   * py api
+   */
+  std::vector<int> PySnapshot(const std::vector<int>& env_ids) {
+    py::gil_scoped_release release;
+    return EnvPool::Snapshot(env_ids);
+  }
+
+  /**
+   * py api
+   */
+  void PyRestore(const std::vector<int>& env_ids,
+                 const std::vector<int>& handles) {
+    py::gil_scoped_release release;
+    EnvPool::Restore(env_ids, handles);
+  }
+
+  /**
+   * py api
+   */
+  void PyReleaseSnapshot(const std::vector<int>& handles) {
+    EnvPool::ReleaseSnapshot(handles);
+  }
+
+  /**
+   * py api
+   */
+  void PyBranch(int src_env_id, const std::vector<int>& dst_env_ids) {
+    py::gil_scoped_release release;
+    EnvPool::Branch(src_env_id, dst_env_ids);
+  }
+
+  /**
+   * py api
+   */
+  void PyCollectBegin(int num_episodes) {
+    py::gil_scoped_release release;
+    EnvPool::CollectBegin(num_episodes);
+  }
+
+  /**
+   * py api
+   */
+  std::size_t PyCollectActive() { return EnvPool::CollectActive(); }
+
+  /**
+   * py api
+   */
+  std::tuple<py::array, py::array> PyCollectEnd() {
+    std::size_t num_envs = EnvPool::spec.config["num_envs"_];
+    auto [returns, lengths] = EnvPool::CollectEnd();
+    std::size_t num_episodes = num_envs == 0 ? 0 : returns.size() / num_envs;
+    std::vector<std::size_t> shape{num_envs, num_episodes};
+    return std::make_tuple(py::array_t<float>(shape, returns.data()),
+                           py::array_t<int>(shape, lengths.data()));
+  }
+
+  /**
+   * py api
+   */
+  void PyServeShm(const std::string& name,
+                  const std::vector<int>& client_num_envs,
+                  const std::vector<int>& client_batch_size) {
+    EnvPool::ServeShm(name, client_num_envs, client_batch_size);
+  }
+
+  /**
+   * py api
+   */
+  void PyStopShm() {
+    py::gil_scoped_release release;
+    EnvPool::StopShm();
+  }
+
+  /**
+   * py api
+   */
+  void PyConnectShm(const std::string& name, int client_id) {
+    EnvPool::ConnectShm(name, client_id);
+  }
+
+  /**
+   * py api
+   */
+  void PyRecordBegin(const std::string& path, bool compress, int num_threads,
+                     std::size_t max_backlog) {
+    EnvPool::RecordBegin(path, compress, num_threads, max_backlog);
+  }
+
+  /**
+   * py api
+   */
+  void PyRecordEnd() {
+    py::gil_scoped_release release;
+    EnvPool::RecordEnd();
+  }
 };
 
 template <typename EnvPool>
@@ -306,8 +420,34 @@ py::object abc_meta = py::module::import("abc").attr("ABCMeta");
       .def("_recv", &ENVPOOL::PyRecv)                                \
       .def("_send", &ENVPOOL::PySend)                                \
       .def("_reset", &ENVPOOL::PyReset)                              \
+      .def("_save_state", &ENVPOOL::PySaveState)                     \
+      .def("_load_state", &ENVPOOL::PyLoadState)                     \
+      .def("_snapshot", &ENVPOOL::PySnapshot)                        \
+      .def("_restore", &ENVPOOL::PyRestore)                          \
+      .def("_release_snapshot", &ENVPOOL::PyReleaseSnapshot)         \
+      .def("_branch", &ENVPOOL::PyBranch)                            \
+      .def("_collect_begin", &ENVPOOL::PyCollectBegin)               \
+      .def("_collect_active", &ENVPOOL::PyCollectActive)             \
+      .def("_collect_end", &ENVPOOL::PyCollectEnd)                   \
+      .def("_serve_shm", &ENVPOOL::PyServeShm)                       \
+      .def("_stop_shm", &ENVPOOL::PyStopShm)                         \
+      .def("_record_begin", &ENVPOOL::PyRecordBegin)                 \
+      .def("_record_end", &ENVPOOL::PyRecordEnd)                     \
       .def_readonly_static("_state_keys", &ENVPOOL::py_state_keys)   \
       .def_readonly_static("_action_keys", &ENVPOOL::py_action_keys) \
-      .def("_xla", &ENVPOOL::Xla);
+      .def("_xla", &ENVPOOL::Xla);                                   \
+  using ENVPOOL##ShmClient = PyEnvPool<ShmEnvPool<ENVPOOL::Spec>>;   \
+  py::class_<ENVPOOL##ShmClient>(MODULE, "_" #ENVPOOL "ShmClient",   \
+                                 py::metaclass(abc_meta))            \
+      .def(py::init<const SPEC&>())                                  \
+      .def_readonly("_spec", &ENVPOOL##ShmClient::py_spec)           \
+      .def("_recv", &ENVPOOL##ShmClient::PyRecv)                     \
+      .def("_send", &ENVPOOL##ShmClient::PySend)                     \
+      .def("_reset", &ENVPOOL##ShmClient::PyReset)                   \
+      .def("_connect_shm", &ENVPOOL##ShmClient::PyConnectShm)        \
+      .def_readonly_static("_state_keys",                            \
+                           &ENVPOOL##ShmClient::py_state_keys)       \
+      .def_readonly_static("_action_keys",                           \
+                           &ENVPOOL##ShmClient::py_action_keys);
 
 #endif  // ENVPOOL_CORE_PY_ENVPOOL_H_
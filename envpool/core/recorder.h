@@ -0,0 +1,639 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_RECORDER_H_
+#define ENVPOOL_CORE_RECORDER_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "envpool/core/array.h"
+#include "envpool/core/spec.h"
+
+/**
+ * Numpy name of a state or action dtype, as written in meta.json.
+ */
+template <typename T>
+std::string DtypeName() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return "bool";
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return "float" + std::to_string(sizeof(T) * 8);
+  } else if constexpr (std::is_signed_v<T>) {
+    return "int" + std::to_string(sizeof(T) * 8);
+  } else {
+    return "uint" + std::to_string(sizeof(T) * 8);
+  }
+}
+
+template <typename... Spec>
+std::vector<std::string> DtypeNames(const std::tuple<Spec...>& specs) {
+  return {DtypeName<typename Spec::dtype>()...};
+}
+
+/**
+ * Append-only file mapped in memory, grown by doubling and truncated to its
+ * content on `Close`.
+ */
+class MappedFile {
+ protected:
+  std::string path_;
+  int fd_{-1};
+  char* data_{nullptr};
+  std::size_t size_{0}, capacity_{0};
+
+  static constexpr std::size_t kInitialCapacity = 1 << 20;
+
+  std::runtime_error Error(const std::string& what) const {
+    return std::runtime_error("Recorder: " + what + " " + path_ + ": " +
+                              std::strerror(errno));
+  }
+
+  void Reserve(std::size_t size) {
+    if (size <= capacity_) {
+      return;
+    }
+    std::size_t capacity = std::max({size, capacity_ * 2, kInitialCapacity});
+    if (ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+      throw Error("cannot resize");
+    }
+    void* ptr = data_ == nullptr
+                    ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd_, 0)
+                    : mremap(data_, capacity_, capacity, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+      throw Error("cannot mmap");
+    }
+    data_ = static_cast<char*>(ptr);
+    capacity_ = capacity;
+  }
+
+ public:
+  explicit MappedFile(std::string path) : path_(std::move(path)) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw Error("cannot create");
+    }
+  }
+
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  void Append(const void* data, std::size_t size) {
+    Reserve(size_ + size);
+    std::memcpy(data_ + size_, data, size);
+    size_ += size;
+  }
+
+  void Close() {
+    if (fd_ < 0) {
+      return;
+    }
+    if (data_ != nullptr) {
+      munmap(data_, capacity_);
+      data_ = nullptr;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+      LOG(ERROR) << "Recorder: cannot truncate " << path_;
+    }
+    close(fd_);
+    fd_ = -1;
+  }
+};
+
+/**
+ * Records every batch going through an EnvPool into a directory of columnar
+ * files, see `AsyncEnvPool::RecordBegin`:
+ *
+ *   meta.json              | row counts and, per column, file, dtype, shape
+ *                          | and compression
+ *   state.<key>.bin        | every received state, in the order of recv
+ *   state.episode_id.bin   | int64 episode of every state row
+ *   action.<key>.bin       | every sent action, in the order of send
+ *   action.state_row.bin   | int64 state row the action responds to, or -1
+ *   episodes.<field>.bin   | env_id, first_row, last_row (-1 if unfinished),
+ *                          | length and return of every episode
+ *
+ * Raw columns hold one row after the other. With compression, uint8 columns
+ * (images) are zlib chunks of one batch each: uint64 rows, uint64 bytes,
+ * then the compressed rows.
+ *
+ * States are recorded without a copy: the writer threads hold references to
+ * the received arrays, so they must not be modified in place. Actions are
+ * copied. The writer threads own disjoint columns, and `Record*` blocks while
+ * more than max_backlog bytes are waiting to be written.
+ */
+class TrajectoryRecorder {
+ protected:
+  struct Column {
+    std::string name;
+    std::string dtype;
+    std::vector<int> shape;
+    bool compress;
+    std::unique_ptr<MappedFile> file;
+  };
+
+  struct Job {
+    std::size_t column;
+    Array data;
+  };
+
+  struct Writer {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> jobs;
+    bool stop{false};
+    std::thread thread;
+  };
+
+  struct Episode {
+    int env_id;
+    int64_t first_row, last_row;
+    int length;
+    float ret;
+  };
+
+  std::string path_;
+  std::size_t num_state_keys_, num_action_keys_;
+  std::size_t max_backlog_;
+  std::vector<Column> columns_;
+  std::vector<std::unique_ptr<Writer>> writers_;
+  std::mutex backlog_mutex_;
+  std::condition_variable backlog_cv_;
+  std::size_t backlog_{0};
+  std::exception_ptr error_;
+  // bookkeeping on the caller side
+  std::mutex mutex_;
+  int64_t num_state_rows_{0}, num_action_rows_{0};
+  std::vector<int64_t> current_episode_, last_state_row_;
+  std::vector<Episode> episodes_;
+  bool closed_{false};
+
+  static std::vector<int> RowShape(const ShapeSpec& spec) {
+    bool is_player = !spec.shape.empty() && spec.shape[0] == -1;
+    return {spec.shape.begin() + (is_player ? 1 : 0), spec.shape.end()};
+  }
+
+  void AddColumn(const std::string& name, const std::string& dtype,
+                 std::vector<int> shape, bool compress) {
+    columns_.push_back(
+        Column{name, dtype, std::move(shape), compress,
+               std::make_unique<MappedFile>(path_ + "/" + name + ".bin")});
+  }
+
+  static std::size_t Bytes(const Array& a) { return a.size * a.element_size; }
+
+  void Submit(std::size_t column, Array data) {
+    std::size_t bytes = Bytes(data);
+    {
+      std::unique_lock<std::mutex> lock(backlog_mutex_);
+      backlog_cv_.wait(lock, [&] {
+        return backlog_ == 0 || backlog_ + bytes <= max_backlog_ || error_;
+      });
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      backlog_ += bytes;
+    }
+    Writer& writer = *writers_[column % writers_.size()];
+    {
+      std::lock_guard<std::mutex> lock(writer.mutex);
+      writer.jobs.push_back(Job{column, std::move(data)});
+    }
+    writer.cv.notify_one();
+  }
+
+  void Write(const Job& job) {
+    Column& column = columns_[job.column];
+    const char* data = static_cast<const char*>(job.data.Data());
+    std::size_t bytes = Bytes(job.data);
+    if (!column.compress) {
+      column.file->Append(data, bytes);
+      return;
+    }
+    thread_local std::vector<Bytef> buf;
+    uLongf size = compressBound(bytes);
+    buf.resize(size);
+    if (compress2(buf.data(), &size, reinterpret_cast<const Bytef*>(data),
+                  bytes, 1) != Z_OK) {
+      throw std::runtime_error("Recorder: cannot compress " + column.name);
+    }
+    uint64_t header[2] = {job.data.Shape(0), size};
+    column.file->Append(header, sizeof(header));
+    column.file->Append(buf.data(), size);
+  }
+
+  void RunWriter(Writer* writer) {
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(writer->mutex);
+        writer->cv.wait(lock,
+                        [&] { return writer->stop || !writer->jobs.empty(); });
+        if (writer->jobs.empty()) {
+          return;
+        }
+        job = std::move(writer->jobs.front());
+        writer->jobs.pop_front();
+      }
+      std::size_t bytes = Bytes(job.data);
+      try {
+        Write(job);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(backlog_mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+      // release the arrays before the backlog
+      job.data = Array();
+      {
+        std::lock_guard<std::mutex> lock(backlog_mutex_);
+        backlog_ -= bytes;
+      }
+      backlog_cv_.notify_all();
+    }
+  }
+
+  void WriteMeta() {
+    std::ofstream meta(path_ + "/meta.json");
+    meta << "{\n  \"version\": 1,\n  \"num_state_rows\": " << num_state_rows_
+         << ",\n  \"num_action_rows\": " << num_action_rows_
+         << ",\n  \"num_episodes\": " << episodes_.size()
+         << ",\n  \"columns\": [\n";
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+      const Column& c = columns_[i];
+      meta << "    {\"name\": \"" << c.name << "\", \"file\": \"" << c.name
+           << ".bin\", \"dtype\": \"" << c.dtype << "\", \"shape\": [";
+      for (std::size_t j = 0; j < c.shape.size(); ++j) {
+        meta << (j > 0 ? ", " : "") << c.shape[j];
+      }
+      meta << "], \"compression\": \"" << (c.compress ? "zlib" : "none")
+           << "\"}" << (i + 1 < columns_.size() ? "," : "") << "\n";
+    }
+    meta << "  ]\n}\n";
+    if (!meta) {
+      throw std::runtime_error("Recorder: cannot write " + path_ +
+                               "/meta.json");
+    }
+  }
+
+  template <typename T>
+  void WriteEpisodeField(const std::string& field, const std::string& dtype,
+                         T Episode::*member) {
+    std::vector<T> values;
+    values.reserve(episodes_.size());
+    for (const auto& e : episodes_) {
+      values.push_back(e.*member);
+    }
+    AddColumn("episodes." + field, dtype, {}, false);
+    columns_.back().file->Append(values.data(), values.size() * sizeof(T));
+    columns_.back().file->Close();
+  }
+
+ public:
+  /**
+   * Start recording into directory `path`, created if needed. Specs, keys
+   * and dtypes are the ones of the pool's states and actions.
+   */
+  TrajectoryRecorder(std::string path, std::size_t num_envs,
+                     const std::vector<std::string>& state_keys,
+                     const std::vector<ShapeSpec>& state_specs,
+                     const std::vector<std::string>& state_dtypes,
+                     const std::vector<std::string>& action_keys,
+                     const std::vector<ShapeSpec>& action_specs,
+                     const std::vector<std::string>& action_dtypes,
+                     bool compress, int num_threads, std::size_t max_backlog)
+      : path_(std::move(path)),
+        num_state_keys_(state_keys.size()),
+        num_action_keys_(action_keys.size()),
+        max_backlog_(max_backlog),
+        current_episode_(num_envs, -1),
+        last_state_row_(num_envs, -1) {
+    if (mkdir(path_.c_str(), 0755) != 0 && errno != EEXIST) {
+      throw std::runtime_error("Recorder: cannot create " + path_ + ": " +
+                               std::strerror(errno));
+    }
+    for (std::size_t i = 0; i < state_keys.size(); ++i) {
+      AddColumn("state." + state_keys[i], state_dtypes[i],
+                RowShape(state_specs[i]),
+                compress && state_dtypes[i] == "uint8");
+    }
+    AddColumn("state.episode_id", "int64", {}, false);
+    for (std::size_t i = 0; i < action_keys.size(); ++i) {
+      AddColumn("action." + action_keys[i], action_dtypes[i],
+                RowShape(action_specs[i]),
+                compress && action_dtypes[i] == "uint8");
+    }
+    AddColumn("action.state_row", "int64", {}, false);
+    for (int i = 0; i < std::max(num_threads, 1); ++i) {
+      writers_.emplace_back(std::make_unique<Writer>());
+    }
+    for (auto& writer : writers_) {
+      writer->thread = std::thread([this, w = writer.get()] { RunWriter(w); });
+    }
+  }
+
+  ~TrajectoryRecorder() {
+    try {
+      Close();
+    } catch (const std::exception& e) {
+      LOG(ERROR) << e.what();
+    }
+  }
+
+  /**
+   * Record a batch returned by recv. The state order is the one hardcoded
+   * in common_state_spec.
+   */
+  void RecordState(const std::vector<Array>& state) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int* env_id = static_cast<const int*>(state[0].Data());
+    const int* elapsed_step = static_cast<const int*>(state[2].Data());
+    const bool* done = static_cast<const bool*>(state[3].Data());
+    const float* reward = static_cast<const float*>(state[4].Data());
+    const int* step_type = static_cast<const int*>(state[6].Data());
+    int n = static_cast<int>(state[0].Shape(0));
+    Array episode_id(Spec<int64_t>({n}));
+    auto* episode = static_cast<int64_t*>(episode_id.Data());
+    for (int i = 0; i < n; ++i) {
+      int eid = env_id[i];
+      int64_t row = num_state_rows_ + i;
+      if (step_type[i] == 0 || current_episode_[eid] < 0) {
+        current_episode_[eid] = static_cast<int64_t>(episodes_.size());
+        episodes_.push_back(Episode{eid, row, -1, 0, 0.0f});
+      } else {
+        episodes_[current_episode_[eid]].ret += reward[i];
+      }
+      episode[i] = current_episode_[eid];
+      last_state_row_[eid] = row;
+      if (done[i]) {
+        episodes_[episode[i]].last_row = row;
+        episodes_[episode[i]].length = elapsed_step[i];
+        current_episode_[eid] = -1;
+      }
+    }
+    num_state_rows_ += n;
+    for (std::size_t i = 0; i < num_state_keys_; ++i) {
+      Submit(i, state[i]);
+    }
+    Submit(num_state_keys_, std::move(episode_id));
+  }
+
+  /**
+   * Record a batch given to send, before it is dispatched.
+   */
+  void RecordAction(const std::vector<Array>& action) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int* env_id = static_cast<const int*>(action[0].Data());
+    int n = static_cast<int>(action[0].Shape(0));
+    Array state_row(Spec<int64_t>({n}));
+    auto* row = static_cast<int64_t*>(state_row.Data());
+    for (int i = 0; i < n; ++i) {
+      row[i] = last_state_row_[env_id[i]];
+    }
+    num_action_rows_ += n;
+    std::size_t offset = num_state_keys_ + 1;
+    for (std::size_t i = 0; i < num_action_keys_; ++i) {
+      std::vector<int> shape(action[i].Shape().begin(),
+                             action[i].Shape().end());
+      Array copy(ShapeSpec(action[i].element_size, shape));
+      copy.Assign(action[i]);
+      Submit(offset + i, std::move(copy));
+    }
+    Submit(offset + num_action_keys_, std::move(state_row));
+  }
+
+  /**
+   * Write everything still pending, the episode index and meta.json.
+   * Rethrows the first error of the writer threads.
+   */
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    for (auto& writer : writers_) {
+      {
+        std::lock_guard<std::mutex> writer_lock(writer->mutex);
+        writer->stop = true;
+      }
+      writer->cv.notify_all();
+    }
+    for (auto& writer : writers_) {
+      writer->thread.join();
+    }
+    for (auto& column : columns_) {
+      column.file->Close();
+    }
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    WriteEpisodeField("env_id", "int32", &Episode::env_id);
+    WriteEpisodeField("first_row", "int64", &Episode::first_row);
+    WriteEpisodeField("last_row", "int64", &Episode::last_row);
+    WriteEpisodeField("length", "int32", &Episode::length);
+    WriteEpisodeField("return", "float32", &Episode::ret);
+    WriteMeta();
+  }
+};
+
+/**
+ * Read-only view of a recording written by `TrajectoryRecorder`. Raw columns
+ * are memory-mapped, zlib columns are decompressed into memory.
+ */
+class Recording {
+ public:
+  struct Column {
+    std::string dtype;
+    std::vector<int> shape;
+    std::size_t row_size{0}, num_rows{0};
+    const char* data{nullptr};
+    bool mapped{false};
+
+    [[nodiscard]] const char* Row(std::size_t row) const {
+      return data + row * row_size;
+    }
+
+    /**
+     * Ask the kernel to read the pages of a row ahead of time.
+     */
+    void WillNeed(std::size_t row) const {
+      if (!mapped || row_size == 0) {
+        return;
+      }
+      static const auto kPage = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+      auto begin = reinterpret_cast<std::uintptr_t>(Row(row));
+      std::uintptr_t aligned = begin & ~(kPage - 1);
+      madvise(reinterpret_cast<void*>(aligned), begin + row_size - aligned,
+              MADV_WILLNEED);
+    }
+  };
+
+ protected:
+  std::string path_;
+  std::map<std::string, Column> columns_;
+  std::vector<std::pair<void*, std::size_t>> mappings_;
+  std::vector<std::vector<char>> buffers_;
+
+  static std::size_t ElementSize(const std::string& dtype) {
+    if (dtype == "bool") {
+      return 1;
+    }
+    return std::stoul(dtype.substr(dtype.find_first_of("0123456789"))) / 8;
+  }
+
+  std::runtime_error Error(const std::string& what) const {
+    return std::runtime_error("Recording " + path_ + ": " + what);
+  }
+
+  std::string ReadFile(const std::string& file) const {
+    std::ifstream in(path_ + "/" + file, std::ios::binary);
+    if (!in) {
+      throw Error("cannot open " + file);
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+  }
+
+  void Map(const std::string& file, Column* column) {
+    std::string full = path_ + "/" + file;
+    int fd = open(full.c_str(), O_RDONLY);
+    struct stat st {};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      throw Error("cannot open " + file);
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    column->mapped = true;
+    column->num_rows = column->row_size == 0 ? 0 : size / column->row_size;
+    if (size > 0) {
+      void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (ptr == MAP_FAILED) {
+        close(fd);
+        throw Error("cannot mmap " + file);
+      }
+      mappings_.emplace_back(ptr, size);
+      column->data = static_cast<const char*>(ptr);
+    }
+    close(fd);
+  }
+
+  void Decompress(const std::string& file, Column* column) {
+    std::string chunks = ReadFile(file);
+    std::vector<char> data;
+    std::size_t pos = 0;
+    while (pos + 2 * sizeof(uint64_t) <= chunks.size()) {
+      uint64_t header[2];
+      std::memcpy(header, chunks.data() + pos, sizeof(header));
+      pos += sizeof(header);
+      uLongf size = header[0] * column->row_size;
+      std::size_t offset = data.size();
+      data.resize(offset + size);
+      if (pos + header[1] > chunks.size() ||
+          uncompress(reinterpret_cast<Bytef*>(data.data() + offset), &size,
+                     reinterpret_cast<const Bytef*>(chunks.data() + pos),
+                     header[1]) != Z_OK) {
+        throw Error("corrupted " + file);
+      }
+      pos += header[1];
+    }
+    column->num_rows =
+        column->row_size == 0 ? 0 : data.size() / column->row_size;
+    buffers_.emplace_back(std::move(data));
+    column->data = buffers_.back().data();
+  }
+
+ public:
+  explicit Recording(std::string path) : path_(std::move(path)) {
+    std::string meta = ReadFile("meta.json");
+    static const std::regex kColumn(
+        R"re(\{"name": "([^"]+)", "file": "([^"]+)", "dtype": "(\w+)", )re"
+        R"re("shape": \[([-0-9, ]*)\], "compression": "(\w+)"\})re");
+    for (auto it = std::sregex_iterator(meta.begin(), meta.end(), kColumn);
+         it != std::sregex_iterator(); ++it) {
+      const auto& m = *it;
+      Column column;
+      column.dtype = m[3];
+      std::stringstream shape(m[4]);
+      std::string dim;
+      column.row_size = ElementSize(column.dtype);
+      while (std::getline(shape, dim, ',')) {
+        column.shape.push_back(std::stoi(dim));
+        column.row_size *= column.shape.back();
+      }
+      if (m[5] == "zlib") {
+        Decompress(m[2], &column);
+      } else {
+        Map(m[2], &column);
+      }
+      columns_.emplace(m[1], std::move(column));
+    }
+    if (columns_.empty()) {
+      throw Error("no column in meta.json");
+    }
+  }
+
+  ~Recording() {
+    for (auto [ptr, size] : mappings_) {
+      munmap(ptr, size);
+    }
+  }
+
+  Recording(const Recording&) = delete;
+  Recording& operator=(const Recording&) = delete;
+
+  [[nodiscard]] bool Has(const std::string& name) const {
+    return columns_.count(name) > 0;
+  }
+
+  [[nodiscard]] const Column& Get(const std::string& name) const {
+    auto it = columns_.find(name);
+    if (it == columns_.end()) {
+      throw Error("no column " + name);
+    }
+    return it->second;
+  }
+};
+
+#endif  // ENVPOOL_CORE_RECORDER_H_
@@ -0,0 +1,263 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/recorder.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "envpool/core/async_envpool.h"
+#include "envpool/core/env.h"
+
+namespace {
+
+class ImageEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs"_.Bind(Spec<uint8_t>({4, 4})),
+                    "count"_.Bind(Spec<int>({-1})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1})));
+  }
+};
+
+using ImageEnvSpec = EnvSpec<ImageEnvFns>;
+
+// episodes of 3 steps with reward 1, obs is filled with env_id * 16 + step
+class ImageEnv : public Env<ImageEnvSpec> {
+ protected:
+  int step_{0};
+
+ public:
+  ImageEnv(const Spec& spec, int env_id) : Env<ImageEnvSpec>(spec, env_id) {}
+
+  void Reset() override {
+    step_ = 0;
+    WriteState(0.0f);
+  }
+
+  void Step(const Action& action) override {
+    ++step_;
+    WriteState(1.0f);
+  }
+
+  bool IsDone() override { return step_ >= 3; }
+
+ protected:
+  void WriteState(float reward) {
+    auto state = Allocate();
+    state["reward"_] = reward;
+    state["count"_] = step_;
+    auto* obs = static_cast<uint8_t*>(state["obs"_].Data());
+    std::memset(obs, env_id_ * 16 + step_, 16);
+  }
+};
+
+using ImageEnvPool = AsyncEnvPool<ImageEnv>;
+
+ImageEnvSpec MakeSpec(int num_envs, int batch_size) {
+  auto config = ImageEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = batch_size;
+  config["num_threads"_] = 2;
+  return ImageEnvSpec(config);
+}
+
+std::vector<Array> MakeAction(const Array& env_id) {
+  int n = static_cast<int>(env_id.Shape(0));
+  const int* ids = static_cast<const int*>(env_id.Data());
+  std::vector<Array> action{Array(Spec<int>({n})), Array(Spec<int>({n})),
+                            Array(Spec<int>({n}))};
+  for (int i = 0; i < n; ++i) {
+    action[0][i] = ids[i];
+    action[1][i] = ids[i];
+    action[2][i] = i;
+  }
+  return action;
+}
+
+Array MakeEnvIds(int n) {
+  Array arr(Spec<int>({n}));
+  for (int i = 0; i < n; ++i) {
+    arr[i] = i;
+  }
+  return arr;
+}
+
+std::string TempDir() {
+  char dir[] = "/tmp/envpool_recorder_XXXXXX";
+  EXPECT_NE(mkdtemp(dir), nullptr);
+  return dir;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  EXPECT_TRUE(file.good()) << path;
+  return {std::istreambuf_iterator<char>(file),
+          std::istreambuf_iterator<char>()};
+}
+
+template <typename T>
+std::vector<T> ReadColumn(const std::string& dir, const std::string& name) {
+  std::string data = ReadFile(dir + "/" + name + ".bin");
+  std::vector<T> result(data.size() / sizeof(T));
+  std::memcpy(result.data(), data.data(), data.size());
+  return result;
+}
+
+}  // namespace
+
+TEST(RecorderTest, Columns) {
+  std::string dir = TempDir();
+  ImageEnvPool pool(MakeSpec(4, 4));
+  pool.RecordBegin(dir, false, 2, 1 << 20);
+  pool.Reset(MakeEnvIds(4));
+  std::vector<int> env_ids;
+  for (int s = 0; s < 11; ++s) {
+    auto state = pool.Recv();
+    const int* ids = static_cast<const int*>(state[0].Data());
+    env_ids.insert(env_ids.end(), ids, ids + 4);
+    if (s < 10) {
+      pool.Send(MakeAction(state[0]));
+    }
+  }
+  pool.RecordEnd();
+  std::string meta = ReadFile(dir + "/meta.json");
+  EXPECT_NE(meta.find("\"num_state_rows\": 44"), std::string::npos);
+  EXPECT_NE(meta.find("\"num_action_rows\": 40"), std::string::npos);
+  EXPECT_NE(meta.find("\"num_episodes\": 12"), std::string::npos);
+  EXPECT_NE(meta.find("{\"name\": \"state.obs\", \"file\": \"state.obs.bin\", "
+                      "\"dtype\": \"uint8\", \"shape\": [4, 4], "
+                      "\"compression\": \"none\"}"),
+            std::string::npos);
+  EXPECT_NE(meta.find("\"name\": \"state.reward\", \"file\": "
+                      "\"state.reward.bin\", \"dtype\": \"float32\", "
+                      "\"shape\": []"),
+            std::string::npos);
+  auto env_id = ReadColumn<int>(dir, "state.info:env_id");
+  auto obs = ReadColumn<uint8_t>(dir, "state.obs");
+  auto count = ReadColumn<int>(dir, "state.count");
+  auto episode_id = ReadColumn<int64_t>(dir, "state.episode_id");
+  ASSERT_EQ(env_id, env_ids);
+  ASSERT_EQ(obs.size(), 44 * 16);
+  ASSERT_EQ(count.size(), 44);
+  ASSERT_EQ(episode_id.size(), 44);
+  for (int r = 0; r < 44; ++r) {
+    // reset, 3 steps, auto reset, ...
+    EXPECT_EQ(count[r], (r / 4) % 4);
+    EXPECT_EQ(obs[r * 16 + 15], env_id[r] * 16 + count[r]);
+  }
+  auto action = ReadColumn<int>(dir, "action.action");
+  auto action_env_id = ReadColumn<int>(dir, "action.env_id");
+  auto state_row = ReadColumn<int64_t>(dir, "action.state_row");
+  ASSERT_EQ(action.size(), 40);
+  ASSERT_EQ(state_row.size(), 40);
+  for (int r = 0; r < 40; ++r) {
+    EXPECT_EQ(action[r], r % 4);
+    EXPECT_EQ(env_id[state_row[r]], action_env_id[r]);
+    EXPECT_EQ(state_row[r] / 4, r / 4);
+  }
+  auto first_row = ReadColumn<int64_t>(dir, "episodes.first_row");
+  auto last_row = ReadColumn<int64_t>(dir, "episodes.last_row");
+  auto length = ReadColumn<int>(dir, "episodes.length");
+  auto ret = ReadColumn<float>(dir, "episodes.return");
+  auto episode_env_id = ReadColumn<int>(dir, "episodes.env_id");
+  ASSERT_EQ(first_row.size(), 12);
+  for (int e = 0; e < 12; ++e) {
+    EXPECT_EQ(episode_id[first_row[e]], e);
+    EXPECT_EQ(env_id[first_row[e]], episode_env_id[e]);
+    if (e < 8) {
+      EXPECT_EQ(last_row[e] - first_row[e], 12);
+      EXPECT_EQ(episode_id[last_row[e]], e);
+      EXPECT_EQ(length[e], 3);
+      EXPECT_EQ(ret[e], 3.0f);
+    } else {
+      EXPECT_EQ(last_row[e], -1);
+      EXPECT_EQ(ret[e], 2.0f);
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(RecorderTest, CompressedAsync) {
+  std::string dir = TempDir();
+  ImageEnvPool pool(MakeSpec(6, 2));
+  // a backlog of one byte writes one column at a time
+  pool.RecordBegin(dir, true, 3, 1);
+  pool.Reset(MakeEnvIds(6));
+  std::vector<uint8_t> expected;
+  for (int s = 0; s < 200; ++s) {
+    auto state = pool.Recv();
+    const auto* obs = static_cast<const uint8_t*>(state[8].Data());
+    expected.insert(expected.end(), obs, obs + state[8].size);
+    pool.Send(MakeAction(state[0]));
+  }
+  pool.RecordEnd();
+  std::string meta = ReadFile(dir + "/meta.json");
+  EXPECT_NE(meta.find("\"num_state_rows\": 400"), std::string::npos);
+  EXPECT_NE(meta.find("\"dtype\": \"uint8\", \"shape\": [4, 4], "
+                      "\"compression\": \"zlib\""),
+            std::string::npos);
+  EXPECT_NE(meta.find("\"dtype\": \"int32\", \"shape\": [], "
+                      "\"compression\": \"none\""),
+            std::string::npos);
+  std::string chunks = ReadFile(dir + "/state.obs.bin");
+  std::vector<uint8_t> obs;
+  std::size_t pos = 0;
+  while (pos < chunks.size()) {
+    uint64_t header[2];
+    std::memcpy(header, chunks.data() + pos, sizeof(header));
+    pos += sizeof(header);
+    EXPECT_EQ(header[0], 2);
+    uLongf size = header[0] * 16;
+    std::vector<uint8_t> rows(size);
+    ASSERT_EQ(uncompress(rows.data(), &size,
+                         reinterpret_cast<const Bytef*>(chunks.data() + pos),
+                         header[1]),
+              Z_OK);
+    obs.insert(obs.end(), rows.begin(), rows.end());
+    pos += header[1];
+  }
+  EXPECT_EQ(obs, expected);
+  EXPECT_EQ(ReadColumn<int64_t>(dir, "state.episode_id").size(), 400);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(RecorderTest, Errors) {
+  ImageEnvPool pool(MakeSpec(4, 4));
+  EXPECT_THROW(pool.RecordBegin("/proc/envpool_recorder", false, 1, 1),
+               std::runtime_error);
+  std::string dir = TempDir();
+  pool.RecordBegin(dir, false, 1, 1);
+  EXPECT_THROW(pool.RecordBegin(dir, false, 1, 1), std::runtime_error);
+  pool.RecordEnd();
+  // ending twice is a no-op
+  pool.RecordEnd();
+  EXPECT_NE(ReadFile(dir + "/meta.json").find("\"num_state_rows\": 0"),
+            std::string::npos);
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_SERIALIZATION_H_
+#define ENVPOOL_CORE_SERIALIZATION_H_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "envpool/core/array.h"
+
+/**
+ * Append-only binary sink used by `Env::SaveState`.
+ *
+ * Values are stored in native byte order without any tagging, the reader has
+ * to consume them in exactly the same order as they were written.
+ */
+class StateWriter {
+ protected:
+  std::vector<char>* buf_;
+
+ public:
+  explicit StateWriter(std::vector<char>* buf) : buf_(buf) {}
+
+  void WriteBytes(const void* data, std::size_t size) {
+    const char* ptr = static_cast<const char*>(data);
+    buf_->insert(buf_->end(), ptr, ptr + size);
+  }
+
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "only trivially copyable types can be written directly");
+    WriteBytes(&value, sizeof(T));
+  }
+
+  template <typename T>
+  void Write(const T* data, std::size_t num) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "only trivially copyable types can be written directly");
+    WriteBytes(data, num * sizeof(T));
+  }
+
+  void WriteString(const std::string& str) {
+    Write<uint64_t>(str.size());
+    WriteBytes(str.data(), str.size());
+  }
+
+  template <typename T>
+  void WriteVector(const std::vector<T>& vec) {
+    Write<uint64_t>(vec.size());
+    Write(vec.data(), vec.size());
+  }
+
+  void WriteArray(const Array& arr) {
+    WriteBytes(arr.Data(), arr.size * arr.element_size);
+  }
+
+  [[nodiscard]] std::size_t Size() const { return buf_->size(); }
+};
+
+/**
+ * Reader counterpart of `StateWriter`, over a borrowed piece of memory.
+ * Reading past the end throws `std::out_of_range`, so a truncated or
+ * mismatched checkpoint never turns into an out-of-bound access.
+ */
+class StateReader {
+ protected:
+  const char* data_;
+  std::size_t size_;
+  std::size_t offset_{0};
+
+ public:
+  StateReader(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+  void ReadBytes(void* data, std::size_t size) {
+    if (offset_ + size > size_) {
+      throw std::out_of_range("StateReader: read " + std::to_string(size) +
+                              " bytes at offset " + std::to_string(offset_) +
+                              ", but only " + std::to_string(size_) +
+                              " bytes are available");
+    }
+    std::memcpy(data, data_ + offset_, size);
+    offset_ += size;
+  }
+
+  template <typename T>
+  void Read(T* value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "only trivially copyable types can be read directly");
+    ReadBytes(value, sizeof(T));
+  }
+
+  template <typename T>
+  void Read(T* data, std::size_t num) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "only trivially copyable types can be read directly");
+    ReadBytes(data, num * sizeof(T));
+  }
+
+  template <typename T>
+  T Read() {
+    T value;
+    Read(&value);
+    return value;
+  }
+
+  std::string ReadString() {
+    auto size = Read<uint64_t>();
+    if (offset_ + size > size_) {
+      throw std::out_of_range("StateReader: string of " +
+                              std::to_string(size) + " bytes is truncated");
+    }
+    std::string ret(data_ + offset_, size);
+    offset_ += size;
+    return ret;
+  }
+
+  template <typename T>
+  void ReadVector(std::vector<T>* vec) {
+    auto size = Read<uint64_t>();
+    if (size > (size_ - offset_) / sizeof(T)) {
+      throw std::out_of_range("StateReader: vector of " +
+                              std::to_string(size) + " elements is truncated");
+    }
+    vec->resize(size);
+    Read(vec->data(), size);
+  }
+
+  void ReadArray(const Array& arr) {
+    ReadBytes(arr.Data(), arr.size * arr.element_size);
+  }
+
+  [[nodiscard]] std::size_t Offset() const { return offset_; }
+  [[nodiscard]] std::size_t Size() const { return size_; }
+};
+
+#endif  // ENVPOOL_CORE_SERIALIZATION_H_
@@ -0,0 +1,663 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_SHM_ENVPOOL_H_
+#define ENVPOOL_CORE_SHM_ENVPOOL_H_
+
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envpool/core/array.h"
+#include "envpool/core/envpool.h"
+#include "envpool/core/spec.h"
+
+/**
+ * Layout of the shared memory segment between one EnvPool server and its
+ * clients:
+ *
+ *   header        | magic, layout hash, number of clients, stop flag,
+ *                 | doorbell semaphore (any client -> server)
+ *   client table  | num_clients x ShmClientHeader
+ *   per client    | request area: num_envs rows of every action field
+ *                 | state ring: num_blocks blocks of a row count and
+ *                 | batch_size rows of every state field
+ *
+ * Every client owns a contiguous range of the server's env ids and sees them
+ * as 0 .. num_envs - 1. Clients write their actions straight into the request
+ * area; the server writes states into the client's ring, and the client reads
+ * them in place. A block of the ring is only reused after the client has
+ * received num_blocks - 1 newer blocks, see `ShmLayout`. A block is full
+ * unless the client is in sync mode and requested fewer than num_envs envs,
+ * then it has the rows of those envs.
+ */
+struct ShmHeader {
+  uint64_t magic;
+  uint64_t layout_hash;
+  uint32_t num_clients;
+  std::atomic<int32_t> stop;
+  sem_t doorbell;
+};
+
+struct ShmClientHeader {
+  int32_t env_offset;
+  int32_t num_envs;
+  int32_t batch_size;
+  int32_t num_blocks;
+  uint64_t offset;
+  std::atomic<int32_t> connected;
+  std::atomic<int32_t> request;
+  int32_t request_size;
+  sem_t request_free;
+  sem_t state_ready;
+};
+
+class ShmLayout {
+ public:
+  static constexpr uint64_t kMagic = 0x314d48534c4f4f50ULL;  // "POOLSHM1"
+  static constexpr std::size_t kAlign = 64;
+  enum Request : int32_t { kNone = 0, kSend = 1, kReset = 2 };
+
+  struct Client {
+    int env_offset{0}, num_envs{0}, batch_size{0}, num_blocks{0};
+    std::size_t offset{0}, state_offset{0}, block_size{0};
+  };
+
+  std::vector<ShapeSpec> action_specs, state_specs;
+  // bytes of one env in every field
+  std::vector<std::size_t> action_row, state_row;
+  std::vector<Client> clients;
+  std::size_t size;
+  uint64_t hash;
+
+  static std::size_t AlignUp(std::size_t x) {
+    return (x + kAlign - 1) / kAlign * kAlign;
+  }
+
+  /**
+   * Bytes of one env, the leading -1 (number of players) counts as 1.
+   */
+  static std::size_t RowSize(const ShapeSpec& spec) {
+    std::size_t size = spec.element_size;
+    for (std::size_t i = 0; i < spec.shape.size(); ++i) {
+      if (i != 0 || spec.shape[i] != -1) {
+        size *= spec.shape[i];
+      }
+    }
+    return size;
+  }
+
+  /**
+   * Shape of `rows` envs in one field.
+   */
+  static ShapeSpec RowsSpec(const ShapeSpec& spec, int rows) {
+    if (!spec.shape.empty() && spec.shape[0] == -1) {
+      ShapeSpec s = spec;
+      s.shape[0] = rows;
+      return s;
+    }
+    return spec.Batch(rows);
+  }
+
+  ShmLayout(std::vector<ShapeSpec> action_spec,
+            std::vector<ShapeSpec> state_spec,
+            const std::vector<int>& client_num_envs,
+            const std::vector<int>& client_batch_size)
+      : action_specs(std::move(action_spec)),
+        state_specs(std::move(state_spec)),
+        hash(1469598103934665603ULL) {
+    for (const auto& spec : state_specs) {
+      if (spec.shape.size() > 1 &&
+          std::find(spec.shape.begin() + 1, spec.shape.end(), -1) !=
+              spec.shape.end()) {
+        throw std::invalid_argument(
+            "shm: states with dynamic (-1) shape are not supported");
+      }
+    }
+    for (const auto* specs : {&action_specs, &state_specs}) {
+      for (const auto& spec : *specs) {
+        Hash(spec.element_size);
+        Hash(spec.shape.size());
+        for (int s : spec.shape) {
+          Hash(s);
+        }
+      }
+    }
+    for (const auto& spec : action_specs) {
+      action_row.push_back(RowSize(spec));
+    }
+    for (const auto& spec : state_specs) {
+      state_row.push_back(RowSize(spec));
+    }
+    std::size_t offset = AlignUp(sizeof(ShmHeader) +
+                                 client_num_envs.size() *
+                                     sizeof(ShmClientHeader));
+    int env_offset = 0;
+    for (std::size_t c = 0; c < client_num_envs.size(); ++c) {
+      int num_envs = client_num_envs[c];
+      int batch_size = client_batch_size[c];
+      if (num_envs <= 0 || batch_size <= 0 || batch_size > num_envs) {
+        throw std::invalid_argument(
+            "shm: every client needs 0 < batch_size <= num_envs");
+      }
+      Client client;
+      client.env_offset = env_offset;
+      client.num_envs = num_envs;
+      client.batch_size = batch_size;
+      // at most num_envs states are pending, i.e. num_envs / batch_size full
+      // blocks plus a partial one, and one more held by the client
+      client.num_blocks = num_envs / batch_size + 2;
+      client.offset = offset;
+      for (auto row : action_row) {
+        offset = AlignUp(offset + row * num_envs);
+      }
+      client.state_offset = offset;
+      // the row count of the block
+      client.block_size = kAlign;
+      for (auto row : state_row) {
+        client.block_size = AlignUp(client.block_size + row * batch_size);
+      }
+      offset += client.block_size * client.num_blocks;
+      clients.push_back(client);
+      env_offset += num_envs;
+      Hash(num_envs);
+      Hash(batch_size);
+    }
+    size = offset;
+  }
+
+  /**
+   * Offset of action field `i` of client `c` in the segment.
+   */
+  [[nodiscard]] std::size_t ActionOffset(std::size_t c, std::size_t i) const {
+    std::size_t offset = clients[c].offset;
+    for (std::size_t j = 0; j < i; ++j) {
+      offset = AlignUp(offset + action_row[j] * clients[c].num_envs);
+    }
+    return offset;
+  }
+
+  /**
+   * Offset of the int32 row count of block `block` of client `c`.
+   */
+  [[nodiscard]] std::size_t RowsOffset(std::size_t c, int block) const {
+    return clients[c].state_offset + block * clients[c].block_size;
+  }
+
+  /**
+   * Offset of state field `i` in block `block` of client `c`.
+   */
+  [[nodiscard]] std::size_t StateOffset(std::size_t c, int block,
+                                        std::size_t i) const {
+    const auto& client = clients[c];
+    std::size_t offset = kAlign;
+    for (std::size_t j = 0; j < i; ++j) {
+      offset = AlignUp(offset + state_row[j] * client.batch_size);
+    }
+    return client.state_offset + block * client.block_size + offset;
+  }
+
+ protected:
+  void Hash(uint64_t x) {
+    // FNV-1a
+    for (int i = 0; i < 8; ++i) {
+      hash = (hash ^ ((x >> (i * 8)) & 0xff)) * 1099511628211ULL;
+    }
+  }
+};
+
+/**
+ * A named POSIX shared memory segment mapped into this process. The creator
+ * unlinks the name when it is destroyed; the mapping of every process stays
+ * valid until its own ShmSegment is gone.
+ */
+class ShmSegment {
+ protected:
+  std::string name_;
+  char* data_{nullptr};
+  std::size_t size_{0};
+  bool owner_;
+
+ public:
+  static std::runtime_error Error(const std::string& what,
+                                  const std::string& name) {
+    return std::runtime_error("shm: " + what + " " + name + ": " +
+                              std::strerror(errno));
+  }
+
+  /**
+   * Create a new segment of `size` bytes, it fails if `name` exists.
+   */
+  ShmSegment(std::string name, std::size_t size)
+      : name_(std::move(name)), size_(size), owner_(true) {
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+      throw Error("cannot create", name_);
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+      close(fd);
+      shm_unlink(name_.c_str());
+      throw Error("cannot resize", name_);
+    }
+    Map(fd);
+  }
+
+  /**
+   * Attach to an existing segment.
+   */
+  explicit ShmSegment(std::string name)
+      : name_(std::move(name)), owner_(false) {
+    int fd = shm_open(name_.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+      throw Error("cannot open", name_);
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw Error("cannot stat", name_);
+    }
+    size_ = st.st_size;
+    Map(fd);
+  }
+
+  ~ShmSegment() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+    if (owner_) {
+      shm_unlink(name_.c_str());
+    }
+  }
+
+  ShmSegment(const ShmSegment&) = delete;
+  ShmSegment& operator=(const ShmSegment&) = delete;
+
+  [[nodiscard]] char* Data() const { return data_; }
+  [[nodiscard]] std::size_t Size() const { return size_; }
+
+  ShmHeader* Header() const { return reinterpret_cast<ShmHeader*>(data_); }
+
+  ShmClientHeader* Client(std::size_t c) const {
+    return reinterpret_cast<ShmClientHeader*>(data_ + sizeof(ShmHeader)) + c;
+  }
+
+ protected:
+  void Map(int fd) {
+    void* ptr =
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      if (owner_) {
+        shm_unlink(name_.c_str());
+      }
+      throw Error("cannot mmap", name_);
+    }
+    data_ = static_cast<char*>(ptr);
+  }
+};
+
+/**
+ * Wait on a process-shared semaphore, retrying on signals.
+ */
+inline void ShmWait(sem_t* sem) {
+  while (sem_wait(sem) != 0) {
+  }
+}
+
+/**
+ * Server side of the shared memory protocol, owned by an `AsyncEnvPool`
+ * that runs `Poll` and `Scatter` on its serving thread.
+ */
+class ShmServer {
+ protected:
+  ShmLayout layout_;
+  ShmSegment segment_;
+  // owner client and order in the last request, per global env id
+  std::vector<int> owner_, order_;
+  // next block and row to be written, and envs requested but not yet
+  // written, per client
+  std::vector<int> block_, fill_, pending_;
+
+ public:
+  ShmServer(const std::string& name, ShmLayout layout)
+      : layout_(std::move(layout)), segment_(name, layout_.size) {
+    auto* header = segment_.Header();
+    header->layout_hash = layout_.hash;
+    header->num_clients = layout_.clients.size();
+    header->stop = 0;
+    sem_init(&header->doorbell, 1, 0);
+    for (std::size_t c = 0; c < layout_.clients.size(); ++c) {
+      const auto& client = layout_.clients[c];
+      auto* ch = segment_.Client(c);
+      ch->env_offset = client.env_offset;
+      ch->num_envs = client.num_envs;
+      ch->batch_size = client.batch_size;
+      ch->num_blocks = client.num_blocks;
+      ch->offset = client.offset;
+      ch->connected = 0;
+      ch->request = ShmLayout::kNone;
+      ch->request_size = 0;
+      sem_init(&ch->request_free, 1, 1);
+      sem_init(&ch->state_ready, 1, 0);
+      owner_.insert(owner_.end(), client.num_envs, static_cast<int>(c));
+    }
+    order_.assign(owner_.size(), 0);
+    block_.assign(layout_.clients.size(), 0);
+    fill_.assign(layout_.clients.size(), 0);
+    pending_.assign(layout_.clients.size(), 0);
+    // clients may attach as soon as the segment exists, publish it last
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = ShmLayout::kMagic;
+  }
+
+  ~ShmServer() {
+    auto* header = segment_.Header();
+    sem_destroy(&header->doorbell);
+    for (std::size_t c = 0; c < layout_.clients.size(); ++c) {
+      sem_destroy(&segment_.Client(c)->request_free);
+      sem_destroy(&segment_.Client(c)->state_ready);
+    }
+  }
+
+  /**
+   * Block until some client posts a request or the server is stopped.
+   */
+  void WaitRequest() { ShmWait(&segment_.Header()->doorbell); }
+
+  [[nodiscard]] bool Stopped() const { return segment_.Header()->stop != 0; }
+
+  /**
+   * Ask the serving thread to leave, and wake up every blocked client so
+   * that they see the stop flag.
+   */
+  void Stop() {
+    segment_.Header()->stop = 1;
+    sem_post(&segment_.Header()->doorbell);
+  }
+
+  void WakeClients() {
+    for (std::size_t c = 0; c < layout_.clients.size(); ++c) {
+      sem_post(&segment_.Client(c)->request_free);
+      sem_post(&segment_.Client(c)->state_ready);
+    }
+  }
+
+  /**
+   * Take every pending request. Actions are copied out of the request area,
+   * since envs parse them only when they are stepped, and their env ids are
+   * translated to the server's.
+   */
+  void Poll(const std::function<void(std::vector<Array>&&)>& send,
+            const std::function<void(const Array&)>& reset) {
+    for (std::size_t c = 0; c < layout_.clients.size(); ++c) {
+      auto* ch = segment_.Client(c);
+      int request = ch->request.load(std::memory_order_acquire);
+      if (request == ShmLayout::kNone) {
+        continue;
+      }
+      int size = ch->request_size;
+      int offset = layout_.clients[c].env_offset;
+      int num_fields = request == ShmLayout::kSend
+                           ? static_cast<int>(layout_.action_specs.size())
+                           : 1;
+      std::vector<Array> arr;
+      arr.reserve(num_fields);
+      for (int i = 0; i < num_fields; ++i) {
+        Array a(ShmLayout::RowsSpec(layout_.action_specs[i], size));
+        std::memcpy(a.Data(), segment_.Data() + layout_.ActionOffset(c, i),
+                    layout_.action_row[i] * size);
+        arr.emplace_back(std::move(a));
+      }
+      // env_id and players.env_id are the first two action fields
+      for (int i = 0; i < std::min(num_fields, 2); ++i) {
+        auto* env_id = static_cast<int*>(arr[i].Data());
+        for (int j = 0; j < size; ++j) {
+          env_id[j] += offset;
+        }
+      }
+      auto* env_id = static_cast<int*>(arr[0].Data());
+      for (int j = 0; j < size; ++j) {
+        order_[env_id[j]] = j;
+      }
+      pending_[c] += size;
+      ch->request.store(ShmLayout::kNone, std::memory_order_release);
+      sem_post(&ch->request_free);
+      if (request == ShmLayout::kSend) {
+        send(std::move(arr));
+      } else {
+        reset(arr[0]);
+      }
+    }
+  }
+
+  /**
+   * Route a received batch to the rings of the clients that own its envs.
+   * A client gets its rows in the order of its requests if it is in sync
+   * mode (batch_size == num_envs), and in arrival order otherwise. Like a
+   * local sync pool, a sync client that requested only some of its envs
+   * gets a block of just those once they are all written.
+   */
+  void Scatter(const std::vector<Array>& state) {
+    const auto* env_id = static_cast<const int*>(state[0].Data());
+    std::size_t n = state[0].Shape(0);
+    for (std::size_t r = 0; r < n; ++r) {
+      int eid = env_id[r];
+      int c = owner_[eid];
+      const auto& client = layout_.clients[c];
+      int local_id = eid - client.env_offset;
+      int pos = client.batch_size == client.num_envs ? order_[eid] : fill_[c];
+      for (std::size_t i = 0; i < state.size(); ++i) {
+        std::size_t row = layout_.state_row[i];
+        char* dst = segment_.Data() + layout_.StateOffset(c, block_[c], i) +
+                    row * pos;
+        if (i < 2) {
+          // info:env_id and info:players.env_id
+          std::memcpy(dst, &local_id, sizeof(int));
+        } else {
+          std::memcpy(dst, static_cast<char*>(state[i].Data()) + row * r, row);
+        }
+      }
+      --pending_[c];
+      if (++fill_[c] == client.batch_size ||
+          (client.batch_size == client.num_envs && pending_[c] == 0)) {
+        Publish(c);
+      }
+    }
+  }
+
+ protected:
+  void Publish(std::size_t c) {
+    auto rows = static_cast<int32_t>(fill_[c]);
+    std::memcpy(segment_.Data() + layout_.RowsOffset(c, block_[c]), &rows,
+                sizeof(rows));
+    fill_[c] = 0;
+    block_[c] = (block_[c] + 1) % layout_.clients[c].num_blocks;
+    sem_post(&segment_.Client(c)->state_ready);
+  }
+};
+
+/**
+ * Client side: an EnvPool of `num_envs` envs hosted by a server pool in
+ * another process. It is constructed from the same spec as a local pool,
+ * with num_envs and batch_size of this client, then attached with
+ * `ConnectShm`.
+ *
+ * Arrays returned by `Recv` point into the shared ring and stay valid until
+ * the next `Recv` of this client; copy them to keep them longer.
+ */
+template <typename EnvSpec>
+class ShmEnvPool : public EnvPool<EnvSpec> {
+ protected:
+  std::unique_ptr<ShmLayout> layout_;
+  std::shared_ptr<ShmSegment> segment_;
+  ShmClientHeader* header_{nullptr};
+  std::size_t client_id_{0};
+  int block_{0};
+
+  void CheckConnected() const {
+    if (header_ == nullptr) {
+      throw std::runtime_error("shm: client is not connected");
+    }
+  }
+
+  void CheckStopped() const {
+    if (segment_->Header()->stop != 0) {
+      throw std::runtime_error("shm: server is stopped");
+    }
+  }
+
+  /**
+   * Write `size` rows of the first `arr.size()` action fields into the
+   * request area and notify the server.
+   */
+  void Request(ShmLayout::Request request, const std::vector<Array>& arr,
+               int size) {
+    CheckConnected();
+    ShmWait(&header_->request_free);
+    CheckStopped();
+    const auto* env_id = static_cast<const int*>(arr[0].Data());
+    for (int j = 0; j < size; ++j) {
+      if (env_id[j] < 0 || env_id[j] >= header_->num_envs) {
+        sem_post(&header_->request_free);
+        throw std::out_of_range("shm: env_id out of range");
+      }
+    }
+    for (std::size_t i = 0; i < arr.size(); ++i) {
+      std::memcpy(segment_->Data() + layout_->ActionOffset(client_id_, i),
+                  arr[i].Data(), layout_->action_row[i] * size);
+    }
+    header_->request_size = size;
+    header_->request.store(request, std::memory_order_release);
+    sem_post(&segment_->Header()->doorbell);
+  }
+
+ public:
+  using Spec = EnvSpec;
+
+  explicit ShmEnvPool(const Spec& spec) : EnvPool<EnvSpec>(spec) {}
+
+  ~ShmEnvPool() override {
+    if (header_ != nullptr) {
+      header_->connected = 0;
+    }
+  }
+
+  /**
+   * Attach to the server's segment `name` as client `client_id`. The specs
+   * of this pool must match the server's, and num_envs / batch_size must be
+   * the ones given to the server for this client.
+   */
+  void ConnectShm(const std::string& name, int client_id) override {
+    if (header_ != nullptr) {
+      throw std::runtime_error("shm: client is already connected");
+    }
+    const auto& spec = EnvPool<EnvSpec>::spec;
+    int num_envs = spec.config["num_envs"_];
+    int batch_size = spec.config["batch_size"_];
+    if (batch_size <= 0) {
+      batch_size = num_envs;
+    }
+    auto segment = std::make_shared<ShmSegment>(name);
+    auto* header = segment->Header();
+    if (segment->Size() < sizeof(ShmHeader) ||
+        header->magic != ShmLayout::kMagic) {
+      throw std::runtime_error("shm: " + name + " is not an envpool server");
+    }
+    if (client_id < 0 || client_id >= static_cast<int>(header->num_clients)) {
+      throw std::out_of_range("shm: client_id out of range");
+    }
+    std::vector<int> client_num_envs, client_batch_size;
+    for (std::size_t c = 0; c < header->num_clients; ++c) {
+      client_num_envs.push_back(segment->Client(c)->num_envs);
+      client_batch_size.push_back(segment->Client(c)->batch_size);
+    }
+    auto* ch = segment->Client(client_id);
+    if (ch->num_envs != num_envs || ch->batch_size != batch_size) {
+      throw std::invalid_argument(
+          "shm: the server expects num_envs=" + std::to_string(ch->num_envs) +
+          ", batch_size=" + std::to_string(ch->batch_size) +
+          " for client " + std::to_string(client_id));
+    }
+    auto layout = std::make_unique<ShmLayout>(
+        spec.action_spec.template AllValues<ShapeSpec>(),
+        spec.state_spec.template AllValues<ShapeSpec>(), client_num_envs,
+        client_batch_size);
+    if (layout->hash != header->layout_hash ||
+        layout->size != segment->Size()) {
+      throw std::invalid_argument(
+          "shm: the spec of this client doesn't match the server's");
+    }
+    int expected = 0;
+    if (!ch->connected.compare_exchange_strong(expected, 1)) {
+      throw std::runtime_error("shm: client " + std::to_string(client_id) +
+                               " is already connected");
+    }
+    layout_ = std::move(layout);
+    segment_ = std::move(segment);
+    header_ = ch;
+    client_id_ = client_id;
+  }
+
+  void Send(const std::vector<Array>& action) override {
+    Request(ShmLayout::kSend, action, action[0].Shape(0));
+  }
+
+  void Send(std::vector<Array>&& action) override {
+    Request(ShmLayout::kSend, action, action[0].Shape(0));
+  }
+
+  void Reset(const Array& env_ids) override {
+    Request(ShmLayout::kReset, {env_ids}, env_ids.Shape(0));
+  }
+
+  std::vector<Array> Recv() override {
+    CheckConnected();
+    ShmWait(&header_->state_ready);
+    CheckStopped();
+    const auto& client = layout_->clients[client_id_];
+    int32_t rows;
+    std::memcpy(&rows,
+                segment_->Data() + layout_->RowsOffset(client_id_, block_),
+                sizeof(rows));
+    std::vector<Array> ret;
+    ret.reserve(layout_->state_specs.size());
+    for (std::size_t i = 0; i < layout_->state_specs.size(); ++i) {
+      char* data =
+          segment_->Data() + layout_->StateOffset(client_id_, block_, i);
+      // the arrays keep the mapping alive, not the ring block
+      ret.emplace_back(ShmLayout::RowsSpec(layout_->state_specs[i], rows),
+                       data, [segment = segment_](char* /*unused*/) {});
+    }
+    block_ = (block_ + 1) % client.num_blocks;
+    return ret;
+  }
+};
+
+#endif  // ENVPOOL_CORE_SHM_ENVPOOL_H_
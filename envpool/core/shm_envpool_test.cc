@@ -0,0 +1,247 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/shm_envpool.h"
+
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "envpool/core/async_envpool.h"
+#include "envpool/core/env.h"
+
+namespace {
+
+class CounterEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs"_.Bind(Spec<int>({2})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1})));
+  }
+};
+
+using CounterEnvSpec = EnvSpec<CounterEnvFns>;
+
+// obs is (env_id, sum of the actions since the last reset)
+class CounterEnv : public Env<CounterEnvSpec> {
+ protected:
+  int counter_{0};
+
+ public:
+  CounterEnv(const Spec& spec, int env_id)
+      : Env<CounterEnvSpec>(spec, env_id) {}
+
+  void Reset() override {
+    counter_ = 0;
+    WriteState();
+  }
+
+  void Step(const Action& action) override {
+    counter_ += static_cast<int>(action["action"_][0]);
+    WriteState();
+  }
+
+  bool IsDone() override { return false; }
+
+ protected:
+  void WriteState() {
+    auto state = Allocate();
+    state["obs"_](0) = env_id_;
+    state["obs"_](1) = counter_;
+  }
+};
+
+using CounterEnvPool = AsyncEnvPool<CounterEnv>;
+using CounterShmEnvPool = ShmEnvPool<CounterEnvSpec>;
+
+CounterEnvSpec MakeSpec(int num_envs, int batch_size) {
+  auto config = CounterEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = batch_size;
+  config["num_threads"_] = 2;
+  config["max_episode_steps"_] = 1 << 20;
+  return CounterEnvSpec(config);
+}
+
+std::string ShmName() {
+  return "/envpool_shm_test_" + std::to_string(getpid());
+}
+
+std::vector<Array> MakeAction(const std::vector<int>& env_ids, int value) {
+  int n = static_cast<int>(env_ids.size());
+  std::vector<Array> action{Array(Spec<int>({n})), Array(Spec<int>({n})),
+                            Array(Spec<int>({n}))};
+  for (int i = 0; i < n; ++i) {
+    action[0][i] = env_ids[i];
+    action[1][i] = env_ids[i];
+    action[2][i] = value;
+  }
+  return action;
+}
+
+Array MakeEnvIds(const std::vector<int>& env_ids) {
+  Array arr(Spec<int>({static_cast<int>(env_ids.size())}));
+  for (std::size_t i = 0; i < env_ids.size(); ++i) {
+    arr[i] = env_ids[i];
+  }
+  return arr;
+}
+
+// run num_steps async steps of +1 on every env of an async client, return
+// false on any mismatch
+bool StepAsyncClient(CounterShmEnvPool* client, int num_envs, int env_offset,
+                     int num_steps) {
+  std::vector<int> all(num_envs);
+  for (int i = 0; i < num_envs; ++i) {
+    all[i] = i;
+  }
+  client->Reset(MakeEnvIds(all));
+  std::vector<int> expected(num_envs, 0);
+  for (int s = 0; s < num_steps; ++s) {
+    auto state = client->Recv();
+    // common state order: info:env_id, ..., then obs last
+    const int* env_id = static_cast<const int*>(state[0].Data());
+    const int* obs = static_cast<const int*>(state.back().Data());
+    std::vector<int> ids;
+    for (std::size_t i = 0; i < state[0].Shape(0); ++i) {
+      int eid = env_id[i];
+      if (obs[i * 2] != eid + env_offset || obs[i * 2 + 1] != expected[eid]) {
+        return false;
+      }
+      ++expected[eid];
+      ids.push_back(eid);
+    }
+    client->Send(MakeAction(ids, 1));
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(ShmEnvPoolTest, AsyncAndSyncClients) {
+  std::string name = ShmName();
+  CounterEnvPool server(MakeSpec(6, 2));
+  server.ServeShm(name, {4, 2}, {2, 2});
+  CounterShmEnvPool async_client(MakeSpec(4, 2));
+  CounterShmEnvPool sync_client(MakeSpec(2, 2));
+  async_client.ConnectShm(name, 0);
+  sync_client.ConnectShm(name, 1);
+  bool async_ok = false;
+  std::thread t([&] {
+    async_ok = StepAsyncClient(&async_client, 4, 0, 200);
+  });
+  // a sync client gets its states in the order of its requests
+  sync_client.Reset(MakeEnvIds({1, 0}));
+  auto state = sync_client.Recv();
+  EXPECT_EQ(static_cast<int>(TArray<int>(state[0])[0]), 1);
+  EXPECT_EQ(static_cast<int>(TArray<int>(state[0])[1]), 0);
+  for (int s = 1; s <= 100; ++s) {
+    sync_client.Send(MakeAction({0, 1}, 2));
+    state = sync_client.Recv();
+    const int* env_id = static_cast<const int*>(state[0].Data());
+    const int* obs = static_cast<const int*>(state.back().Data());
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_EQ(env_id[i], i);
+      EXPECT_EQ(obs[i * 2], i + 4);
+      EXPECT_EQ(obs[i * 2 + 1], 2 * s);
+    }
+  }
+  t.join();
+  EXPECT_TRUE(async_ok);
+  server.StopShm();
+  EXPECT_THROW(async_client.Recv(), std::runtime_error);
+}
+
+TEST(ShmEnvPoolTest, SyncClientSubset) {
+  std::string name = ShmName();
+  CounterEnvPool server(MakeSpec(3, 1));
+  server.ServeShm(name, {3}, {3});
+  CounterShmEnvPool client(MakeSpec(3, 3));
+  client.ConnectShm(name, 0);
+  client.Reset(MakeEnvIds({0, 1, 2}));
+  EXPECT_EQ(client.Recv()[0].Shape(0), 3);
+  // a sync client that steps some of its envs gets just their states
+  for (int s = 1; s <= 50; ++s) {
+    client.Send(MakeAction({2, 0}, 1));
+    auto state = client.Recv();
+    ASSERT_EQ(state[0].Shape(0), 2);
+    const int* env_id = static_cast<const int*>(state[0].Data());
+    const int* obs = static_cast<const int*>(state.back().Data());
+    EXPECT_EQ(env_id[0], 2);
+    EXPECT_EQ(env_id[1], 0);
+    EXPECT_EQ(obs[1], s);
+    EXPECT_EQ(obs[3], s);
+  }
+  client.Reset(MakeEnvIds({1}));
+  auto state = client.Recv();
+  ASSERT_EQ(state[0].Shape(0), 1);
+  EXPECT_EQ(static_cast<int>(TArray<int>(state[0])[0]), 1);
+  server.StopShm();
+}
+
+TEST(ShmEnvPoolTest, Mismatch) {
+  std::string name = ShmName();
+  CounterEnvPool server(MakeSpec(4, 2));
+  EXPECT_THROW(server.ServeShm(name, {2, 1}, {2, 1}), std::invalid_argument);
+  EXPECT_THROW(server.ServeShm(name, {2, 2}, {2, 3}), std::invalid_argument);
+  server.ServeShm(name, {2, 2}, {2, 1});
+  CounterShmEnvPool client(MakeSpec(2, 2));
+  EXPECT_THROW(client.ConnectShm(name, 1), std::invalid_argument);
+  EXPECT_THROW(client.ConnectShm(name, 2), std::out_of_range);
+  client.ConnectShm(name, 0);
+  CounterShmEnvPool again(MakeSpec(2, 2));
+  EXPECT_THROW(again.ConnectShm(name, 0), std::runtime_error);
+  CounterShmEnvPool missing(MakeSpec(2, 2));
+  EXPECT_THROW(missing.ConnectShm(name + "_missing", 0), std::runtime_error);
+}
+
+TEST(ShmEnvPoolTest, OtherProcess) {
+  std::string name = ShmName();
+  // fork before the server starts any thread
+  pid_t pid = fork();
+  if (pid == 0) {
+    CounterShmEnvPool client(MakeSpec(3, 1));
+    for (int retry = 0;; ++retry) {
+      try {
+        client.ConnectShm(name, 1);
+        break;
+      } catch (const std::exception& e) {
+        if (retry == 1000) {
+          _exit(2);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+    _exit(StepAsyncClient(&client, 3, 2, 300) ? 0 : 1);
+  }
+  CounterEnvPool server(MakeSpec(5, 2));
+  server.ServeShm(name, {2, 3}, {2, 1});
+  CounterShmEnvPool client(MakeSpec(2, 2));
+  client.ConnectShm(name, 0);
+  EXPECT_TRUE(StepAsyncClient(&client, 2, 0, 300));
+  int status = 0;
+  waitpid(pid, &status, 0);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_SNAPSHOT_ARENA_H_
+#define ENVPOOL_CORE_SNAPSHOT_ARENA_H_
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "envpool/core/serialization.h"
+
+/**
+ * Fixed-size slots for in-memory env snapshots, addressed by an int handle.
+ *
+ * Memory is allocated in chunks of `chunk_slots` slots, the first one at
+ * construction, so taking a snapshot normally costs one memcpy and no
+ * allocation. A snapshot larger than the slot size falls back to a heap
+ * buffer owned by its slot.
+ *
+ * Acquire and Release are not thread-safe and are meant to be called from the
+ * thread that drives the pool; Store and Reader on distinct handles can run
+ * concurrently on the worker threads.
+ */
+class SnapshotArena {
+ protected:
+  std::size_t slot_size_, chunk_slots_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  std::vector<std::size_t> sizes_;
+  std::vector<std::vector<char>> overflow_;
+  std::vector<bool> in_use_;
+  std::vector<int> free_;
+
+ public:
+  SnapshotArena(std::size_t slot_size, std::size_t chunk_slots)
+      : slot_size_(slot_size), chunk_slots_(chunk_slots) {
+    if (chunk_slots_ == 0) {
+      throw std::invalid_argument("SnapshotArena: chunk_slots must be > 0");
+    }
+    Grow();
+  }
+
+  int Acquire() {
+    if (free_.empty()) {
+      Grow();
+    }
+    int handle = free_.back();
+    free_.pop_back();
+    in_use_[handle] = true;
+    return handle;
+  }
+
+  void Release(int handle) {
+    Check(handle);
+    in_use_[handle] = false;
+    sizes_[handle] = 0;
+    std::vector<char>().swap(overflow_[handle]);
+    free_.push_back(handle);
+  }
+
+  void Store(int handle, const std::vector<char>& buf) {
+    Check(handle);
+    sizes_[handle] = buf.size();
+    if (buf.size() <= slot_size_) {
+      std::memcpy(Slot(handle), buf.data(), buf.size());
+      std::vector<char>().swap(overflow_[handle]);
+    } else {
+      overflow_[handle] = buf;
+    }
+  }
+
+  [[nodiscard]] StateReader Reader(int handle) const {
+    Check(handle);
+    const char* data = sizes_[handle] <= slot_size_
+                           ? Slot(handle)
+                           : overflow_[handle].data();
+    return {data, sizes_[handle]};
+  }
+
+  [[nodiscard]] std::size_t SlotSize() const { return slot_size_; }
+  [[nodiscard]] std::size_t Capacity() const { return sizes_.size(); }
+  [[nodiscard]] std::size_t NumFree() const { return free_.size(); }
+
+ protected:
+  void Grow() {
+    int begin = static_cast<int>(sizes_.size());
+    chunks_.emplace_back(new char[slot_size_ * chunk_slots_]);
+    sizes_.resize(begin + chunk_slots_, 0);
+    overflow_.resize(begin + chunk_slots_);
+    in_use_.resize(begin + chunk_slots_, false);
+    // hand out low handles first
+    for (int i = static_cast<int>(sizes_.size()) - 1; i >= begin; --i) {
+      free_.push_back(i);
+    }
+  }
+
+  [[nodiscard]] char* Slot(int handle) const {
+    return chunks_[handle / chunk_slots_].get() +
+           (handle % chunk_slots_) * slot_size_;
+  }
+
+  void Check(int handle) const {
+    if (handle < 0 || handle >= static_cast<int>(sizes_.size()) ||
+        !in_use_[handle]) {
+      throw std::out_of_range("SnapshotArena: invalid snapshot handle " +
+                              std::to_string(handle));
+    }
+  }
+};
+
+#endif  // ENVPOOL_CORE_SNAPSHOT_ARENA_H_
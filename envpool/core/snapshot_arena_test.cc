@@ -0,0 +1,66 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/snapshot_arena.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+static std::vector<char> MakeBuf(std::size_t size, char seed) {
+  std::vector<char> buf(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    buf[i] = static_cast<char>(seed + i);
+  }
+  return buf;
+}
+
+static void ExpectEq(StateReader reader, const std::vector<char>& buf) {
+  ASSERT_EQ(reader.Size(), buf.size());
+  std::vector<char> out(buf.size());
+  reader.ReadBytes(out.data(), out.size());
+  EXPECT_EQ(out, buf);
+}
+
+TEST(SnapshotArenaTest, StoreAndGrow) {
+  SnapshotArena arena(16, 2);
+  EXPECT_EQ(arena.Capacity(), 2);
+  std::vector<int> handles;
+  for (int i = 0; i < 5; ++i) {
+    handles.push_back(arena.Acquire());
+    arena.Store(handles.back(), MakeBuf(10 + i, static_cast<char>(i)));
+  }
+  EXPECT_EQ(arena.Capacity(), 6);
+  EXPECT_EQ(arena.NumFree(), 1);
+  for (int i = 0; i < 5; ++i) {
+    ExpectEq(arena.Reader(handles[i]), MakeBuf(10 + i, static_cast<char>(i)));
+  }
+  // larger than a slot, kept on the heap
+  arena.Store(handles[0], MakeBuf(100, 7));
+  ExpectEq(arena.Reader(handles[0]), MakeBuf(100, 7));
+  ExpectEq(arena.Reader(handles[1]), MakeBuf(11, 1));
+}
+
+TEST(SnapshotArenaTest, Release) {
+  SnapshotArena arena(8, 4);
+  int a = arena.Acquire();
+  int b = arena.Acquire();
+  EXPECT_NE(a, b);
+  arena.Release(a);
+  EXPECT_THROW((void)arena.Reader(a), std::out_of_range);
+  EXPECT_THROW(arena.Release(a), std::out_of_range);
+  EXPECT_THROW((void)arena.Reader(100), std::out_of_range);
+  EXPECT_EQ(arena.Acquire(), a);
+  EXPECT_EQ(arena.Capacity(), 4);
+}
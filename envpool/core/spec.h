@@ -97,6 +97,15 @@ class TArray;
 template <typename dtype>
 using Container = std::unique_ptr<TArray<dtype>>;
 
+template <typename D>
+constexpr bool is_container_v = false;  // NOLINT
+template <typename D>
+constexpr bool is_container_v<Container<D>> = true;  // NOLINT
+template <typename... T>
+constexpr bool HasContainerType(std::tuple<T...> /*unused*/) {
+  return (is_container_v<typename T::dtype> || ...);
+}
+
 template <typename D>
 class Spec<Container<D>> : public ShapeSpec {
  public:
@@ -0,0 +1,553 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_VIDEO_RECORDER_H_
+#define ENVPOOL_CORE_VIDEO_RECORDER_H_
+
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// jpeglib.h needs size_t and FILE to be declared first
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "envpool/core/array.h"
+#include "envpool/core/spec.h"
+#include "lightweightsemaphore.h"
+
+/**
+ * Encode a gray (channels == 1) or RGB (channels == 3) image to PNG.
+ */
+inline std::string EncodePng(const uint8_t* pixels, int width, int height,
+                             int channels) {
+  std::size_t stride = static_cast<std::size_t>(width) * channels;
+  std::vector<uint8_t> raw((stride + 1) * height);
+  for (int y = 0; y < height; ++y) {
+    // filter type 0 (none) in front of every scanline
+    raw[y * (stride + 1)] = 0;
+    std::memcpy(&raw[y * (stride + 1) + 1], pixels + y * stride, stride);
+  }
+  uLongf size = compressBound(raw.size());
+  std::vector<uint8_t> idat(size);
+  compress2(idat.data(), &size, raw.data(), raw.size(), Z_BEST_SPEED);
+  std::string png("\x89PNG\r\n\x1a\n", 8);
+  auto chunk = [&](const char* type, const uint8_t* data, uint32_t len) {
+    uint8_t header[8] = {static_cast<uint8_t>(len >> 24),
+                         static_cast<uint8_t>(len >> 16),
+                         static_cast<uint8_t>(len >> 8),
+                         static_cast<uint8_t>(len)};
+    std::memcpy(header + 4, type, 4);
+    png.append(reinterpret_cast<char*>(header), 8);
+    png.append(reinterpret_cast<const char*>(data), len);
+    uLong crc = crc32(0, header + 4, 4);
+    if (len > 0) {
+      // crc32 returns its initial value for a null buffer
+      crc = crc32(crc, data, len);
+    }
+    uint8_t tail[4] = {static_cast<uint8_t>(crc >> 24),
+                       static_cast<uint8_t>(crc >> 16),
+                       static_cast<uint8_t>(crc >> 8),
+                       static_cast<uint8_t>(crc)};
+    png.append(reinterpret_cast<char*>(tail), 4);
+  };
+  uint8_t ihdr[13] = {
+      static_cast<uint8_t>(width >> 24),  static_cast<uint8_t>(width >> 16),
+      static_cast<uint8_t>(width >> 8),   static_cast<uint8_t>(width),
+      static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16),
+      static_cast<uint8_t>(height >> 8),  static_cast<uint8_t>(height),
+      8,  // bit depth
+      static_cast<uint8_t>(channels == 1 ? 0 : 2),  // gray or RGB
+      0, 0, 0};
+  chunk("IHDR", ihdr, sizeof(ihdr));
+  chunk("IDAT", idat.data(), size);
+  chunk("IEND", nullptr, 0);
+  return png;
+}
+
+/**
+ * Encode a gray (channels == 1) or RGB (channels == 3) image to JPEG.
+ */
+inline std::vector<uint8_t> EncodeJpeg(const uint8_t* pixels, int width,
+                                       int height, int channels,
+                                       int quality = 90) {
+  struct ErrorManager {
+    jpeg_error_mgr mgr;
+    std::jmp_buf jump;
+  };
+  jpeg_compress_struct cinfo{};
+  ErrorManager error{};
+  cinfo.err = jpeg_std_error(&error.mgr);
+  error.mgr.error_exit = [](j_common_ptr info) {
+    std::longjmp(reinterpret_cast<ErrorManager*>(info->err)->jump, 1);
+  };
+  unsigned char* buffer = nullptr;
+  unsigned long size = 0;  // NOLINT
+  if (setjmp(error.jump) != 0) {
+    jpeg_destroy_compress(&cinfo);
+    free(buffer);
+    throw std::runtime_error("video: jpeg encoding failed");
+  }
+  jpeg_create_compress(&cinfo);
+  jpeg_mem_dest(&cinfo, &buffer, &size);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = channels;
+  cinfo.in_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  std::size_t stride = static_cast<std::size_t>(width) * channels;
+  while (cinfo.next_scanline < cinfo.image_height) {
+    auto* row = const_cast<uint8_t*>(pixels + cinfo.next_scanline * stride);
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  std::vector<uint8_t> jpeg(buffer, buffer + size);
+  free(buffer);
+  return jpeg;
+}
+
+/**
+ * Motion-JPEG AVI file, written frame by frame. The frame count and sizes in
+ * the headers are patched and the index appended on `Close`.
+ */
+class MjpegAviWriter {
+ protected:
+  std::ofstream file_;
+  int width_, height_;
+  uint32_t num_frames_{0}, max_frame_size_{0};
+  std::streamoff movi_begin_;
+  std::vector<std::pair<uint32_t, uint32_t>> index_;  // offset, size
+
+  void Put32(uint32_t v) { file_.write(reinterpret_cast<char*>(&v), 4); }
+  void Put16(uint16_t v) { file_.write(reinterpret_cast<char*>(&v), 2); }
+  void PutTag(const char* tag) { file_.write(tag, 4); }
+  void Patch(std::streamoff pos, uint32_t v) {
+    file_.seekp(pos);
+    Put32(v);
+  }
+
+  // offsets of the fields patched on close
+  static constexpr std::streamoff kRiffSize = 4;
+  static constexpr std::streamoff kTotalFrames = 48;
+  static constexpr std::streamoff kAvihBufferSize = 60;
+  static constexpr std::streamoff kLength = 140;
+  static constexpr std::streamoff kStrhBufferSize = 144;
+  static constexpr std::streamoff kMoviSize = 216;
+
+ public:
+  MjpegAviWriter(const std::string& path, int width, int height, int fps)
+      : file_(path, std::ios::binary), width_(width), height_(height) {
+    if (!file_) {
+      throw std::runtime_error("video: cannot create " + path);
+    }
+    PutTag("RIFF");
+    Put32(0);
+    PutTag("AVI ");
+    PutTag("LIST");
+    Put32(4 + 8 + 56 + 8 + 4 + 8 + 56 + 8 + 40);
+    PutTag("hdrl");
+    PutTag("avih");
+    Put32(56);
+    Put32(1000000 / fps);  // microseconds per frame
+    Put32(0);
+    Put32(0);
+    Put32(0x10);  // AVIF_HASINDEX
+    Put32(0);     // total frames
+    Put32(0);
+    Put32(1);  // streams
+    Put32(0);  // suggested buffer size
+    Put32(width);
+    Put32(height);
+    for (int i = 0; i < 4; ++i) {
+      Put32(0);
+    }
+    PutTag("LIST");
+    Put32(4 + 8 + 56 + 8 + 40);
+    PutTag("strl");
+    PutTag("strh");
+    Put32(56);
+    PutTag("vids");
+    PutTag("MJPG");
+    Put32(0);
+    Put16(0);
+    Put16(0);
+    Put32(0);
+    Put32(1);    // scale
+    Put32(fps);  // rate
+    Put32(0);
+    Put32(0);  // length
+    Put32(0);  // suggested buffer size
+    Put32(0xffffffff);
+    Put32(0);
+    Put16(0);
+    Put16(0);
+    Put16(width);
+    Put16(height);
+    PutTag("strf");
+    Put32(40);
+    Put32(40);
+    Put32(width);
+    Put32(height);
+    Put16(1);
+    Put16(24);
+    PutTag("MJPG");
+    Put32(width * height * 3);
+    for (int i = 0; i < 4; ++i) {
+      Put32(0);
+    }
+    PutTag("LIST");
+    Put32(0);
+    movi_begin_ = file_.tellp();
+    PutTag("movi");
+  }
+
+  ~MjpegAviWriter() { Close(); }
+
+  void Write(const uint8_t* pixels, int channels) {
+    auto jpeg = EncodeJpeg(pixels, width_, height_, channels);
+    auto size = static_cast<uint32_t>(jpeg.size());
+    index_.emplace_back(
+        static_cast<uint32_t>(file_.tellp() - movi_begin_), size);
+    PutTag("00dc");
+    Put32(size);
+    file_.write(reinterpret_cast<char*>(jpeg.data()), size);
+    if (size % 2 == 1) {
+      file_.put(0);
+    }
+    ++num_frames_;
+    max_frame_size_ = std::max(max_frame_size_, size);
+  }
+
+  void Close() {
+    if (!file_.is_open()) {
+      return;
+    }
+    std::streamoff movi_end = file_.tellp();
+    PutTag("idx1");
+    Put32(static_cast<uint32_t>(index_.size() * 16));
+    for (auto [offset, size] : index_) {
+      PutTag("00dc");
+      Put32(0x10);  // AVIIF_KEYFRAME
+      Put32(offset);
+      Put32(size);
+    }
+    std::streamoff end = file_.tellp();
+    Patch(kRiffSize, static_cast<uint32_t>(end - 8));
+    Patch(kTotalFrames, num_frames_);
+    Patch(kAvihBufferSize, max_frame_size_);
+    Patch(kLength, num_frames_);
+    Patch(kStrhBufferSize, max_frame_size_);
+    Patch(kMoviSize, static_cast<uint32_t>(movi_end - movi_begin_));
+    file_.close();
+  }
+};
+
+/**
+ * Records the episodes of sampled envs as videos, configured by the video_*
+ * configs of the pool: episode k of env i is recorded if
+ * i < video_num_envs and k % video_every == 0.
+ *
+ * The frame is the first uint8 state named "obs" or "obs:*" that looks like
+ * an image: (H, W), (H, W, C) with C = 1 or 3, or (C, H, W). For (C, H, W),
+ * C = 3 is read as RGB and otherwise the last plane is taken, e.g. the
+ * newest frame of a stack.
+ *
+ * Envs copy their frames right after writing them, in `Env::PostProcess`,
+ * into a bounded lock-free ring with preallocated frames, which never blocks
+ * them: when it is full the frame is dropped and counted. A background
+ * thread encodes the frames into
+ * `<video_path>/env<i>_episode<k>.avi` (format "mjpeg") or
+ * `<video_path>/env<i>_episode<k>/<step>.png` (format "png").
+ */
+class VideoRecorder {
+ public:
+  struct Frame {
+    int env_id{-1};
+    int episode{-1};
+    int step{0};
+    bool last{false};
+    std::vector<uint8_t> pixels;
+  };
+
+  static constexpr int kFps = 30;
+
+ protected:
+  std::string path_;
+  bool png_;
+  int num_envs_, every_;
+  int key_{-1};
+  int height_{0}, width_{0}, channels_{1};
+  bool planar_{false};
+  std::size_t offset_{0}, size_{0};
+  // Bounded multi-producer ring with a sequence number per slot: the slot of
+  // position pos is free for it when seq == pos and holds its frame when
+  // seq == pos + 1, the encoder hands it to pos + capacity_ after encoding.
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    Frame frame;
+  };
+  std::size_t capacity_;
+  std::unique_ptr<Slot[]> ring_;
+  std::atomic<uint64_t> enqueue_pos_{0};
+  uint64_t dequeue_pos_{0};
+  // counts the published frames, for the encoder to sleep on
+  moodycamel::LightweightSemaphore ready_;
+  std::atomic<std::size_t> num_dropped_{0};
+  // the open video of each env and its episode
+  using AviWriters =
+      std::map<int, std::pair<int, std::unique_ptr<MjpegAviWriter>>>;
+  // the episode whose png directory each env has created
+  using PngDirs = std::map<int, int>;
+  std::thread encoder_;
+
+  void FindFrame(const std::vector<std::string>& keys,
+                 const std::vector<ShapeSpec>& specs) {
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if ((keys[i] != "obs" && keys[i].rfind("obs:", 0) != 0) ||
+          specs[i].element_size != 1) {
+        continue;
+      }
+      std::vector<int> shape = specs[i].shape;
+      if (!shape.empty() && shape[0] == -1) {
+        shape.erase(shape.begin());
+      }
+      if (shape.size() == 2) {
+        height_ = shape[0];
+        width_ = shape[1];
+      } else if (shape.size() == 3 && (shape[2] == 1 || shape[2] == 3)) {
+        height_ = shape[0];
+        width_ = shape[1];
+        channels_ = shape[2];
+      } else if (shape.size() == 3) {
+        height_ = shape[1];
+        width_ = shape[2];
+        if (shape[0] == 3) {
+          channels_ = 3;
+          planar_ = true;
+        } else {
+          offset_ = static_cast<std::size_t>(shape[0] - 1) * height_ * width_;
+        }
+      } else {
+        continue;
+      }
+      key_ = static_cast<int>(i);
+      size_ = static_cast<std::size_t>(height_) * width_ * channels_;
+      return;
+    }
+    throw std::invalid_argument(
+        "video_path: there is no uint8 image observation to record");
+  }
+
+  // the slot of the next position, stored in pos, or nullptr if it is full
+  Slot* TryClaim(uint64_t* pos) {
+    uint64_t p = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = ring_[p % capacity_];
+      auto diff = static_cast<int64_t>(
+          slot.seq.load(std::memory_order_acquire) - p);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(p, p + 1,
+                                               std::memory_order_relaxed)) {
+          *pos = p;
+          return &slot;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        p = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void Publish(Slot* slot, uint64_t pos) {
+    slot->seq.store(pos + 1, std::memory_order_release);
+    ready_.signal(1);
+  }
+
+  void Encode() {
+    AviWriters avi;
+    PngDirs png_dirs;
+    std::vector<uint8_t> interleaved;
+    for (;; ++dequeue_pos_) {
+      while (!ready_.wait()) {
+      }
+      Slot& slot = ring_[dequeue_pos_ % capacity_];
+      // ready_ may count a later frame, whose producer was faster
+      while (slot.seq.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+        std::this_thread::yield();
+      }
+      const Frame& frame = slot.frame;
+      if (frame.env_id < 0) {
+        break;
+      }
+      Write(frame, &avi, &png_dirs, &interleaved);
+      slot.seq.store(dequeue_pos_ + capacity_, std::memory_order_release);
+    }
+  }
+
+  void Write(const Frame& frame, AviWriters* avi, PngDirs* png_dirs,
+             std::vector<uint8_t>* interleaved) {
+    const uint8_t* pixels = frame.pixels.data();
+    if (planar_) {
+      std::size_t plane = static_cast<std::size_t>(height_) * width_;
+      interleaved->resize(size_);
+      for (std::size_t p = 0; p < plane; ++p) {
+        for (int c = 0; c < 3; ++c) {
+          (*interleaved)[p * 3 + c] = pixels[c * plane + p];
+        }
+      }
+      pixels = interleaved->data();
+    }
+    std::string name = path_ + "/env" + std::to_string(frame.env_id) +
+                       "_episode" + std::to_string(frame.episode);
+    try {
+      if (png_) {
+        // an episode may not start at step 0, e.g. an Atari life with
+        // episodic_life, and its first frames may have been dropped
+        auto [dir, created] = png_dirs->emplace(frame.env_id, frame.episode);
+        if (created || dir->second != frame.episode) {
+          dir->second = frame.episode;
+          if (mkdir(name.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("video: cannot create " + name + ": " +
+                                     std::strerror(errno));
+          }
+        }
+        char file[16];
+        std::snprintf(file, sizeof(file), "/%06d.png", frame.step);
+        std::ofstream out(name + file, std::ios::binary);
+        out << EncodePng(pixels, width_, height_, channels_);
+        if (!out) {
+          throw std::runtime_error("video: cannot write " + name + file);
+        }
+        return;
+      }
+      auto& [episode, writer] = (*avi)[frame.env_id];
+      if (writer == nullptr || episode != frame.episode) {
+        // the previous episode of this env was cut by a reset
+        writer = std::make_unique<MjpegAviWriter>(name + ".avi", width_,
+                                                  height_, kFps);
+        episode = frame.episode;
+      }
+      writer->Write(pixels, channels_);
+      if (frame.last) {
+        writer.reset();
+      }
+    } catch (const std::exception& e) {
+      LOG(ERROR) << e.what();
+    }
+  }
+
+ public:
+  VideoRecorder(std::string path, const std::string& format, int num_envs,
+                int every, const std::vector<std::string>& keys,
+                const std::vector<ShapeSpec>& specs,
+                std::size_t capacity = 256)
+      : path_(std::move(path)),
+        png_(format == "png"),
+        num_envs_(num_envs),
+        every_(std::max(every, 1)),
+        capacity_(capacity),
+        ring_(new Slot[capacity]),
+        ready_(0) {
+    if (format != "png" && format != "mjpeg") {
+      throw std::invalid_argument("video_format should be png or mjpeg, got " +
+                                  format);
+    }
+    FindFrame(keys, specs);
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      ring_[i].seq.store(i, std::memory_order_relaxed);
+      ring_[i].frame.pixels.resize(size_);
+    }
+    if (mkdir(path_.c_str(), 0755) != 0 && errno != EEXIST) {
+      throw std::runtime_error("video: cannot create " + path_ + ": " +
+                               std::strerror(errno));
+    }
+    encoder_ = std::thread([this] { Encode(); });
+  }
+
+  /**
+   * Encode what is queued and close the files.
+   */
+  ~VideoRecorder() {
+    uint64_t pos;
+    Slot* slot;
+    while ((slot = TryClaim(&pos)) == nullptr) {
+      std::this_thread::yield();
+    }
+    slot->frame.env_id = -1;
+    Publish(slot, pos);
+    encoder_.join();
+    if (num_dropped_ > 0) {
+      LOG(WARNING) << "video: dropped " << num_dropped_ << " frames";
+    }
+  }
+
+  VideoRecorder(const VideoRecorder&) = delete;
+  VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+  /**
+   * Whether episode `episode` of env `env_id` is recorded.
+   */
+  [[nodiscard]] bool Sample(int env_id, int episode) const {
+    return env_id < num_envs_ && episode % every_ == 0;
+  }
+
+  /**
+   * Called by the env after its state row is written, from any worker. It
+   * claims a slot with a compare-and-swap and copies the frame into it, so
+   * it takes no lock and allocates nothing; the frame is dropped if the ring
+   * is full.
+   */
+  void Push(int env_id, int episode, const std::vector<Array>& state) {
+    uint64_t pos;
+    Slot* slot = TryClaim(&pos);
+    if (slot == nullptr) {
+      ++num_dropped_;
+      return;
+    }
+    Frame& frame = slot->frame;
+    frame.env_id = env_id;
+    frame.episode = episode;
+    frame.step = *static_cast<int*>(state[2].Data());
+    frame.last = *static_cast<bool*>(state[3].Data());
+    const auto* obs = static_cast<const uint8_t*>(state[key_].Data());
+    std::memcpy(frame.pixels.data(), obs + offset_, size_);
+    Publish(slot, pos);
+  }
+
+  [[nodiscard]] std::size_t NumDropped() const { return num_dropped_; }
+};
+
+#endif  // ENVPOOL_CORE_VIDEO_RECORDER_H_
@@ -0,0 +1,360 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/video_recorder.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "envpool/core/async_envpool.h"
+#include "envpool/core/env.h"
+
+namespace {
+
+template <int kDim0, int kDim1, int kDim2>
+class ImageEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs"_.Bind(Spec<uint8_t>({kDim0, kDim1, kDim2})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1})));
+  }
+};
+
+// episodes of 3 steps, byte i of obs is env_id * 64 + step * 16 + i % 16
+template <int kDim0, int kDim1, int kDim2>
+class ImageEnv : public Env<EnvSpec<ImageEnvFns<kDim0, kDim1, kDim2>>> {
+ protected:
+  using Base = Env<EnvSpec<ImageEnvFns<kDim0, kDim1, kDim2>>>;
+  int step_{0};
+
+ public:
+  using Spec = EnvSpec<ImageEnvFns<kDim0, kDim1, kDim2>>;
+
+  ImageEnv(const Spec& spec, int env_id) : Base(spec, env_id) {}
+
+  void Reset() override {
+    step_ = 0;
+    WriteState();
+  }
+
+  void Step(const typename Base::Action& action) override {
+    ++step_;
+    WriteState();
+  }
+
+  bool IsDone() override { return step_ >= 3; }
+
+ protected:
+  void WriteState() {
+    auto state = this->Allocate();
+    auto* obs = static_cast<uint8_t*>(state["obs"_].Data());
+    for (int i = 0; i < kDim0 * kDim1 * kDim2; ++i) {
+      obs[i] = this->env_id_ * 64 + step_ * 16 + i % 16;
+    }
+  }
+};
+
+using RgbEnv = ImageEnv<6, 8, 3>;
+using StackEnv = ImageEnv<4, 6, 8>;
+
+template <typename E>
+typename E::Spec MakeSpec(int num_envs, const std::string& path,
+                          const std::string& format) {
+  auto config = E::Spec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["video_path"_] = path;
+  config["video_num_envs"_] = 2;
+  config["video_every"_] = 2;
+  config["video_format"_] = format;
+  return typename E::Spec(config);
+}
+
+template <typename E>
+void RunPool(const typename E::Spec& spec, int num_steps) {
+  AsyncEnvPool<E> pool(spec);
+  int n = spec.config["num_envs"_];
+  Array env_ids(Spec<int>({n}));
+  for (int i = 0; i < n; ++i) {
+    env_ids[i] = i;
+  }
+  pool.Reset(env_ids);
+  std::vector<Array> action{Array(Spec<int>({n})), Array(Spec<int>({n})),
+                            Array(Spec<int>({n}))};
+  for (int s = 0; s < num_steps; ++s) {
+    auto state = pool.Recv();
+    action[0].Assign(state[0]);
+    action[1].Assign(state[0]);
+    pool.Send(action);
+  }
+  pool.Recv();
+}
+
+std::string TempDir() {
+  char dir[] = "/tmp/envpool_video_XXXXXX";
+  EXPECT_NE(mkdtemp(dir), nullptr);
+  return dir;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  EXPECT_TRUE(file.good()) << path;
+  return {std::istreambuf_iterator<char>(file),
+          std::istreambuf_iterator<char>()};
+}
+
+uint32_t Read32(const std::string& data, std::size_t pos, bool big_endian) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    auto byte = static_cast<uint8_t>(data[pos + (big_endian ? i : 3 - i)]);
+    v = (v << 8) | byte;
+  }
+  return v;
+}
+
+// decode a PNG written by EncodePng, checking its chunks
+std::vector<uint8_t> DecodePng(const std::string& png, int* width,
+                               int* height, int* channels) {
+  EXPECT_EQ(png.substr(0, 8), std::string("\x89PNG\r\n\x1a\n", 8));
+  std::string idat;
+  std::size_t pos = 8;
+  while (pos < png.size()) {
+    uint32_t len = Read32(png, pos, true);
+    std::string type = png.substr(pos + 4, 4);
+    const auto* data = reinterpret_cast<const Bytef*>(png.data() + pos + 4);
+    EXPECT_EQ(crc32(0, data, len + 4), Read32(png, pos + 8 + len, true));
+    if (type == "IHDR") {
+      *width = static_cast<int>(Read32(png, pos + 8, true));
+      *height = static_cast<int>(Read32(png, pos + 12, true));
+      *channels = png[pos + 17] == 0 ? 1 : 3;
+    } else if (type == "IDAT") {
+      idat += png.substr(pos + 8, len);
+    }
+    pos += 12 + len;
+  }
+  std::size_t stride = static_cast<std::size_t>(*width) * *channels;
+  uLongf size = (stride + 1) * *height;
+  std::vector<uint8_t> raw(size);
+  EXPECT_EQ(uncompress(raw.data(), &size,
+                       reinterpret_cast<const Bytef*>(idat.data()),
+                       idat.size()),
+            Z_OK);
+  std::vector<uint8_t> pixels;
+  for (int y = 0; y < *height; ++y) {
+    EXPECT_EQ(raw[y * (stride + 1)], 0);
+    pixels.insert(pixels.end(), raw.begin() + y * (stride + 1) + 1,
+                  raw.begin() + (y + 1) * (stride + 1));
+  }
+  return pixels;
+}
+
+// a recorder of 6x8 RGB frames that exposes its drop count
+class Recorder : public VideoRecorder {
+ public:
+  Recorder(const std::string& path, const std::string& format, int num_envs,
+           std::size_t capacity)
+      : VideoRecorder(path, format, num_envs, 1,
+                      {"info:env_id", "info:players.env_id", "elapsed_step",
+                       "done", "obs"},
+                      {ShapeSpec(4, {-1}), ShapeSpec(4, {-1}),
+                       ShapeSpec(4, {-1}), ShapeSpec(1, {-1}),
+                       ShapeSpec(1, {-1, 6, 8, 3})},
+                      capacity) {}
+
+  [[nodiscard]] std::size_t NumDropped() const { return num_dropped_; }
+};
+
+// a state row for Recorder::Push
+std::vector<Array> FrameState() {
+  return {Array(Spec<int>({})), Array(Spec<int>({})), Array(Spec<int>({})),
+          Array(Spec<bool>({})), Array(Spec<uint8_t>({6, 8, 3}))};
+}
+
+}  // namespace
+
+TEST(VideoRecorderTest, Png) {
+  std::vector<uint8_t> rgb(5 * 7 * 3);
+  for (std::size_t i = 0; i < rgb.size(); ++i) {
+    rgb[i] = static_cast<uint8_t>(i * 7);
+  }
+  int width;
+  int height;
+  int channels;
+  EXPECT_EQ(DecodePng(EncodePng(rgb.data(), 7, 5, 3), &width, &height,
+                      &channels),
+            rgb);
+  EXPECT_EQ(width, 7);
+  EXPECT_EQ(height, 5);
+  EXPECT_EQ(channels, 3);
+  std::vector<uint8_t> gray(rgb.begin(), rgb.begin() + 35);
+  EXPECT_EQ(DecodePng(EncodePng(gray.data(), 7, 5, 1), &width, &height,
+                      &channels),
+            gray);
+  EXPECT_EQ(channels, 1);
+}
+
+TEST(VideoRecorderTest, MjpegAvi) {
+  std::string dir = TempDir();
+  // 3 envs, 4 frames per episode, 5 episodes each
+  RunPool<RgbEnv>(MakeSpec<RgbEnv>(3, dir, "mjpeg"), 19);
+  for (int env_id = 0; env_id < 3; ++env_id) {
+    for (int episode = 0; episode < 5; ++episode) {
+      std::string file = dir + "/env" + std::to_string(env_id) + "_episode" +
+                         std::to_string(episode) + ".avi";
+      bool sampled = env_id < 2 && episode % 2 == 0;
+      ASSERT_EQ(std::filesystem::exists(file), sampled) << file;
+      if (!sampled) {
+        continue;
+      }
+      std::string avi = ReadFile(file);
+      EXPECT_EQ(avi.substr(0, 4), "RIFF");
+      EXPECT_EQ(Read32(avi, 4, false), avi.size() - 8);
+      EXPECT_EQ(avi.substr(8, 4), "AVI ");
+      EXPECT_EQ(avi.substr(108, 8), "vidsMJPG");
+      // total frames, width, height
+      EXPECT_EQ(Read32(avi, 48, false), 4);
+      EXPECT_EQ(Read32(avi, 64, false), 8);
+      EXPECT_EQ(Read32(avi, 68, false), 6);
+      EXPECT_EQ(avi.substr(220, 4), "movi");
+      // the first frame is a JPEG
+      EXPECT_EQ(avi.substr(224, 4), "00dc");
+      EXPECT_EQ(avi.substr(232, 2), "\xff\xd8");
+      std::size_t idx1 = 216 + 4 + Read32(avi, 216, false);
+      EXPECT_EQ(avi.substr(idx1, 4), "idx1");
+      EXPECT_EQ(Read32(avi, idx1 + 4, false), 4 * 16);
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(VideoRecorderTest, PngFrameStack) {
+  std::string dir = TempDir();
+  RunPool<StackEnv>(MakeSpec<StackEnv>(2, dir, "png"), 7);
+  for (const char* episode : {"/env0_episode0", "/env1_episode0"}) {
+    for (int step = 0; step < 4; ++step) {
+      char name[16];
+      std::snprintf(name, sizeof(name), "/%06d.png", step);
+      int width;
+      int height;
+      int channels;
+      auto pixels = DecodePng(ReadFile(dir + episode + name), &width, &height,
+                              &channels);
+      EXPECT_EQ(width, 8);
+      EXPECT_EQ(height, 6);
+      EXPECT_EQ(channels, 1);
+      // the last plane of the stack
+      int env_id = episode[4] - '0';
+      for (int i = 0; i < 48; ++i) {
+        EXPECT_EQ(pixels[i], env_id * 64 + step * 16 + (3 * 48 + i) % 16);
+      }
+    }
+  }
+  EXPECT_FALSE(std::filesystem::exists(dir + "/env0_episode1"));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(VideoRecorderTest, PngEpisodeStart) {
+  // an episode that starts past step 0, like an Atari life
+  std::string dir = TempDir();
+  {
+    Recorder recorder(dir, "png", 1, 16);
+    auto state = FrameState();
+    for (int step = 5; step < 8; ++step) {
+      state[2] = step;
+      recorder.Push(0, 3, state);
+    }
+  }
+  for (const char* file : {"/000005.png", "/000006.png", "/000007.png"}) {
+    EXPECT_TRUE(std::filesystem::exists(dir + "/env0_episode3" + file));
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(VideoRecorderTest, Errors) {
+  std::string dir = TempDir();
+  EXPECT_THROW(RunPool<RgbEnv>(MakeSpec<RgbEnv>(1, dir, "gif"), 1),
+               std::invalid_argument);
+  std::vector<ShapeSpec> specs{ShapeSpec(4, {2})};
+  EXPECT_THROW(VideoRecorder(dir, "png", 1, 1, {"obs"}, specs),
+               std::invalid_argument);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(VideoRecorderTest, ConcurrentPush) {
+  // a small ring that the producers overrun: every frame is either encoded or
+  // counted as dropped
+  std::string dir = TempDir();
+  constexpr int kNumEnvs = 4;
+  constexpr int kNumSteps = 500;
+  std::size_t num_dropped;
+  {
+    Recorder recorder(dir, "mjpeg", kNumEnvs, 4);
+    std::vector<std::thread> producers;
+    for (int env_id = 0; env_id < kNumEnvs; ++env_id) {
+      producers.emplace_back([&recorder, env_id] {
+        auto state = FrameState();
+        for (int step = 0; step < kNumSteps; ++step) {
+          state[2] = step;
+          state[3] = step == kNumSteps - 1;
+          recorder.Push(env_id, 0, state);
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    num_dropped = recorder.NumDropped();
+  }
+  std::size_t num_written = 0;
+  for (int env_id = 0; env_id < kNumEnvs; ++env_id) {
+    std::string file = dir + "/env" + std::to_string(env_id) + "_episode0.avi";
+    if (std::filesystem::exists(file)) {
+      num_written += Read32(ReadFile(file), 48, false);
+    }
+  }
+  EXPECT_EQ(num_written + num_dropped, kNumEnvs * kNumSteps);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(VideoRecorderTest, Overhead) {
+  // envs 0 and 1 of 8 record every other episode
+  std::string dir = TempDir();
+  using AtariSizedEnv = ImageEnv<84, 84, 3>;
+  for (const std::string& path : {std::string(""), dir}) {
+    auto start = std::chrono::steady_clock::now();
+    RunPool<AtariSizedEnv>(MakeSpec<AtariSizedEnv>(8, path, "mjpeg"), 2000);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "video " << (path.empty() ? "off" : "on") << ": "
+              << elapsed.count() / 2000 * 1e6 << " us per batch of 8";
+  }
+  std::filesystem::remove_all(dir);
+}
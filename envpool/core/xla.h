@@ -29,14 +29,6 @@
 #include "envpool/core/array.h"
 #include "envpool/core/xla_template.h"
 
-template <typename D>
-constexpr bool is_container_v = false;  // NOLINT
-template <typename D>
-constexpr bool is_container_v<Container<D>> = true;  // NOLINT
-template <typename... T>
-constexpr bool HasContainerType(std::tuple<T...> /*unused*/) {
-  return (is_container_v<typename T::dtype> || ...);
-}
 bool HasDynamicDim(const std::vector<int>& shape) {
   return std::any_of(shape.begin() + 1, shape.end(),
                      [](int s) { return s == -1; });
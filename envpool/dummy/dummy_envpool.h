@@ -209,6 +209,41 @@ class DummyEnv : public Env<DummyEnvSpec> {
     }
   }
 
+  /**
+   * Save everything needed to resume the current episode. It is used by
+   * `save_state` and doesn't need to be implemented if checkpointing is not
+   * required.
+   */
+  void SaveState(StateWriter* writer) override { writer->Write(state_); }
+
+  /**
+   * Restore what `SaveState` wrote, and write the current state through
+   * `Allocate`, in the same way as `Reset`.
+   */
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    int num_players =
+        max_num_players_ <= 1 ? 1 : state_ % (max_num_players_ - 1) + 1;
+    auto state = Allocate(num_players);
+    for (int i = 0; i < num_players; ++i) {
+      state["info:players.id"_][i] = i;
+      state["info:players.done"_][i] = IsDone();
+      state["obs:raw"_](i, 0) = state_;
+      state["obs:raw"_](i, 1) = 0;
+      state["reward"_][i] = -i;
+      Container<int>& dyn = state["obs:dyn"_][i];
+      auto dyn_spec = ::Spec<int>({env_id_ + 1, spec_.config["state_num"_]});
+      dyn = std::make_unique<TArray<int>>(dyn_spec);
+      dyn->Fill(env_id_);
+    }
+  }
+
+  /**
+   * Restore what `SaveState` (or `Snapshot`, which defaults to `SaveState`)
+   * wrote without writing any state, it backs `snapshot`/`restore`/`branch`.
+   */
+  void Restore(StateReader* reader) override { reader->Read(&state_); }
+
   /**
    * Whether the single env has ended the current episode.
    */
@@ -17,7 +17,9 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <random>
+#include <string>
 #include <vector>
 
 using DummyAction = typename dummy::DummyEnv::Action;
@@ -236,3 +238,155 @@ TEST(DummyEnvPoolTest, MultiPlayers) {
   Runner(9, 4, 30, 100000, 9, 6);
   Runner(10, 10, 25, 100000, 0, 9);
 }
+
+TEST(DummyEnvPoolTest, SaveLoadState) {
+  int num_envs = 4;
+  auto config = dummy::DummyEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 20;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  TArray all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  DummyAction action;
+  action["env_id"_] = all_env_ids;
+  action["players.env_id"_] = all_env_ids;
+  action["list_action"_] = TArray(Spec<double>({num_envs, 6}));
+  action["players.action"_] = all_env_ids;
+  action["players.id"_] = TArray(Spec<int>({num_envs}));
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  for (int i = 0; i < 5; ++i) {
+    envpool.Send(action);
+    envpool.Recv();
+  }
+  std::string path = testing::TempDir() + "/dummy_save_load_state.bin";
+  envpool.SaveState(path);
+  for (int i = 0; i < 3; ++i) {
+    envpool.Send(action);
+    envpool.Recv();
+  }
+  auto check = [&](dummy::DummyEnvPool* pool) {
+    pool->LoadState(path);
+    DummyState state(pool->Recv());
+    for (int i = 0; i < num_envs; ++i) {
+      EXPECT_EQ(static_cast<int>(state["info:env_id"_][i]), i);
+      EXPECT_EQ(static_cast<int>(state["obs:raw"_](i, 0)), 5);
+      EXPECT_EQ(static_cast<int>(state["elapsed_step"_][i]), 5);
+    }
+    pool->Send(action);
+    state = DummyState(pool->Recv());
+    for (int i = 0; i < num_envs; ++i) {
+      EXPECT_EQ(static_cast<int>(state["obs:raw"_](i, 0)), 6);
+    }
+  };
+  check(&envpool);
+  // a freshly created pool can resume from the same file
+  dummy::DummyEnvPool another(spec);
+  check(&another);
+  config["num_envs"_] = num_envs + 1;
+  config["batch_size"_] = num_envs + 1;
+  dummy::DummyEnvPool mismatch(dummy::DummyEnvSpec{config});
+  EXPECT_THROW(mismatch.LoadState(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(DummyEnvPoolTest, SnapshotRestoreBranch) {
+  int num_envs = 6;
+  auto config = dummy::DummyEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["num_threads"_] = 3;
+  config["seed"_] = 100;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  TArray all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  DummyAction action;
+  action["env_id"_] = all_env_ids;
+  action["players.env_id"_] = all_env_ids;
+  action["list_action"_] = TArray(Spec<double>({num_envs, 6}));
+  action["players.action"_] = all_env_ids;
+  action["players.id"_] = TArray(Spec<int>({num_envs}));
+  auto step = [&] {
+    envpool.Send(action);
+    return DummyState(envpool.Recv());
+  };
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  step();
+  step();
+  auto handles = envpool.Snapshot({0, 1, 2, 3, 4, 5});
+  EXPECT_EQ(handles.size(), num_envs);
+  auto check = [&](const DummyState& state, const std::vector<int>& ref) {
+    for (int i = 0; i < num_envs; ++i) {
+      EXPECT_EQ(static_cast<int>(state["obs:raw"_](i, 0)), ref[i]);
+      EXPECT_EQ(static_cast<int>(state["elapsed_step"_][i]), ref[i]);
+    }
+  };
+  check(step(), {3, 3, 3, 3, 3, 3});
+  envpool.Restore({1}, {handles[1]});
+  check(step(), {4, 3, 4, 4, 4, 4});
+  envpool.Branch(1, {4, 5, 1});
+  check(step(), {5, 4, 5, 5, 4, 4});
+  envpool.Restore({0, 1, 2, 3, 4, 5}, handles);
+  check(step(), {3, 3, 3, 3, 3, 3});
+  envpool.ReleaseSnapshot(handles);
+  EXPECT_THROW(envpool.Restore({0}, {handles[0]}), std::out_of_range);
+  // released slots are reused without growing the arena
+  auto handles2 = envpool.Snapshot({2, 3});
+  check(step(), {4, 4, 4, 4, 4, 4});
+  envpool.Restore({4, 5}, handles2);
+  check(step(), {5, 5, 5, 5, 4, 4});
+}
+
+void RunCollectEpisodes(int num_envs, int batch, int num_episodes) {
+  auto config = dummy::DummyEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = batch;
+  config["num_threads"_] = 2;
+  config["seed"_] = 1;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  std::vector<int> num_states(num_envs);
+  envpool.CollectBegin(num_episodes);
+  while (envpool.CollectActive() > 0) {
+    DummyState state(envpool.Recv());
+    int n = state["info:env_id"_].Shape(0);
+    EXPECT_LE(n, batch);
+    TArray env_ids(Spec<int>({n}));
+    for (int i = 0; i < n; ++i) {
+      int env_id = state["info:env_id"_][i];
+      env_ids[i] = env_id;
+      ++num_states[env_id];
+    }
+    DummyAction action;
+    action["env_id"_] = env_ids;
+    action["players.env_id"_] = env_ids;
+    action["list_action"_] = TArray(Spec<double>({n, 6}));
+    action["players.action"_] = env_ids;
+    action["players.id"_] = TArray(Spec<int>({n}));
+    envpool.Send(action);
+  }
+  auto [returns, lengths] = envpool.CollectEnd();
+  ASSERT_EQ(lengths.size(), num_envs * num_episodes);
+  for (int i = 0; i < num_envs; ++i) {
+    // dummy env i finishes an episode after seed + i steps
+    for (int j = 0; j < num_episodes; ++j) {
+      EXPECT_EQ(lengths[i * num_episodes + j], i + 1);
+      EXPECT_EQ(returns[i * num_episodes + j], 0.0f);
+    }
+    // one reset plus the steps of each episode, nothing more
+    EXPECT_EQ(num_states[i], num_episodes * (i + 2));
+  }
+}
+
+TEST(DummyEnvPoolTest, CollectEpisodesSync) { RunCollectEpisodes(5, 5, 3); }
+
+TEST(DummyEnvPoolTest, CollectEpisodesAsync) { RunCollectEpisodes(7, 3, 4); }
@@ -32,6 +32,12 @@ class _DummyEnvPoolTest(absltest.TestCase):
       "num_threads",
       "max_num_players",
       "thread_affinity_offset",
+      "num_preprocess_threads",
+      "isolation",
+      "video_path",
+      "video_num_envs",
+      "video_every",
+      "video_format",
       "base_path",
       "seed",
       "gym_reset_return_info",
@@ -43,6 +43,11 @@ try:
 except ImportError:
   pass
 
+try:
+  import envpool.replay.registration  # noqa: F401
+except ImportError:
+  pass
+
 try:
   import envpool.toy_text.registration  # noqa: F401
 except ImportError:
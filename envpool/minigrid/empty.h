@@ -64,6 +64,15 @@ class EmptyEnv : public Env<EmptyEnvSpec>, public MiniGridEmptyEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MiniGridSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override { MiniGridRestore(reader); }
+
   void Reset() override {
     MiniGridReset();
     WriteState(0.0);
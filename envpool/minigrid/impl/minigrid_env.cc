@@ -238,4 +238,69 @@ void MiniGridEnv::GenImage(const Array& obs) {
   }
 }
 
+static void SaveObj(StateWriter* writer, WorldObj* obj) {
+  writer->Write(obj->GetType());
+  writer->Write(obj->GetColor());
+  writer->Write(obj->GetDoorOpen());
+  writer->Write(obj->GetDoorLocked());
+  writer->Write(obj->GetContains() != nullptr);
+  if (obj->GetContains() != nullptr) {
+    SaveObj(writer, obj->GetContains());
+  }
+}
+
+static void LoadObj(StateReader* reader, WorldObj* obj) {
+  auto type = reader->Read<Type>();
+  auto color = reader->Read<Color>();
+  // WorldObj only shallow-copies contains_, free it before overwriting
+  delete obj->GetContains();
+  obj->SetContains(nullptr);
+  *obj = WorldObj(type, color);
+  obj->SetDoorOpen(reader->Read<bool>());
+  obj->SetDoorLocker(reader->Read<bool>());
+  if (reader->Read<bool>()) {
+    auto* contains = new WorldObj();
+    LoadObj(reader, contains);
+    obj->SetContains(contains);
+  }
+}
+
+void MiniGridEnv::MiniGridSaveState(StateWriter* writer) {
+  writer->Write(step_count_);
+  writer->Write(done_);
+  writer->Write(agent_pos_.first);
+  writer->Write(agent_pos_.second);
+  writer->Write(agent_dir_);
+  writer->Write(agent_start_pos_.first);
+  writer->Write(agent_start_pos_.second);
+  writer->Write(agent_start_dir_);
+  writer->Write(grid_.size());
+  for (auto& row : grid_) {
+    writer->Write(row.size());
+    for (auto& obj : row) {
+      SaveObj(writer, &obj);
+    }
+  }
+  SaveObj(writer, &carrying_);
+}
+
+void MiniGridEnv::MiniGridRestore(StateReader* reader) {
+  reader->Read(&step_count_);
+  reader->Read(&done_);
+  reader->Read(&agent_pos_.first);
+  reader->Read(&agent_pos_.second);
+  reader->Read(&agent_dir_);
+  reader->Read(&agent_start_pos_.first);
+  reader->Read(&agent_start_pos_.second);
+  reader->Read(&agent_start_dir_);
+  grid_.resize(reader->Read<std::size_t>());
+  for (auto& row : grid_) {
+    row.resize(reader->Read<std::size_t>());
+    for (auto& obj : row) {
+      LoadObj(reader, &obj);
+    }
+  }
+  LoadObj(reader, &carrying_);
+}
+
 }  // namespace minigrid
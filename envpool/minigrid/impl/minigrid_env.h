@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "envpool/core/array.h"
+#include "envpool/core/serialization.h"
 #include "envpool/minigrid/impl/utils.h"
 
 namespace minigrid {
@@ -50,6 +51,8 @@ class MiniGridEnv {
   void PlaceAgent(int start_x = 0, int start_y = 0, int end_x = -1,
                   int end_y = -1);
   void GenImage(const Array& obs);
+  void MiniGridSaveState(StateWriter* writer);
+  void MiniGridRestore(StateReader* reader);
   virtual void GenGrid() {}
 };
 
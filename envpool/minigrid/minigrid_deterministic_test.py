@@ -13,7 +13,9 @@
 # limitations under the License.
 """Unit tests for minigrid environments check."""
 
-from typing import Any
+import os
+import tempfile
+from typing import Any, List
 
 import numpy as np
 from absl.testing import absltest
@@ -52,10 +54,54 @@ class _MiniGridEnvPoolDeterministicTest(absltest.TestCase):
       )
     assert same_count == 0, f"{same_count=}"
 
+  def run_restore_check(
+    self,
+    task_id: str,
+    num_envs: int = 2,
+    total: int = 100,
+  ) -> None:
+    env = make_gym(task_id, num_envs=num_envs, seed=0)
+    env.action_space.seed(0)
+    actions = [env.action_space.sample() for _ in range(3 * total)]
+
+    def run(begin: int, end: int) -> List[List[Any]]:
+      # every env takes the same actions, the result is indexed by env_id
+      traj: List[List[Any]] = [[] for _ in range(num_envs)]
+      for action in actions[begin:end]:
+        obs, rew, term, trunc, info = env.step(np.array([action] * num_envs))
+        for i, env_id in enumerate(info["env_id"]):
+          traj[env_id].append(
+            [
+              obs["image"][i].tolist(), obs["direction"][i], rew[i], term[i],
+              trunc[i]
+            ]
+          )
+      return traj
+
+    env.reset()
+    run(0, total)
+    handles = env.snapshot(np.array([0]))
+    ref = run(total, 2 * total)[0]
+    env.restore(handles, np.array([0]))
+    env.branch(0, np.array([1]))
+    traj = run(total, 2 * total)
+    env.release_snapshot(handles)
+    # bit-identical, not only close
+    self.assertEqual(traj, [ref] * num_envs)
+    with tempfile.TemporaryDirectory() as tmp:
+      path = os.path.join(tmp, "state")
+      env.save_state(path)
+      ref = run(2 * total, 3 * total)
+      env.load_state(path)
+      self.assertEqual(run(2 * total, 3 * total), ref)
+
   def test_empty(self) -> None:
     self.run_deterministic_check("MiniGrid-Empty-Random-5x5-v0")
     self.run_deterministic_check("MiniGrid-Empty-Random-6x6-v0")
 
+  def test_restore(self) -> None:
+    self.run_restore_check("MiniGrid-Empty-Random-6x6-v0")
+
 
 if __name__ == "__main__":
   absltest.main()
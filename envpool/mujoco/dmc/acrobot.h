@@ -40,12 +40,15 @@ std::string GetAcrobotXML(const std::string& base_path,
 class AcrobotEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(1),
-                    "task_name"_.Bind(std::string("swingup")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(1),
+                 "task_name"_.Bind(std::string("swingup"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:orientations"_.Bind(Spec<mjtNum>({4})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:orientations"_.Bind(Spec<mjtNum>({4})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({2}))
 #ifdef ENVPOOL_TEST
                         ,
@@ -73,7 +76,8 @@ class AcrobotEnv : public Env<AcrobotEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetAcrobotXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_), PixelOptions(spec.config)),
         id_upper_arm_(mj_name2id(model_, mjOBJ_XBODY, "upper_arm")),
         id_lower_arm_(mj_name2id(model_, mjOBJ_XBODY, "lower_arm")),
         id_target_(mj_name2id(model_, mjOBJ_SITE, "target")),
@@ -98,6 +102,15 @@ class AcrobotEnv : public Env<AcrobotEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -119,6 +132,7 @@ class AcrobotEnv : public Env<AcrobotEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -39,12 +39,15 @@ std::string GetBallInCupXML(const std::string& base_path,
 class BallInCupEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(10),
-                    "task_name"_.Bind(std::string("catch")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(10),
+                 "task_name"_.Bind(std::string("catch"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({4})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({4})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({4}))
 #ifdef ENVPOOL_TEST
                         ,
@@ -71,7 +74,9 @@ class BallInCupEnv : public Env<BallInCupEnvSpec>, public MujocoEnv {
                   GetBallInCupXML(spec.config["base_path"_],
                                   spec.config["task_name"_]),
                   spec.config["frame_skip"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_),
+                  PixelOptions(spec.config)),
         id_target_(mj_name2id(model_, mjOBJ_SITE, "target")),
         id_ball_(mj_name2id(model_, mjOBJ_XBODY, "ball")),
         id_ball_x_(GetQposId(model_, "ball_x")),
@@ -100,6 +105,15 @@ class BallInCupEnv : public Env<BallInCupEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -118,6 +132,7 @@ class BallInCupEnv : public Env<BallInCupEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -50,8 +50,10 @@ std::string GetCartpoleXML(const std::string& base_path,
 class CartpoleEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(1),
-                    "task_name"_.Bind(std::string("balance")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(1),
+                 "task_name"_.Bind(std::string("balance"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -68,7 +70,8 @@ class CartpoleEnvFns {
       throw std::runtime_error("Unknown task_name " + task_name +
                                " for dmc cartpole.");
     }
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({1 + 2 * n_poles})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({1 + 2 * n_poles})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({1 + n_poles}))
 #ifdef ENVPOOL_TEST
                         ,
@@ -101,7 +104,9 @@ class CartpoleEnv : public Env<CartpoleEnvSpec>, public MujocoEnv {
                   GetCartpoleXML(spec.config["base_path"_],
                                  spec.config["task_name"_]),
                   spec.config["frame_skip"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_),
+                  PixelOptions(spec.config)),
         id_slider_(GetQposId(model_, "slider")),
         id_hinge1_(GetQposId(model_, "hinge_1")),
         is_sparse_(spec.config["task_name"_] == "balance_sparse" ||
@@ -139,6 +144,15 @@ class CartpoleEnv : public Env<CartpoleEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -186,6 +200,7 @@ class CartpoleEnv : public Env<CartpoleEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -39,12 +39,14 @@ std::string GetCheetahXML(const std::string& base_path,
 class CheetahEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(1),
-                    "task_name"_.Bind(std::string("run")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(1), "task_name"_.Bind(std::string("run"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({8})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({8})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({9}))
 #ifdef ENVPOOL_TEST
                         ,
@@ -71,13 +73,16 @@ class CheetahEnv : public Env<CheetahEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetCheetahXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_), PixelOptions(spec.config)),
         id_torso_subtreelinvel_(GetSensorId(model_, "torso_subtreelinvel")) {
     const std::string& task_name = spec.config["task_name"_];
     if (task_name != "run") {
       throw std::runtime_error("Unknown task_name " + task_name +
                                " for dmc cheetah.");
     }
+    // the first substep of TaskInitializeEpisode is the mj_step2 of the reset
+    reset_forward_read_ = true;
   }
 
   void TaskInitializeEpisode() override {
@@ -99,6 +104,15 @@ class CheetahEnv : public Env<CheetahEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -121,6 +135,7 @@ class CheetahEnv : public Env<CheetahEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
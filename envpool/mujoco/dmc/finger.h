@@ -40,12 +40,14 @@ std::string GetFingerXML(const std::string& base_path,
 class FingerEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(2),
-                    "task_name"_.Bind(std::string("spin")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(2), "task_name"_.Bind(std::string("spin"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({4})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({4})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({3})),
                     "obs:touch"_.Bind(Spec<mjtNum>({2})),
                     "obs:target_position"_.Bind(Spec<mjtNum>({2})),
@@ -89,7 +91,9 @@ class FingerEnv : public Env<FingerEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetFingerXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_),
+            PixelOptions(spec.config), true),
         id_site_target_(mj_name2id(model_, mjOBJ_SITE, "target")),
         id_site_tip_(mj_name2id(model_, mjOBJ_SITE, "tip")),
         id_hinge_(GetQvelId(model_, "hinge")),
@@ -152,6 +156,15 @@ class FingerEnv : public Env<FingerEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -175,6 +188,7 @@ class FingerEnv : public Env<FingerEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
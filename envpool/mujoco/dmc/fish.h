@@ -40,12 +40,15 @@ std::string GetFishXML(const std::string& base_path,
 class FishEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(10),
-                    "task_name"_.Bind(std::string("upright")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(10),
+                 "task_name"_.Bind(std::string("upright"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:joint_angles"_.Bind(Spec<mjtNum>({7})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:joint_angles"_.Bind(Spec<mjtNum>({7})),
                     "obs:upright"_.Bind(Spec<mjtNum>({})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({13})),
                     "obs:target"_.Bind(Spec<mjtNum>({3}))
@@ -83,7 +86,9 @@ class FishEnv : public Env<FishEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetFishXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_),
+            PixelOptions(spec.config), true),
         id_mouth_(mj_name2id(model_, mjOBJ_GEOM, "mouth")),
         id_qpos_root_(GetQposId(model_, "root")),
         id_torso_(mj_name2id(model_, mjOBJ_XBODY, "torso")),
@@ -142,6 +147,15 @@ class FishEnv : public Env<FishEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -172,6 +186,7 @@ class FishEnv : public Env<FishEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -38,12 +38,15 @@ std::string GetHopperXML(const std::string& base_path,
 class HopperEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(4),
-                    "task_name"_.Bind(std::string("stand")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(4),
+                 "task_name"_.Bind(std::string("stand"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({6})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({6})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({7})),
                     "obs:touch"_.Bind(Spec<mjtNum>({2}))
 #ifdef ENVPOOL_TEST
@@ -73,7 +76,8 @@ class HopperEnv : public Env<HopperEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetHopperXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_), PixelOptions(spec.config)),
         id_torso_(mj_name2id(model_, mjOBJ_XBODY, "torso")),
         id_foot_(mj_name2id(model_, mjOBJ_XBODY, "foot")),
         id_torso_subtreelinvel_(GetSensorId(model_, "torso_subtreelinvel")),
@@ -100,6 +104,15 @@ class HopperEnv : public Env<HopperEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -151,6 +164,7 @@ class HopperEnv : public Env<HopperEnvSpec>, public MujocoEnv {
 
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
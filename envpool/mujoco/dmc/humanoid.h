@@ -40,12 +40,15 @@ std::string GetHumanoidXML(const std::string& base_path,
 class HumanoidEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(5),
-                    "task_name"_.Bind(std::string("stand")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(5),
+                 "task_name"_.Bind(std::string("stand"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:joint_angles"_.Bind(Spec<mjtNum>({21})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:joint_angles"_.Bind(Spec<mjtNum>({21})),
                     "obs:head_height"_.Bind(Spec<mjtNum>({})),
                     "obs:extremities"_.Bind(Spec<mjtNum>({12})),
                     "obs:torso_vertical"_.Bind(Spec<mjtNum>({3})),
@@ -90,7 +93,9 @@ class HumanoidEnv : public Env<HumanoidEnvSpec>, public MujocoEnv {
                   GetHumanoidXML(spec.config["base_path"_],
                                  spec.config["task_name"_]),
                   spec.config["frame_skip"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_),
+                  PixelOptions(spec.config)),
         id_head_(mj_name2id(model_, mjOBJ_XBODY, "head")),
         id_left_hand_(mj_name2id(model_, mjOBJ_XBODY, "left_hand")),
         id_left_foot_(mj_name2id(model_, mjOBJ_XBODY, "left_foot")),
@@ -130,6 +135,15 @@ class HumanoidEnv : public Env<HumanoidEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -179,6 +193,7 @@ class HumanoidEnv : public Env<HumanoidEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -56,12 +56,15 @@ std::string GetManipulatorXML(const std::string& base_path,
 class ManipulatorEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(10),
-                    "task_name"_.Bind(std::string("bring_ball")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(10),
+                 "task_name"_.Bind(std::string("bring_ball"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:arm_pos"_.Bind(Spec<mjtNum>({8, 2})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:arm_pos"_.Bind(Spec<mjtNum>({8, 2})),
                     "obs:arm_vel"_.Bind(Spec<mjtNum>({8})),
                     "obs:touch"_.Bind(Spec<mjtNum>({5})),
                     "obs:hand_pos"_.Bind(Spec<mjtNum>({4})),
@@ -119,7 +122,9 @@ class ManipulatorEnv : public Env<ManipulatorEnvSpec>, public MujocoEnv {
                   GetManipulatorXML(spec.config["base_path"_],
                                     spec.config["task_name"_]),
                   spec.config["frame_skip"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_),
+                  PixelOptions(spec.config), true),
         use_peg_(spec.config["task_name"_] == "bring_peg" ||
                  spec.config["task_name"_] == "insert_peg"),
         insert_(spec.config["task_name"_] == "insert_peg" ||
@@ -260,6 +265,15 @@ class ManipulatorEnv : public Env<ManipulatorEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -362,6 +376,7 @@ class ManipulatorEnv : public Env<ManipulatorEnvSpec>, public MujocoEnv {
     const auto& target_pos = Body2dPose(id_xbody_target_);
 
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
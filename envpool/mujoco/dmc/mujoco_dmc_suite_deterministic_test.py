@@ -13,15 +13,36 @@
 # limitations under the License.
 """Unit tests for Mujoco dm_control deterministic check."""
 
+import os
+import subprocess
+import sys
+import tempfile
+import time
 from typing import List, Optional
 
 import dm_env
 import numpy as np
+from absl import logging
 from absl.testing import absltest
 
 import envpool.mujoco.dmc.registration  # noqa: F401
 from envpool.registration import make_dm
 
+# creates an env in a new process, i.e. with an empty in-process model cache
+_CACHE_SCRIPT = """
+import time
+import numpy as np
+import envpool.mujoco.dmc.registration
+from envpool.registration import make_dm
+start = time.time()
+env = make_dm("HumanoidCMURun-v1", num_envs=4, seed=0)
+elapsed = time.time() - start
+ts = env.reset()
+for _ in range(10):
+  ts = env.step(np.zeros((4,) + env.action_spec().shape))
+print(elapsed, sum(float(np.sum(v)) for v in ts.observation))
+"""
+
 
 class _MujocoDmcDeterministicTest(absltest.TestCase):
 
@@ -164,6 +185,169 @@ class _MujocoDmcDeterministicTest(absltest.TestCase):
     for task in ["run", "stand", "walk"]:
       self.check("walker", task, obs_keys)
 
+  def test_domain_randomization(self) -> None:
+    num_envs = 4
+    ranges = {
+      "body_mass_scale": (0.5, 1.5),
+      "geom_friction_scale": (0.5, 1.5),
+      "dof_damping_scale": (0.5, 1.5),
+      "actuator_gear_scale": (0.5, 1.5),
+    }
+    no_scale = {key: (1.0, 1.0) for key in ranges}
+    # walker shares its model arrays, finger has a model of its own
+    for task_id, obs_keys in [
+      ("WalkerWalk-v1", ["orientations", "height", "velocity"]),
+      ("FingerSpin-v1", ["position", "velocity", "touch"]),
+    ]:
+      env0 = make_dm(task_id, num_envs=num_envs, seed=0)
+      env1 = make_dm(task_id, num_envs=num_envs, seed=0, **no_scale)
+      env2 = make_dm(task_id, num_envs=num_envs, seed=0, **ranges)
+      env3 = make_dm(task_id, num_envs=num_envs, seed=0, **ranges)
+      act_spec = env0.action_spec()
+      np.random.seed(0)
+      differs = False
+      for _ in range(300):
+        action = np.random.uniform(
+          low=act_spec.minimum,
+          high=act_spec.maximum,
+          size=(num_envs,) + act_spec.shape
+        )
+        obs0, obs1, obs2, obs3 = [
+          np.concatenate(
+            [
+              getattr(ts.observation, k).reshape(num_envs, -1)
+              for k in obs_keys
+            ],
+            axis=1,
+          ) for ts in [env.step(action) for env in [env0, env1, env2, env3]]
+        ]
+        # unit scales give the nominal model, the same seed the same physics
+        np.testing.assert_allclose(obs0, obs1)
+        np.testing.assert_allclose(obs2, obs3)
+        differs = differs or not np.allclose(obs0, obs2)
+      self.assertTrue(differs, task_id)
+
+  def test_pixels(self) -> None:
+    num_envs, stack_num, size = 4, 3, 84
+    task_id = "CheetahRun-v1"
+    env0, env1 = [
+      make_dm(
+        task_id,
+        num_envs=num_envs,
+        seed=0,
+        from_pixels=True,
+        img_height=size,
+        img_width=size,
+        stack_num=stack_num,
+      ) for _ in range(2)
+    ]
+    env2 = make_dm(task_id, num_envs=num_envs, seed=0)
+    spec = env0.observation_spec().pixels
+    self.assertEqual(spec.shape, (3 * stack_num, size, size))
+    self.assertEqual(spec.dtype, np.uint8)
+    # the key is static, see docs/env/dm_control.rst
+    self.assertEqual(env2.observation_spec().pixels.shape, (0, size, size))
+    ts0, ts1, ts2 = env0.reset(), env1.reset(), env2.reset()
+    first = ts0.observation.pixels
+    self.assertEqual(first.shape, (num_envs, 3 * stack_num, size, size))
+    np.testing.assert_array_equal(first, ts1.observation.pixels)
+    # after a reset every frame of the stack is the first one
+    for i in range(stack_num - 1):
+      np.testing.assert_array_equal(first[:, 3 * i:3 * i + 3], first[:, -3:])
+    act_spec = env0.action_spec()
+    np.random.seed(0)
+    prev = first
+    for _ in range(100):
+      action = np.random.uniform(
+        low=act_spec.minimum,
+        high=act_spec.maximum,
+        size=(num_envs,) + act_spec.shape
+      )
+      ts0, ts1, ts2 = env0.step(action), env1.step(action), env2.step(action)
+      pixels = ts0.observation.pixels
+      np.testing.assert_array_equal(pixels, ts1.observation.pixels)
+      # the stack moves by one frame per step
+      np.testing.assert_array_equal(pixels[:, :-3], prev[:, 3:])
+      # rendering does not change the physics
+      np.testing.assert_allclose(
+        ts0.observation.position, ts2.observation.position
+      )
+      prev = pixels
+    self.assertFalse(np.array_equal(prev[:, -3:], first[:, -3:]))
+    # throughput of the same steps with and without pixels
+    for name, env in [("pixels", env0), ("state", env2)]:
+      env.reset()
+      start = time.time()
+      for _ in range(500):
+        env.step(np.zeros((num_envs,) + act_spec.shape))
+      fps = 500 * num_envs / (time.time() - start)
+      logging.info(f"{task_id} {size}x{size} {name}: {fps:.0f} steps/s")
+
+  def test_restore(self) -> None:
+    num_envs = 2
+    # contact tasks, whose touch sensors belong to the acceleration stage
+    for task_id in ["ManipulatorBringBall-v1", "HumanoidWalk-v1"]:
+      env = make_dm(task_id, num_envs=num_envs, seed=0)
+      act_spec = env.action_spec()
+      np.random.seed(0)
+      actions = np.random.uniform(
+        low=act_spec.minimum,
+        high=act_spec.maximum,
+        size=(30,) + act_spec.shape
+      )
+
+      def run(begin: int, end: int) -> np.ndarray:
+        # every env takes the same actions, the result is indexed by env_id
+        result = []
+        for action in actions[begin:end]:
+          ts = env.step(np.stack([action] * num_envs))
+          order = np.argsort(ts.observation.env_id)
+          values = [
+            np.asarray(v, dtype=np.float64).reshape(num_envs, -1)
+            for k, v in ts.observation._asdict().items()
+            if k not in ["env_id", "players"]
+          ]
+          values.append(ts.reward.reshape(num_envs, -1))
+          result.append(np.concatenate(values, axis=1)[order])
+        return np.stack(result, axis=1)
+
+      env.reset()
+      run(0, 10)
+      handles = env.snapshot(np.array([0]))
+      ref = run(10, 20)[0]
+      env.restore(handles, np.array([0]))
+      env.branch(0, np.array([1]))
+      traj = run(10, 20)
+      env.release_snapshot(handles)
+      # bit-identical, not only close
+      np.testing.assert_array_equal(traj[0], ref)
+      np.testing.assert_array_equal(traj[1], ref)
+      with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "state")
+        env.save_state(path)
+        ref = run(20, 30)
+        env.load_state(path)
+        np.testing.assert_array_equal(run(20, 30), ref)
+
+  def test_model_cache(self) -> None:
+    with tempfile.TemporaryDirectory() as cache_dir:
+      env = dict(os.environ, ENVPOOL_CACHE_DIR=cache_dir)
+      results = []
+      for _ in range(2):
+        output = subprocess.check_output(
+          [sys.executable, "-c", _CACHE_SCRIPT], env=env, text=True
+        )
+        results.append([float(x) for x in output.split()[-2:]])
+      files = os.listdir(os.path.join(cache_dir, "mujoco_dmc"))
+      self.assertEqual(len(files), 1)
+      self.assertTrue(files[0].endswith(".mjb"))
+      (cold, obs0), (warm, obs1) = results
+      logging.info(
+        f"HumanoidCMURun-v1 cold start {cold:.3f}s, warm start {warm:.3f}s"
+      )
+      # the cached model is the same
+      self.assertEqual(obs0, obs1)
+
 
 if __name__ == "__main__":
   absltest.main()
@@ -14,23 +14,47 @@
 
 #include "envpool/mujoco/dmc/mujoco_env.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace mujoco_dmc {
 
-MujocoEnv::MujocoEnv(const std::string& base_path, const std::string& raw_xml,
-                     int n_sub_steps, int max_episode_steps)
-    : n_sub_steps_(n_sub_steps),
-      max_episode_steps_(max_episode_steps),
-      elapsed_step_(max_episode_steps + 1) {
-  // initialize vfs from common assets and raw xml
-  // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/mujoco/wrapper/core.py#L158
-  // https://github.com/deepmind/mujoco/blob/main/python/mujoco/structs.cc
-  // MjModelWrapper::LoadXML
+namespace {
+
+using Assets = std::vector<std::pair<std::string, std::string>>;
+
+// https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/suite/common/__init__.py#L28
+Assets CommonAssets(const std::string& base_path) {
+  Assets assets;
+  for (const char* name : {"./common/materials.xml", "./common/skybox.xml",
+                           "./common/visual.xml"}) {
+    assets.emplace_back(name, GetFileContent(base_path, name));
+  }
+  return assets;
+}
+
+// initialize vfs from common assets and raw xml, then compile the model
+// https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/mujoco/wrapper/core.py#L158
+// https://github.com/deepmind/mujoco/blob/main/python/mujoco/structs.cc
+// MjModelWrapper::LoadXML
+mjModel* CompileModel(const std::string& raw_xml, const Assets& assets,
+                      char* error, int error_sz) {
   std::unique_ptr<mjVFS, void (*)(mjVFS*)> vfs(new mjVFS, [](mjVFS* vfs) {
     mj_deleteVFS(vfs);
     delete vfs;
@@ -40,16 +64,144 @@ MujocoEnv::MujocoEnv(const std::string& base_path, const std::string& raw_xml,
   std::string model_filename("model_.xml");
   mj_makeEmptyFileVFS(vfs.get(), model_filename.c_str(), raw_xml.size());
   std::memcpy(vfs->filedata[vfs->nfile - 1], raw_xml.c_str(), raw_xml.size());
-  // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/suite/common/__init__.py#L28
-  std::vector<std::string> common_assets_name(
-      {"./common/materials.xml", "./common/skybox.xml", "./common/visual.xml"});
-  for (const auto& asset_name : common_assets_name) {
-    std::string content = GetFileContent(base_path, asset_name);
-    mj_makeEmptyFileVFS(vfs.get(), asset_name.c_str(), content.size());
+  for (const auto& [name, content] : assets) {
+    mj_makeEmptyFileVFS(vfs.get(), name.c_str(), content.size());
     std::memcpy(vfs->filedata[vfs->nfile - 1], content.c_str(), content.size());
   }
+  return mj_loadXML(model_filename.c_str(), vfs.get(), error, error_sz);
+}
+
+// FNV-1a, which unlike std::hash is the same in every process
+uint64_t Hash(const std::string& str, uint64_t hash) {
+  for (uint8_t c : str) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// $ENVPOOL_CACHE_DIR, $XDG_CACHE_HOME/envpool or ~/.cache/envpool; an empty
+// ENVPOOL_CACHE_DIR disables the cache
+std::string CacheDir() {
+  if (const char* dir = std::getenv("ENVPOOL_CACHE_DIR")) {
+    return dir;
+  }
+  const char* xdg = std::getenv("XDG_CACHE_HOME");
+  if (xdg != nullptr && *xdg != '\0') {
+    return std::string(xdg) + "/envpool";
+  }
+  const char* home = std::getenv("HOME");
+  if (home != nullptr && *home != '\0') {
+    return std::string(home) + "/.cache/envpool";
+  }
+  return "";
+}
+
+// mkdir -p
+bool MakeDirs(const std::string& dir) {
+  for (std::size_t pos = dir.find('/', 1);; pos = dir.find('/', pos + 1)) {
+    std::string prefix = dir.substr(0, pos);
+    if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (pos == std::string::npos) {
+      return true;
+    }
+  }
+}
+
+// Compiling is by far the slowest part of creating an env, so the compiled
+// binary model is saved under the cache dir, keyed by the MuJoCo version, the
+// xml and the assets, and loaded instead by the next processes.
+mjModel* CompileOrLoadModel(const std::string& raw_xml, const Assets& assets,
+                            char* error, int error_sz) {
+  std::string cache_dir = CacheDir();
+  if (cache_dir.empty()) {
+    return CompileModel(raw_xml, assets, error, error_sz);
+  }
+  uint64_t hash = Hash(std::to_string(mj_version()), 0xcbf29ce484222325ULL);
+  hash = Hash(raw_xml + '\0', hash);
+  for (const auto& [name, content] : assets) {
+    hash = Hash(name + '\0' + content + '\0', hash);
+  }
+  std::array<char, 17> hex;
+  std::snprintf(hex.data(), hex.size(), "%016llx",
+                static_cast<unsigned long long>(hash));  // NOLINT
+  std::string dir = cache_dir + "/mujoco_dmc";
+  std::string path = dir + "/" + hex.data() + ".mjb";
+  if (access(path.c_str(), R_OK) == 0) {
+    mjModel* model = mj_loadModel(path.c_str(), nullptr);
+    if (model != nullptr) {
+      return model;
+    }
+  }
+  mjModel* model = CompileModel(raw_xml, assets, error, error_sz);
+  if (model == nullptr || !MakeDirs(dir)) {
+    return model;
+  }
+  // other processes may be reading it, write it aside and move it in place
+  std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+  mj_saveModel(model, tmp_path.c_str(), nullptr, 0);
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+  }
+  return model;
+}
+
+// Tasks edit the xml per config, so the compiled models are keyed by the
+// final xml together with the asset directory. They are compiled once and
+// never modified nor erased until the process exits.
+const mjModel* LoadModel(const std::string& base_path,
+                         const std::string& raw_xml, char* error,
+                         int error_sz) {
+  using ModelPtr = std::unique_ptr<mjModel, void (*)(mjModel*)>;
+  static std::mutex mutex;
+  static std::map<std::pair<std::string, std::string>, ModelPtr> models;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto key = std::make_pair(base_path, raw_xml);
+  auto it = models.find(key);
+  if (it == models.end()) {
+    mjModel* model = CompileOrLoadModel(raw_xml, CommonAssets(base_path),
+                                        error, error_sz);
+    if (model == nullptr) {
+      throw std::runtime_error(std::string("cannot compile model: ") + error);
+    }
+    it = models.emplace(key, ModelPtr(model, mj_deleteModel)).first;
+  }
+  return it->second.get();
+}
+
+}  // namespace
+
+MujocoEnv::MujocoEnv(const std::string& base_path, const std::string& raw_xml,
+                     int n_sub_steps, int max_episode_steps,
+                     ModelRandomizer randomizer, PixelOptions pixels,
+                     bool randomize_model)
+    : own_model_(randomize_model),
+      randomizer_(std::move(randomizer)),
+      n_sub_steps_(n_sub_steps),
+      max_episode_steps_(max_episode_steps),
+      elapsed_step_(max_episode_steps + 1) {
   // create model and data
-  model_ = mj_loadXML(model_filename.c_str(), vfs.get(), error_.begin(), 1000);
+  const mjModel* model = LoadModel(base_path, raw_xml, error_.begin(), 1000);
+  // before anything is allocated, the checks may throw
+  if (pixels.from_pixels) {
+    if (pixels.stack_num <= 0) {
+      throw std::invalid_argument("stack_num should be positive");
+    }
+    renderer_ = std::make_unique<SoftwareRenderer>(
+        model, pixels.height, pixels.width, pixels.camera_id);
+    pixel_stack_.resize(static_cast<std::size_t>(pixels.stack_num) * 3 *
+                        pixels.height * pixels.width);
+  }
+  if (own_model_) {
+    model_ = mj_copyModel(nullptr, model);
+  } else {
+    // a shallow copy: the arrays stay shared and read-only, while the scalar
+    // fields such as opt, which PhysicsReset toggles, are per env
+    model_ = new mjModel(*model);
+  }
+  randomizer_.Attach(model_);
   data_ = mj_makeData(model_);
 #ifdef ENVPOOL_TEST
   qpos0_.reset(new mjtNum[model_->nq]);
@@ -57,7 +209,14 @@ MujocoEnv::MujocoEnv(const std::string& base_path, const std::string& raw_xml,
 }
 
 MujocoEnv::~MujocoEnv() {
-  mj_deleteModel(model_);
+  if (reset_data_ != nullptr) {
+    mj_deleteData(reset_data_);
+  }
+  if (own_model_) {
+    mj_deleteModel(model_);
+  } else {
+    delete model_;
+  }
   mj_deleteData(data_);
 }
 
@@ -67,11 +226,18 @@ void MujocoEnv::ControlReset() {
   elapsed_step_ = 0;
   discount_ = 1.0;
   done_ = false;
+  randomizer_.Randomize();
   TaskInitializeEpisodeMjcf();
   // attention: no keyframe_id
   PhysicsReset();  // first mj_forward
   TaskInitializeEpisode();
   PhysicsAfterReset();  // second mj_forward
+#ifdef ENVPOOL_TEST
+  if (check_data_ != nullptr) {
+    CheckResetData();
+  }
+#endif
+  pixels_stale_ = pixels_reset_ = true;
 }
 
 // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/rl/control.py#L94
@@ -80,6 +246,7 @@ void MujocoEnv::ControlStep(const mjtNum* action) {
   PhysicsStep(n_sub_steps_, action);
   TaskAfterStep();
   reward_ = TaskGetReward();
+  pixels_stale_ = true;
   if (++elapsed_step_ >= max_episode_steps_) {
     discount_ = 1.0;
     done_ = true;
@@ -108,21 +275,110 @@ bool MujocoEnv::TaskShouldTerminateEpisode() { return false; }
 // Physics
 // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/mujoco/engine.py#L263
 void MujocoEnv::PhysicsReset(int keyframe_id) {
+  if (keyframe_id < 0 && reset_data_ != nullptr) {
+    CopyInputs(data_, reset_data_);
+#ifdef ENVPOOL_TEST
+    check_data_.reset(mj_makeData(model_));
+    ResetData(check_data_.get(), -1);
+#endif
+    return;
+  }
+  ResetData(data_, keyframe_id);
+  // the result only depends on the model, which the task keeps as it is
+  // unless it has a model of its own or the physics are randomized
+  if (keyframe_id < 0 && !own_model_ && !randomizer_.Enabled() &&
+      !reset_forward_read_) {
+    reset_data_ = mj_makeData(model_);
+    mj_copyData(reset_data_, model_, data_);
+  }
+}
+
+void MujocoEnv::ResetData(mjData* data, int keyframe_id) {
   if (keyframe_id < 0) {
-    mj_resetData(model_, data_);
+    mj_resetData(model_, data);
   } else {
     // actually no one steps to this line
     assert(keyframe_id < model_->nkey);
-    mj_resetDataKeyframe(model_, data_, keyframe_id);
+    mj_resetDataKeyframe(model_, data, keyframe_id);
   }
 
   // PhysicsAfterReset may be overwritten?
+  ForwardWithoutActuation(data);
+}
+
+void MujocoEnv::ForwardWithoutActuation(mjData* data) {
   int old_flags = model_->opt.disableflags;
   model_->opt.disableflags |= mjDSBL_ACTUATION;
-  PhysicsForward();
+  mj_forward(model_, data);
   model_->opt.disableflags = old_flags;
 }
 
+// Only the inputs of mj_forward: the rest of mjData is a function of them,
+// which the forward pass of PhysicsAfterReset recomputes before any task
+// reads it, unless reset_forward_read_. Unlike mj_copyData, neither the
+// derived arrays, the contact and constraint buffers nor the stack are copied.
+void MujocoEnv::CopyInputs(mjData* dst, const mjData* src) const {
+  auto copy = [](mjtNum* to, const mjtNum* from, int n) {
+    std::memcpy(to, from, sizeof(mjtNum) * n);
+  };
+  dst->time = src->time;
+  copy(dst->qpos, src->qpos, model_->nq);
+  copy(dst->qvel, src->qvel, model_->nv);
+  copy(dst->act, src->act, model_->na);
+  copy(dst->ctrl, src->ctrl, model_->nu);
+  copy(dst->qacc_warmstart, src->qacc_warmstart, model_->nv);
+  copy(dst->qfrc_applied, src->qfrc_applied, model_->nv);
+  copy(dst->xfrc_applied, src->xfrc_applied, model_->nbody * 6);
+  copy(dst->mocap_pos, src->mocap_pos, model_->nmocap * 3);
+  copy(dst->mocap_quat, src->mocap_quat, model_->nmocap * 4);
+  copy(dst->userdata, src->userdata, model_->nuserdata);
+}
+
+#ifdef ENVPOOL_TEST
+// After PhysicsAfterReset, data_ must be bit-equal to what the full reset
+// path computes. check_data_ took that path up to TaskInitializeEpisode,
+// whose effect is the inputs it left in data_, then gets the same forward
+// pass, so that anything stale in data_ that leaks into it shows up.
+void MujocoEnv::CheckResetData() {
+  mjData* data = check_data_.get();
+  CopyInputs(data, data_);
+  ForwardWithoutActuation(data);
+  struct Field {
+    const char* name;
+    mjtNum* mjData::*array;
+    int size;
+  };
+  const Field fields[] = {
+      {"xpos", &mjData::xpos, model_->nbody * 3},
+      {"xquat", &mjData::xquat, model_->nbody * 4},
+      {"xmat", &mjData::xmat, model_->nbody * 9},
+      {"xipos", &mjData::xipos, model_->nbody * 3},
+      {"subtree_com", &mjData::subtree_com, model_->nbody * 3},
+      {"geom_xpos", &mjData::geom_xpos, model_->ngeom * 3},
+      {"geom_xmat", &mjData::geom_xmat, model_->ngeom * 9},
+      {"site_xpos", &mjData::site_xpos, model_->nsite * 3},
+      {"site_xmat", &mjData::site_xmat, model_->nsite * 9},
+      {"cinert", &mjData::cinert, model_->nbody * 10},
+      {"cvel", &mjData::cvel, model_->nbody * 6},
+      {"qfrc_bias", &mjData::qfrc_bias, model_->nv},
+      {"qfrc_constraint", &mjData::qfrc_constraint, model_->nv},
+      {"qacc", &mjData::qacc, model_->nv},
+      {"sensordata", &mjData::sensordata, model_->nsensordata},
+  };
+  for (const auto& field : fields) {
+    if (std::memcmp(data->*field.array, data_->*field.array,
+                    sizeof(mjtNum) * field.size) != 0) {
+      throw std::runtime_error(
+          std::string("PhysicsReset: the snapshot changes ") + field.name);
+    }
+  }
+  if (data->ncon != data_->ncon) {
+    throw std::runtime_error("PhysicsReset: the snapshot changes ncon");
+  }
+  check_data_.reset();
+}
+#endif
+
 // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/mujoco/engine.py#L286
 void MujocoEnv::PhysicsAfterReset() {
   int old_flags = model_->opt.disableflags;
@@ -158,6 +414,103 @@ void MujocoEnv::PhysicsStep(int nstep, const mjtNum* action) {
   mj_step1(model_, data_);
 }
 
+void MujocoEnv::PhysicsSaveState(StateWriter* writer) {
+  writer->Write(elapsed_step_);
+  writer->Write(reward_);
+  writer->Write(discount_);
+  writer->Write(done_);
+  writer->Write(data_->time);
+  writer->Write(data_->qpos, model_->nq);
+  writer->Write(data_->qvel, model_->nv);
+  writer->Write(data_->act, model_->na);
+  writer->Write(data_->ctrl, model_->nu);
+  writer->Write(data_->qacc_warmstart, model_->nv);
+  writer->Write(data_->mocap_pos, model_->nmocap * 3);
+  writer->Write(data_->mocap_quat, model_->nmocap * 4);
+  // only a model of its own can be randomized
+  if (own_model_) {
+    writer->Write(model_->body_pos, model_->nbody * 3);
+    writer->Write(model_->body_quat, model_->nbody * 4);
+    writer->Write(model_->dof_damping, model_->nv);
+    writer->Write(model_->geom_pos, model_->ngeom * 3);
+    writer->Write(model_->geom_size, model_->ngeom * 3);
+    writer->Write(model_->geom_rgba, model_->ngeom * 4);
+    writer->Write(model_->site_pos, model_->nsite * 3);
+    writer->Write(model_->site_size, model_->nsite * 3);
+    writer->Write(model_->site_rgba, model_->nsite * 4);
+    writer->Write(model_->light_pos, model_->nlight * 3);
+    writer->Write(model_->wrap_prm, model_->nwrap);
+  }
+  randomizer_.Save(writer);
+  if (renderer_) {
+    writer->Write(pixel_stack_.data(), pixel_stack_.size());
+  }
+  writer->Write(data_->sensordata, model_->nsensordata);
+}
+
+void MujocoEnv::PhysicsLoadState(StateReader* reader) {
+  reader->Read(&elapsed_step_);
+  reader->Read(&reward_);
+  reader->Read(&discount_);
+  reader->Read(&done_);
+  reader->Read(&data_->time);
+  reader->Read(data_->qpos, model_->nq);
+  reader->Read(data_->qvel, model_->nv);
+  reader->Read(data_->act, model_->na);
+  reader->Read(data_->ctrl, model_->nu);
+  reader->Read(data_->qacc_warmstart, model_->nv);
+  reader->Read(data_->mocap_pos, model_->nmocap * 3);
+  reader->Read(data_->mocap_quat, model_->nmocap * 4);
+  if (own_model_) {
+    reader->Read(model_->body_pos, model_->nbody * 3);
+    reader->Read(model_->body_quat, model_->nbody * 4);
+    reader->Read(model_->dof_damping, model_->nv);
+    reader->Read(model_->geom_pos, model_->ngeom * 3);
+    reader->Read(model_->geom_size, model_->ngeom * 3);
+    reader->Read(model_->geom_rgba, model_->ngeom * 4);
+    reader->Read(model_->site_pos, model_->nsite * 3);
+    reader->Read(model_->site_size, model_->nsite * 3);
+    reader->Read(model_->site_rgba, model_->nsite * 4);
+    reader->Read(model_->light_pos, model_->nlight * 3);
+    reader->Read(model_->wrap_prm, model_->nwrap);
+  }
+  randomizer_.Load(reader);
+  if (renderer_) {
+    reader->Read(pixel_stack_.data(), pixel_stack_.size());
+    pixels_stale_ = pixels_reset_ = false;
+  }
+  // the state is the one after mj_step1, or after the forward pass of a
+  // reset: mj_forward would also recompute the acceleration stage, i.e.
+  // overwrite the warmstart and the acceleration sensors such as touch with
+  // other values than the ones the next mj_step2 and the task would read
+  mj_step1(model_, data_);
+  reader->Read(data_->sensordata, model_->nsensordata);
+}
+
+void MujocoEnv::RenderPixels(Array* pixels) {
+  if (!renderer_) {
+    return;
+  }
+  if (pixels_stale_) {
+    // frame stacking, the oldest frame is dropped and the new one appended
+    std::size_t frame = 3 * static_cast<std::size_t>(renderer_->Height()) *
+                        renderer_->Width();
+    uint8_t* last = pixel_stack_.data() + pixel_stack_.size() - frame;
+    if (!pixels_reset_) {
+      std::memmove(pixel_stack_.data(), pixel_stack_.data() + frame,
+                   pixel_stack_.size() - frame);
+    }
+    renderer_->Render(model_, data_, last);
+    if (pixels_reset_) {
+      for (uint8_t* p = pixel_stack_.data(); p != last; p += frame) {
+        std::memcpy(p, last, frame);
+      }
+    }
+    pixels_stale_ = pixels_reset_ = false;
+  }
+  std::memcpy(pixels->Data(), pixel_stack_.data(), pixel_stack_.size());
+}
+
 // randomizer
 // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/suite/utils/randomizers.py#L35
 void MujocoEnv::RandomizeLimitedAndRotationalJoints(std::mt19937* gen) {
@@ -20,14 +20,42 @@
 #include <mjxmacro.h>
 #include <mujoco.h>
 
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <string>
+#include <vector>
 
+#include "envpool/core/array.h"
+#include "envpool/core/dict.h"
+#include "envpool/core/serialization.h"
+#include "envpool/core/spec.h"
 #include "envpool/mujoco/dmc/utils.h"
+#include "envpool/mujoco/model_randomizer.h"
+#include "envpool/mujoco/software_renderer.h"
 
 namespace mujoco_dmc {
 
+/*
+ * Pixel observations, as the pixels wrapper of dm_control with
+ * pixels_only=False: "obs:pixels" holds the last stack_num RGB frames seen
+ * from camera_id, (3 * stack_num, img_height, img_width), oldest first.
+ */
+struct PixelOptions {
+  bool from_pixels{false};
+  int height{84}, width{84}, stack_num{1}, camera_id{0};
+
+  PixelOptions() = default;
+
+  template <typename Config>
+  explicit PixelOptions(const Config& conf)
+      : from_pixels(conf["from_pixels"_]),
+        height(conf["img_height"_]),
+        width(conf["img_width"_]),
+        stack_num(conf["stack_num"_]),
+        camera_id(conf["camera_id"_]) {}
+};
+
 /*
  * This class combines with dmc Task and Physics API.
  *
@@ -40,10 +68,44 @@ namespace mujoco_dmc {
 class MujocoEnv {
  private:
   std::array<char, 1000> error_;
+  // data_ right after PhysicsReset, whose state is restored instead of
+  // recomputed, see CopyInputs
+  mjData* reset_data_{nullptr};
+#ifdef ENVPOOL_TEST
+  // what a full PhysicsReset computes, set when the snapshot was restored
+  // instead, see CheckResetData
+  std::unique_ptr<mjData, void (*)(mjData*)> check_data_{nullptr,
+                                                         mj_deleteData};
+#endif
+
+  // renders on CPU, so that pixels need no GL context per worker thread
+  std::unique_ptr<SoftwareRenderer> renderer_;
+  // the frame stack, stack_num planar RGB frames
+  std::vector<uint8_t> pixel_stack_;
+  // whether the physics moved since the last frame, and whether it was reset
+  bool pixels_stale_{false}, pixels_reset_{false};
+
+  // mj_resetData and a forward pass without actuation
+  void ResetData(mjData* data, int keyframe_id);
+  void ForwardWithoutActuation(mjData* data);
+  void CopyInputs(mjData* dst, const mjData* src) const;
+#ifdef ENVPOOL_TEST
+  void CheckResetData();
+#endif
 
  protected:
   mjModel* model_;
   mjData* data_;
+  // whether model_ is a full copy of the compiled model, which the task may
+  // modify, rather than one sharing its arrays with the other envs
+  bool own_model_;
+  // domain randomization of the physics parameters, applied to model_ at
+  // the start of every ControlReset
+  ModelRandomizer randomizer_;
+  // whether TaskInitializeEpisode uses what the forward pass of PhysicsReset
+  // computed before PhysicsAfterReset recomputes it, e.g. by stepping; the
+  // reset snapshot only has the state, so such a task always resets in full
+  bool reset_forward_read_{false};
   int n_sub_steps_, max_episode_steps_, elapsed_step_;
   float reward_, discount_;
   bool done_{true};
@@ -52,8 +114,29 @@ class MujocoEnv {
 #endif
 
  public:
+  // the config shared by all tasks
+  static decltype(auto) DefaultConfig() {
+    return ConcatDict(
+        MakeDict("from_pixels"_.Bind(false), "img_height"_.Bind(84),
+                 "img_width"_.Bind(84), "stack_num"_.Bind(1),
+                 "camera_id"_.Bind(0)),
+        ModelRandomizer::DefaultConfig());
+  }
+
+  // "obs:pixels", empty unless from_pixels; the state keys of a task are
+  // fixed by its class, not by the config, so every task has the key
+  template <typename Config>
+  static Spec<uint8_t> PixelSpec(const Config& conf) {
+    int channel = conf["from_pixels"_] ? 3 * conf["stack_num"_] : 0;
+    return Spec<uint8_t>({channel, conf["img_height"_], conf["img_width"_]},
+                         {0, 255});
+  }
+
+  // tasks that modify model arrays per episode have to pass randomize_model
   MujocoEnv(const std::string& base_path, const std::string& raw_xml,
-            int n_sub_steps, int max_episode_steps);
+            int n_sub_steps, int max_episode_steps,
+            ModelRandomizer randomizer, PixelOptions pixels,
+            bool randomize_model = false);
   ~MujocoEnv();
 
   // rl control Environment
@@ -91,6 +174,15 @@ class MujocoEnv {
   // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/mujoco/engine.py#L146
   void PhysicsStep(int nstep, const mjtNum* action);
 
+  // checkpoint, physics state together with the model fields that tasks
+  // randomize per episode in TaskInitializeEpisode(Mjcf) and randomizer_
+  void PhysicsSaveState(StateWriter* writer);
+  void PhysicsLoadState(StateReader* reader);
+
+  // write the frame stack into pixels, rendering a new frame if the physics
+  // moved; a no-op unless from_pixels
+  void RenderPixels(Array* pixels);
+
   // randomizer
   // https://github.com/deepmind/dm_control/blob/1.0.2/dm_control/suite/utils/randomizers.py#L35
   void RandomizeLimitedAndRotationalJoints(std::mt19937* gen);
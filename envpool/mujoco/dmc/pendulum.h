@@ -40,12 +40,15 @@ std::string GetPendulumXML(const std::string& base_path,
 class PendulumEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(1),
-                    "task_name"_.Bind(std::string("swingup")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(1),
+                 "task_name"_.Bind(std::string("swingup"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:orientation"_.Bind(Spec<mjtNum>({2})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:orientation"_.Bind(Spec<mjtNum>({2})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({1}))
 #ifdef ENVPOOL_TEST
                         ,
@@ -73,7 +76,9 @@ class PendulumEnv : public Env<PendulumEnvSpec>, public MujocoEnv {
                   GetPendulumXML(spec.config["base_path"_],
                                  spec.config["task_name"_]),
                   spec.config["frame_skip"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_),
+                  PixelOptions(spec.config)),
         id_hinge_(GetQvelId(model_, "hinge")),
         id_pole_(mj_name2id(model_, mjOBJ_XBODY, "pole")) {
     const std::string& task_name = spec.config["task_name"_];
@@ -92,6 +97,15 @@ class PendulumEnv : public Env<PendulumEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -111,6 +125,7 @@ class PendulumEnv : public Env<PendulumEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
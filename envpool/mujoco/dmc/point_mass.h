@@ -38,12 +38,14 @@ std::string GetPointMassXML(const std::string& base_path,
 class PointMassEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(1),
-                    "task_name"_.Bind(std::string("easy")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(1), "task_name"_.Bind(std::string("easy"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({2})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({2})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({2}))
 #ifdef ENVPOOL_TEST
                         ,
@@ -75,7 +77,9 @@ class PointMassEnv : public Env<PointMassEnvSpec>, public MujocoEnv {
                   GetPointMassXML(spec.config["base_path"_],
                                   spec.config["task_name"_]),
                   spec.config["frame_skip"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_),
+                  PixelOptions(spec.config), true),
 
         id_geom_target_(mj_name2id(model_, mjOBJ_GEOM, "target")),
         id_geom_pointmass_(mj_name2id(model_, mjOBJ_GEOM, "pointmass")) {
@@ -124,6 +128,15 @@ class PointMassEnv : public Env<PointMassEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -171,6 +184,7 @@ class PointMassEnv : public Env<PointMassEnvSpec>, public MujocoEnv {
 
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -40,12 +40,14 @@ std::string GetReacherXML(const std::string& base_path,
 class ReacherEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(1),
-                    "task_name"_.Bind(std::string("easy")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(1), "task_name"_.Bind(std::string("easy"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    return MakeDict("obs:position"_.Bind(Spec<mjtNum>({2})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:position"_.Bind(Spec<mjtNum>({2})),
                     "obs:to_target"_.Bind(Spec<mjtNum>({2})),
                     "obs:velocity"_.Bind(Spec<mjtNum>({2}))
 #ifdef ENVPOOL_TEST
@@ -79,7 +81,9 @@ class ReacherEnv : public Env<ReacherEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetReacherXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_),
+            PixelOptions(spec.config), true),
         id_target_(mj_name2id(model_, mjOBJ_GEOM, "target")),
         id_finger_(mj_name2id(model_, mjOBJ_GEOM, "finger")) {
     const std::string& task_name = spec.config["task_name"_];
@@ -111,6 +115,15 @@ class ReacherEnv : public Env<ReacherEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -132,6 +145,7 @@ class ReacherEnv : public Env<ReacherEnvSpec>, public MujocoEnv {
  private:
   void WriteState() {
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
@@ -50,8 +50,10 @@ std::string GetSwimmerXML(const std::string& base_path,
 class SwimmerEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(15),
-                    "task_name"_.Bind(std::string("swimmer6")));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(15),
+                 "task_name"_.Bind(std::string("swimmer6"))),
+        MujocoEnv::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -65,7 +67,8 @@ class SwimmerEnvFns {
       throw std::runtime_error("Unknown task_name " + task_name +
                                " for dmc swimmer.");
     }
-    return MakeDict("obs:joints"_.Bind(Spec<mjtNum>({n_bodies - 1})),
+    return MakeDict("obs:pixels"_.Bind(MujocoEnv::PixelSpec(conf)),
+                    "obs:joints"_.Bind(Spec<mjtNum>({n_bodies - 1})),
                     "obs:to_target"_.Bind(Spec<mjtNum>({2})),
                     "obs:body_velocities"_.Bind(Spec<mjtNum>({3 * n_bodies}))
 #ifdef ENVPOOL_TEST
@@ -104,7 +107,9 @@ class SwimmerEnv : public Env<SwimmerEnvSpec>, public MujocoEnv {
         MujocoEnv(
             spec.config["base_path"_],
             GetSwimmerXML(spec.config["base_path"_], spec.config["task_name"_]),
-            spec.config["frame_skip"_], spec.config["max_episode_steps"_]),
+            spec.config["frame_skip"_], spec.config["max_episode_steps"_],
+            ModelRandomizer(spec.config, seed_),
+            PixelOptions(spec.config), true),
         id_head_(mj_name2id(model_, mjOBJ_GEOM, "head")),
         id_nose_(mj_name2id(model_, mjOBJ_GEOM, "nose")),
         id_target_(mj_name2id(model_, mjOBJ_GEOM, "target")),
@@ -132,6 +137,15 @@ class SwimmerEnv : public Env<SwimmerEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { PhysicsSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    PhysicsLoadState(reader);
+    WriteState();
+  }
+
+  void Restore(StateReader* reader) override { PhysicsLoadState(reader); }
+
   void Reset() override {
     ControlReset();
     WriteState();
@@ -159,6 +173,7 @@ class SwimmerEnv : public Env<SwimmerEnvSpec>, public MujocoEnv {
     const auto& body_velocities = BodyVelocities();
 
     State state = Allocate();
+    RenderPixels(&state["obs:pixels"_]);
     state["reward"_] = reward_;
     state["discount"_] = discount_;
     // obs
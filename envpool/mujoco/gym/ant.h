@@ -31,16 +31,20 @@ namespace mujoco_gym {
 class AntEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict(
-        "reward_threshold"_.Bind(6000.0), "frame_skip"_.Bind(5),
-        "post_constraint"_.Bind(true), "use_contact_force"_.Bind(false),
-        "terminate_when_unhealthy"_.Bind(true),
-        "exclude_current_positions_from_observation"_.Bind(true),
-        "forward_reward_weight"_.Bind(1.0), "ctrl_cost_weight"_.Bind(0.5),
-        "contact_cost_weight"_.Bind(5e-4), "healthy_reward"_.Bind(1.0),
-        "healthy_z_min"_.Bind(0.2), "healthy_z_max"_.Bind(1.0),
-        "contact_force_min"_.Bind(-1.0), "contact_force_max"_.Bind(1.0),
-        "reset_noise_scale"_.Bind(0.1));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(6000.0), "frame_skip"_.Bind(5),
+                 "post_constraint"_.Bind(true),
+                 "use_contact_force"_.Bind(false),
+                 "terminate_when_unhealthy"_.Bind(true),
+                 "exclude_current_positions_from_observation"_.Bind(true),
+                 "forward_reward_weight"_.Bind(1.0),
+                 "ctrl_cost_weight"_.Bind(0.5),
+                 "contact_cost_weight"_.Bind(5e-4), "healthy_reward"_.Bind(1.0),
+                 "healthy_z_min"_.Bind(0.2), "healthy_z_max"_.Bind(1.0),
+                 "contact_force_min"_.Bind(-1.0),
+                 "contact_force_max"_.Bind(1.0),
+                 "reset_noise_scale"_.Bind(0.1)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -88,7 +92,8 @@ class AntEnv : public Env<AntEnvSpec>, public MujocoEnv {
       : Env<AntEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/ant.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         id_torso_(mj_name2id(model_, mjOBJ_XBODY, "torso")),
         terminate_when_unhealthy_(spec.config["terminate_when_unhealthy"_]),
         no_pos_(spec.config["exclude_current_positions_from_observation"_]),
@@ -120,6 +125,15 @@ class AntEnv : public Env<AntEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
@@ -31,16 +31,20 @@ namespace mujoco_gym {
 class HopperEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict(
-        "reward_threshold"_.Bind(6000.0), "frame_skip"_.Bind(4),
-        "post_constraint"_.Bind(true), "terminate_when_unhealthy"_.Bind(true),
-        "exclude_current_positions_from_observation"_.Bind(true),
-        "ctrl_cost_weight"_.Bind(1e-3), "forward_reward_weight"_.Bind(1.0),
-        "healthy_reward"_.Bind(1.0), "velocity_min"_.Bind(-10.0),
-        "velocity_max"_.Bind(10.0), "healthy_state_min"_.Bind(-100.0),
-        "healthy_state_max"_.Bind(100.0), "healthy_angle_min"_.Bind(-0.2),
-        "healthy_angle_max"_.Bind(0.2), "healthy_z_min"_.Bind(0.7),
-        "reset_noise_scale"_.Bind(5e-3));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(6000.0), "frame_skip"_.Bind(4),
+                 "post_constraint"_.Bind(true),
+                 "terminate_when_unhealthy"_.Bind(true),
+                 "exclude_current_positions_from_observation"_.Bind(true),
+                 "ctrl_cost_weight"_.Bind(1e-3),
+                 "forward_reward_weight"_.Bind(1.0),
+                 "healthy_reward"_.Bind(1.0), "velocity_min"_.Bind(-10.0),
+                 "velocity_max"_.Bind(10.0), "healthy_state_min"_.Bind(-100.0),
+                 "healthy_state_max"_.Bind(100.0),
+                 "healthy_angle_min"_.Bind(-0.2),
+                 "healthy_angle_max"_.Bind(0.2), "healthy_z_min"_.Bind(0.7),
+                 "reset_noise_scale"_.Bind(5e-3)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -77,7 +81,8 @@ class HopperEnv : public Env<HopperEnvSpec>, public MujocoEnv {
       : Env<HopperEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/hopper.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         terminate_when_unhealthy_(spec.config["terminate_when_unhealthy"_]),
         no_pos_(spec.config["exclude_current_positions_from_observation"_]),
         ctrl_cost_weight_(spec.config["ctrl_cost_weight"_]),
@@ -108,6 +113,15 @@ class HopperEnv : public Env<HopperEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
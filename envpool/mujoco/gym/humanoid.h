@@ -31,15 +31,18 @@ namespace mujoco_gym {
 class HumanoidEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict(
-        "frame_skip"_.Bind(5), "post_constraint"_.Bind(true),
-        "use_contact_force"_.Bind(false), "forward_reward_weight"_.Bind(1.25),
-        "terminate_when_unhealthy"_.Bind(true),
-        "exclude_current_positions_from_observation"_.Bind(true),
-        "ctrl_cost_weight"_.Bind(0.1), "healthy_reward"_.Bind(5.0),
-        "healthy_z_min"_.Bind(1.0), "healthy_z_max"_.Bind(2.0),
-        "contact_cost_weight"_.Bind(5e-7), "contact_cost_max"_.Bind(10.0),
-        "reset_noise_scale"_.Bind(1e-2));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(5), "post_constraint"_.Bind(true),
+                 "use_contact_force"_.Bind(false),
+                 "forward_reward_weight"_.Bind(1.25),
+                 "terminate_when_unhealthy"_.Bind(true),
+                 "exclude_current_positions_from_observation"_.Bind(true),
+                 "ctrl_cost_weight"_.Bind(0.1), "healthy_reward"_.Bind(5.0),
+                 "healthy_z_min"_.Bind(1.0), "healthy_z_max"_.Bind(2.0),
+                 "contact_cost_weight"_.Bind(5e-7),
+                 "contact_cost_max"_.Bind(10.0),
+                 "reset_noise_scale"_.Bind(1e-2)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -82,7 +85,8 @@ class HumanoidEnv : public Env<HumanoidEnvSpec>, public MujocoEnv {
       : Env<HumanoidEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/humanoid.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         terminate_when_unhealthy_(spec.config["terminate_when_unhealthy"_]),
         no_pos_(spec.config["exclude_current_positions_from_observation"_]),
         use_contact_force_(spec.config["use_contact_force"_]),
@@ -111,6 +115,15 @@ class HumanoidEnv : public Env<HumanoidEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
@@ -31,13 +31,15 @@ namespace mujoco_gym {
 class HumanoidStandupEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("frame_skip"_.Bind(5), "post_constraint"_.Bind(true),
-                    "forward_reward_weight"_.Bind(1.0),
-                    "exclude_current_positions_from_observation"_.Bind(true),
-                    "ctrl_cost_weight"_.Bind(0.1),
-                    "contact_cost_weight"_.Bind(5e-7),
-                    "contact_cost_max"_.Bind(10.0), "healthy_reward"_.Bind(1.0),
-                    "reset_noise_scale"_.Bind(1e-2));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(5), "post_constraint"_.Bind(true),
+                 "forward_reward_weight"_.Bind(1.0),
+                 "exclude_current_positions_from_observation"_.Bind(true),
+                 "ctrl_cost_weight"_.Bind(0.1),
+                 "contact_cost_weight"_.Bind(5e-7),
+                 "contact_cost_max"_.Bind(10.0), "healthy_reward"_.Bind(1.0),
+                 "reset_noise_scale"_.Bind(1e-2)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -76,7 +78,8 @@ class HumanoidStandupEnv : public Env<HumanoidStandupEnvSpec>,
         MujocoEnv(spec.config["base_path"_] +
                       "/mujoco/assets_gym/humanoidstandup.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         no_pos_(spec.config["exclude_current_positions_from_observation"_]),
         ctrl_cost_weight_(spec.config["ctrl_cost_weight"_]),
         contact_cost_weight_(spec.config["contact_cost_weight"_]),
@@ -101,6 +104,15 @@ class HumanoidStandupEnv : public Env<HumanoidStandupEnvSpec>,
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
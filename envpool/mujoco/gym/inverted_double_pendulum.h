@@ -31,11 +31,12 @@ namespace mujoco_gym {
 class InvertedDoublePendulumEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("reward_threshold"_.Bind(9100.0), "frame_skip"_.Bind(5),
-                    "post_constraint"_.Bind(true), "healthy_reward"_.Bind(10.0),
-                    "healthy_z_max"_.Bind(1.0), "observation_min"_.Bind(-10.0),
-                    "observation_max"_.Bind(10.0),
-                    "reset_noise_scale"_.Bind(0.1));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(9100.0), "frame_skip"_.Bind(5),
+                 "post_constraint"_.Bind(true), "healthy_reward"_.Bind(10.0),
+                 "healthy_z_max"_.Bind(1.0), "observation_min"_.Bind(-10.0),
+                 "observation_max"_.Bind(10.0), "reset_noise_scale"_.Bind(0.1)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -70,7 +71,8 @@ class InvertedDoublePendulumEnv : public Env<InvertedDoublePendulumEnvSpec>,
         MujocoEnv(spec.config["base_path"_] +
                       "/mujoco/assets_gym/inverted_double_pendulum.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         healthy_reward_(spec.config["healthy_reward"_]),
         healthy_z_max_(spec.config["healthy_z_max"_]),
         observation_min_(spec.config["observation_min"_]),
@@ -94,6 +96,15 @@ class InvertedDoublePendulumEnv : public Env<InvertedDoublePendulumEnvSpec>,
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
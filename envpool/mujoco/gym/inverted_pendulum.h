@@ -31,10 +31,12 @@ namespace mujoco_gym {
 class InvertedPendulumEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("reward_threshold"_.Bind(950.0), "frame_skip"_.Bind(2),
-                    "post_constraint"_.Bind(true), "healthy_reward"_.Bind(1.0),
-                    "healthy_z_min"_.Bind(-0.2), "healthy_z_max"_.Bind(0.2),
-                    "reset_noise_scale"_.Bind(0.01));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(950.0), "frame_skip"_.Bind(2),
+                 "post_constraint"_.Bind(true), "healthy_reward"_.Bind(1.0),
+                 "healthy_z_min"_.Bind(-0.2), "healthy_z_max"_.Bind(0.2),
+                 "reset_noise_scale"_.Bind(0.01)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -67,7 +69,8 @@ class InvertedPendulumEnv : public Env<InvertedPendulumEnvSpec>,
         MujocoEnv(spec.config["base_path"_] +
                       "/mujoco/assets_gym/inverted_pendulum.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         healthy_reward_(spec.config["healthy_reward"_]),
         healthy_z_min_(spec.config["healthy_z_min"_]),
         healthy_z_max_(spec.config["healthy_z_max"_]),
@@ -89,6 +92,15 @@ class InvertedPendulumEnv : public Env<InvertedPendulumEnvSpec>,
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
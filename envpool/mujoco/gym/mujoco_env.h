@@ -20,16 +20,54 @@
 #include <mjxmacro.h>
 #include <mujoco.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <utility>
+
+#include "envpool/core/serialization.h"
+#include "envpool/mujoco/model_randomizer.h"
 
 namespace mujoco_gym {
 
+/*
+ * Compiling the MJCF dominates env construction, so every xml is compiled
+ * once per process. No gym env modifies its model, so all the envs of an xml
+ * share the compiled one, read-only, and only have their own mjData. With
+ * domain randomization, each env has a shallow copy of it instead, whose
+ * randomized arrays are its own, see ModelRandomizer.
+ */
+inline const mjModel* LoadModel(const std::string& xml, char* error,
+                                int error_sz) {
+  using ModelPtr = std::unique_ptr<mjModel, void (*)(mjModel*)>;
+  static std::mutex mutex;
+  static std::map<std::string, ModelPtr> models;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = models.find(xml);
+  if (it == models.end()) {
+    mjModel* model = mj_loadXML(xml.c_str(), nullptr, error, error_sz);
+    if (model == nullptr) {
+      throw std::runtime_error("cannot load " + xml + ": " + error);
+    }
+    it = models.emplace(xml, ModelPtr(model, mj_deleteModel)).first;
+  }
+  // models are never modified nor erased until the process exits
+  return it->second.get();
+}
+
 class MujocoEnv {
  private:
   std::array<char, 1000> error_;
 
  protected:
-  mjModel* model_;
+  // shared by all the envs of the same xml, see LoadModel, unless the
+  // physics parameters are randomized
+  const mjModel* model_;
+  ModelRandomizer randomizer_;
+  // a shallow copy of the shared model, with the randomized arrays redirected
+  std::unique_ptr<mjModel> randomized_model_;
   mjData* data_;
   mjtNum *init_qpos_, *init_qvel_;
 #ifdef ENVPOOL_TEST
@@ -42,8 +80,10 @@ class MujocoEnv {
 
  public:
   MujocoEnv(const std::string& xml, int frame_skip, bool post_constraint,
-            int max_episode_steps)
-      : model_(mj_loadXML(xml.c_str(), nullptr, error_.begin(), 1000)),
+            int max_episode_steps,
+            ModelRandomizer randomizer = ModelRandomizer())
+      : model_(LoadModel(xml, error_.begin(), 1000)),
+        randomizer_(std::move(randomizer)),
         data_(mj_makeData(model_)),
         init_qpos_(new mjtNum[model_->nq]),
         init_qvel_(new mjtNum[model_->nv]),
@@ -57,11 +97,15 @@ class MujocoEnv {
         elapsed_step_(max_episode_steps + 1) {
     std::memcpy(init_qpos_, data_->qpos, sizeof(mjtNum) * model_->nq);
     std::memcpy(init_qvel_, data_->qvel, sizeof(mjtNum) * model_->nv);
+    if (randomizer_.Enabled()) {
+      randomized_model_ = std::make_unique<mjModel>(*model_);
+      randomizer_.Attach(randomized_model_.get());
+      model_ = randomized_model_.get();
+    }
   }
 
   ~MujocoEnv() {
     mj_deleteData(data_);
-    mj_deleteModel(model_);
     delete[] init_qpos_;
     delete[] init_qvel_;
 #ifdef ENVPOOL_TEST
@@ -71,6 +115,7 @@ class MujocoEnv {
   }
 
   void MujocoReset() {
+    randomizer_.Randomize();
     mj_resetData(model_, data_);
     MujocoResetModel();
     mj_forward(model_, data_);
@@ -91,6 +136,57 @@ class MujocoEnv {
       mj_rnePostConstraint(model_, data_);
     }
   }
+
+  /**
+   * Physics state plus episode counters and the randomized parameters, and
+   * the arrays derived from the state that the observations and rewards
+   * read. These are what the last mj_step computed, one substep behind the
+   * state, so recomputing them with mj_forward would not give them back;
+   * the next mj_step recomputes everything else from the state.
+   */
+  void MujocoSaveState(StateWriter* writer) {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(data_->time);
+    writer->Write(data_->qpos, model_->nq);
+    writer->Write(data_->qvel, model_->nv);
+    writer->Write(data_->act, model_->na);
+    writer->Write(data_->ctrl, model_->nu);
+    writer->Write(data_->qacc_warmstart, model_->nv);
+    writer->Write(data_->mocap_pos, model_->nmocap * 3);
+    writer->Write(data_->mocap_quat, model_->nmocap * 4);
+    writer->Write(data_->xpos, model_->nbody * 3);
+    writer->Write(data_->xipos, model_->nbody * 3);
+    writer->Write(data_->cinert, model_->nbody * 10);
+    writer->Write(data_->cvel, model_->nbody * 6);
+    writer->Write(data_->cfrc_ext, model_->nbody * 6);
+    writer->Write(data_->site_xpos, model_->nsite * 3);
+    writer->Write(data_->qfrc_actuator, model_->nv);
+    writer->Write(data_->qfrc_constraint, model_->nv);
+    randomizer_.Save(writer);
+  }
+
+  void MujocoLoadState(StateReader* reader) {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&data_->time);
+    reader->Read(data_->qpos, model_->nq);
+    reader->Read(data_->qvel, model_->nv);
+    reader->Read(data_->act, model_->na);
+    reader->Read(data_->ctrl, model_->nu);
+    reader->Read(data_->qacc_warmstart, model_->nv);
+    reader->Read(data_->mocap_pos, model_->nmocap * 3);
+    reader->Read(data_->mocap_quat, model_->nmocap * 4);
+    reader->Read(data_->xpos, model_->nbody * 3);
+    reader->Read(data_->xipos, model_->nbody * 3);
+    reader->Read(data_->cinert, model_->nbody * 10);
+    reader->Read(data_->cvel, model_->nbody * 6);
+    reader->Read(data_->cfrc_ext, model_->nbody * 6);
+    reader->Read(data_->site_xpos, model_->nsite * 3);
+    reader->Read(data_->qfrc_actuator, model_->nv);
+    reader->Read(data_->qfrc_constraint, model_->nv);
+    randomizer_.Load(reader);
+  }
 };
 
 }  // namespace mujoco_gym
@@ -75,6 +75,41 @@ class _MujocoGymDeterministicTest(absltest.TestCase):
   def test_walker2d(self) -> None:
     self.check("Walker2d-v4")
 
+  def test_domain_randomization(self) -> None:
+    num_envs = 4
+    ranges = {
+      "body_mass_scale": (0.5, 1.5),
+      "geom_friction_scale": (0.5, 1.5),
+      "dof_damping_scale": (0.5, 1.5),
+      "actuator_gear_scale": (0.5, 1.5),
+    }
+    no_scale = {key: (1.0, 1.0) for key in ranges}
+    env0 = make_gym("Ant-v4", num_envs=num_envs, seed=0)
+    env1 = make_gym("Ant-v4", num_envs=num_envs, seed=0, **no_scale)
+    env2 = make_gym("Ant-v4", num_envs=num_envs, seed=0, **ranges)
+    env3 = make_gym("Ant-v4", num_envs=num_envs, seed=0, **ranges)
+    envs = [env0, env1, env2, env3]
+    act_space = env0.action_space
+    obs0, obs1, obs2, obs3 = [env.reset()[0] for env in envs]
+    # the initial state noise is drawn from the same generator as before
+    np.testing.assert_allclose(obs0, obs1)
+    np.testing.assert_allclose(obs0, obs2)
+    np.testing.assert_allclose(obs2, obs3)
+    differs = False
+    for _ in range(200):
+      action = np.array([act_space.sample() for _ in range(num_envs)])
+      obs0, _, term0, trunc0, _ = env0.step(action)
+      obs1 = env1.step(action)[0]
+      obs2, _, term2, trunc2, _ = env2.step(action)
+      obs3 = env3.step(action)[0]
+      # unit scales give the nominal model, the same seed the same physics
+      np.testing.assert_allclose(obs0, obs1)
+      np.testing.assert_allclose(obs2, obs3)
+      differs = differs or not np.allclose(obs0, obs2)
+      if np.any(term0 | trunc0 | term2 | trunc2):
+        break
+    self.assertTrue(differs)
+
 
 if __name__ == "__main__":
   absltest.main()
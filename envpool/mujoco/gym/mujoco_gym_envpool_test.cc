@@ -15,10 +15,13 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <random>
 #include <vector>
 
+#include "envpool/mujoco/gym/ant.h"
 #include "envpool/mujoco/gym/half_cheetah.h"
+#include "envpool/mujoco/gym/humanoid.h"
 
 using MjcAction = typename mujoco_gym::HalfCheetahEnv::Action;
 using MjcState = typename mujoco_gym::HalfCheetahEnv::State;
@@ -51,3 +54,94 @@ TEST(MjcEnvPoolTest, CheckAction) {
   envpool.Send(action);
   state_vec = envpool.Recv();
 }
+
+// the obs and reward of every env after each step, in env_id order
+struct Trajectory {
+  std::vector<std::vector<mjtNum>> obs;
+  std::vector<std::vector<float>> reward;
+};
+
+// Steps from a restored or branched mid-episode state must be bit-identical
+// to the steps taken from the state when it was snapshotted, including what
+// the observations and rewards read from the derived arrays of mjData.
+template <typename EnvSpec, typename EnvPool>
+void CheckRestore(typename EnvSpec::Config config, int action_dim) {
+  int num_envs = 2;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["terminate_when_unhealthy"_] = false;
+  EnvSpec spec(config);
+  EnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action({Array(Spec<int>({num_envs})),
+                                 Array(Spec<int>({num_envs})),
+                                 Array(Spec<double>({num_envs, action_dim}))});
+  typename EnvPool::Action action(raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dist(-0.4, 0.4);
+  std::vector<std::vector<double>> actions(20);
+  for (auto& a : actions) {
+    for (int j = 0; j < action_dim; ++j) {
+      a.push_back(dist(gen));
+    }
+  }
+  // every env takes the same actions
+  auto run = [&](int begin, int end) {
+    Trajectory traj;
+    for (int t = begin; t < end; ++t) {
+      for (int i = 0; i < num_envs; ++i) {
+        for (int j = 0; j < action_dim; ++j) {
+          action["action"_][i][j] = actions[t][j];
+        }
+      }
+      envpool.Send(action);
+      typename EnvPool::State state(envpool.Recv());
+      traj.obs.resize(num_envs);
+      traj.reward.resize(num_envs);
+      for (int i = 0; i < num_envs; ++i) {
+        auto env_id = static_cast<int>(state["info:env_id"_][i]);
+        Array obs = state["obs"_][i];
+        const auto* data = static_cast<const mjtNum*>(obs.Data());
+        auto& dst = traj.obs[env_id];
+        dst.insert(dst.end(), data, data + obs.size);
+        traj.reward[env_id].push_back(static_cast<float>(state["reward"_][i]));
+      }
+    }
+    return traj;
+  };
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  run(0, 10);
+  auto handles = envpool.Snapshot({0});
+  Trajectory ref = run(10, 20);
+  envpool.Restore({0}, handles);
+  envpool.Branch(0, {1});
+  Trajectory traj = run(10, 20);
+  for (int i = 0; i < num_envs; ++i) {
+    // bit-identical, not only close
+    ASSERT_EQ(traj.obs[i].size(), ref.obs[0].size());
+    EXPECT_EQ(std::memcmp(traj.obs[i].data(), ref.obs[0].data(),
+                          sizeof(mjtNum) * ref.obs[0].size()),
+              0);
+    EXPECT_EQ(traj.reward[i], ref.reward[0]);
+  }
+  envpool.ReleaseSnapshot(handles);
+}
+
+TEST(MjcEnvPoolTest, RestoreAnt) {
+  auto config = mujoco_gym::AntEnvSpec::kDefaultConfig;
+  config["use_contact_force"_] = true;
+  CheckRestore<mujoco_gym::AntEnvSpec, mujoco_gym::AntEnvPool>(config, 8);
+}
+
+TEST(MjcEnvPoolTest, RestoreHumanoid) {
+  CheckRestore<mujoco_gym::HumanoidEnvSpec, mujoco_gym::HumanoidEnvPool>(
+      mujoco_gym::HumanoidEnvSpec::kDefaultConfig, 17);
+}
@@ -31,13 +31,14 @@ namespace mujoco_gym {
 class PusherEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict(
-        "reward_threshold"_.Bind(0.0), "frame_skip"_.Bind(5),
-        "post_constraint"_.Bind(true), "ctrl_cost_weight"_.Bind(0.1),
-        "dist_cost_weight"_.Bind(1.0), "near_cost_weight"_.Bind(0.5),
-        "reset_qvel_scale"_.Bind(0.005), "cylinder_x_min"_.Bind(-0.3),
-        "cylinder_x_max"_.Bind(0.0), "cylinder_y_min"_.Bind(-0.2),
-        "cylinder_y_max"_.Bind(0.2), "cylinder_dist_min"_.Bind(0.17));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(0.0), "frame_skip"_.Bind(5),
+                 "post_constraint"_.Bind(true), "ctrl_cost_weight"_.Bind(0.1),
+                 "dist_cost_weight"_.Bind(1.0), "near_cost_weight"_.Bind(0.5),
+                 "reset_qvel_scale"_.Bind(0.005), "cylinder_x_min"_.Bind(-0.3),
+                 "cylinder_x_max"_.Bind(0.0), "cylinder_y_min"_.Bind(-0.2),
+                 "cylinder_y_max"_.Bind(0.2), "cylinder_dist_min"_.Bind(0.17)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -70,7 +71,8 @@ class PusherEnv : public Env<PusherEnvSpec>, public MujocoEnv {
       : Env<PusherEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/pusher.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         id_tips_arm_(mj_name2id(model_, mjOBJ_XBODY, "tips_arm")),
         id_object_(mj_name2id(model_, mjOBJ_XBODY, "object")),
         id_goal_(mj_name2id(model_, mjOBJ_XBODY, "goal")),
@@ -112,6 +114,15 @@ class PusherEnv : public Env<PusherEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
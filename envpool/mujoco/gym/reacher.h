@@ -31,11 +31,13 @@ namespace mujoco_gym {
 class ReacherEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict(
-        "reward_threshold"_.Bind(-3.75), "frame_skip"_.Bind(2),
-        "post_constraint"_.Bind(true), "ctrl_cost_weight"_.Bind(1.0),
-        "dist_cost_weight"_.Bind(1.0), "reset_qpos_scale"_.Bind(0.1),
-        "reset_qvel_scale"_.Bind(0.005), "reset_goal_scale"_.Bind(0.2));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(-3.75), "frame_skip"_.Bind(2),
+                 "post_constraint"_.Bind(true), "ctrl_cost_weight"_.Bind(1.0),
+                 "dist_cost_weight"_.Bind(1.0), "reset_qpos_scale"_.Bind(0.1),
+                 "reset_qvel_scale"_.Bind(0.005),
+                 "reset_goal_scale"_.Bind(0.2)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -67,7 +69,8 @@ class ReacherEnv : public Env<ReacherEnvSpec>, public MujocoEnv {
       : Env<ReacherEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/reacher.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         id_fingertip_(mj_name2id(model_, mjOBJ_XBODY, "fingertip")),
         id_target_(mj_name2id(model_, mjOBJ_XBODY, "target")),
         ctrl_cost_weight_(spec.config["ctrl_cost_weight"_]),
@@ -105,6 +108,15 @@ class ReacherEnv : public Env<ReacherEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
@@ -31,12 +31,14 @@ namespace mujoco_gym {
 class SwimmerEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict("reward_threshold"_.Bind(360.0), "frame_skip"_.Bind(4),
-                    "post_constraint"_.Bind(true),
-                    "exclude_current_positions_from_observation"_.Bind(true),
-                    "forward_reward_weight"_.Bind(1.0),
-                    "ctrl_cost_weight"_.Bind(1e-4),
-                    "reset_noise_scale"_.Bind(0.1));
+    return ConcatDict(
+        MakeDict("reward_threshold"_.Bind(360.0), "frame_skip"_.Bind(4),
+                 "post_constraint"_.Bind(true),
+                 "exclude_current_positions_from_observation"_.Bind(true),
+                 "forward_reward_weight"_.Bind(1.0),
+                 "ctrl_cost_weight"_.Bind(1e-4),
+                 "reset_noise_scale"_.Bind(0.1)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -74,7 +76,8 @@ class SwimmerEnv : public Env<SwimmerEnvSpec>, public MujocoEnv {
       : Env<SwimmerEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/swimmer.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         no_pos_(spec.config["exclude_current_positions_from_observation"_]),
         ctrl_cost_weight_(spec.config["ctrl_cost_weight"_]),
         forward_reward_weight_(spec.config["forward_reward_weight"_]),
@@ -96,6 +99,15 @@ class SwimmerEnv : public Env<SwimmerEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
@@ -31,15 +31,17 @@ namespace mujoco_gym {
 class Walker2dEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
-    return MakeDict(
-        "frame_skip"_.Bind(4), "post_constraint"_.Bind(true),
-        "ctrl_cost_weight"_.Bind(0.001), "terminate_when_unhealthy"_.Bind(true),
-        "exclude_current_positions_from_observation"_.Bind(true),
-        "forward_reward_weight"_.Bind(1.0), "healthy_reward"_.Bind(1.0),
-        "healthy_z_min"_.Bind(0.8), "healthy_z_max"_.Bind(2.0),
-        "healthy_angle_min"_.Bind(-1.0), "healthy_angle_max"_.Bind(1.0),
-        "velocity_min"_.Bind(-10.0), "velocity_max"_.Bind(10.0),
-        "reset_noise_scale"_.Bind(0.005));
+    return ConcatDict(
+        MakeDict("frame_skip"_.Bind(4), "post_constraint"_.Bind(true),
+                 "ctrl_cost_weight"_.Bind(0.001),
+                 "terminate_when_unhealthy"_.Bind(true),
+                 "exclude_current_positions_from_observation"_.Bind(true),
+                 "forward_reward_weight"_.Bind(1.0),
+                 "healthy_reward"_.Bind(1.0), "healthy_z_min"_.Bind(0.8),
+                 "healthy_z_max"_.Bind(2.0), "healthy_angle_min"_.Bind(-1.0),
+                 "healthy_angle_max"_.Bind(1.0), "velocity_min"_.Bind(-10.0),
+                 "velocity_max"_.Bind(10.0), "reset_noise_scale"_.Bind(0.005)),
+        ModelRandomizer::DefaultConfig());
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -75,7 +77,8 @@ class Walker2dEnv : public Env<Walker2dEnvSpec>, public MujocoEnv {
       : Env<Walker2dEnvSpec>(spec, env_id),
         MujocoEnv(spec.config["base_path"_] + "/mujoco/assets_gym/walker2d.xml",
                   spec.config["frame_skip"_], spec.config["post_constraint"_],
-                  spec.config["max_episode_steps"_]),
+                  spec.config["max_episode_steps"_],
+                  ModelRandomizer(spec.config, seed_)),
         terminate_when_unhealthy_(spec.config["terminate_when_unhealthy"_]),
         no_pos_(spec.config["exclude_current_positions_from_observation"_]),
         ctrl_cost_weight_(spec.config["ctrl_cost_weight"_]),
@@ -105,6 +108,15 @@ class Walker2dEnv : public Env<Walker2dEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override { MujocoSaveState(writer); }
+
+  void LoadState(StateReader* reader) override {
+    MujocoLoadState(reader);
+    WriteState(0.0, 0.0, 0.0);
+  }
+
+  void Restore(StateReader* reader) override { MujocoLoadState(reader); }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
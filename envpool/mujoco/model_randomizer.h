@@ -0,0 +1,210 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_MUJOCO_MODEL_RANDOMIZER_H_
+#define ENVPOOL_MUJOCO_MODEL_RANDOMIZER_H_
+
+#include <mujoco.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "envpool/core/dict.h"
+#include "envpool/core/serialization.h"
+
+/**
+ * Per-env domain randomization of the physics parameters of a shared
+ * mjModel. Each parameter is scaled by a factor drawn uniformly from its
+ * (low, high) config range at every reset, independently per element:
+ *
+ * - body_mass_scale: per body, scales body_mass and body_inertia together,
+ *   i.e. the density; body_subtreemass follows.
+ * - geom_friction_scale: per geom, the three friction coefficients.
+ * - dof_damping_scale: per dof.
+ * - actuator_gear_scale: per actuator, the six gear values.
+ *
+ * An empty range, the default, leaves the parameter alone. The env passes
+ * its own mjModel struct, usually a shallow copy of the shared one, and only
+ * the arrays of the randomized parameters are redirected to buffers of the
+ * randomizer; all the others stay shared. The nominal values are read from
+ * the arrays the struct pointed to before.
+ *
+ * The constants that MuJoCo derives from the masses at compile time for the
+ * constraint regularization, such as dof_invweight0, keep their nominal
+ * values, the same as when body_mass is written from the Python bindings.
+ */
+class ModelRandomizer {
+ public:
+  static decltype(auto) DefaultConfig() {
+    return MakeDict("body_mass_scale"_.Bind(std::vector<double>()),
+                    "geom_friction_scale"_.Bind(std::vector<double>()),
+                    "dof_damping_scale"_.Bind(std::vector<double>()),
+                    "actuator_gear_scale"_.Bind(std::vector<double>()));
+  }
+
+ private:
+  struct Field {
+    bool enabled{false};
+    mjtNum low{1.0}, high{1.0};
+    // a scale is drawn for each of the `rows` rows of `width` values
+    int rows{0}, width{1};
+    const mjtNum* nominal{nullptr};
+    std::vector<mjtNum> value;
+
+    Field() = default;
+    Field(const std::vector<double>& range, const std::string& name) {
+      if (range.empty()) {
+        return;
+      }
+      if (range.size() != 2 || range[0] < 0 || range[0] > range[1]) {
+        throw std::invalid_argument(
+            name + " should be empty or (low, high) with 0 <= low <= high");
+      }
+      enabled = true;
+      low = range[0];
+      high = range[1];
+    }
+
+    // point *array to value, a copy of the nominal values
+    void Attach(mjtNum** array, int num_rows, int row_width) {
+      rows = num_rows;
+      width = row_width;
+      nominal = *array;
+      value.assign(nominal, nominal + rows * width);
+      *array = value.data();
+    }
+
+    void Scale(int row, mjtNum scale) {
+      for (int i = row * width; i < (row + 1) * width; ++i) {
+        value[i] = nominal[i] * scale;
+      }
+    }
+  };
+
+  Field body_mass_, body_inertia_, geom_friction_, dof_damping_,
+      actuator_gear_;
+  std::vector<mjtNum> body_subtreemass_;
+  const int* body_parentid_{nullptr};
+  // separate from the env's generator, whose draws stay the same whether
+  // randomization is on or not
+  std::mt19937 gen_;
+
+  mjtNum Draw(const Field& field) {
+    return std::uniform_real_distribution<mjtNum>(field.low, field.high)(gen_);
+  }
+
+  // the subtree masses of mj_setConst, children come after their parent
+  void UpdateSubtreeMass() {
+    int nbody = body_mass_.rows;
+    for (int i = 0; i < nbody; ++i) {
+      body_subtreemass_[i] = body_mass_.value[i];
+    }
+    for (int i = nbody - 1; i > 0; --i) {
+      body_subtreemass_[body_parentid_[i]] += body_subtreemass_[i];
+    }
+  }
+
+ public:
+  ModelRandomizer() = default;
+
+  template <typename Config>
+  ModelRandomizer(const Config& conf, int seed)
+      : body_mass_(conf["body_mass_scale"_], "body_mass_scale"),
+        geom_friction_(conf["geom_friction_scale"_], "geom_friction_scale"),
+        dof_damping_(conf["dof_damping_scale"_], "dof_damping_scale"),
+        actuator_gear_(conf["actuator_gear_scale"_], "actuator_gear_scale") {
+    std::seed_seq seq{seed, 0x6d6f64};
+    gen_.seed(seq);
+  }
+
+  bool Enabled() const {
+    return body_mass_.enabled || geom_friction_.enabled ||
+           dof_damping_.enabled || actuator_gear_.enabled;
+  }
+
+  /**
+   * Redirect the randomized arrays of model to per-env buffers, which hold
+   * the nominal values until the first Randomize.
+   */
+  void Attach(mjModel* model) {
+    if (body_mass_.enabled) {
+      body_mass_.Attach(&model->body_mass, model->nbody, 1);
+      body_inertia_.Attach(&model->body_inertia, model->nbody, 3);
+      body_subtreemass_.assign(model->body_subtreemass,
+                               model->body_subtreemass + model->nbody);
+      model->body_subtreemass = body_subtreemass_.data();
+      body_parentid_ = model->body_parentid;
+    }
+    if (geom_friction_.enabled) {
+      geom_friction_.Attach(&model->geom_friction, model->ngeom, 3);
+    }
+    if (dof_damping_.enabled) {
+      dof_damping_.Attach(&model->dof_damping, model->nv, 1);
+    }
+    if (actuator_gear_.enabled) {
+      actuator_gear_.Attach(&model->actuator_gear, model->nu, 6);
+    }
+  }
+
+  // draw new parameters, a few hundred random numbers at most
+  void Randomize() {
+    if (body_mass_.enabled) {
+      for (int i = 0; i < body_mass_.rows; ++i) {
+        mjtNum scale = Draw(body_mass_);
+        body_mass_.Scale(i, scale);
+        body_inertia_.Scale(i, scale);
+      }
+      UpdateSubtreeMass();
+    }
+    for (Field* field : {&geom_friction_, &dof_damping_, &actuator_gear_}) {
+      if (field->enabled) {
+        for (int i = 0; i < field->rows; ++i) {
+          field->Scale(i, Draw(*field));
+        }
+      }
+    }
+  }
+
+  // nothing is written when randomization is off
+  void Save(StateWriter* writer) const {
+    if (!Enabled()) {
+      return;
+    }
+    writer->Write(gen_);
+    for (const Field* field : {&body_mass_, &body_inertia_, &geom_friction_,
+                               &dof_damping_, &actuator_gear_}) {
+      writer->Write(field->value.data(), field->value.size());
+    }
+  }
+
+  void Load(StateReader* reader) {
+    if (!Enabled()) {
+      return;
+    }
+    reader->Read(&gen_);
+    for (Field* field : {&body_mass_, &body_inertia_, &geom_friction_,
+                         &dof_damping_, &actuator_gear_}) {
+      reader->Read(field->value.data(), field->value.size());
+    }
+    if (body_mass_.enabled) {
+      UpdateSubtreeMass();
+    }
+  }
+};
+
+#endif  // ENVPOOL_MUJOCO_MODEL_RANDOMIZER_H_
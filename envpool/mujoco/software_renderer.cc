@@ -0,0 +1,612 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/mujoco/software_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+struct Vec3 {
+  float x, y, z;
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) {
+  return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+inline Vec3 operator-(const Vec3& a, const Vec3& b) {
+  return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+inline Vec3 operator*(const Vec3& a, float s) {
+  return {a.x * s, a.y * s, a.z * s};
+}
+inline Vec3 operator*(const Vec3& a, const Vec3& b) {
+  return {a.x * b.x, a.y * b.y, a.z * b.z};
+}
+inline float Dot(const Vec3& a, const Vec3& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+inline Vec3 Cross(const Vec3& a, const Vec3& b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+          a.x * b.y - a.y * b.x};
+}
+inline Vec3 Normalize(const Vec3& a) {
+  float norm = std::sqrt(Dot(a, a));
+  return norm > 0 ? a * (1.0f / norm) : a;
+}
+inline Vec3 Load(const mjtNum* v) {
+  return {static_cast<float>(v[0]), static_cast<float>(v[1]),
+          static_cast<float>(v[2])};
+}
+inline Vec3 Load(const float* v) { return {v[0], v[1], v[2]}; }
+// R * v with the row-major 3x3 matrices of mjData
+inline Vec3 Rotate(const mjtNum* mat, const Vec3& v) {
+  return {static_cast<float>(mat[0] * v.x + mat[1] * v.y + mat[2] * v.z),
+          static_cast<float>(mat[3] * v.x + mat[4] * v.y + mat[5] * v.z),
+          static_cast<float>(mat[6] * v.x + mat[7] * v.y + mat[8] * v.z)};
+}
+
+/**
+ * A unit shape, scaled per axis by the size of the geom. cap moves a vertex
+ * by the half length along z, which turns the unit sphere into a capsule.
+ */
+struct Shape {
+  struct Vertex {
+    Vec3 pos, normal;
+    float cap;
+  };
+  std::vector<Vertex> vertices;
+  std::vector<int> triangles;
+
+  void Quad(int a, int b, int c, int d) {
+    triangles.insert(triangles.end(), {a, b, c, a, c, d});
+  }
+};
+
+constexpr float kPi = 3.14159265358979f;
+constexpr int kSlices = 16;
+// even, the equator is split between the two caps of a capsule
+constexpr int kStacks = 8;
+constexpr int kPlaneGrid = 8;
+
+Shape MakeBall() {
+  Shape shape;
+  for (int i = 0; i <= kStacks + 1; ++i) {
+    // ring kStacks / 2 is the upper copy of the equator, the next one the
+    // lower copy
+    int stack = i <= kStacks / 2 ? i : i - 1;
+    float cap = i <= kStacks / 2 ? 1.0f : -1.0f;
+    float theta = kPi / 2 - kPi * static_cast<float>(stack) / kStacks;
+    for (int j = 0; j < kSlices; ++j) {
+      float phi = 2 * kPi * static_cast<float>(j) / kSlices;
+      Vec3 p{std::cos(theta) * std::cos(phi), std::cos(theta) * std::sin(phi),
+             std::sin(theta)};
+      shape.vertices.push_back({p, p, cap});
+    }
+  }
+  for (int i = 0; i <= kStacks; ++i) {
+    for (int j = 0; j < kSlices; ++j) {
+      int k = (j + 1) % kSlices;
+      shape.Quad(i * kSlices + j, (i + 1) * kSlices + j,
+                 (i + 1) * kSlices + k, i * kSlices + k);
+    }
+  }
+  return shape;
+}
+
+Shape MakeCylinder() {
+  Shape shape;
+  for (float z : {1.0f, -1.0f}) {
+    for (int j = 0; j < kSlices; ++j) {
+      float phi = 2 * kPi * static_cast<float>(j) / kSlices;
+      Vec3 n{std::cos(phi), std::sin(phi), 0};
+      shape.vertices.push_back({{n.x, n.y, z}, n, 0});
+    }
+  }
+  for (int j = 0; j < kSlices; ++j) {
+    int k = (j + 1) % kSlices;
+    shape.Quad(j, kSlices + j, kSlices + k, k);
+  }
+  for (float z : {1.0f, -1.0f}) {
+    int center = static_cast<int>(shape.vertices.size());
+    shape.vertices.push_back({{0, 0, z}, {0, 0, z}, 0});
+    for (int j = 0; j < kSlices; ++j) {
+      float phi = 2 * kPi * static_cast<float>(j) / kSlices;
+      shape.vertices.push_back(
+          {{std::cos(phi), std::sin(phi), z}, {0, 0, z}, 0});
+    }
+    for (int j = 0; j < kSlices; ++j) {
+      int k = (j + 1) % kSlices;
+      shape.triangles.insert(shape.triangles.end(),
+                             {center, center + 1 + j, center + 1 + k});
+    }
+  }
+  return shape;
+}
+
+Shape MakeBox() {
+  Shape shape;
+  for (int axis = 0; axis < 3; ++axis) {
+    for (float sign : {1.0f, -1.0f}) {
+      float n[3] = {0, 0, 0};
+      n[axis] = sign;
+      int u = (axis + 1) % 3;
+      int v = (axis + 2) % 3;
+      int base = static_cast<int>(shape.vertices.size());
+      for (auto [a, b] : {std::pair{-1, -1}, {1, -1}, {1, 1}, {-1, 1}}) {
+        float p[3];
+        p[axis] = sign;
+        p[u] = static_cast<float>(a);
+        p[v] = static_cast<float>(b);
+        shape.vertices.push_back({Load(p), Load(n), 0});
+      }
+      shape.Quad(base, base + 1, base + 2, base + 3);
+    }
+  }
+  return shape;
+}
+
+// one sided, facing +z
+Shape MakePlane() {
+  Shape shape;
+  for (int i = 0; i <= kPlaneGrid; ++i) {
+    for (int j = 0; j <= kPlaneGrid; ++j) {
+      float x = 2 * static_cast<float>(j) / kPlaneGrid - 1;
+      float y = 2 * static_cast<float>(i) / kPlaneGrid - 1;
+      shape.vertices.push_back({{x, y, 0}, {0, 0, 1}, 0});
+    }
+  }
+  int row = kPlaneGrid + 1;
+  for (int i = 0; i < kPlaneGrid; ++i) {
+    for (int j = 0; j < kPlaneGrid; ++j) {
+      shape.Quad(i * row + j, i * row + j + 1, (i + 1) * row + j + 1,
+                 (i + 1) * row + j);
+    }
+  }
+  return shape;
+}
+
+const Shape* GetShape(int type) {
+  static const Shape kBall = MakeBall();
+  static const Shape kCylinder = MakeCylinder();
+  static const Shape kBox = MakeBox();
+  static const Shape kPlane = MakePlane();
+  switch (type) {
+    case mjGEOM_PLANE:
+      return &kPlane;
+    case mjGEOM_SPHERE:
+    case mjGEOM_CAPSULE:
+    case mjGEOM_ELLIPSOID:
+      return &kBall;
+    case mjGEOM_CYLINDER:
+      return &kCylinder;
+    case mjGEOM_BOX:
+      return &kBox;
+    default:
+      return nullptr;
+  }
+}
+
+struct Light {
+  bool directional;
+  // direction the light travels, or its position
+  Vec3 dir, pos;
+  Vec3 diffuse;
+};
+
+// a vertex in world and camera coordinates, camera z is the depth
+struct Vertex {
+  Vec3 world, normal, view, color;
+};
+
+struct ScreenVertex {
+  float x, y, inv_depth;
+  Vec3 color;
+};
+
+/**
+ * Scratch space of a thread, reused by every env that the thread renders.
+ */
+struct Context {
+  std::vector<float> inv_depth;
+  std::vector<Vertex> vertices;
+};
+
+class Frame {
+ public:
+  int height, width;
+  Vec3 pos, right, up, forward;
+  float focal, znear;
+  Vec3 ambient;
+  std::vector<Light> lights;
+  Context* context;
+  uint8_t* dst;
+
+  Vec3 View(const Vec3& p) const {
+    Vec3 d = p - pos;
+    return {Dot(d, right), Dot(d, up), Dot(d, forward)};
+  }
+
+  Vec3 Shade(const Vec3& p, const Vec3& n, const Vec3& rgb,
+             float emission) const {
+    Vec3 c = rgb * (ambient + Vec3{emission, emission, emission});
+    for (const auto& light : lights) {
+      Vec3 l = light.directional ? light.dir * -1.0f : Normalize(light.pos - p);
+      float diffuse = std::max(0.0f, Dot(n, l));
+      c = c + rgb * light.diffuse * diffuse;
+    }
+    return c;
+  }
+
+  // whether a sphere is out of the view frustum
+  bool Outside(const Vec3& center, float radius) const {
+    Vec3 v = View(center);
+    if (v.z + radius < znear) {
+      return true;
+    }
+    float depth = v.z + radius;
+    return std::abs(v.x) - radius > depth * 0.5f * width / focal ||
+           std::abs(v.y) - radius > depth * 0.5f * height / focal;
+  }
+
+  void Triangle(const Vertex& a, const Vertex& b, const Vertex& c) const {
+    // back-face culling, with the face oriented along the vertex normals
+    Vec3 face = Cross(b.world - a.world, c.world - a.world);
+    if (Dot(face, a.normal + b.normal + c.normal) < 0) {
+      face = face * -1.0f;
+    }
+    if (Dot(face, a.world - pos) >= 0) {
+      return;
+    }
+    Clip(a, b, c);
+  }
+
+  // clip against the near plane, then fill the one or two triangles
+  void Clip(const Vertex& a, const Vertex& b, const Vertex& c) const {
+    const Vertex* in[3] = {&a, &b, &c};
+    ScreenVertex out[4];
+    int n = 0;
+    for (int i = 0; i < 3; ++i) {
+      const Vertex& cur = *in[i];
+      const Vertex& next = *in[(i + 1) % 3];
+      bool cur_in = cur.view.z >= znear;
+      bool next_in = next.view.z >= znear;
+      if (cur_in) {
+        out[n++] = Project(cur.view, cur.color);
+      }
+      if (cur_in != next_in) {
+        float t = (znear - cur.view.z) / (next.view.z - cur.view.z);
+        out[n++] = Project(cur.view + (next.view - cur.view) * t,
+                           cur.color + (next.color - cur.color) * t);
+      }
+    }
+    if (n >= 3) {
+      Fill(out[0], out[1], out[2]);
+    }
+    if (n == 4) {
+      Fill(out[0], out[2], out[3]);
+    }
+  }
+
+  ScreenVertex Project(const Vec3& v, const Vec3& color) const {
+    float inv = 1.0f / v.z;
+    return {0.5f * width + focal * v.x * inv,
+            0.5f * height - focal * v.y * inv, inv, color};
+  }
+
+  void Fill(const ScreenVertex& a, const ScreenVertex& b,
+            const ScreenVertex& c) const {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::abs(area) < 1e-9f) {
+      return;
+    }
+    float inv_area = 1.0f / area;
+    // clamped as floats, the corners of a huge plane overflow an int
+    int x0 = Lower(std::min({a.x, b.x, c.x}), width);
+    int x1 = Upper(std::max({a.x, b.x, c.x}), width);
+    int y0 = Lower(std::min({a.y, b.y, c.y}), height);
+    int y1 = Upper(std::max({a.y, b.y, c.y}), height);
+    // barycentric weights of a and b, linear in the pixel center
+    float wa_dx = -(c.y - b.y) * inv_area;
+    float wb_dx = -(a.y - c.y) * inv_area;
+    std::size_t plane = static_cast<std::size_t>(height) * width;
+    float* depth = context->inv_depth.data();
+    for (int y = y0; y <= y1; ++y) {
+      float px = static_cast<float>(x0) + 0.5f;
+      float py = static_cast<float>(y) + 0.5f;
+      float wa = ((c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x)) *
+                 inv_area;
+      float wb = ((a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x)) *
+                 inv_area;
+      for (int x = x0; x <= x1; ++x, wa += wa_dx, wb += wb_dx) {
+        float wc = 1.0f - wa - wb;
+        if (wa < 0 || wb < 0 || wc < 0) {
+          continue;
+        }
+        std::size_t i = static_cast<std::size_t>(y) * width + x;
+        float inv = wa * a.inv_depth + wb * b.inv_depth + wc * c.inv_depth;
+        if (inv <= depth[i]) {
+          continue;
+        }
+        depth[i] = inv;
+        Vec3 color = a.color * wa + b.color * wb + c.color * wc;
+        dst[i] = ToByte(color.x);
+        dst[plane + i] = ToByte(color.y);
+        dst[2 * plane + i] = ToByte(color.z);
+      }
+    }
+  }
+
+  // the first and last pixel covered by [v, ...] and [..., v], in [0, size)
+  // or empty
+  static int Lower(float v, int size) {
+    return static_cast<int>(
+        std::min(static_cast<float>(size), std::max(0.0f, std::floor(v))));
+  }
+
+  static int Upper(float v, int size) {
+    return static_cast<int>(
+        std::min(static_cast<float>(size - 1), std::max(-1.0f, std::ceil(v))));
+  }
+
+  static uint8_t ToByte(float v) {
+    v = std::min(1.0f, std::max(0.0f, v));
+    return static_cast<uint8_t>(v * 255.0f + 0.5f);
+  }
+};
+
+// mean color of a texture, which stands for the texture
+Vec3 TextureMean(const mjModel* model, int tex_id) {
+  const mjtByte* rgb = model->tex_rgb + model->tex_adr[tex_id];
+  std::size_t n = static_cast<std::size_t>(model->tex_width[tex_id]) *
+                  model->tex_height[tex_id];
+  double sum[3] = {0, 0, 0};
+  for (std::size_t i = 0; i < n; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      sum[c] += rgb[i * 3 + c];
+    }
+  }
+  float scale = n == 0 ? 0.0f : 1.0f / (255.0f * static_cast<float>(n));
+  return {static_cast<float>(sum[0]) * scale,
+          static_cast<float>(sum[1]) * scale,
+          static_cast<float>(sum[2]) * scale};
+}
+
+}  // namespace
+
+SoftwareRenderer::SoftwareRenderer(const mjModel* model, int height,
+                                   int width, int camera_id)
+    : height_(height), width_(width), camera_id_(camera_id) {
+  if (height <= 0 || width <= 0) {
+    throw std::invalid_argument("invalid image size " +
+                                std::to_string(height) + "x" +
+                                std::to_string(width));
+  }
+  if (camera_id < -1 || camera_id >= model->ncam) {
+    throw std::invalid_argument("camera_id " + std::to_string(camera_id) +
+                                " out of range, the model has " +
+                                std::to_string(model->ncam) + " cameras");
+  }
+  background_[0] = background_[1] = background_[2] = 0.0f;
+  bool skybox = false;
+  tex_mean_.resize(3 * model->ntex);
+  for (int i = 0; i < model->ntex; ++i) {
+    Vec3 mean = TextureMean(model, i);
+    tex_mean_[3 * i] = mean.x;
+    tex_mean_[3 * i + 1] = mean.y;
+    tex_mean_[3 * i + 2] = mean.z;
+    if (!skybox && model->tex_type[i] == mjTEXTURE_SKYBOX) {
+      std::memcpy(background_, &tex_mean_[3 * i], sizeof(background_));
+      skybox = true;
+    }
+  }
+  // what mjv_addGeoms draws with the default mjvOption
+  for (bool site : {false, true}) {
+    int num = site ? model->nsite : model->ngeom;
+    for (int i = 0; i < num; ++i) {
+      int type = site ? model->site_type[i] : model->geom_type[i];
+      int group = site ? model->site_group[i] : model->geom_group[i];
+      if (group < 0 || group > 2 ||
+          (type != mjGEOM_MESH && GetShape(type) == nullptr)) {
+        continue;
+      }
+      drawables_.push_back({site, i, type});
+    }
+  }
+}
+
+void SoftwareRenderer::Render(const mjModel* model, const mjData* data,
+                              uint8_t* dst) const {
+  thread_local Context context;
+  std::size_t plane = static_cast<std::size_t>(height_) * width_;
+  context.inv_depth.assign(plane, 0.0f);
+  for (int c = 0; c < 3; ++c) {
+    std::memset(dst + c * plane, Frame::ToByte(background_[c]), plane);
+  }
+
+  Frame frame;
+  frame.height = height_;
+  frame.width = width_;
+  frame.context = &context;
+  frame.dst = dst;
+  float fovy;
+  if (camera_id_ >= 0) {
+    const mjtNum* mat = data->cam_xmat + 9 * camera_id_;
+    frame.pos = Load(data->cam_xpos + 3 * camera_id_);
+    // the camera looks along -z, with y up
+    frame.right = {static_cast<float>(mat[0]), static_cast<float>(mat[3]),
+                   static_cast<float>(mat[6])};
+    frame.up = {static_cast<float>(mat[1]), static_cast<float>(mat[4]),
+                static_cast<float>(mat[7])};
+    frame.forward = {static_cast<float>(-mat[2]), static_cast<float>(-mat[5]),
+                     static_cast<float>(-mat[8])};
+    fovy = static_cast<float>(model->cam_fovy[camera_id_]);
+  } else {
+    // mjv_defaultFreeCamera, tracking the root body
+    Vec3 lookat = model->nbody > 1 ? Load(data->subtree_com + 3)
+                                   : Load(model->stat.center);
+    float distance = 1.5f * static_cast<float>(model->stat.extent);
+    float azimuth = model->vis.global.azimuth * kPi / 180;
+    float elevation = model->vis.global.elevation * kPi / 180;
+    frame.forward = {std::cos(elevation) * std::cos(azimuth),
+                     std::cos(elevation) * std::sin(azimuth),
+                     std::sin(elevation)};
+    frame.pos = lookat - frame.forward * distance;
+    frame.right = Normalize(Cross(frame.forward, {0, 0, 1}));
+    frame.up = Cross(frame.right, frame.forward);
+    fovy = model->vis.global.fovy;
+  }
+  frame.focal = 0.5f * height_ / std::tan(fovy * kPi / 360);
+  float extent = static_cast<float>(model->stat.extent);
+  frame.znear = model->vis.map.znear * extent;
+
+  frame.ambient = {0, 0, 0};
+  if (model->vis.headlight.active != 0) {
+    frame.ambient = Load(model->vis.headlight.ambient);
+    frame.lights.push_back({true, frame.forward, frame.pos,
+                            Load(model->vis.headlight.diffuse)});
+  }
+  for (int i = 0; i < model->nlight; ++i) {
+    if (model->light_active[i] == 0) {
+      continue;
+    }
+    frame.ambient = frame.ambient + Load(model->light_ambient + 3 * i);
+    frame.lights.push_back({model->light_directional[i] != 0,
+                            Load(data->light_xdir + 3 * i),
+                            Load(data->light_xpos + 3 * i),
+                            Load(model->light_diffuse + 3 * i)});
+  }
+
+  auto& vertices = context.vertices;
+  for (const auto& d : drawables_) {
+    const mjtNum* xpos =
+        d.site ? data->site_xpos + 3 * d.id : data->geom_xpos + 3 * d.id;
+    const mjtNum* xmat =
+        d.site ? data->site_xmat + 9 * d.id : data->geom_xmat + 9 * d.id;
+    const mjtNum* size =
+        d.site ? model->site_size + 3 * d.id : model->geom_size + 3 * d.id;
+    int mat_id = d.site ? model->site_matid[d.id] : model->geom_matid[d.id];
+    const float* rgba =
+        d.site ? model->site_rgba + 4 * d.id : model->geom_rgba + 4 * d.id;
+    Vec3 rgb = Load(rgba);
+    float alpha = rgba[3];
+    float emission = 0;
+    if (mat_id >= 0) {
+      // the material color, unless the rgba of the geom is set
+      bool default_rgba = rgba[0] == 0.5f && rgba[1] == 0.5f &&
+                          rgba[2] == 0.5f && rgba[3] == 1.0f;
+      if (default_rgba) {
+        rgb = Load(model->mat_rgba + 4 * mat_id);
+        alpha = model->mat_rgba[4 * mat_id + 3];
+      }
+      emission = model->mat_emission[mat_id];
+      int tex_id = model->mat_texid[mat_id];
+      if (tex_id >= 0) {
+        rgb = rgb * Load(&tex_mean_[3 * tex_id]);
+      }
+    }
+    if (alpha <= 0) {
+      continue;
+    }
+    Vec3 center = Load(xpos);
+    if (d.type == mjGEOM_MESH) {
+      if (frame.Outside(center, static_cast<float>(model->geom_rbound[d.id]))) {
+        continue;
+      }
+      int mesh_id = model->geom_dataid[d.id];
+      const float* vert = model->mesh_vert + 3 * model->mesh_vertadr[mesh_id];
+      const int* face = model->mesh_face + 3 * model->mesh_faceadr[mesh_id];
+      vertices.resize(model->mesh_vertnum[mesh_id]);
+      for (auto& v : vertices) {
+        v.world = center + Rotate(xmat, Load(vert));
+        v.view = frame.View(v.world);
+        vert += 3;
+      }
+      // flat shading, the faces wind counterclockwise seen from outside
+      for (int f = 0; f < model->mesh_facenum[mesh_id]; ++f, face += 3) {
+        Vertex a = vertices[face[0]];
+        Vertex b = vertices[face[1]];
+        Vertex c = vertices[face[2]];
+        Vec3 n = Normalize(Cross(b.world - a.world, c.world - a.world));
+        if (Dot(n, a.world - frame.pos) >= 0) {
+          continue;
+        }
+        Vec3 color =
+            frame.Shade((a.world + b.world + c.world) * (1.0f / 3), n, rgb,
+                        emission);
+        a.color = b.color = c.color = color;
+        frame.Clip(a, b, c);
+      }
+      continue;
+    }
+
+    Vec3 scale{static_cast<float>(size[0]), static_cast<float>(size[1]),
+               static_cast<float>(size[2])};
+    float half_length = 0;
+    float radius;
+    switch (d.type) {
+      case mjGEOM_PLANE: {
+        // zero size is infinite, drawn up to the far clipping plane
+        float far = model->vis.map.zfar * extent;
+        scale = {scale.x > 0 ? scale.x : far, scale.y > 0 ? scale.y : far, 1};
+        radius = 0;
+        break;
+      }
+      case mjGEOM_SPHERE:
+        scale = {scale.x, scale.x, scale.x};
+        radius = scale.x;
+        break;
+      case mjGEOM_CAPSULE:
+        half_length = scale.y;
+        scale = {scale.x, scale.x, scale.x};
+        radius = scale.x + half_length;
+        break;
+      case mjGEOM_CYLINDER:
+        scale = {scale.x, scale.x, scale.y};
+        radius = std::sqrt(Dot(scale, scale));
+        break;
+      case mjGEOM_ELLIPSOID:
+        radius = std::max({scale.x, scale.y, scale.z});
+        break;
+      default:  // mjGEOM_BOX
+        radius = std::sqrt(Dot(scale, scale));
+        break;
+    }
+    if (radius > 0 && frame.Outside(center, radius)) {
+      continue;
+    }
+    const Shape* shape = GetShape(d.type);
+    Vec3 inv_scale{1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z};
+    vertices.resize(shape->vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+      const auto& s = shape->vertices[i];
+      Vec3 local = s.pos * scale + Vec3{0, 0, s.cap * half_length};
+      auto& v = vertices[i];
+      v.world = center + Rotate(xmat, local);
+      v.normal = Normalize(Rotate(xmat, s.normal * inv_scale));
+      v.view = frame.View(v.world);
+      v.color = frame.Shade(v.world, v.normal, rgb, emission);
+    }
+    const auto& tri = shape->triangles;
+    for (std::size_t i = 0; i < tri.size(); i += 3) {
+      frame.Triangle(vertices[tri[i]], vertices[tri[i + 1]],
+                     vertices[tri[i + 2]]);
+    }
+  }
+}
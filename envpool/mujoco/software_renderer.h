@@ -0,0 +1,78 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_MUJOCO_SOFTWARE_RENDERER_H_
+#define ENVPOOL_MUJOCO_SOFTWARE_RENDERER_H_
+
+#include <mujoco.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * CPU rasterizer for the geoms and sites of a MuJoCo model, for pixel
+ * observations without an OpenGL context. It draws what mjr_render draws
+ * with the default mjvOption, i.e. groups 0 to 2, as seen from a model
+ * camera or the default free camera:
+ *
+ * - planes, spheres, capsules, ellipsoids, cylinders, boxes and meshes,
+ *   tessellated and depth-buffered; height fields are not drawn;
+ * - per-vertex lighting by the headlight and the model lights, ambient and
+ *   diffuse only; spot lights are treated as directional at their position;
+ * - the color of the geom or of its material, where a texture contributes
+ *   its mean color; the background is the mean color of the skybox.
+ *
+ * No shadows, reflections, fog, specular highlights nor transparency, so
+ * the frames are close to but not the same as mjr_render.
+ *
+ * The renderer holds only the visible geoms and sites and the mean texture
+ * colors; the colors, sizes and lights are read from the model passed to
+ * Render, so a task may change them between frames. The depth buffer
+ * and the transformed vertices are scratch space of the calling thread, so
+ * the envs stepped by a worker thread share them.
+ */
+class SoftwareRenderer {
+ public:
+  /**
+   * camera_id -1 is the free camera, which looks at the root body from the
+   * azimuth, elevation and distance of mjv_defaultFreeCamera.
+   */
+  SoftwareRenderer(const mjModel* model, int height, int width,
+                   int camera_id);
+
+  /**
+   * Draw the scene of data as planar RGB, (3, height, width), into dst.
+   */
+  void Render(const mjModel* model, const mjData* data, uint8_t* dst) const;
+
+  int Height() const { return height_; }
+  int Width() const { return width_; }
+
+ private:
+  struct Drawable {
+    // geom or site
+    bool site;
+    int id, type;
+  };
+
+  int height_, width_, camera_id_;
+  std::vector<Drawable> drawables_;
+  // mean color of each texture, 3 floats per texture
+  std::vector<float> tex_mean_;
+  float background_[3];
+};
+
+#endif  // ENVPOOL_MUJOCO_SOFTWARE_RENDERER_H_
@@ -0,0 +1,205 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/mujoco/software_renderer.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using ModelPtr = std::unique_ptr<mjModel, void (*)(mjModel*)>;
+using DataPtr = std::unique_ptr<mjData, void (*)(mjData*)>;
+
+// a red box in front of camera "front", which looks along +y with z up
+const char* kSceneXml = R"(
+<mujoco>
+  <worldbody>
+    <camera name="front" pos="0 -2 0" xyaxes="1 0 0 0 0 1"/>
+    <geom name="box" type="box" size=".2 .2 .2" rgba="1 0 0 1"/>
+    <geom name="hidden" type="sphere" pos="0 0 .5" size=".1" rgba="0 1 0 1"
+          group="3"/>
+    <body name="ball" pos="0 0 -.5">
+      <joint name="slide" type="slide" axis="1 0 0"/>
+      <geom name="ball" type="sphere" size=".1" rgba="0 0 1 1"/>
+    </body>
+  </worldbody>
+</mujoco>
+)";
+
+// a planar chain of capsules over a textured floor, about the size of the
+// dm_control cheetah
+const char* kChainXml = R"(
+<mujoco>
+  <asset>
+    <texture name="sky" type="skybox" builtin="gradient" rgb1=".4 .6 .8"
+             rgb2="0 0 0" width="64" height="64"/>
+    <texture name="grid" type="2d" builtin="checker" rgb1=".1 .2 .3"
+             rgb2=".2 .3 .4" width="64" height="64"/>
+    <material name="grid" texture="grid" texrepeat="1 1"/>
+  </asset>
+  <worldbody>
+    <light pos="0 0 3" dir="0 0 -1"/>
+    <geom name="floor" type="plane" size="0 0 1" material="grid"/>
+    <body name="torso" pos="0 0 .7">
+      <camera name="side" pos="0 -3 0" xyaxes="1 0 0 0 0 1"/>
+      <joint name="root" type="free"/>
+      <geom type="capsule" fromto="-.5 0 0 .5 0 0" size=".046"/>
+      <geom type="capsule" pos=".6 0 .1" axisangle="0 1 0 .87" size=".046 .15"/>
+      <body pos="-.5 0 0">
+        <joint type="hinge" axis="0 1 0"/>
+        <geom type="capsule" fromto="0 0 0 .1 0 -.3" size=".046"/>
+        <body pos=".1 0 -.3">
+          <joint type="hinge" axis="0 1 0"/>
+          <geom type="capsule" fromto="0 0 0 -.1 0 -.3" size=".046"/>
+          <body pos="-.1 0 -.3">
+            <joint type="hinge" axis="0 1 0"/>
+            <geom type="capsule" fromto="0 0 0 .1 0 -.1" size=".046"/>
+          </body>
+        </body>
+      </body>
+      <body pos=".5 0 0">
+        <joint type="hinge" axis="0 1 0"/>
+        <geom type="capsule" fromto="0 0 0 -.1 0 -.3" size=".046"/>
+        <body pos="-.1 0 -.3">
+          <joint type="hinge" axis="0 1 0"/>
+          <geom type="capsule" fromto="0 0 0 .1 0 -.2" size=".046"/>
+          <body pos=".1 0 -.2">
+            <joint type="hinge" axis="0 1 0"/>
+            <geom type="capsule" fromto="0 0 0 .05 0 -.1" size=".046"/>
+          </body>
+        </body>
+      </body>
+    </body>
+  </worldbody>
+</mujoco>
+)";
+
+ModelPtr LoadXml(const std::string& xml) {
+  std::unique_ptr<mjVFS, void (*)(mjVFS*)> vfs(new mjVFS, [](mjVFS* vfs) {
+    mj_deleteVFS(vfs);
+    delete vfs;
+  });
+  mj_defaultVFS(vfs.get());
+  mj_makeEmptyFileVFS(vfs.get(), "model.xml", static_cast<int>(xml.size()));
+  std::memcpy(vfs->filedata[vfs->nfile - 1], xml.c_str(), xml.size());
+  std::array<char, 1000> error;
+  ModelPtr model(mj_loadXML("model.xml", vfs.get(), error.data(), 1000),
+                 mj_deleteModel);
+  CHECK(model != nullptr) << error.data();
+  return model;
+}
+
+// RGB of pixel (y, x) of a planar frame
+std::array<int, 3> Pixel(const std::vector<uint8_t>& frame, int height,
+                         int width, int y, int x) {
+  std::size_t plane = static_cast<std::size_t>(height) * width;
+  std::size_t i = static_cast<std::size_t>(y) * width + x;
+  return {frame[i], frame[plane + i], frame[2 * plane + i]};
+}
+
+}  // namespace
+
+TEST(SoftwareRendererTest, Scene) {
+  ModelPtr model = LoadXml(kSceneXml);
+  DataPtr data(mj_makeData(model.get()), mj_deleteData);
+  mj_forward(model.get(), data.get());
+  int h = 64;
+  int w = 80;
+  SoftwareRenderer renderer(model.get(), h, w, 0);
+  EXPECT_EQ(renderer.Height(), h);
+  EXPECT_EQ(renderer.Width(), w);
+  std::vector<uint8_t> frame(3 * h * w, 7);
+  renderer.Render(model.get(), data.get(), frame.data());
+  // the lit box in the middle, pure red
+  auto center = Pixel(frame, h, w, h / 2, w / 2);
+  EXPECT_GT(center[0], 100);
+  EXPECT_EQ(center[1], 0);
+  EXPECT_EQ(center[2], 0);
+  // no skybox, so a black background
+  EXPECT_EQ(Pixel(frame, h, w, 0, 0), (std::array<int, 3>{0, 0, 0}));
+  // group 3 is not drawn: the sphere would be at 0.5 / 2 * focal above the
+  // center, with focal = 0.5 * h / tan(fovy / 2) and the default fovy 45
+  EXPECT_EQ(Pixel(frame, h, w, h / 2 - 19, w / 2),
+            (std::array<int, 3>{0, 0, 0}));
+  // the blue ball below the box, and nothing where it moves to
+  int ball_y = h / 2 + 19;
+  EXPECT_GT(Pixel(frame, h, w, ball_y, w / 2)[2], 100);
+  EXPECT_EQ(Pixel(frame, h, w, ball_y, w / 2 + 19)[2], 0);
+  data->qpos[0] = 0.5;
+  mj_forward(model.get(), data.get());
+  std::vector<uint8_t> moved(frame.size());
+  renderer.Render(model.get(), data.get(), moved.data());
+  EXPECT_EQ(Pixel(moved, h, w, ball_y, w / 2)[2], 0);
+  EXPECT_GT(Pixel(moved, h, w, ball_y, w / 2 + 19)[2], 100);
+  // the same state, the same frame
+  data->qpos[0] = 0;
+  mj_forward(model.get(), data.get());
+  std::vector<uint8_t> again(frame.size());
+  renderer.Render(model.get(), data.get(), again.data());
+  EXPECT_EQ(again, frame);
+  // colors are read from the model at every frame
+  float* box_rgba = model->geom_rgba;
+  box_rgba[0] = 0;
+  box_rgba[1] = 1;
+  renderer.Render(model.get(), data.get(), again.data());
+  center = Pixel(again, h, w, h / 2, w / 2);
+  EXPECT_EQ(center[0], 0);
+  EXPECT_GT(center[1], 100);
+  box_rgba[3] = 0;
+  renderer.Render(model.get(), data.get(), again.data());
+  EXPECT_EQ(Pixel(again, h, w, h / 2, w / 2), (std::array<int, 3>{0, 0, 0}));
+}
+
+TEST(SoftwareRendererTest, Camera) {
+  ModelPtr model = LoadXml(kSceneXml);
+  // the free camera
+  SoftwareRenderer renderer(model.get(), 16, 16, -1);
+  EXPECT_THROW(SoftwareRenderer(model.get(), 16, 16, 1),
+               std::invalid_argument);
+  EXPECT_THROW(SoftwareRenderer(model.get(), 16, 16, -2),
+               std::invalid_argument);
+  EXPECT_THROW(SoftwareRenderer(model.get(), 0, 16, 0), std::invalid_argument);
+}
+
+TEST(SoftwareRendererSpeedTest, Benchmark) {
+  ModelPtr model = LoadXml(kChainXml);
+  DataPtr data(mj_makeData(model.get()), mj_deleteData);
+  mj_forward(model.get(), data.get());
+  for (int size : {64, 84, 128}) {
+    SoftwareRenderer renderer(model.get(), size, size, 0);
+    std::vector<uint8_t> frame(3 * size * size);
+    int repeat = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      renderer.Render(model.get(), data.get(), frame.data());
+    }
+    std::chrono::duration<double> dur =
+        std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "capsule chain " << size << "x" << size << ": "
+              << dur.count() / repeat * 1e6 << " us per frame";
+    // the torso in the middle, against the sky in the corner
+    EXPECT_NE(Pixel(frame, size, size, size / 2, size / 2),
+              Pixel(frame, size, size, 0, 0));
+  }
+}
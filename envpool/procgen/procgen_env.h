@@ -19,12 +19,15 @@
 
 #include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "buffer.h"
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/image_kernels.h"
 #include "game.h"
 
 namespace procgen {
@@ -36,6 +39,8 @@ namespace procgen {
    QT build needs: sudo apt update && sudo apt install qtdeclarative5-dev
  */
 static const int kRes = 64;
+// https://github.com/openai/procgen/blob/0.10.7/procgen/env.py#L19
+static const int kMaxStateSize = 1 << 20;
 static std::once_flag procgen_global_init_flag;
 
 void ProcgenGlobalInit(std::string path) {
@@ -66,7 +71,8 @@ class ProcgenEnvFns {
         "use_backgrounds"_.Bind(true), "use_monochrome_assets"_.Bind(false),
         "restrict_themes"_.Bind(false), "use_generated_assets"_.Bind(false),
         "paint_vel_info"_.Bind(false), "use_easy_jump"_.Bind(false),
-        "distribution_mode"_.Bind(1));
+        "distribution_mode"_.Bind(1), "frame_skip"_.Bind(1),
+        "maxpool_last_two"_.Bind(false));
   }
 
   template <typename Config>
@@ -97,9 +103,14 @@ class ProcgenEnv : public Env<ProcgenEnvSpec> {
   std::shared_ptr<Game> game_;
   std::string env_name_;
   bool channel_first_;
-  // buffer used by game
+  int frame_skip_;
+  bool maxpool_;
+  // the game renders straight into the obs of the state when it is HWC, and
+  // into obs_ otherwise or when Game::step renders, see WriteObs
   FrameSpec obs_spec_;
   Array obs_;
+  // frame before the last of a step with maxpool_last_two
+  Array pool_buf_;
   float reward_;
   int level_seed_, prev_level_seed_;
   uint8_t done_{1}, prev_level_complete_;
@@ -109,8 +120,15 @@ class ProcgenEnv : public Env<ProcgenEnvSpec> {
       : Env<ProcgenEnvSpec>(spec, env_id),
         env_name_(spec.config["env_name"_]),
         channel_first_(spec.config["channel_first"_]),
+        frame_skip_(spec.config["frame_skip"_]),
+        maxpool_(spec.config["maxpool_last_two"_] && frame_skip_ > 1),
         obs_spec_({kRes, kRes, 3}),
-        obs_(obs_spec_) {
+        obs_(obs_spec_),
+        pool_buf_(obs_spec_) {
+    if (frame_skip_ < 1) {
+      throw std::invalid_argument("frame_skip must be positive, got " +
+                                  std::to_string(frame_skip_));
+    }
     /* Initialize the single game we are holding in this EnvPool environment
      * It depends on some default setting along with the config map passed in
      * We mostly follow how it's done in the vector environment at Procgen and
@@ -169,37 +187,115 @@ class ProcgenEnv : public Env<ProcgenEnvSpec> {
     game_->step_data.reward = 0.0;
     game_->step_data.level_complete = false;
     game_->reset();
-    game_->observe();
-    WriteObs();
+    WriteObs(0.0f, false);
   }
 
   void Step(const Action& action) override {
-    game_->action = action["action"_];
-    game_->step();
-    WriteObs();
+    int act = action["action"_];
+    if (frame_skip_ == 1) {
+      // Game::step as is, which renders into obs_
+      game_->action = act;
+      game_->obs_bufs[0] = obs_.Data();
+      game_->step();
+      WriteObs(reward_, false, true);
+      return;
+    }
+    float reward = 0.0f;
+    // only the frames that are observed are rendered: the last one, by
+    // WriteObs, and the one before with maxpool_last_two
+    bool pool = false;
+    for (int i = 0; i < frame_skip_; ++i) {
+      game_->action = act;
+      bool done = StepWithoutRender();
+      reward += game_->step_data.reward;
+      if (done) {
+        break;
+      }
+      if (maxpool_ && i + 2 == frame_skip_) {
+        game_->obs_bufs[0] = pool_buf_.Data();
+        game_->observe();
+        pool = true;
+      }
+    }
+    WriteObs(reward, pool);
   }
 
   bool IsDone() override { return done_ != 0; }
 
+  void SaveState(StateWriter* writer) override {
+    std::vector<char> buf(kMaxStateSize);
+    WriteBuffer b(buf.data(), kMaxStateSize);
+    game_->serialize(&b);
+    writer->Write<uint64_t>(b.offset);
+    writer->WriteBytes(buf.data(), b.offset);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteObs(game_->step_data.reward, false);
+  }
+
+  void Restore(StateReader* reader) override {
+    std::vector<char> buf(reader->Read<uint64_t>());
+    reader->ReadBytes(buf.data(), buf.size());
+    ReadBuffer b(buf.data(), static_cast<int>(buf.size()));
+    game_->deserialize(&b);
+    // what observe() would write into done_, read by IsDone
+    done_ = static_cast<uint8_t>(game_->step_data.done);
+  }
+
  private:
-  void WriteObs() {
+  /**
+   * Game::step without its final observe(), which renders the frame; returns
+   * whether the episode is done, the game being reset already in that case.
+   * https://github.com/openai/procgen/blob/0.10.7/procgen/src/game.cpp#L95
+   */
+  bool StepWithoutRender() {
+    game_->cur_time += 1;
+    game_->step_data.reward = 0;
+    game_->step_data.done = false;
+    game_->step_data.level_complete = false;
+    game_->game_step();
+    game_->prev_level_complete = game_->step_data.level_complete;
+    if (game_->step_data.done) {
+      game_->reset();
+    }
+    if (game_->options.use_sequential_levels &&
+        game_->step_data.level_complete) {
+      game_->step_data.done = false;
+    }
+    return game_->step_data.done;
+  }
+
+  /**
+   * Render the current frame of the game into a newly allocated state, max
+   * pooled with pool_buf_ if pool, or copy it from obs_ if Game::step
+   * rendered it there already. Allocate reads IsDone, so done_ is set from
+   * the game first; observe() writes the same value into it again, along
+   * with the info buffers and reward_, the reward of the last frame.
+   */
+  void WriteObs(float reward, bool pool, bool observed = false) {
+    done_ = static_cast<uint8_t>(game_->step_data.done);
     State state = Allocate();
+    auto* obs = static_cast<uint8_t*>(state["obs"_].Data());
+    auto* frame = channel_first_ || observed
+                      ? static_cast<uint8_t*>(obs_.Data())
+                      : obs;
+    if (!observed) {
+      game_->obs_bufs[0] = frame;
+      game_->observe();
+    }
+    if (pool) {
+      image_kernels::MaxPool(frame,
+                             static_cast<const uint8_t*>(pool_buf_.Data()),
+                             obs_.size);
+    }
     if (channel_first_) {
-      // convert from HWC to CHW
-      auto* data = static_cast<uint8_t*>(state["obs"_].Data());
-      auto* buffer = static_cast<uint8_t*>(obs_.Data());
-      for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < kRes; ++j) {
-          for (int k = 0; k < kRes; ++k) {
-            data[i * kRes * kRes + j * kRes + k] =
-                buffer[j * kRes * 3 + k * 3 + i];
-          }
-        }
-      }
-    } else {
+      image_kernels::HwcToChw(frame, kRes * kRes, 3, obs);
+    } else if (observed) {
       state["obs"_].Assign(obs_);
     }
-    state["reward"_] = reward_;
+    state["reward"_] = reward;
     state["info:prev_level_seed"_] = prev_level_seed_;
     state["info:prev_level_complete"_] = prev_level_complete_;
     state["info:level_seed"_] = level_seed_;
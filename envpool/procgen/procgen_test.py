@@ -13,6 +13,10 @@
 # limitations under the License.
 """Unit tests for Procgen environments."""
 
+import os
+import tempfile
+from typing import Any, List
+
 # import cv2
 import numpy as np
 from absl import logging
@@ -89,6 +93,86 @@ class _ProcgenEnvPoolTest(absltest.TestCase):
       self.assertEqual(obs2.shape, (64, 64, 3))
       np.testing.assert_allclose(obs1, obs2.transpose(2, 0, 1))
 
+  def test_frame_skip(
+    self,
+    task_id: str = "CoinrunHard-v0",
+    seed: int = 0,
+    total: int = 100,
+  ) -> None:
+    frame_skip = 4
+    env0 = make_gym(task_id, seed=seed, channel_first=False)
+    env1 = make_gym(task_id, seed=seed, frame_skip=frame_skip)
+    env2 = make_gym(
+      task_id, seed=seed, frame_skip=frame_skip, maxpool_last_two=True
+    )
+    # the first step of each env is a reset
+    done = True
+    for _ in range(total):
+      act = np.array([env0.action_space.sample()])
+      obs1, rew1, term1, _, _ = env1.step(act)
+      obs2, rew2, term2, _, _ = env2.step(act)
+      # the same frames, one step per frame
+      frames, rew0 = [], 0.0
+      for _ in range(1 if done else frame_skip):
+        obs0, rew, term0, trunc0, _ = env0.step(act)
+        frames.append(obs0[0].transpose(2, 0, 1))
+        rew0 += rew[0]
+        if term0[0] or trunc0[0]:
+          break
+      np.testing.assert_allclose(obs1[0], frames[-1])
+      self.assertEqual(rew1[0], rew0)
+      self.assertEqual(term1[0], term0[0])
+      pooled = frames[-1]
+      if len(frames) == frame_skip:
+        pooled = np.maximum(frames[-2], frames[-1])
+      np.testing.assert_allclose(obs2[0], pooled)
+      self.assertEqual(rew2[0], rew0)
+      self.assertEqual(term2[0], term0[0])
+      done = term0[0] or trunc0[0]
+
+  def test_restore(
+    self,
+    task_id: str = "CoinrunHard-v0",
+    num_envs: int = 2,
+    total: int = 100,
+  ) -> None:
+    for kwargs in [{}, {"frame_skip": 4, "maxpool_last_two": True}]:
+      env = make_gym(task_id, num_envs=num_envs, seed=0, **kwargs)
+      env.action_space.seed(0)
+      actions = [env.action_space.sample() for _ in range(3 * total)]
+
+      def run(begin: int, end: int) -> List[List[Any]]:
+        # every env takes the same actions, the result is indexed by env_id
+        traj: List[List[Any]] = [[] for _ in range(num_envs)]
+        for action in actions[begin:end]:
+          obs, rew, term, trunc, info = env.step(
+            np.array([action] * num_envs)
+          )
+          for i, env_id in enumerate(info["env_id"]):
+            traj[env_id].append(
+              [
+                obs[i].tolist(), rew[i], term[i], trunc[i],
+                info["level_seed"][i]
+              ]
+            )
+        return traj
+
+      env.reset()
+      run(0, total)
+      handles = env.snapshot(np.array([0]))
+      ref = run(total, 2 * total)[0]
+      env.restore(handles, np.array([0]))
+      env.branch(0, np.array([1]))
+      traj = run(total, 2 * total)
+      env.release_snapshot(handles)
+      self.assertEqual(traj, [ref] * num_envs)
+      with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "state")
+        env.save_state(path)
+        ref = run(2 * total, 3 * total)
+        env.load_state(path)
+        self.assertEqual(run(2 * total, 3 * total), ref)
+
 
 if __name__ == "__main__":
   absltest.main()
@@ -16,7 +16,7 @@
 import pprint
 import warnings
 from abc import ABC
-from typing import Any, Dict, List, Optional, Tuple, Union
+from typing import Any, Callable, Dict, List, Optional, Tuple, Union
 
 import numpy as np
 import optree
@@ -156,6 +156,133 @@ class EnvPoolMixin(ABC):
       reset=True, return_info=self.config["gym_reset_return_info"]
     )
 
+  def save_state(self: EnvPool, path: str) -> None:
+    """Save the state of all envs into a single checkpoint file.
+
+    It must be called when no env is stepping, i.e. after recv and before
+    the next send.
+    """
+    self._save_state(path)
+
+  def load_state(self: EnvPool, path: str) -> Optional[Union[TimeStep, Tuple]]:
+    """Restore all envs from a checkpoint written by save_state.
+
+    The restored observations are returned like reset in sync mode; in async
+    mode they follow the async_reset semantics and should be fetched by recv.
+    """
+    self._load_state(path)
+    if self.is_async:
+      return None
+    return self.recv(
+      reset=True, return_info=self.config["gym_reset_return_info"]
+    )
+
+  def snapshot(
+    self: EnvPool,
+    env_id: Optional[np.ndarray] = None,
+  ) -> np.ndarray:
+    """Take in-memory snapshots of env_id and return their handles.
+
+    Handles are valid until release_snapshot. Like save_state, the envs must
+    not be stepping.
+    """
+    if env_id is None:
+      env_id = self.all_env_ids
+    return np.asarray(self._snapshot(env_id), dtype=np.int32)
+
+  def restore(
+    self: EnvPool,
+    handles: np.ndarray,
+    env_id: Optional[np.ndarray] = None,
+  ) -> None:
+    """Restore env_id[i] from handles[i] without emitting any state."""
+    if env_id is None:
+      env_id = self.all_env_ids
+    self._restore(env_id, handles)
+
+  def release_snapshot(self: EnvPool, handles: np.ndarray) -> None:
+    """Give the snapshot memory back to the pool."""
+    self._release_snapshot(handles)
+
+  def branch(self: EnvPool, src_env_id: int, dst_env_ids: np.ndarray) -> None:
+    """Copy the state of src_env_id into every env in dst_env_ids.
+
+    The copies continue from the source state on the next send, e.g.
+    ``env.branch(0, ids); env.send(actions, ids)`` expands K children of env 0
+    in one batched call.
+    """
+    self._branch(int(src_env_id), dst_env_ids)
+
+  def collect_episodes(
+    self: EnvPool,
+    num_episodes: int,
+    policy: Callable[[Union[TimeStep, Tuple]], Any],
+  ) -> Tuple[np.ndarray, np.ndarray]:
+    """Run every env for num_episodes episodes with actions from policy.
+
+    All envs are reset first. policy maps the output of recv to the actions
+    of that batch. Once an env has finished its episodes, it is neither
+    stepped nor reset anymore, so the last batches can be smaller than
+    batch_size. Returns the per-episode returns and lengths, both with shape
+    (num_envs, num_episodes), accumulated on the C++ side.
+    """
+    self._collect_begin(num_episodes)
+    try:
+      while self._collect_active() > 0:
+        ts = self.recv(reset=False, return_info=True)
+        if isinstance(ts, TimeStep):
+          env_id = ts.observation.env_id
+        else:
+          env_id = ts[-1]["env_id"]
+        self.send(policy(ts), env_id)
+    finally:
+      returns, lengths = self._collect_end()
+    return returns, lengths
+
+  def serve_shm(
+    self: EnvPool,
+    name: str,
+    client_num_envs: List[int],
+    client_batch_size: Optional[List[int]] = None,
+  ) -> None:
+    """Host this pool for other local processes through shared memory.
+
+    Client i owns the next client_num_envs[i] env ids, and connects with
+    ``envpool.connect_shm(task_id, name, i, num_envs=client_num_envs[i],
+    batch_size=client_batch_size[i], ...)``. client_batch_size defaults to
+    client_num_envs, i.e. sync clients. The pool itself must be in async mode
+    and must not be used until stop_shm.
+    """
+    if client_batch_size is None:
+      client_batch_size = client_num_envs
+    self._serve_shm(name, list(client_num_envs), list(client_batch_size))
+
+  def stop_shm(self: EnvPool) -> None:
+    """Stop serving and remove the shared memory segment."""
+    self._stop_shm()
+
+  def record(
+    self: EnvPool,
+    path: str,
+    compress: bool = False,
+    num_threads: int = 2,
+    max_backlog_mb: int = 1024,
+  ) -> None:
+    """Record every received state and sent action into directory path.
+
+    Columns are written in the background by num_threads threads, recv and
+    send only block when more than max_backlog_mb are waiting. With compress,
+    uint8 columns (images) are zlib-compressed. Received observations are
+    recorded without a copy, so they must not be modified in place until
+    stop_record. Read the recording back with
+    ``envpool.python.recording.load_recording(path)``.
+    """
+    self._record_begin(path, compress, num_threads, max_backlog_mb << 20)
+
+  def stop_record(self: EnvPool) -> None:
+    """Flush the recording, then write its episode index and meta.json."""
+    self._record_end()
+
   @property
   def config(self: EnvPool) -> Dict[str, Any]:
     """Config dict of this class."""
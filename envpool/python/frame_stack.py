@@ -0,0 +1,133 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Rebuild stacked observations of envs running with ``frame_dedup=True``.
+
+With ``frame_dedup``, Atari and ViZDoom envs emit only the newest frame as
+``obs``, of shape ``(C, H, W)``, and ``info:frame_index``, the number of
+frames the env pushed since its frame stack was last filled by a reset. The
+stack of an observation is the frames with index ``frame_index - stack_num +
+1`` to ``frame_index``, where the ones before index 0 are frame 0. Both
+helpers below give the same ``(stack_num * C, H, W)`` observations as
+``frame_dedup=False``, bit for bit.
+
+``save_state``, ``load_state``, ``snapshot``, ``restore`` and ``branch`` keep
+``info:frame_index``, which carries on from the restored state, but the older
+frames of the stack are only kept by ``FrameStacker``: mirror these calls
+with its ``snapshot``, ``restore`` and ``branch``, e.g. save its snapshot
+together with ``save_state`` and restore it right after ``load_state``.
+"""
+
+from typing import Optional
+
+import numpy as np
+
+
+def stack_frames(
+  frames: np.ndarray, frame_index: np.ndarray, stack_num: int
+) -> np.ndarray:
+  """Stack the frames of one env's trajectory with a single gather.
+
+  :param frames: the obs received from one env, in order, ``(T, C, H, W)``.
+  :param frame_index: their ``info:frame_index``, ``(T,)``; the trajectory
+    starts at a reset, i.e. ``frame_index[0] == 0``.
+  :param stack_num: the ``stack_num`` of the env.
+
+  :return: the stacked observations, ``(T, stack_num * C, H, W)``.
+  """
+  frame_index = np.asarray(frame_index, dtype=np.int64)
+  if len(frame_index) > 0 and frame_index[0] != 0:
+    raise ValueError("the trajectory should start with frame_index 0")
+  rows = np.arange(len(frame_index))
+  # a row brings a new frame unless it repeats the previous frame index, like
+  # the state after the last frame of a ViZDoom episode
+  new = np.ones(len(frame_index), dtype=bool)
+  new[1:] = (frame_index[1:] != frame_index[:-1]) | (frame_index[1:] == 0)
+  frame_rows = rows[new]
+  ordinal = np.cumsum(new) - 1
+  # ordinal of frame 0 of each row's stack
+  start = np.maximum.accumulate(np.where(frame_index == 0, ordinal, 0))
+  offset = frame_index[:, None] + np.arange(1 - stack_num, 1)
+  stacked = frames[frame_rows[start[:, None] + np.maximum(offset, 0)]]
+  return stacked.reshape(
+    (len(frame_index), stack_num * frames.shape[1]) + frames.shape[2:]
+  )
+
+
+class FrameStacker:
+  """Keep the last ``stack_num`` frames of each env to stack received obs.
+
+  ::
+
+    stacker = FrameStacker(num_envs, stack_num, env.observation_space.shape)
+    obs, rew, term, trunc, info = env.step(action, env_id)
+    obs = stacker(obs, info["env_id"], info["frame_index"])
+  """
+
+  def __init__(
+    self,
+    num_envs: int,
+    stack_num: int,
+    frame_shape: tuple,
+    dtype: np.dtype = np.uint8,
+  ) -> None:
+    self._stack_num = stack_num
+    self._frame_shape = tuple(frame_shape)
+    # frame i of env e is in ring[e, i % stack_num]
+    self._ring = np.zeros((num_envs, stack_num) + self._frame_shape, dtype)
+
+  def __call__(
+    self,
+    frames: np.ndarray,
+    env_id: np.ndarray,
+    frame_index: np.ndarray,
+    out: Optional[np.ndarray] = None,
+  ) -> np.ndarray:
+    """Push a batch of obs and return their stacks.
+
+    :param frames: a received obs batch, ``(B, C, H, W)``.
+    :param env_id: ``info:env_id`` of the batch, ``(B,)``.
+    :param frame_index: ``info:frame_index`` of the batch, ``(B,)``.
+    :param out: optional buffer of shape ``(B, stack_num * C, H, W)``.
+    """
+    env_id = np.asarray(env_id)
+    frame_index = np.asarray(frame_index, dtype=np.int64)
+    slot = frame_index % self._stack_num
+    reset = frame_index == 0
+    # a reset fills the whole stack with its frame
+    self._ring[env_id[reset]] = frames[reset][:, None]
+    self._ring[env_id, slot] = frames
+    offset = np.arange(1, self._stack_num + 1)
+    slots = (frame_index[:, None] + offset) % self._stack_num
+    stacked = self._ring[env_id[:, None], slots]
+    shape = (len(env_id), self._stack_num * self._frame_shape[0])
+    shape += self._frame_shape[1:]
+    if out is None:
+      return stacked.reshape(shape)
+    out[...] = stacked.reshape(shape)
+    return out
+
+  def snapshot(self, env_id: np.ndarray) -> np.ndarray:
+    """Copy the frames kept for env_id, to restore along with the envs.
+
+    :return: the frames, ``(len(env_id), stack_num, C, H, W)``.
+    """
+    return self._ring[np.asarray(env_id)].copy()
+
+  def restore(self, frames: np.ndarray, env_id: np.ndarray) -> None:
+    """Put back frames from snapshot for the restored env_id."""
+    self._ring[np.asarray(env_id)] = frames
+
+  def branch(self, src_env_id: int, dst_env_ids: np.ndarray) -> None:
+    """Copy the frames of src_env_id to dst_env_ids, like EnvPool.branch."""
+    self._ring[np.asarray(dst_env_ids)] = self._ring[src_env_id]
@@ -0,0 +1,116 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Unit tests for rebuilding stacked observations from deduplicated frames."""
+
+from collections import deque
+from typing import List, Tuple
+
+import numpy as np
+from absl.testing import absltest
+
+from envpool.python.frame_stack import FrameStacker, stack_frames
+
+
+def _simulate(
+  num_steps: int, stack_num: int, seed: int
+) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+  """Frame stacking of one env the way the C++ envs do it.
+
+  Returns the newest frames, their frame index and the reference stacks.
+  """
+  rng = np.random.default_rng(seed)
+  stack: deque = deque(maxlen=stack_num)
+  frames: List[np.ndarray] = []
+  index: List[int] = []
+  stacks: List[np.ndarray] = []
+  frame_index = 0
+  for t in range(num_steps):
+    frame = rng.integers(0, 256, size=(2, 3, 4), dtype=np.uint8)
+    # a reset fills the stack, an episodic-life reset keeps it
+    push_all = t == 0 or rng.random() < 0.1
+    if push_all:
+      stack.extend([frame] * stack_num)
+      frame_index = 0
+    else:
+      stack.append(frame)
+      frame_index += 1
+    frames.append(frame)
+    index.append(frame_index)
+    stacks.append(np.concatenate(list(stack)))
+    if rng.random() < 0.05:
+      # the last state of a ViZDoom episode repeats the newest frame
+      frames.append(frame)
+      index.append(frame_index)
+      stacks.append(stacks[-1])
+  return np.stack(frames), np.array(index), np.stack(stacks)
+
+
+class _FrameStackTest(absltest.TestCase):
+
+  def test_stack_frames(self) -> None:
+    for stack_num in [1, 2, 4]:
+      frames, index, ref = _simulate(200, stack_num, stack_num)
+      stacked = stack_frames(frames, index, stack_num)
+      self.assertEqual(stacked.shape, (len(frames), stack_num * 2, 3, 4))
+      np.testing.assert_array_equal(stacked, ref)
+    with self.assertRaises(ValueError):
+      stack_frames(frames[1:], index[1:] + 1, 4)
+
+  def test_frame_stacker(self) -> None:
+    num_envs, stack_num = 3, 4
+    trajectories = [_simulate(100, stack_num, seed) for seed in range(3)]
+    stacker = FrameStacker(num_envs, stack_num, (2, 3, 4))
+    pos = [0] * num_envs
+    rng = np.random.default_rng(0)
+    while True:
+      env_id = np.array(
+        [
+          e for e in range(num_envs)
+          if pos[e] < len(trajectories[e][0]) and rng.random() < 0.7
+        ]
+      )
+      if all(pos[e] == len(trajectories[e][0]) for e in range(num_envs)):
+        break
+      if len(env_id) == 0:
+        continue
+      frames = np.stack([trajectories[e][0][pos[e]] for e in env_id])
+      index = np.array([trajectories[e][1][pos[e]] for e in env_id])
+      ref = np.stack([trajectories[e][2][pos[e]] for e in env_id])
+      out = np.empty_like(ref)
+      np.testing.assert_array_equal(stacker(frames, env_id, index, out), ref)
+      for e in env_id:
+        pos[e] += 1
+
+  def test_frame_stacker_restore(self) -> None:
+    stack_num = 4
+    frames, index, ref = _simulate(100, stack_num, 0)
+    stacker = FrameStacker(2, stack_num, (2, 3, 4))
+
+    def push(env_id: int, t: int) -> np.ndarray:
+      return stacker(frames[t:t + 1], np.array([env_id]), index[t:t + 1])[0]
+
+    for t in range(50):
+      push(0, t)
+    saved = stacker.snapshot(np.array([0]))
+    for t in range(50, 60):
+      push(0, t)
+    stacker.restore(saved, np.array([0]))
+    stacker.branch(0, np.array([1]))
+    for t in range(50, 100):
+      np.testing.assert_array_equal(push(0, t), ref[t])
+      np.testing.assert_array_equal(push(1, t), ref[t])
+
+
+if __name__ == "__main__":
+  absltest.main()
@@ -157,6 +157,49 @@ class EnvPool(Protocol):
   def _reset(self, env_id: np.ndarray) -> None:
     """Cpp private _reset method."""
 
+  def _save_state(self, path: str) -> None:
+    """Cpp private _save_state method."""
+
+  def _load_state(self, path: str) -> None:
+    """Cpp private _load_state method."""
+
+  def _snapshot(self, env_id: np.ndarray) -> List[int]:
+    """Cpp private _snapshot method."""
+
+  def _restore(self, env_id: np.ndarray, handles: np.ndarray) -> None:
+    """Cpp private _restore method."""
+
+  def _release_snapshot(self, handles: np.ndarray) -> None:
+    """Cpp private _release_snapshot method."""
+
+  def _branch(self, src_env_id: int, dst_env_ids: np.ndarray) -> None:
+    """Cpp private _branch method."""
+
+  def _collect_begin(self, num_episodes: int) -> None:
+    """Cpp private _collect_begin method."""
+
+  def _collect_active(self) -> int:
+    """Cpp private _collect_active method."""
+
+  def _collect_end(self) -> Tuple[np.ndarray, np.ndarray]:
+    """Cpp private _collect_end method."""
+
+  def _serve_shm(
+    self, name: str, client_num_envs: List[int], client_batch_size: List[int]
+  ) -> None:
+    """Cpp private _serve_shm method."""
+
+  def _stop_shm(self) -> None:
+    """Cpp private _stop_shm method."""
+
+  def _record_begin(
+    self, path: str, compress: bool, num_threads: int, max_backlog: int
+  ) -> None:
+    """Cpp private _record_begin method."""
+
+  def _record_end(self) -> None:
+    """Cpp private _record_end method."""
+
   def _from(
     self,
     action: Union[Dict[str, Any], np.ndarray],
@@ -231,5 +274,57 @@ class EnvPool(Protocol):
   ) -> Union[TimeStep, Tuple]:
     """Envpool reset interface."""
 
+  def save_state(self, path: str) -> None:
+    """Envpool checkpoint interface."""
+
+  def load_state(self, path: str) -> Optional[Union[TimeStep, Tuple]]:
+    """Envpool restore interface."""
+
+  def snapshot(self, env_id: Optional[np.ndarray] = None) -> np.ndarray:
+    """Envpool in-memory snapshot interface."""
+
+  def restore(
+    self,
+    handles: np.ndarray,
+    env_id: Optional[np.ndarray] = None,
+  ) -> None:
+    """Envpool in-memory restore interface."""
+
+  def release_snapshot(self, handles: np.ndarray) -> None:
+    """Envpool snapshot release interface."""
+
+  def branch(self, src_env_id: int, dst_env_ids: np.ndarray) -> None:
+    """Envpool branching interface."""
+
+  def collect_episodes(
+    self,
+    num_episodes: int,
+    policy: Callable[[Union[TimeStep, Tuple]], Any],
+  ) -> Tuple[np.ndarray, np.ndarray]:
+    """Envpool episode collection interface."""
+
+  def serve_shm(
+    self,
+    name: str,
+    client_num_envs: List[int],
+    client_batch_size: Optional[List[int]] = None,
+  ) -> None:
+    """Envpool shared memory server interface."""
+
+  def stop_shm(self) -> None:
+    """Envpool shared memory server interface."""
+
+  def record(
+    self,
+    path: str,
+    compress: bool = False,
+    num_threads: int = 2,
+    max_backlog_mb: int = 1024,
+  ) -> None:
+    """Envpool trajectory recording interface."""
+
+  def stop_record(self) -> None:
+    """Envpool trajectory recording interface."""
+
   def xla(self) -> Tuple[Any, Callable, Callable, Callable]:
     """Get the xla functions."""
@@ -0,0 +1,77 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Reader of the trajectories written by ``EnvPool.record``.
+
+A recording is a directory with one file per column and a ``meta.json``
+describing them. Raw columns are memory-mapped, zlib columns are chunks of
+one batch each (uint64 rows, uint64 bytes, compressed rows) and are
+decompressed into memory.
+"""
+
+import json
+import os
+import struct
+import zlib
+from typing import Dict
+
+import numpy as np
+
+_CHUNK = struct.Struct("<QQ")
+
+
+def _load_chunks(path: str, dtype: np.dtype, shape: tuple) -> np.ndarray:
+  with open(path, "rb") as f:
+    data = f.read()
+  chunks, pos = [], 0
+  while pos < len(data):
+    rows, nbytes = _CHUNK.unpack_from(data, pos)
+    pos += _CHUNK.size
+    chunk = zlib.decompress(data[pos:pos + nbytes])
+    chunks.append(np.frombuffer(chunk, dtype=dtype).reshape((rows,) + shape))
+    pos += nbytes
+  if not chunks:
+    return np.zeros((0,) + shape, dtype=dtype)
+  return np.concatenate(chunks)
+
+
+def load_recording(path: str) -> Dict[str, np.ndarray]:
+  """Load all columns of a recording, keyed by column name.
+
+  State columns are named ``state.<key>`` and have one row per received
+  state, ``state.episode_id`` gives their episode. Action columns are named
+  ``action.<key>`` and have one row per sent action, ``action.state_row``
+  gives the state row each action responds to (-1 if none). The episode
+  index is in ``episodes.env_id``, ``episodes.first_row``,
+  ``episodes.last_row`` (-1 if unfinished), ``episodes.length`` and
+  ``episodes.return``.
+  """
+  with open(os.path.join(path, "meta.json")) as f:
+    meta = json.load(f)
+  columns = {}
+  for column in meta["columns"]:
+    file = os.path.join(path, column["file"])
+    dtype = np.dtype(column["dtype"])
+    shape = tuple(column["shape"])
+    if column["compression"] == "zlib":
+      columns[column["name"]] = _load_chunks(file, dtype, shape)
+      continue
+    row_size = dtype.itemsize * int(np.prod(shape, dtype=np.int64))
+    num_rows = os.path.getsize(file) // row_size if row_size > 0 else 0
+    if num_rows == 0:
+      columns[column["name"]] = np.zeros((0,) + shape, dtype=dtype)
+    else:
+      columns[column["name"]] = np.memmap(
+        file, dtype=dtype, mode="r", shape=(num_rows,) + shape
+      )
+  return columns
@@ -0,0 +1,329 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Remote EnvPool over TCP.
+
+The server hosts one pool per connection, created from the task id and
+kwargs sent by the client, which may not set the configs that write files.
+The client implements the private ``_send``, ``_recv`` and ``_reset`` of a
+pool over the socket, and is wrapped by the same dm / gym / gymnasium meta
+classes as a local pool. Run a server with
+::
+
+  python -m envpool.python.remote --port 5555
+
+and connect to it with ``envpool.make_remote(task_id, "host:5555", ...)``.
+The server only listens on localhost unless given ``--host``, e.g.
+``--host 0.0.0.0`` on a trusted network.
+
+Every message is a 9-byte header (uint8 type, uint64 payload size) followed by the
+payload. A batch of arrays is encoded as
+::
+
+  uint32 number of arrays
+  per array: uint8 len(dtype) | dtype | uint8 ndim | int64 shape[ndim]
+             | uint8 codec | uint64 nbytes | data
+
+uint8 arrays of the states are zlib-compressed if the client asks for it.
+"""
+
+import argparse
+import json
+import queue
+import socket
+import struct
+import threading
+import zlib
+from typing import Any, Dict, List, Optional, Tuple
+
+import numpy as np
+
+# client -> server
+_HELLO, _SEND, _RESET, _RECV, _CLOSE = range(5)
+# server -> client
+_READY, _ERROR, _STATE = range(5, 8)
+
+_HEADER = struct.Struct("<BQ")
+_COUNT = struct.Struct("<I")
+_CODEC = struct.Struct("<BQ")
+_RAW, _ZLIB = range(2)
+# configs that make the server write files where the client asks
+_FILE_WRITING_KWARGS = ("video_", "lmp_save_dir")
+
+
+def _recv_exact(sock: socket.socket, size: int) -> bytearray:
+  buf = bytearray(size)
+  view = memoryview(buf)
+  pos = 0
+  while pos < size:
+    n = sock.recv_into(view[pos:], size - pos)
+    if n == 0:
+      raise ConnectionError("remote envpool: connection closed")
+    pos += n
+  return buf
+
+
+def send_message(
+  sock: socket.socket, msg_type: int, buffers: List[Any]
+) -> None:
+  """Send a message made of several buffers, without joining them."""
+  size = sum(memoryview(b).nbytes for b in buffers)
+  sock.sendall(_HEADER.pack(msg_type, size))
+  for b in buffers:
+    sock.sendall(b)
+
+
+def recv_message(sock: socket.socket) -> Tuple[int, bytearray]:
+  """Receive a message, return its type and payload."""
+  msg_type, size = _HEADER.unpack(_recv_exact(sock, _HEADER.size))
+  return msg_type, _recv_exact(sock, size)
+
+
+def encode_arrays(arrays: List[np.ndarray], compress: bool) -> List[Any]:
+  """Encode a batch of arrays into a list of buffers."""
+  buffers: List[Any] = [_COUNT.pack(len(arrays))]
+  for a in arrays:
+    a = np.asarray(a, order="C")
+    if a.dtype == object:
+      raise TypeError("remote envpool: object arrays are not supported")
+    dtype = a.dtype.str.encode()
+    meta = struct.pack(f"<B{len(dtype)}sB{a.ndim}q", len(dtype), dtype, a.ndim,
+                       *a.shape)
+    data: Any = a.reshape(-1).view(np.uint8)
+    codec = _RAW
+    if compress and a.dtype == np.uint8:
+      data = zlib.compress(data, 1)
+      codec = _ZLIB
+    buffers += [meta, _CODEC.pack(codec, len(data)), data]
+  return buffers
+
+
+def decode_arrays(payload: bytearray) -> List[np.ndarray]:
+  """Decode what encode_arrays produced, raw data is used in place."""
+  view = memoryview(payload)
+  (count,), pos = _COUNT.unpack_from(view), _COUNT.size
+  arrays = []
+  for _ in range(count):
+    dtype_len = view[pos]
+    dtype = np.dtype(bytes(view[pos + 1:pos + 1 + dtype_len]).decode())
+    pos += 1 + dtype_len
+    ndim = view[pos]
+    shape = struct.unpack_from(f"<{ndim}q", view, pos + 1)
+    pos += 1 + 8 * ndim
+    codec, nbytes = _CODEC.unpack_from(view, pos)
+    pos += _CODEC.size
+    data = view[pos:pos + nbytes]
+    pos += nbytes
+    if codec == _ZLIB:
+      data = bytearray(zlib.decompress(data))
+    arrays.append(np.frombuffer(data, dtype=dtype).reshape(shape))
+  return arrays
+
+
+class RemoteEnvPool:
+  """Client side of a remote pool, wrapped by the EnvPool meta classes.
+
+  Up to ``pipeline`` recv requests are kept in flight, so that the states of
+  a batch are already on the way when recv is called. Only the batches that
+  the envs sent or reset so far are sure to fill are requested ahead, one per
+  batch_size of them, since a request blocks the server until its batch is
+  ready; a recv that finds none in flight requests its own.
+  """
+
+  _spec: Any
+
+  def __init__(self, spec: Any) -> None:
+    """Only keep the spec, the pool is created by _connect."""
+    self._spec = spec
+    self._sock: Optional[socket.socket] = None
+    self._pending = 0
+    self._pipeline = 1
+    # envs sent or reset whose batch is not requested yet
+    self._unrequested = 0
+
+  def _connect(
+    self, address: str, task_id: str, env_type: str, kwargs: Dict[str, Any],
+    compress: bool, pipeline: int
+  ) -> None:
+    host, port = address.rsplit(":", 1)
+    self._sock = socket.create_connection((host, int(port)))
+    self._sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    self._pipeline = max(pipeline, 1)
+    self._batch_size = self.config["batch_size"] or self.config["num_envs"]
+    self._env_id_index = self._spec._action_keys.index("env_id")
+    hello = {
+      "task_id": task_id,
+      "env_type": env_type,
+      "kwargs": kwargs,
+      "compress": compress,
+    }
+    send_message(self._sock, _HELLO, [json.dumps(hello).encode()])
+    msg_type, payload = recv_message(self._sock)
+    if msg_type == _ERROR:
+      self.close()
+      raise RuntimeError(f"remote envpool: {payload.decode()}")
+
+  def _request_recv(self) -> None:
+    assert self._sock is not None, "remote envpool is closed"
+    send_message(self._sock, _RECV, [])
+    self._pending += 1
+    self._unrequested = max(self._unrequested - self._batch_size, 0)
+
+  def _prefetch(self) -> None:
+    while (
+      self._pending < self._pipeline and
+      self._unrequested >= self._batch_size
+    ):
+      self._request_recv()
+
+  def _send(self, action: List[np.ndarray]) -> None:
+    assert self._sock is not None, "remote envpool is closed"
+    send_message(self._sock, _SEND, encode_arrays(action, False))
+    self._unrequested += len(action[self._env_id_index])
+    self._prefetch()
+
+  def _reset(self, env_id: np.ndarray) -> None:
+    assert self._sock is not None, "remote envpool is closed"
+    env_id = np.asarray(env_id, dtype=np.int32)
+    send_message(self._sock, _RESET, encode_arrays([env_id], False))
+    self._unrequested += len(env_id)
+    self._prefetch()
+
+  def _recv(self) -> List[np.ndarray]:
+    assert self._sock is not None, "remote envpool is closed"
+    if self._pending == 0:
+      self._request_recv()
+    msg_type, payload = recv_message(self._sock)
+    self._pending -= 1
+    if msg_type == _ERROR:
+      raise RuntimeError(f"remote envpool: {payload.decode()}")
+    self._prefetch()
+    return decode_arrays(payload)
+
+  def close(self) -> None:
+    """Close the connection, the server drops the pool."""
+    if self._sock is not None:
+      try:
+        send_message(self._sock, _CLOSE, [])
+      except OSError:
+        pass
+      self._sock.close()
+      self._sock = None
+
+  def __del__(self) -> None:
+    """Close the connection."""
+    self.close()
+
+
+class RemoteServer:
+  """Serve remote pools, one per connection, on host:port."""
+
+  def __init__(self, host: str = "127.0.0.1", port: int = 5555) -> None:
+    """Bind the listening socket, port 0 picks a free port."""
+    self._listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    self._listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    self._listener.bind((host, port))
+    self._listener.listen()
+    self.address = "%s:%d" % self._listener.getsockname()[:2]
+    self._closed = False
+
+  def serve_forever(self) -> None:
+    """Accept connections until shutdown."""
+    while not self._closed:
+      try:
+        sock, _ = self._listener.accept()
+      except OSError:
+        break
+      sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+      threading.Thread(target=self._handle, args=(sock,), daemon=True).start()
+
+  def shutdown(self) -> None:
+    """Stop accepting connections."""
+    self._closed = True
+    self._listener.close()
+
+  @staticmethod
+  def _handle(sock: socket.socket) -> None:
+    import envpool
+
+    try:
+      msg_type, payload = recv_message(sock)
+      assert msg_type == _HELLO
+      hello = json.loads(payload.decode())
+      for key in hello["kwargs"]:
+        if key.startswith(_FILE_WRITING_KWARGS):
+          raise ValueError(f"{key} is not allowed on a remote pool")
+      pool = envpool.make(
+        hello["task_id"], env_type=hello["env_type"], **hello["kwargs"]
+      )
+    except Exception as e:
+      send_message(sock, _ERROR, [repr(e).encode()])
+      sock.close()
+      return
+    send_message(sock, _READY, [])
+    compress = hello["compress"]
+    # a recv blocks until its batch is ready, so it runs on its own thread
+    # and never holds back the sends that it is waiting for
+    requests: queue.Queue = queue.Queue()
+    lock = threading.Lock()
+
+    def reply() -> None:
+      while requests.get():
+        try:
+          buffers = encode_arrays(pool._recv(), compress)
+          msg_type = _STATE
+        except Exception as e:
+          buffers, msg_type = [repr(e).encode()], _ERROR
+        try:
+          with lock:
+            send_message(sock, msg_type, buffers)
+        except OSError:
+          break
+
+    replier = threading.Thread(target=reply, daemon=True)
+    replier.start()
+    try:
+      while True:
+        msg_type, payload = recv_message(sock)
+        if msg_type == _SEND:
+          pool._send(decode_arrays(payload))
+        elif msg_type == _RESET:
+          pool._reset(decode_arrays(payload)[0])
+        elif msg_type == _RECV:
+          requests.put(True)
+        else:
+          break
+    except Exception as e:
+      try:
+        with lock:
+          send_message(sock, _ERROR, [repr(e).encode()])
+      except OSError:
+        pass
+    requests.put(False)
+    replier.join()
+    sock.close()
+
+
+def main() -> None:
+  """Command line entry of the server."""
+  parser = argparse.ArgumentParser()
+  parser.add_argument("--host", type=str, default="127.0.0.1")
+  parser.add_argument("--port", type=int, default=5555)
+  args = parser.parse_args()
+  server = RemoteServer(args.host, args.port)
+  print(f"EnvPool remote server on {server.address}")
+  server.serve_forever()
+
+
+if __name__ == "__main__":
+  main()
@@ -30,6 +30,8 @@ class EnvRegistry:
     """Constructor of EnvRegistry."""
     self.specs: Dict[str, Tuple[str, str, Dict[str, Any]]] = {}
     self.envpools: Dict[str, Dict[str, Tuple[str, str]]] = {}
+    self.shm_clients: Dict[Any, Any] = {}
+    self.remote_clients: Dict[Any, Any] = {}
 
   def register(
     self, task_id: str, import_path: str, spec_cls: str, dm_cls: str,
@@ -48,6 +50,71 @@ class EnvRegistry:
 
   def make(self, task_id: str, env_type: str, **kwargs: Any) -> Any:
     """Make envpool."""
+    spec, envpool_cls = self._make_spec_and_cls(task_id, env_type, kwargs)
+    return envpool_cls(spec)
+
+  def connect_shm(
+    self,
+    task_id: str,
+    name: str,
+    client_id: int,
+    env_type: str = "gym",
+    **kwargs: Any
+  ) -> Any:
+    """Connect to a pool served by ``serve_shm`` in another process.
+
+    kwargs must match the server's, except num_envs and batch_size, which are
+    the ones of this client.
+    """
+    spec, envpool_cls = self._make_spec_and_cls(task_id, env_type, kwargs)
+    if envpool_cls not in self.shm_clients:
+      cpp_cls = envpool_cls.__bases__[0]
+      cpp_client_cls = getattr(
+        importlib.import_module(cpp_cls.__module__),
+        cpp_cls.__name__ + "ShmClient"
+      )
+      self.shm_clients[envpool_cls] = type(envpool_cls)(
+        envpool_cls.__name__.replace("EnvPool", "ShmEnvPool"),
+        (cpp_client_cls,), {}
+      )
+    env = self.shm_clients[envpool_cls](spec)
+    env._connect_shm(name, client_id)
+    return env
+
+  def make_remote(
+    self,
+    task_id: str,
+    address: str,
+    env_type: str = "gym",
+    compress: bool = False,
+    pipeline: int = 2,
+    **kwargs: Any
+  ) -> Any:
+    """Make an envpool hosted by a remote server at ``address``.
+
+    The server creates the pool from the same task_id and kwargs, which must
+    be JSON serializable. ``compress`` zlib-compresses uint8 states and
+    ``pipeline`` is the number of batches requested ahead of recv.
+    """
+    from envpool.python.remote import RemoteEnvPool
+
+    spec, envpool_cls = self._make_spec_and_cls(task_id, env_type, kwargs)
+    if envpool_cls not in self.remote_clients:
+      base = type(
+        "_RemoteEnvPool", (RemoteEnvPool,), {
+          "_state_keys": spec._state_keys,
+          "_action_keys": spec._action_keys,
+        }
+      )
+      self.remote_clients[envpool_cls] = type(envpool_cls)(
+        envpool_cls.__name__.replace("EnvPool", "RemoteEnvPool"), (base,), {}
+      )
+    env = self.remote_clients[envpool_cls](spec)
+    env._connect(address, task_id, env_type, kwargs, compress, pipeline)
+    return env
+
+  def _make_spec_and_cls(self, task_id: str, env_type: str,
+                         kwargs: Dict[str, Any]) -> Tuple[Any, Any]:
     new_gym_api = version.parse(gym.__version__) >= version.parse("0.26.0")
     if "gym_reset_return_info" not in kwargs:
       kwargs["gym_reset_return_info"] = new_gym_api
@@ -64,7 +131,7 @@ class EnvRegistry:
 
     spec = self.make_spec(task_id, **kwargs)
     import_path, envpool_cls = self.envpools[task_id][env_type]
-    return getattr(importlib.import_module(import_path), envpool_cls)(spec)
+    return spec, getattr(importlib.import_module(import_path), envpool_cls)
 
   def make_dm(self, task_id: str, **kwargs: Any) -> Any:
     """Make dm_env compatible envpool."""
@@ -112,4 +179,6 @@ make_dm = registry.make_dm
 make_gym = registry.make_gym
 make_gymnasium = registry.make_gymnasium
 make_spec = registry.make_spec
+connect_shm = registry.connect_shm
+make_remote = registry.make_remote
 list_all_envs = registry.list_all_envs
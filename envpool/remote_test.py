@@ -0,0 +1,110 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Test for envpool.make_remote over loopback."""
+
+import threading
+
+import numpy as np
+from absl.testing import absltest
+
+import envpool
+from envpool.python.remote import RemoteServer, decode_arrays, encode_arrays
+
+
+class _RemoteTest(absltest.TestCase):
+
+  def setUp(self) -> None:
+    self.server = RemoteServer("127.0.0.1", 0)
+    threading.Thread(target=self.server.serve_forever, daemon=True).start()
+
+  def tearDown(self) -> None:
+    self.server.shutdown()
+
+  def test_codec(self) -> None:
+    arrays = [
+      np.arange(6, dtype=np.int32).reshape(2, 3),
+      np.random.randint(0, 255, (4, 84, 84), dtype=np.uint8),
+      np.array([True, False]),
+      np.zeros((0, 2), dtype=np.float64),
+      np.array(1.5),
+    ]
+    for compress in [False, True]:
+      payload = b"".join(map(bytes, encode_arrays(arrays, compress)))
+      for a, b in zip(arrays, decode_arrays(bytearray(payload))):
+        self.assertEqual(a.dtype, b.dtype)
+        np.testing.assert_array_equal(a, b)
+    self.assertRaises(
+      TypeError, encode_arrays, [np.array([None], dtype=object)], False
+    )
+
+  def test_sync_same_as_local(self) -> None:
+    kwargs = {"num_envs": 4, "seed": 1}
+    local = envpool.make_dm("CartPole-v1", **kwargs)
+    remote = envpool.make_remote(
+      "CartPole-v1", self.server.address, env_type="dm", **kwargs
+    )
+    self.assertEqual(remote.observation_spec(), local.observation_spec())
+    np.testing.assert_allclose(
+      remote.reset().observation.obs,
+      local.reset().observation.obs,
+    )
+    for _ in range(300):
+      action = np.random.randint(2, size=4)
+      ts0, ts1 = local.step(action), remote.step(action)
+      np.testing.assert_allclose(ts0.observation.obs, ts1.observation.obs)
+      np.testing.assert_allclose(ts0.reward, ts1.reward)
+      np.testing.assert_array_equal(ts0.step_type, ts1.step_type)
+      np.testing.assert_array_equal(
+        ts0.observation.env_id, ts1.observation.env_id
+      )
+    remote.close()
+
+  def test_async(self) -> None:
+    num_envs, batch_size = 8, 3
+    remote = envpool.make_remote(
+      "CartPole-v1",
+      self.server.address,
+      env_type="dm",
+      compress=True,
+      pipeline=3,
+      num_envs=num_envs,
+      batch_size=batch_size,
+    )
+    remote.async_reset()
+    # the two batches that the 8 reset envs fill are requested ahead
+    self.assertEqual(remote._pending, 2)
+    steps = np.zeros(num_envs, dtype=np.int64)
+    for _ in range(500):
+      ts = remote.recv()
+      env_id = ts.observation.env_id
+      self.assertEqual(len(env_id), batch_size)
+      steps[env_id] += 1
+      remote.send(np.random.randint(2, size=batch_size), env_id)
+    self.assertEqual(steps.sum(), 500 * batch_size)
+    remote.close()
+
+  def test_reject_file_writing_kwargs(self) -> None:
+    self.assertRaisesRegex(
+      RuntimeError,
+      "video_path",
+      envpool.make_remote,
+      "CartPole-v1",
+      self.server.address,
+      num_envs=1,
+      video_path="/tmp/envpool_remote_video",
+    )
+
+
+if __name__ == "__main__":
+  absltest.main()
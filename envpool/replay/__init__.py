@@ -0,0 +1,42 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Replay of recorded trajectories in EnvPool."""
+
+from envpool.python.api import py_env
+
+from .replay_envpool import (
+  _ReplayEnvPool,
+  _ReplayEnvSpec,
+  _ReplayFloatEnvPool,
+  _ReplayFloatEnvSpec,
+)
+
+(ReplayEnvSpec, ReplayDMEnvPool, ReplayGymEnvPool,
+ ReplayGymnasiumEnvPool) = py_env(_ReplayEnvSpec, _ReplayEnvPool)
+
+(
+  ReplayFloatEnvSpec, ReplayFloatDMEnvPool, ReplayFloatGymEnvPool,
+  ReplayFloatGymnasiumEnvPool
+) = py_env(_ReplayFloatEnvSpec, _ReplayFloatEnvPool)
+
+__all__ = [
+  "ReplayEnvSpec",
+  "ReplayDMEnvPool",
+  "ReplayGymEnvPool",
+  "ReplayGymnasiumEnvPool",
+  "ReplayFloatEnvSpec",
+  "ReplayFloatDMEnvPool",
+  "ReplayFloatGymEnvPool",
+  "ReplayFloatGymnasiumEnvPool",
+]
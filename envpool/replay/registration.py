@@ -0,0 +1,34 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Replay env registration."""
+
+from envpool.registration import register
+
+register(
+  task_id="Replay-v0",
+  import_path="envpool.replay",
+  spec_cls="ReplayEnvSpec",
+  dm_cls="ReplayDMEnvPool",
+  gym_cls="ReplayGymEnvPool",
+  gymnasium_cls="ReplayGymnasiumEnvPool",
+)
+
+register(
+  task_id="ReplayFloat-v0",
+  import_path="envpool.replay",
+  spec_cls="ReplayFloatEnvSpec",
+  dm_cls="ReplayFloatDMEnvPool",
+  gym_cls="ReplayFloatGymEnvPool",
+  gymnasium_cls="ReplayFloatGymnasiumEnvPool",
+)
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_REPLAY_REPLAY_ENV_H_
+#define ENVPOOL_REPLAY_REPLAY_ENV_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "envpool/core/async_envpool.h"
+#include "envpool/core/env.h"
+#include "envpool/core/recorder.h"
+
+namespace replay {
+
+/**
+ * A recording and the index of its finished episodes: the state rows of
+ * episode e are rows[offsets[e]:offsets[e + 1]].
+ */
+class ReplayData {
+ public:
+  Recording recording;
+  std::vector<int64_t> rows, offsets, episode_ids;
+  // action row responding to each state row, -1 if none
+  std::vector<int64_t> action_rows;
+
+  explicit ReplayData(const std::string& path) : recording(path) {
+    const auto& last_row = recording.Get("episodes.last_row");
+    const auto* last = reinterpret_cast<const int64_t*>(last_row.data);
+    std::vector<int64_t> finished(last_row.num_rows, -1);
+    for (std::size_t e = 0; e < last_row.num_rows; ++e) {
+      if (last[e] >= 0) {
+        finished[e] = static_cast<int64_t>(episode_ids.size());
+        episode_ids.push_back(static_cast<int64_t>(e));
+      }
+    }
+    const auto& episode_id = recording.Get("state.episode_id");
+    const auto* episode = reinterpret_cast<const int64_t*>(episode_id.data);
+    offsets.assign(episode_ids.size() + 1, 0);
+    for (std::size_t r = 0; r < episode_id.num_rows; ++r) {
+      if (finished[episode[r]] >= 0) {
+        ++offsets[finished[episode[r]] + 1];
+      }
+    }
+    for (std::size_t e = 0; e < episode_ids.size(); ++e) {
+      offsets[e + 1] += offsets[e];
+    }
+    rows.resize(offsets.back());
+    std::vector<int64_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t r = 0; r < episode_id.num_rows; ++r) {
+      if (finished[episode[r]] >= 0) {
+        rows[fill[finished[episode[r]]]++] = static_cast<int64_t>(r);
+      }
+    }
+    action_rows.assign(episode_id.num_rows, -1);
+    const auto& state_row = recording.Get("action.state_row");
+    const auto* responds = reinterpret_cast<const int64_t*>(state_row.data);
+    for (std::size_t a = 0; a < state_row.num_rows; ++a) {
+      if (responds[a] >= 0) {
+        action_rows[responds[a]] = static_cast<int64_t>(a);
+      }
+    }
+  }
+
+  [[nodiscard]] std::size_t NumEpisodes() const { return episode_ids.size(); }
+};
+
+/**
+ * Recordings are opened and indexed once per process, then shared read-only
+ * by the specs and all envs.
+ */
+inline std::shared_ptr<const ReplayData> LoadReplayData(
+    const std::string& path) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const ReplayData>> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = cache.find(path);
+  if (it == cache.end()) {
+    it = cache.emplace(path, std::make_shared<const ReplayData>(path)).first;
+  }
+  return it->second;
+}
+
+inline std::vector<int> ColumnShape(const std::string& path,
+                                    const std::string& key) {
+  if (path.empty() || key.empty()) {
+    return {0};
+  }
+  return LoadReplayData(path)->recording.Get(key).shape;
+}
+
+template <typename T>
+void CastRow(const char* src, float* dst, std::size_t n) {
+  const T* data = reinterpret_cast<const T*>(src);
+  for (std::size_t i = 0; i < n; ++i) {
+    dst[i] = static_cast<float>(data[i]);
+  }
+}
+
+using RowCastFn = void (*)(const char*, float*, std::size_t);
+
+inline RowCastFn RowCaster(const std::string& dtype) {
+  static const std::map<std::string, RowCastFn> kCasters{
+      {"bool", CastRow<bool>},       {"uint8", CastRow<uint8_t>},
+      {"int8", CastRow<int8_t>},     {"int16", CastRow<int16_t>},
+      {"int32", CastRow<int32_t>},   {"int64", CastRow<int64_t>},
+      {"float32", CastRow<float>},   {"float64", CastRow<double>},
+  };
+  auto it = kCasters.find(dtype);
+  if (it == kCasters.end()) {
+    throw std::runtime_error("Replay: unsupported dtype " + dtype);
+  }
+  return it->second;
+}
+
+template <typename Dtype>
+class ReplayEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() {
+    return MakeDict("path"_.Bind(std::string("")),
+                    "obs_key"_.Bind(std::string("state.obs")),
+                    "action_key"_.Bind(std::string("action.action")),
+                    "readahead"_.Bind(16));
+  }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict(
+        "obs"_.Bind(Spec<Dtype>(ColumnShape(conf["path"_], conf["obs_key"_]))),
+        "info:action"_.Bind(
+            Spec<float>(ColumnShape(conf["path"_], conf["action_key"_]))),
+        "info:episode"_.Bind(Spec<int>({})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1})));
+  }
+};
+
+template <typename Dtype>
+using ReplayEnvSpecT = EnvSpec<ReplayEnvFns<Dtype>>;
+
+/**
+ * Streams the finished episodes of a recording written by `record`. Env i
+ * plays episodes i, i + num_envs, ... in a loop, so num_envs envs give as
+ * many parallel streams. Actions are ignored; the recorded action that
+ * responded to each observation is returned as info:action. Observations
+ * are copied straight out of the memory-mapped column, and the rows coming
+ * next are prefetched with madvise every `readahead` steps.
+ *
+ * Dtype is the observation dtype: uint8 observations are copied as is, float
+ * observations of any recorded float or int dtype are cast to float32.
+ */
+template <typename Dtype>
+class ReplayEnv : public Env<ReplayEnvSpecT<Dtype>> {
+ protected:
+  using Base = Env<ReplayEnvSpecT<Dtype>>;
+  std::shared_ptr<const ReplayData> data_;
+  const Recording::Column *obs_, *action_, *reward_, *discount_, *trunc_;
+  RowCastFn cast_obs_{nullptr}, cast_action_{nullptr};
+  int64_t num_envs_, readahead_, next_episode_, episode_{0}, pos_{0}, end_{0};
+
+ public:
+  using Spec = ReplayEnvSpecT<Dtype>;
+
+  ReplayEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id),
+        num_envs_(spec.config["num_envs"_]),
+        readahead_(spec.config["readahead"_]),
+        next_episode_(env_id) {
+    const std::string& path = spec.config["path"_];
+    if (path.empty()) {
+      throw std::invalid_argument("Replay: path of a recording is required");
+    }
+    data_ = LoadReplayData(path);
+    if (data_->NumEpisodes() == 0) {
+      throw std::runtime_error("Replay: no finished episode in " + path);
+    }
+    const Recording& recording = data_->recording;
+    obs_ = &recording.Get(spec.config["obs_key"_]);
+    if (obs_->dtype != DtypeName<Dtype>()) {
+      if constexpr (std::is_same_v<Dtype, float>) {
+        cast_obs_ = RowCaster(obs_->dtype);
+      } else {
+        throw std::runtime_error("Replay: " + obs_->dtype +
+                                 " observations, use the task with matching "
+                                 "dtype");
+      }
+    }
+    const std::string& action_key = spec.config["action_key"_];
+    action_ = action_key.empty() ? nullptr : &recording.Get(action_key);
+    if (action_ != nullptr) {
+      cast_action_ = RowCaster(action_->dtype);
+    }
+    reward_ = &recording.Get("state.reward");
+    discount_ = &recording.Get("state.discount");
+    trunc_ = &recording.Get("state.trunc");
+  }
+
+  void Reset() override {
+    episode_ = next_episode_ % static_cast<int64_t>(data_->NumEpisodes());
+    next_episode_ += num_envs_;
+    pos_ = data_->offsets[episode_];
+    end_ = data_->offsets[episode_ + 1];
+    Prefetch(pos_);
+    WriteState();
+  }
+
+  void Step(const typename Base::Action& action) override {
+    ++pos_;
+    if (readahead_ > 0 && (pos_ - data_->offsets[episode_]) % readahead_ == 0) {
+      Prefetch(pos_);
+    }
+    WriteState();
+  }
+
+  bool IsDone() override { return pos_ + 1 >= end_; }
+
+ protected:
+  void Prefetch(int64_t from) {
+    int64_t to = std::min(from + readahead_, end_);
+    for (int64_t i = from; i < to; ++i) {
+      obs_->WillNeed(data_->rows[i]);
+    }
+  }
+
+  void WriteState() {
+    int64_t row = data_->rows[pos_];
+    auto state = this->Allocate();
+    state["reward"_] = *reinterpret_cast<const float*>(reward_->Row(row));
+    state["discount"_] = *reinterpret_cast<const float*>(discount_->Row(row));
+    state["trunc"_] = *reinterpret_cast<const bool*>(trunc_->Row(row));
+    state["info:episode"_] = static_cast<int>(data_->episode_ids[episode_]);
+    auto* obs = static_cast<char*>(state["obs"_].Data());
+    if (cast_obs_ == nullptr) {
+      std::memcpy(obs, obs_->Row(row), obs_->row_size);
+    } else {
+      cast_obs_(obs_->Row(row), reinterpret_cast<float*>(obs),
+                state["obs"_].size);
+    }
+    if (action_ != nullptr) {
+      auto* action = static_cast<float*>(state["info:action"_].Data());
+      int64_t action_row = data_->action_rows[row];
+      if (action_row >= 0) {
+        cast_action_(action_->Row(action_row), action,
+                     state["info:action"_].size);
+      } else {
+        std::fill(action, action + state["info:action"_].size, 0.0f);
+      }
+    }
+  }
+};
+
+using ReplayEnvSpec = ReplayEnvSpecT<uint8_t>;
+using ReplayEnvPool = AsyncEnvPool<ReplayEnv<uint8_t>>;
+using ReplayFloatEnvSpec = ReplayEnvSpecT<float>;
+using ReplayFloatEnvPool = AsyncEnvPool<ReplayEnv<float>>;
+
+}  // namespace replay
+
+#endif  // ENVPOOL_REPLAY_REPLAY_ENV_H_
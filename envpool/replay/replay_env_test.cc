@@ -0,0 +1,197 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/replay/replay_env.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+class SourceEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs"_.Bind(Spec<uint8_t>({2, 3})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1})));
+  }
+};
+
+using SourceEnvSpec = EnvSpec<SourceEnvFns>;
+
+// obs is (env_id, episode, step, ...), episode k of env i lasts i + k % 3 + 1
+// steps, reward is the action
+class SourceEnv : public Env<SourceEnvSpec> {
+ protected:
+  int episode_{-1}, step_{0};
+
+ public:
+  SourceEnv(const Spec& spec, int env_id)
+      : Env<SourceEnvSpec>(spec, env_id) {}
+
+  void Reset() override {
+    ++episode_;
+    step_ = 0;
+    WriteState(0.0f);
+  }
+
+  void Step(const Action& action) override {
+    ++step_;
+    WriteState(static_cast<float>(action["action"_][0]));
+  }
+
+  bool IsDone() override { return step_ >= env_id_ + episode_ % 3 + 1; }
+
+ protected:
+  void WriteState(float reward) {
+    auto state = Allocate();
+    state["reward"_] = reward;
+    auto* obs = static_cast<uint8_t*>(state["obs"_].Data());
+    obs[0] = env_id_;
+    obs[1] = episode_;
+    obs[2] = step_;
+    obs[3] = obs[4] = obs[5] = 7;
+  }
+};
+
+using SourceEnvPool = AsyncEnvPool<SourceEnv>;
+
+int ExpertAction(const uint8_t* obs) { return obs[0] * 100 + obs[2]; }
+
+std::vector<Array> MakeAction(const Array& env_id, const Array& obs) {
+  int n = static_cast<int>(env_id.Shape(0));
+  std::vector<Array> action{Array(Spec<int>({n})), Array(Spec<int>({n})),
+                            Array(Spec<int>({n}))};
+  const int* ids = static_cast<const int*>(env_id.Data());
+  const auto* data = static_cast<const uint8_t*>(obs.Data());
+  for (int i = 0; i < n; ++i) {
+    action[0][i] = ids[i];
+    action[1][i] = ids[i];
+    action[2][i] = ExpertAction(data + i * 6);
+  }
+  return action;
+}
+
+Array MakeEnvIds(int n) {
+  Array arr(Spec<int>({n}));
+  for (int i = 0; i < n; ++i) {
+    arr[i] = i;
+  }
+  return arr;
+}
+
+std::string Record(int num_envs, int batch_size, int num_batches,
+                   bool compress) {
+  char dir[] = "/tmp/envpool_replay_XXXXXX";
+  EXPECT_NE(mkdtemp(dir), nullptr);
+  auto config = SourceEnvSpec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = batch_size;
+  SourceEnvPool pool{SourceEnvSpec(config)};
+  pool.RecordBegin(dir, compress, 2, 1 << 20);
+  pool.Reset(MakeEnvIds(num_envs));
+  for (int s = 0; s < num_batches; ++s) {
+    auto state = pool.Recv();
+    pool.Send(MakeAction(state[0], state[8]));
+  }
+  pool.RecordEnd();
+  return dir;
+}
+
+template <typename Pool>
+Pool MakeReplay(const std::string& path, int num_envs, int batch_size) {
+  auto config = Pool::Spec::kDefaultConfig;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = batch_size;
+  config["path"_] = path;
+  config["readahead"_] = 2;
+  return Pool(typename Pool::Spec(config));
+}
+
+}  // namespace
+
+TEST(ReplayEnvTest, SameAsRecorded) {
+  std::string path = Record(3, 2, 300, true);
+  auto data = replay::LoadReplayData(path);
+  ASSERT_GT(data->NumEpisodes(), 10);
+  int num_envs = 4;
+  auto pool = MakeReplay<replay::ReplayEnvPool>(path, num_envs, 4);
+  EXPECT_EQ(pool.spec.state_spec["obs"_].shape, std::vector<int>({2, 3}));
+  EXPECT_EQ(pool.spec.state_spec["info:action"_].shape, std::vector<int>{});
+  pool.Reset(MakeEnvIds(num_envs));
+  std::vector<int> played(num_envs, 0);
+  std::vector<int> episode(num_envs, -1);
+  for (int s = 0; s < 200; ++s) {
+    auto state = pool.Recv();
+    const auto* obs = static_cast<const uint8_t*>(state[8].Data());
+    const auto* action = static_cast<const float*>(state[9].Data());
+    const int* episode_id = static_cast<const int*>(state[10].Data());
+    const int* elapsed = static_cast<const int*>(state[2].Data());
+    const bool* done = static_cast<const bool*>(state[3].Data());
+    const float* reward = static_cast<const float*>(state[4].Data());
+    for (int i = 0; i < num_envs; ++i) {
+      const uint8_t* o = obs + i * 6;
+      if (elapsed[i] == 0) {
+        // env i plays finished episodes i, i + num_envs, ...
+        int k = played[i]++ * num_envs + i;
+        episode[i] = static_cast<int>(
+            data->episode_ids[k % data->NumEpisodes()]);
+      }
+      EXPECT_EQ(episode_id[i], episode[i]);
+      EXPECT_EQ(o[2], elapsed[i]);
+      EXPECT_EQ(o[5], 7);
+      EXPECT_EQ(done[i], elapsed[i] == o[0] + o[1] % 3 + 1);
+      if (elapsed[i] > 0) {
+        EXPECT_EQ(reward[i], o[0] * 100 + o[2] - 1);
+      }
+      // the recorder also saw the action sent after the last step
+      EXPECT_EQ(action[i], ExpertAction(o));
+    }
+    pool.Send(MakeAction(state[0], state[8]));
+  }
+  std::filesystem::remove_all(path);
+}
+
+TEST(ReplayEnvTest, FloatObservations) {
+  std::string path = Record(2, 2, 50, false);
+  auto pool = MakeReplay<replay::ReplayFloatEnvPool>(path, 2, 2);
+  Array unused(Spec<uint8_t>({2, 2, 3}));
+  pool.Reset(MakeEnvIds(2));
+  for (int s = 0; s < 20; ++s) {
+    auto state = pool.Recv();
+    const auto* obs = static_cast<const float*>(state[8].Data());
+    const int* elapsed = static_cast<const int*>(state[2].Data());
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_EQ(obs[i * 6 + 2], static_cast<float>(elapsed[i]));
+      EXPECT_EQ(obs[i * 6 + 5], 7.0f);
+    }
+    pool.Send(MakeAction(state[0], unused));
+  }
+  std::filesystem::remove_all(path);
+}
+
+TEST(ReplayEnvTest, Errors) {
+  using Pool = replay::ReplayEnvPool;
+  EXPECT_THROW(MakeReplay<Pool>("", 1, 1), std::invalid_argument);
+  EXPECT_THROW(MakeReplay<Pool>("/nonexistent", 1, 1), std::runtime_error);
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "envpool/core/py_envpool.h"
+#include "envpool/replay/replay_env.h"
+
+using ReplayEnvSpec = PyEnvSpec<replay::ReplayEnvSpec>;
+using ReplayEnvPool = PyEnvPool<replay::ReplayEnvPool>;
+
+using ReplayFloatEnvSpec = PyEnvSpec<replay::ReplayFloatEnvSpec>;
+using ReplayFloatEnvPool = PyEnvPool<replay::ReplayFloatEnvPool>;
+
+PYBIND11_MODULE(replay_envpool, m) {
+  REGISTER(m, ReplayEnvSpec, ReplayEnvPool)
+  REGISTER(m, ReplayFloatEnvSpec, ReplayFloatEnvPool)
+}
@@ -0,0 +1,58 @@
+# Copyright 2023 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Unit tests for the replay env."""
+
+import shutil
+import tempfile
+
+import numpy as np
+from absl.testing import absltest
+
+import envpool.classic_control.registration  # noqa: F401
+import envpool.replay.registration  # noqa: F401
+from envpool.python.recording import load_recording
+from envpool.registration import make_gym
+
+
+class _ReplayEnvTest(absltest.TestCase):
+
+  def test_cartpole(self) -> None:
+    path = tempfile.mkdtemp()
+    num_envs = 4
+    env = make_gym("CartPole-v1", num_envs=num_envs, seed=0)
+    env.record(path)
+    obs, _ = env.reset()
+    for _ in range(300):
+      obs, _, _, _, _ = env.step((obs[:, 2] > 0).astype(np.int32))
+    env.stop_record()
+    data = load_recording(path)
+    self.assertGreater(np.sum(data["episodes.last_row"] >= 0), num_envs)
+
+    replay = make_gym("ReplayFloat-v0", path=path, num_envs=num_envs)
+    self.assertEqual(replay.observation_space.shape, (4,))
+    obs, info = replay.reset()
+    action = np.zeros(num_envs, dtype=np.int32)
+    for _ in range(100):
+      for i in range(num_envs):
+        rows = np.flatnonzero(data["state.episode_id"] == info["episode"][i])
+        row = rows[info["elapsed_step"][i]]
+        np.testing.assert_allclose(obs[i], data["state.obs"][row])
+        # the recorded policy pushed right when the pole leant right
+        self.assertEqual(info["action"][i], float(obs[i, 2] > 0))
+      obs, _, _, _, info = replay.step(action)
+    shutil.rmtree(path)
+
+
+if __name__ == "__main__":
+  absltest.main()
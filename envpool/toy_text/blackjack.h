@@ -62,6 +62,23 @@ class BlackjackEnv : public Env<BlackjackEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(done_);
+    writer->WriteVector(player_);
+    writer->WriteVector(dealer_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&done_);
+    reader->ReadVector(&player_);
+    reader->ReadVector(&dealer_);
+  }
+
   void Reset() override {
     player_.clear();
     player_.push_back(DrawCard());
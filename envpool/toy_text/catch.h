@@ -59,6 +59,25 @@ class CatchEnv : public Env<CatchEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(done_);
+    writer->Write(x_);
+    writer->Write(y_);
+    writer->Write(paddle_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&done_);
+    reader->Read(&x_);
+    reader->Read(&y_);
+    reader->Read(&paddle_);
+  }
+
   void Reset() override {
     x_ = 0;
     y_ = dist_(gen_);
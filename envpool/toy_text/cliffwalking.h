@@ -55,6 +55,23 @@ class CliffWalkingEnv : public Env<CliffWalkingEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(done_);
+    writer->Write(x_);
+    writer->Write(y_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&done_);
+    reader->Read(&x_);
+    reader->Read(&y_);
+  }
+
   void Reset() override {
     x_ = 3;
     y_ = 0;
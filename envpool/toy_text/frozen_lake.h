@@ -71,6 +71,25 @@ class FrozenLakeEnv : public Env<FrozenLakeEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(x_);
+    writer->Write(y_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&x_);
+    reader->Read(&y_);
+  }
+
   void Reset() override {
     x_ = y_ = 0;
     done_ = false;
@@ -66,6 +66,29 @@ class TaxiEnv : public Env<TaxiEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void SaveState(StateWriter* writer) override {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(x_);
+    writer->Write(y_);
+    writer->Write(s_);
+    writer->Write(t_);
+  }
+
+  void LoadState(StateReader* reader) override {
+    Restore(reader);
+    WriteState(0.0);
+  }
+
+  void Restore(StateReader* reader) override {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&x_);
+    reader->Read(&y_);
+    reader->Read(&s_);
+    reader->Read(&t_);
+  }
+
   void Reset() override {
     x_ = dist_loc_(gen_);
     y_ = dist_loc_(gen_);
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_AREA_RESIZE_H_
+#define ENVPOOL_UTILS_AREA_RESIZE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// The kernels below must do exactly the float operations of OpenCV, a
+// multiply and an add must not be contracted into an FMA.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// Clones of the kernels for each instruction set, picked at load time.
+#ifndef ENVPOOL_SIMD_CLONES
+#if defined(__x86_64__) && defined(__linux__) && \
+    (defined(__clang__) ? __clang_major__ >= 14 : __GNUC__ >= 8)
+#define ENVPOOL_SIMD_CLONES                                               \
+  __attribute__((target_clones("arch=skylake-avx512", "avx2", "sse4.1", \
+                                "default")))
+#else
+#define ENVPOOL_SIMD_CLONES
+#endif
+#endif
+
+namespace area_resize {
+
+/**
+ * Horizontal pass over one source row: dst[i] = sum_k row[index[k][i]] *
+ * weight[k][i], accumulated in order of k from zero.
+ */
+ENVPOOL_SIMD_CLONES inline void Horizontal(const float* __restrict row,
+                                           const int* __restrict index,
+                                           const float* __restrict weight,
+                                           int num_taps, int n,
+                                           float* __restrict dst) {
+  for (int i = 0; i < n; ++i) {
+    dst[i] = 0.0f;
+  }
+  for (int k = 0; k < num_taps; ++k) {
+    const int* idx = index + k * n;
+    const float* w = weight + k * n;
+    for (int i = 0; i < n; ++i) {
+      dst[i] += row[idx[i]] * w[i];
+    }
+  }
+}
+
+/**
+ * Vertical pass: sum = beta * buf for the first source row of an output row,
+ * sum += beta * buf for the others.
+ */
+ENVPOOL_SIMD_CLONES inline void Vertical(const float* __restrict buf,
+                                         float beta, bool first, int n,
+                                         float* __restrict sum) {
+  if (first) {
+    for (int i = 0; i < n; ++i) {
+      sum[i] = beta * buf[i];
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      sum[i] += beta * buf[i];
+    }
+  }
+}
+
+/**
+ * saturate_cast<uint8_t>: round half to even, then clamp.
+ */
+ENVPOOL_SIMD_CLONES inline void Store(const float* __restrict sum, int n,
+                                      uint8_t* __restrict dst) {
+  // adding 1.5 * 2^23 rounds to an integer in the default rounding mode
+  constexpr float kMagic = 12582912.0f;
+  for (int i = 0; i < n; ++i) {
+    float v = sum[i] < 0.0f ? 0.0f : sum[i];
+    v = v > 255.0f ? 255.0f : v;
+    dst[i] = static_cast<uint8_t>(static_cast<int>((v + kMagic) - kMagic));
+  }
+}
+
+}  // namespace area_resize
+
+/**
+ * cv::resize with INTER_AREA for downscaling by a non-integer factor, bit-
+ * exact with OpenCV, which does the same float computations here: every
+ * source row is reduced horizontally with the per-column taps, and the
+ * results are accumulated with the per-row taps.
+ *
+ * The source is given one row at a time by the caller as floats, so the
+ * pixels can be produced on the fly, e.g. from a palette, and never
+ * written to memory. The image is planar: row y of plane c is at
+ * c * src_width of the row, and the result is written plane after plane,
+ * i.e. (C, H, W). Rows shared by two output rows are produced once.
+ */
+class AreaResizer {
+ protected:
+  int src_height_, src_width_, dst_height_, dst_width_, num_x_taps_{0};
+  // tap k of output column i is index[k * dst_width + i], zero weight pads
+  std::vector<int> x_index_;
+  std::vector<float> x_weight_;
+  struct RowTap {
+    int dst, src;
+    float weight;
+  };
+  std::vector<RowTap> y_taps_;
+  // scratch rows of `Resize`
+  std::vector<float> row_, buf_, sum_;
+
+  // computeResizeAreaTab of OpenCV, with cn = 1
+  static std::vector<RowTap> Taps(int src_size, int dst_size) {
+    double scale = 1.0 / (static_cast<double>(dst_size) / src_size);
+    std::vector<RowTap> taps;
+    for (int d = 0; d < dst_size; ++d) {
+      double fs1 = d * scale;
+      double fs2 = fs1 + scale;
+      double cell = std::min(scale, src_size - fs1);
+      int s1 = static_cast<int>(std::ceil(fs1));
+      int s2 = static_cast<int>(std::floor(fs2));
+      s2 = std::min(s2, src_size - 1);
+      s1 = std::min(s1, s2);
+      if (s1 - fs1 > 1e-3) {
+        taps.push_back({d, s1 - 1, static_cast<float>((s1 - fs1) / cell)});
+      }
+      for (int s = s1; s < s2; ++s) {
+        taps.push_back({d, s, static_cast<float>(1.0 / cell)});
+      }
+      if (fs2 - s2 > 1e-3) {
+        taps.push_back(
+            {d, s2,
+             static_cast<float>(std::min(std::min(fs2 - s2, 1.0), cell) /
+                                cell)});
+      }
+    }
+    return taps;
+  }
+
+ public:
+  /**
+   * Whether cv::resize takes this general INTER_AREA path: downscaling
+   * along both axes, not by integer factors along both.
+   */
+  static bool Supports(int src_height, int src_width, int dst_height,
+                       int dst_width) {
+    double scale_x = 1.0 / (static_cast<double>(dst_width) / src_width);
+    double scale_y = 1.0 / (static_cast<double>(dst_height) / src_height);
+    if (scale_x < 1 || scale_y < 1) {
+      return false;
+    }
+    constexpr double kEps = std::numeric_limits<double>::epsilon();
+    return std::abs(scale_x - std::round(scale_x)) >= kEps ||
+           std::abs(scale_y - std::round(scale_y)) >= kEps;
+  }
+
+  AreaResizer(int src_height, int src_width, int dst_height, int dst_width)
+      : src_height_(src_height),
+        src_width_(src_width),
+        dst_height_(dst_height),
+        dst_width_(dst_width),
+        y_taps_(Taps(src_height, dst_height)) {
+    auto x_taps = Taps(src_width, dst_width);
+    std::vector<int> count(dst_width, 0);
+    for (const auto& tap : x_taps) {
+      num_x_taps_ = std::max(num_x_taps_, ++count[tap.dst]);
+    }
+    x_index_.assign(num_x_taps_ * dst_width, 0);
+    x_weight_.assign(num_x_taps_ * dst_width, 0.0f);
+    std::fill(count.begin(), count.end(), 0);
+    for (const auto& tap : x_taps) {
+      int k = count[tap.dst]++;
+      x_index_[k * dst_width + tap.dst] = tap.src;
+      x_weight_[k * dst_width + tap.dst] = tap.weight;
+    }
+  }
+
+  /**
+   * row_fn(y, row) writes source row y of every plane to row, src_width
+   * floats per plane; dst gets num_planes planes of dst_height * dst_width.
+   */
+  template <typename RowFn>
+  void Resize(int num_planes, RowFn&& row_fn, uint8_t* dst) {
+    row_.resize(num_planes * src_width_);
+    buf_.resize(num_planes * dst_width_);
+    sum_.resize(num_planes * dst_width_);
+    int last_src = -1;
+    std::size_t plane_size = static_cast<std::size_t>(dst_height_) * dst_width_;
+    for (std::size_t j = 0; j < y_taps_.size(); ++j) {
+      const RowTap& tap = y_taps_[j];
+      if (tap.src != last_src) {
+        row_fn(tap.src, row_.data());
+        for (int c = 0; c < num_planes; ++c) {
+          area_resize::Horizontal(row_.data() + c * src_width_,
+                                  x_index_.data(), x_weight_.data(),
+                                  num_x_taps_, dst_width_,
+                                  buf_.data() + c * dst_width_);
+        }
+        last_src = tap.src;
+      }
+      bool first = j == 0 || y_taps_[j - 1].dst != tap.dst;
+      area_resize::Vertical(buf_.data(), tap.weight, first,
+                            num_planes * dst_width_, sum_.data());
+      if (j + 1 == y_taps_.size() || y_taps_[j + 1].dst != tap.dst) {
+        for (int c = 0; c < num_planes; ++c) {
+          area_resize::Store(sum_.data() + c * dst_width_, dst_width_,
+                             dst + c * plane_size + tap.dst * dst_width_);
+        }
+      }
+    }
+  }
+};
+
+#if !defined(__clang__) && defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif  // ENVPOOL_UTILS_AREA_RESIZE_H_
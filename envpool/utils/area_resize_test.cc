@@ -0,0 +1,78 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/area_resize.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "envpool/utils/image_process.h"
+
+TEST(AreaResizeTest, Supports) {
+  EXPECT_TRUE(AreaResizer::Supports(210, 160, 84, 84));
+  EXPECT_TRUE(AreaResizer::Supports(210, 160, 105, 84));
+  // integer factors along both axes, upscaling
+  EXPECT_FALSE(AreaResizer::Supports(210, 160, 105, 80));
+  EXPECT_FALSE(AreaResizer::Supports(84, 84, 84, 84));
+  EXPECT_FALSE(AreaResizer::Supports(84, 84, 100, 64));
+}
+
+TEST(AreaResizeTest, SameAsOpenCV) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(0, 255);
+  struct Size {
+    int src_h, src_w, dst_h, dst_w, channel;
+  };
+  for (auto s : {Size{210, 160, 84, 84, 1}, Size{210, 160, 84, 84, 3},
+                 Size{210, 160, 64, 48, 1}, Size{250, 160, 72, 96, 3},
+                 Size{100, 100, 33, 41, 1}, Size{210, 160, 105, 84, 1},
+                 Size{97, 53, 20, 20, 3}}) {
+    Array src(Spec<uint8_t>({s.src_h, s.src_w, s.channel}));
+    Array expect(Spec<uint8_t>({s.dst_h, s.dst_w, s.channel}));
+    auto* pixels = static_cast<uint8_t*>(src.Data());
+    for (std::size_t i = 0; i < src.size; ++i) {
+      pixels[i] = dist(gen);
+    }
+    Resize(src, &expect);
+    ASSERT_TRUE(AreaResizer::Supports(s.src_h, s.src_w, s.dst_h, s.dst_w));
+    AreaResizer resizer(s.src_h, s.src_w, s.dst_h, s.dst_w);
+    std::vector<uint8_t> result(expect.size);
+    // run twice to check the scratch rows are reset
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      resizer.Resize(
+          s.channel,
+          [&](int y, float* row) {
+            for (int c = 0; c < s.channel; ++c) {
+              for (int x = 0; x < s.src_w; ++x) {
+                row[c * s.src_w + x] =
+                    pixels[(y * s.src_w + x) * s.channel + c];
+              }
+            }
+          },
+          result.data());
+      const auto* ptr = static_cast<const uint8_t*>(expect.Data());
+      std::size_t plane = static_cast<std::size_t>(s.dst_h) * s.dst_w;
+      for (std::size_t j = 0; j < plane; ++j) {
+        for (int c = 0; c < s.channel; ++c) {
+          ASSERT_EQ(result[c * plane + j], ptr[j * s.channel + c])
+              << s.src_h << "x" << s.src_w << " -> " << s.dst_h << "x"
+              << s.dst_w << " channel " << c << " pixel " << j;
+        }
+      }
+    }
+  }
+}
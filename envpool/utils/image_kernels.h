@@ -0,0 +1,159 @@
+/*
+ * Copyright 2023 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_IMAGE_KERNELS_H_
+#define ENVPOOL_UTILS_IMAGE_KERNELS_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// ENVPOOL_SIMD_CLONES and AreaResizer, the INTER_AREA resize
+#include "envpool/utils/area_resize.h"
+
+// same results on every instruction set, with or without FMA
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/**
+ * Pixel kernels of the env observation pipelines, on raw uint8 buffers.
+ * They are plain loops written to be auto-vectorized, and built for each
+ * instruction set of ENVPOOL_SIMD_CLONES; the best one for the running CPU
+ * is picked once, when the library is loaded. The results are the same on
+ * every instruction set, and the same as OpenCV where it has an equivalent.
+ *
+ * Images are either interleaved (H, W, C) or planar (C, H, W); n is the
+ * number of pixels H * W.
+ */
+namespace image_kernels {
+
+/**
+ * dst = max(dst, src), e.g. the max-pool of the last two Atari frames.
+ */
+ENVPOOL_SIMD_CLONES inline void MaxPool(uint8_t* __restrict dst,
+                                        const uint8_t* __restrict src,
+                                        std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    dst[i] = std::max(dst[i], src[i]);
+  }
+}
+
+ENVPOOL_SIMD_CLONES inline void Hwc3ToChw(const uint8_t* __restrict src,
+                                          std::size_t n,
+                                          uint8_t* __restrict dst) {
+  for (std::size_t i = 0; i < n; ++i) {
+    dst[i] = src[i * 3];
+    dst[n + i] = src[i * 3 + 1];
+    dst[2 * n + i] = src[i * 3 + 2];
+  }
+}
+
+ENVPOOL_SIMD_CLONES inline void Chw3ToHwc(const uint8_t* __restrict src,
+                                          std::size_t n,
+                                          uint8_t* __restrict dst) {
+  for (std::size_t i = 0; i < n; ++i) {
+    dst[i * 3] = src[i];
+    dst[i * 3 + 1] = src[n + i];
+    dst[i * 3 + 2] = src[2 * n + i];
+  }
+}
+
+/**
+ * (H, W, C) to (C, H, W), i.e. transpose(2, 0, 1).
+ */
+inline void HwcToChw(const uint8_t* src, std::size_t n, int channel,
+                     uint8_t* dst) {
+  if (channel == 3) {
+    Hwc3ToChw(src, n, dst);
+    return;
+  }
+  for (int c = 0; c < channel; ++c) {
+    for (std::size_t i = 0; i < n; ++i) {
+      dst[c * n + i] = src[i * channel + c];
+    }
+  }
+}
+
+/**
+ * (C, H, W) to (H, W, C), i.e. transpose(1, 2, 0).
+ */
+inline void ChwToHwc(const uint8_t* src, std::size_t n, int channel,
+                     uint8_t* dst) {
+  if (channel == 3) {
+    Chw3ToHwc(src, n, dst);
+    return;
+  }
+  for (int c = 0; c < channel; ++c) {
+    for (std::size_t i = 0; i < n; ++i) {
+      dst[i * channel + c] = src[c * n + i];
+    }
+  }
+}
+
+/**
+ * RGB <-> BGR of (H, W, 3) pixels, as cv::COLOR_BGR2RGB; dst may be src.
+ */
+ENVPOOL_SIMD_CLONES inline void SwapRedBlue(const uint8_t* src,
+                                            std::size_t n, uint8_t* dst) {
+  for (std::size_t i = 0; i < n; ++i) {
+    uint8_t r = src[i * 3];
+    uint8_t g = src[i * 3 + 1];
+    uint8_t b = src[i * 3 + 2];
+    dst[i * 3] = b;
+    dst[i * 3 + 1] = g;
+    dst[i * 3 + 2] = r;
+  }
+}
+
+/**
+ * Gray level of (H, W, 3) RGB pixels, bit-exact with cv::COLOR_RGB2GRAY,
+ * which uses the same 15-bit fixed-point weights.
+ */
+ENVPOOL_SIMD_CLONES inline void RgbToGray(const uint8_t* __restrict src,
+                                          std::size_t n,
+                                          uint8_t* __restrict dst) {
+  constexpr int kShift = 15;
+  constexpr int kR = 9798;
+  constexpr int kG = 19235;
+  constexpr int kB = 3735;
+  for (std::size_t i = 0; i < n; ++i) {
+    int y = src[i * 3] * kR + src[i * 3 + 1] * kG + src[i * 3 + 2] * kB;
+    dst[i] = static_cast<uint8_t>((y + (1 << (kShift - 1))) >> kShift);
+  }
+}
+
+/**
+ * dst = src * scale + bias, e.g. scale = 1 / 255 for observations in [0, 1].
+ */
+ENVPOOL_SIMD_CLONES inline void Normalize(const uint8_t* __restrict src,
+                                          std::size_t size, float scale,
+                                          float bias, float* __restrict dst) {
+  for (std::size_t i = 0; i < size; ++i) {
+    dst[i] = static_cast<float>(src[i]) * scale + bias;
+  }
+}
+
+}  // namespace image_kernels
+
+#if !defined(__clang__) && defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif  // ENVPOOL_UTILS_IMAGE_KERNELS_H_
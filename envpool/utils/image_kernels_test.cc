@@ -0,0 +1,204 @@
+// Copyright 2023 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/image_kernels.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "envpool/utils/image_process.h"
+
+namespace {
+
+std::vector<uint8_t> RandomBytes(std::size_t size, int seed = 0) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<uint8_t> bytes(size);
+  for (auto& b : bytes) {
+    b = dist(gen);
+  }
+  return bytes;
+}
+
+cv::Mat Wrap(std::vector<uint8_t>* data, int height, int width, int channel) {
+  return {height, width, CV_8UC(channel), data->data()};
+}
+
+template <typename F>
+double Seconds(int repeat, F&& f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double> dur = std::chrono::steady_clock::now() - start;
+  return dur.count();
+}
+
+}  // namespace
+
+TEST(ImageKernelsTest, MaxPool) {
+  // odd size to cover the scalar tail
+  std::size_t n = 210 * 160 * 3 + 7;
+  auto a = RandomBytes(n, 0);
+  auto b = RandomBytes(n, 1);
+  auto expect = a;
+  for (std::size_t i = 0; i < n; ++i) {
+    expect[i] = std::max(a[i], b[i]);
+  }
+  image_kernels::MaxPool(a.data(), b.data(), n);
+  EXPECT_EQ(a, expect);
+}
+
+TEST(ImageKernelsTest, Transpose) {
+  for (int channel : {1, 3, 4}) {
+    int h = 61;
+    int w = 67;
+    auto hwc = RandomBytes(h * w * channel);
+    std::vector<uint8_t> chw(hwc.size());
+    image_kernels::HwcToChw(hwc.data(), h * w, channel, chw.data());
+    // the planes of cv::split
+    std::vector<cv::Mat> planes;
+    cv::split(Wrap(&hwc, h, w, channel), planes);
+    for (int c = 0; c < channel; ++c) {
+      ASSERT_EQ(std::memcmp(chw.data() + c * h * w, planes[c].data, h * w), 0)
+          << channel << " " << c;
+    }
+    std::vector<uint8_t> back(hwc.size());
+    image_kernels::ChwToHwc(chw.data(), h * w, channel, back.data());
+    EXPECT_EQ(back, hwc) << channel;
+  }
+}
+
+TEST(ImageKernelsTest, Color) {
+  int h = 96;
+  int w = 101;
+  auto rgb = RandomBytes(h * w * 3);
+  std::vector<uint8_t> expect(rgb.size());
+  cv::Mat expect_img = Wrap(&expect, h, w, 3);
+  cv::cvtColor(Wrap(&rgb, h, w, 3), expect_img, cv::COLOR_BGR2RGB);
+  std::vector<uint8_t> bgr(rgb.size());
+  image_kernels::SwapRedBlue(rgb.data(), h * w, bgr.data());
+  EXPECT_EQ(bgr, expect);
+  // in place
+  image_kernels::SwapRedBlue(bgr.data(), h * w, bgr.data());
+  EXPECT_EQ(bgr, rgb);
+
+  std::vector<uint8_t> gray(h * w);
+  std::vector<uint8_t> expect_gray(h * w);
+  cv::Mat expect_gray_img = Wrap(&expect_gray, h, w, 1);
+  cv::cvtColor(Wrap(&rgb, h, w, 3), expect_gray_img, cv::COLOR_RGB2GRAY);
+  image_kernels::RgbToGray(rgb.data(), h * w, gray.data());
+  EXPECT_EQ(gray, expect_gray);
+}
+
+TEST(ImageKernelsTest, Normalize) {
+  std::size_t n = 1001;
+  auto bytes = RandomBytes(n);
+  std::vector<float> result(n);
+  image_kernels::Normalize(bytes.data(), n, 1.0f / 255, -0.5f, result.data());
+  for (std::size_t i = 0; i < n; ++i) {
+    float scaled = static_cast<float>(bytes[i]) * (1.0f / 255);
+    EXPECT_EQ(result[i], scaled + -0.5f);
+  }
+}
+
+TEST(ImageKernelsTest, PlanarResize) {
+  struct Size {
+    int src_h, src_w, dst_h, dst_w;
+  };
+  for (auto s : {Size{240, 320, 84, 84}, Size{120, 160, 60, 80},
+                 Size{60, 80, 84, 84}, Size{120, 160, 120, 160}}) {
+    for (bool use_inter_area : {true, false}) {
+      int channel = 3;
+      auto src = RandomBytes(channel * s.src_h * s.src_w);
+      std::vector<uint8_t> result(channel * s.dst_h * s.dst_w);
+      PlanarResizer resizer(channel, s.src_h, s.src_w, s.dst_h, s.dst_w,
+                            use_inter_area);
+      resizer.Resize(src.data(), result.data());
+      for (int c = 0; c < channel; ++c) {
+        Array plane(Spec<uint8_t>({s.src_h, s.src_w, 1}));
+        std::memcpy(plane.Data(), src.data() + c * s.src_h * s.src_w,
+                    plane.size);
+        Array expect(Spec<uint8_t>({s.dst_h, s.dst_w, 1}));
+        Resize(plane, &expect, use_inter_area);
+        EXPECT_EQ(std::memcmp(result.data() + c * expect.size, expect.Data(),
+                              expect.size),
+                  0)
+            << s.src_h << "x" << s.src_w << " -> " << s.dst_h << "x"
+            << s.dst_w << " inter_area=" << use_inter_area;
+      }
+    }
+  }
+}
+
+TEST(ImageKernelsSpeedTest, Benchmark) {
+  int repeat = 2000;
+  // Atari RGB frame
+  std::size_t n = 210 * 160;
+  auto a = RandomBytes(n * 3, 0);
+  auto b = RandomBytes(n * 3, 1);
+  std::vector<uint8_t> out(n * 3);
+  double kernel = Seconds(
+      repeat, [&] { image_kernels::MaxPool(a.data(), b.data(), n * 3); });
+  double scalar = Seconds(repeat, [&] {
+    for (std::size_t i = 0; i < n * 3; ++i) {
+      a[i] = std::max(a[i], b[i]);
+    }
+  });
+  LOG(INFO) << "MaxPool 210x160x3: " << kernel / repeat * 1e6
+            << " us, scalar loop: " << scalar / repeat * 1e6 << " us";
+  kernel = Seconds(
+      repeat, [&] { image_kernels::HwcToChw(a.data(), n, 3, out.data()); });
+  scalar = Seconds(repeat, [&] {
+    for (int c = 0; c < 3; ++c) {
+      for (std::size_t i = 0; i < n; ++i) {
+        out[c * n + i] = a[i * 3 + c];
+      }
+    }
+  });
+  LOG(INFO) << "HwcToChw 210x160x3: " << kernel / repeat * 1e6
+            << " us, scalar loop: " << scalar / repeat * 1e6 << " us";
+  cv::Mat rgb = Wrap(&a, 210, 160, 3);
+  cv::Mat gray(210, 160, CV_8UC1);
+  kernel = Seconds(
+      repeat, [&] { image_kernels::RgbToGray(a.data(), n, out.data()); });
+  double opencv =
+      Seconds(repeat, [&] { cv::cvtColor(rgb, gray, cv::COLOR_RGB2GRAY); });
+  LOG(INFO) << "RgbToGray 210x160: " << kernel / repeat * 1e6
+            << " us, cv::cvtColor: " << opencv / repeat * 1e6 << " us";
+  // ViZDoom RGB screen
+  auto screen = RandomBytes(3 * 240 * 320);
+  std::vector<uint8_t> obs(3 * 84 * 84);
+  PlanarResizer resizer(3, 240, 320, 84, 84);
+  kernel = Seconds(repeat / 10,
+                   [&] { resizer.Resize(screen.data(), obs.data()); });
+  opencv = Seconds(repeat / 10, [&] {
+    for (int c = 0; c < 3; ++c) {
+      cv::Mat src(240, 320, CV_8UC1, screen.data() + c * 240 * 320);
+      cv::Mat dst(84, 84, CV_8UC1, obs.data() + c * 84 * 84);
+      cv::resize(src, dst, dst.size(), 0, 0, cv::INTER_AREA);
+    }
+  });
+  LOG(INFO) << "PlanarResizer 3x240x320 -> 84x84: "
+            << kernel / (repeat / 10) * 1e6
+            << " us, cv::resize per plane: " << opencv / (repeat / 10) * 1e6
+            << " us";
+}
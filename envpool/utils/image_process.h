@@ -17,9 +17,13 @@
 #ifndef ENVPOOL_UTILS_IMAGE_PROCESS_H_
 #define ENVPOOL_UTILS_IMAGE_PROCESS_H_
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <opencv2/opencv.hpp>
 
 #include "envpool/core/array.h"
+#include "envpool/utils/image_kernels.h"
 
 /**
  * Resize `src` image to `tgt`. Use inplace modification to reduce overhead.
@@ -39,9 +43,70 @@ void Resize(const Array& src, Array* tgt, bool use_inter_area = true) {
  * Change src (with RGB format) to grayscale image.
  */
 void GrayScale(const Array& src, Array* tgt) {
-  cv::Mat src_img(src.Shape(0), src.Shape(1), CV_8UC3, src.Data());
-  cv::Mat tgt_img(tgt->Shape(0), tgt->Shape(1), CV_8UC1, tgt->Data());
-  cv::cvtColor(src_img, tgt_img, cv::COLOR_RGB2GRAY);
+  image_kernels::RgbToGray(static_cast<const uint8_t*>(src.Data()),
+                           src.Shape(0) * src.Shape(1),
+                           static_cast<uint8_t*>(tgt->Data()));
 }
 
+/**
+ * Resize planar (C, H, W) images, the same as resizing each plane with
+ * `Resize`. INTER_AREA downscaling is done for all planes in one pass by
+ * AreaResizer, anything else plane by plane with cv::resize.
+ */
+class PlanarResizer {
+ protected:
+  int channel_, src_height_, src_width_, dst_height_, dst_width_;
+  bool use_inter_area_;
+  std::unique_ptr<AreaResizer> area_;
+
+ public:
+  PlanarResizer(int channel, int src_height, int src_width, int dst_height,
+                int dst_width, bool use_inter_area = true)
+      : channel_(channel),
+        src_height_(src_height),
+        src_width_(src_width),
+        dst_height_(dst_height),
+        dst_width_(dst_width),
+        use_inter_area_(use_inter_area) {
+    if (use_inter_area &&
+        AreaResizer::Supports(src_height, src_width, dst_height, dst_width)) {
+      area_ = std::make_unique<AreaResizer>(src_height, src_width,
+                                            dst_height, dst_width);
+    }
+  }
+
+  void Resize(const uint8_t* src, uint8_t* dst) {
+    std::size_t src_plane = static_cast<std::size_t>(src_height_) * src_width_;
+    std::size_t dst_plane = static_cast<std::size_t>(dst_height_) * dst_width_;
+    if (src_height_ == dst_height_ && src_width_ == dst_width_) {
+      std::memcpy(dst, src, channel_ * src_plane);
+      return;
+    }
+    if (area_ != nullptr) {
+      area_->Resize(
+          channel_,
+          [&](int y, float* row) {
+            for (int c = 0; c < channel_; ++c) {
+              const uint8_t* line = src + c * src_plane + y * src_width_;
+              for (int x = 0; x < src_width_; ++x) {
+                row[c * src_width_ + x] = line[x];
+              }
+            }
+          },
+          dst);
+      return;
+    }
+    for (int c = 0; c < channel_; ++c) {
+      cv::Mat src_img(src_height_, src_width_, CV_8UC1,
+                      const_cast<uint8_t*>(src + c * src_plane));
+      cv::Mat tgt_img(dst_height_, dst_width_, CV_8UC1, dst + c * dst_plane);
+      if (use_inter_area_) {
+        cv::resize(src_img, tgt_img, tgt_img.size(), 0, 0, cv::INTER_AREA);
+      } else {
+        cv::resize(src_img, tgt_img, tgt_img.size());
+      }
+    }
+  }
+};
+
 #endif  // ENVPOOL_UTILS_IMAGE_PROCESS_H_
@@ -20,6 +20,7 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -40,6 +41,71 @@ std::string MergePath(const std::string& base_path,
   return base_path + "/" + file_path;
 }
 
+struct CfgInfo {
+  int screen_channels;
+  std::vector<Button> buttons;
+};
+
+struct Resolution {
+  ScreenResolution value;
+  int width, height;
+};
+
+// the engine resolutions up to 640x480, see ScreenResolution
+const std::vector<Resolution> kResolutions = {
+    {RES_160X120, 160, 120}, {RES_200X125, 200, 125}, {RES_200X150, 200, 150},
+    {RES_256X144, 256, 144}, {RES_256X160, 256, 160}, {RES_256X192, 256, 192},
+    {RES_320X180, 320, 180}, {RES_320X200, 320, 200}, {RES_320X240, 320, 240},
+    {RES_320X256, 320, 256}, {RES_400X225, 400, 225}, {RES_400X250, 400, 250},
+    {RES_400X300, 400, 300}, {RES_512X288, 512, 288}, {RES_512X320, 512, 320},
+    {RES_512X384, 512, 384}, {RES_640X360, 640, 360}, {RES_640X400, 640, 400},
+    {RES_640X480, 640, 480}};
+
+/**
+ * The smallest engine resolution of at least height x width, preferably with
+ * the aspect ratio of the cfg one so that the view is the same; nullptr if
+ * it would not be smaller than the cfg one.
+ */
+const Resolution* NativeResolution(int height, int width, int cfg_height,
+                                   int cfg_width) {
+  const Resolution* best = nullptr;
+  auto key = [&](const Resolution& r) {
+    // same aspect ratio first, then the smallest
+    return std::make_pair(r.width * cfg_height != r.height * cfg_width,
+                          r.width * r.height);
+  };
+  for (const auto& r : kResolutions) {
+    if (r.width >= width && r.height >= height &&
+        (best == nullptr || key(r) < key(*best))) {
+      best = &r;
+    }
+  }
+  if (best == nullptr || best->width * best->height >= cfg_width * cfg_height) {
+    return nullptr;
+  }
+  return best;
+}
+
+/**
+ * What the specs need from a cfg file. Parsing it with a DoomGame per call is
+ * slow, so it is done once per cfg per process.
+ */
+const CfgInfo& GetCfgInfo(const std::string& cfg_path) {
+  static std::mutex mutex;
+  static std::map<std::string, CfgInfo> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = cache.find(cfg_path);
+  if (it == cache.end()) {
+    DoomGame dg;
+    dg.loadConfig(cfg_path);
+    it = cache
+             .emplace(cfg_path,
+                      CfgInfo{dg.getScreenChannels(), dg.getAvailableButtons()})
+             .first;
+  }
+  return it->second;
+}
+
 class VizdoomEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
@@ -77,16 +143,20 @@ class VizdoomEnvFns {
         "vzd_path"_.Bind(std::string("vizdoom/bin/vizdoom")),
         "iwad_path"_.Bind(std::string("vizdoom/bin/freedoom2")),
         "game_args"_.Bind(std::string("")),
-        "map_id"_.Bind(std::string("map01")));
+        "map_id"_.Bind(std::string("map01")), "frame_dedup"_.Bind(false),
+        "gray_scale"_.Bind(false), "native_resolution"_.Bind(false));
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    DoomGame dg;
-    dg.loadConfig(conf["cfg_path"_]);
+    const auto& cfg = GetCfgInfo(conf["cfg_path"_]);
+    int num_frames = conf["frame_dedup"_] ? 1 : conf["stack_num"_];
+    int channel = conf["gray_scale"_] ? 1 : cfg.screen_channels;
+    // the game variables must stay the last keys, see `WriteState`
     return MakeDict(
-        "obs"_.Bind(Spec<uint8_t>({conf["stack_num"_] * dg.getScreenChannels(),
+        "obs"_.Bind(Spec<uint8_t>({num_frames * channel,
                                    conf["img_height"_], conf["img_width"_]},
                                   {0, 255})),
+        "info:frame_index"_.Bind(Spec<int>({-1})),
         "info:AMMO2"_.Bind(Spec<double>({-1})),
         "info:AMMO3"_.Bind(Spec<double>({-1})),
         "info:AMMO4"_.Bind(Spec<double>({-1})),
@@ -106,13 +176,11 @@ class VizdoomEnvFns {
   }
   template <typename Config>
   static decltype(auto) ActionSpec(const Config& conf) {
-    DoomGame dg;
-    dg.loadConfig(conf["cfg_path"_]);
+    const auto& button_list = GetCfgInfo(conf["cfg_path"_]).buttons;
     if (!conf["use_combined_action"_]) {
-      return MakeDict("action"_.Bind(Spec<double>(
-          {-1, static_cast<int>(dg.getAvailableButtons().size())})));
+      return MakeDict("action"_.Bind(
+          Spec<double>({-1, static_cast<int>(button_list.size())})));
     }
-    auto button_list = dg.getAvailableButtons();
     std::vector<std::tuple<int, float, float>> delta_config(
         button_string_list.size());
     for (auto& i : conf["delta_button_config"_]) {
@@ -139,11 +207,15 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
   //  "DAMAGECOUNT", "DEATHCOUNT", "FRAGCOUNT", "HEALTH", "HITCOUNT",
   //  "KILLCOUNT", "SELECTED_WEAPON", "SELECTED_WEAPON_AMMO", "USER2"});
   std::unique_ptr<DoomGame> dg_;
-  Array raw_buf_;
+  // all channels of the channel-first screen to the stack frame size
+  std::unique_ptr<PlanarResizer> resizer_;
   std::deque<Array> stack_buf_;
   std::string lmp_dir_;
   bool save_lmp_, episodic_life_, use_combined_action_, use_inter_area_resize_;
+  bool frame_dedup_;
   bool done_{true};
+  // frames pushed to stack_buf_ since it was last filled by a reset
+  int frame_index_{0};
   int max_episode_steps_, elapsed_step_, stack_num_, frame_skip_,
       episode_count_{0}, channel_;
   int deathcount_idx_, hitcount_idx_, damagecount_idx_;  // bugged var
@@ -165,6 +237,7 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
         episodic_life_(spec.config["episodic_life"_]),
         use_combined_action_(spec.config["use_combined_action"_]),
         use_inter_area_resize_(spec.config["use_inter_area_resize"_]),
+        frame_dedup_(spec.config["frame_dedup"_]),
         max_episode_steps_(spec.config["max_episode_steps"_]),
         elapsed_step_(max_episode_steps_ + 1),
         stack_num_(spec.config["stack_num"_]),
@@ -189,10 +262,24 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
     }
     dg_->setSeed(spec.config["seed"_]);
     dg_->setDoomMap(spec.config["map_id"_]);
+    // let the engine render the screen that is the cheapest to resize
+    if (spec.config["gray_scale"_]) {
+      dg_->setScreenFormat(GRAY8);
+    }
+    if (spec.config["native_resolution"_]) {
+      const auto* res = NativeResolution(
+          spec.config["img_height"_], spec.config["img_width"_],
+          dg_->getScreenHeight(), dg_->getScreenWidth());
+      if (res != nullptr) {
+        dg_->setScreenResolution(res->value);
+      }
+    }
 
     channel_ = dg_->getScreenChannels();
-    raw_buf_ =
-        Array(FrameSpec({dg_->getScreenHeight(), dg_->getScreenWidth(), 1}));
+    resizer_ = std::make_unique<PlanarResizer>(
+        channel_, dg_->getScreenHeight(), dg_->getScreenWidth(),
+        spec.config["img_height"_], spec.config["img_width"_],
+        use_inter_area_resize_);
     for (int i = 0; i < stack_num_; ++i) {
       stack_buf_.emplace_back(Array(FrameSpec(
           {channel_, spec.config["img_height"_], spec.config["img_width"_]})));
@@ -311,7 +398,8 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
   void GetState(bool is_reset) {
     GameStatePtr gamestate = dg_->getState();
     if (gamestate == nullptr) {  // finish episode
-      WriteState(0.0);
+      State state = WriteState(0.0);
+      WriteObs(&state);
       return;
     }
 
@@ -394,22 +482,26 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
       reward += weapon_reward_[selected_weapon_];
     }
 
+    State state = WriteState(reward);
+    // gamestate owns the screen buffer, keep it alive until the deferred
+    // resize is done
+    Defer([this, state, gamestate, is_reset]() mutable {
+      PushStack(gamestate->screenBuffer->data(), is_reset);
+      WriteObs(&state);
+    });
+  }
+
+  void PushStack(const uint8_t* screen, bool push_all) {
     Array tgt = std::move(*stack_buf_.begin());
     auto* ptr = static_cast<uint8_t*>(tgt.Data());
     stack_buf_.pop_front();
 
-    // get screen
-    auto* raw_ptr = static_cast<uint8_t*>(raw_buf_.Data());
-    std::size_t size = raw_buf_.size;
-    for (int c = 0; c < channel_; ++c) {
-      // gamestate->screenBuffer is channel-first image
-      std::memcpy(raw_ptr, gamestate->screenBuffer->data() + c * size, size);
-      auto slice = tgt[c];
-      Resize(raw_buf_, &slice, use_inter_area_resize_);
-    }
-    size = tgt.size;
+    // screen is channel-first image
+    resizer_->Resize(screen, ptr);
+    std::size_t size = tgt.size;
     stack_buf_.emplace_back(tgt);
-    if (is_reset) {
+    frame_index_ = push_all ? 0 : frame_index_ + 1;
+    if (push_all) {
       for (auto& s : stack_buf_) {
         auto* ptr_s = static_cast<uint8_t*>(s.Data());
         if (ptr != ptr_s) {
@@ -417,18 +509,12 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
         }
       }
     }
-    WriteState(reward);
   }
 
-  void WriteState(float reward) {
+  State WriteState(float reward) {
     State state = Allocate();
     auto state_array = state.AllValues<Array>();
     state["reward"_] = reward;
-    for (int i = 0; i < stack_num_; ++i) {
-      state["obs"_]
-          .Slice(i * channel_, (i + 1) * channel_)
-          .Assign(stack_buf_[i]);
-    }
     // info
     double zero = 0.0;
     std::size_t offset = state_array.size() - gv_info_index_.size();
@@ -439,6 +525,24 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
         state_array[i + offset][0] = zero;
       }
     }
+    return state;
+  }
+
+  /**
+   * With frame_dedup, obs is only the newest frame, and info:frame_index
+   * tells where it goes in the stack, see `envpool.python.frame_stack`.
+   */
+  void WriteObs(State* state) {
+    (*state)["info:frame_index"_] = frame_index_;
+    if (frame_dedup_) {
+      (*state)["obs"_].Assign(stack_buf_.back());
+      return;
+    }
+    for (int i = 0; i < stack_num_; ++i) {
+      (*state)["obs"_]
+          .Slice(i * channel_, (i + 1) * channel_)
+          .Assign(stack_buf_[i]);
+    }
   }
 };
 
@@ -14,12 +14,15 @@
 """Unit tests for vizdoom environments."""
 
 import os
+import time
 
 import cv2
 import numpy as np
+from absl import logging
 from absl.testing import absltest
 
 import envpool.vizdoom.registration  # noqa: F401
+from envpool.python.frame_stack import FrameStacker
 from envpool.registration import make_dm, make_gym
 
 
@@ -148,6 +151,60 @@ class _VizdoomEnvPoolBasicTest(absltest.TestCase):
     assert e.step(np.array([0]),
                   np.array([0])).observation.obs.shape[1] == 1 * 4
 
+  def test_frame_dedup(self) -> None:
+    num_envs = 3
+    kwargs = dict(
+      num_envs=num_envs, use_combined_action=True, max_episode_steps=50
+    )
+    env0 = make_gym("D1Basic-v1", **kwargs)
+    env1 = make_gym("D1Basic-v1", frame_dedup=True, **kwargs)
+    self.assertEqual(env1.observation_space.shape, (1, 84, 84))
+    stacker = FrameStacker(num_envs, 4, (1, 84, 84))
+    obs0, _ = env0.reset()
+    obs1, info = env1.reset()
+    np.testing.assert_array_equal(
+      obs0, stacker(obs1, info["env_id"], info["frame_index"])
+    )
+    for _ in range(200):
+      action = np.random.randint(env0.action_space.n, size=num_envs)
+      obs0 = env0.step(action)[0]
+      obs1, _, _, _, info = env1.step(action)
+      np.testing.assert_array_equal(
+        obs0, stacker(obs1, info["env_id"], info["frame_index"])
+      )
+
+  def test_native_resolution(self) -> None:
+    kwargs = dict(use_combined_action=True, max_episode_steps=50)
+    env0 = make_gym("HealthGathering-v1", **kwargs)
+    env1 = make_gym(
+      "HealthGathering-v1", gray_scale=True, native_resolution=True, **kwargs
+    )
+    self.assertEqual(env0.observation_space.shape, (3 * 4, 84, 84))
+    self.assertEqual(env1.observation_space.shape, (1 * 4, 84, 84))
+    obs0, _ = env0.reset()
+    obs1, _ = env1.reset()
+    self.assertEqual(obs1.shape, (1, 4, 84, 84))
+    for _ in range(100):
+      action = np.random.randint(env0.action_space.n, size=1)
+      obs0, rew0 = env0.step(action)[:2]
+      obs1, rew1 = env1.step(action)[:2]
+      # the same game, only rendered differently
+      np.testing.assert_allclose(rew0, rew1)
+      self.assertGreater(obs1.std(), 0)
+
+  def test_benchmark(self, num_envs: int = 4, total: int = 500) -> None:
+    for task_id in ["HealthGathering-v1", "D1Basic-v1"]:
+      for kwargs in [{}, dict(gray_scale=True, native_resolution=True)]:
+        env = make_gym(
+          task_id, num_envs=num_envs, use_combined_action=True, **kwargs
+        )
+        env.reset()
+        start = time.time()
+        for _ in range(total):
+          env.step(np.random.randint(env.action_space.n, size=num_envs))
+        fps = total * num_envs / (time.time() - start)
+        logging.info(f"{task_id} {kwargs}: {fps:.0f} steps/s")
+
 
 if __name__ == "__main__":
   absltest.main()